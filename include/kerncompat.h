@@ -233,6 +233,49 @@ static inline int test_bit(int nr, const volatile unsigned long *addr)
 	return 1UL & (addr[BITOP_WORD(nr)] >> (nr & (BITS_PER_LONG-1)));
 }
 
+/**
+ * ffz - find first zero bit in word
+ * @word: the word to search
+ *
+ * Undefined if no zero exists, so code should check against ~0UL first.
+ */
+static inline unsigned long ffz(unsigned long word)
+{
+	return __builtin_ctzl(~word);
+}
+
+#define BITMAP_FIRST_WORD_MASK(start) (~0UL << ((start) & (BITS_PER_LONG - 1)))
+#define BITMAP_LAST_WORD_MASK(nbits) (~0UL >> (-(nbits) & (BITS_PER_LONG - 1)))
+
+/**
+ * __bitmap_set - set a range of bits in memory
+ * @map: the address to start counting from
+ * @start: the first bit to set
+ * @len: number of bits to set
+ *
+ * The whole words of the range are set by one store.
+ */
+static inline void __bitmap_set(unsigned long *map, unsigned int start, int len)
+{
+	unsigned long *p = map + BITOP_WORD(start);
+	const unsigned int size = start + len;
+	int bits_to_set = BITS_PER_LONG - (start % BITS_PER_LONG);
+	unsigned long mask_to_set = BITMAP_FIRST_WORD_MASK(start);
+
+	while (len - bits_to_set >= 0) {
+		*p |= mask_to_set;
+		len -= bits_to_set;
+		bits_to_set = BITS_PER_LONG;
+		mask_to_set = ~0UL;
+		p++;
+	}
+
+	if (len) {
+		mask_to_set &= BITMAP_LAST_WORD_MASK(size);
+		*p |= mask_to_set;
+	}
+}
+
 /*
  * non-constant log of base 2 calculators
  */
@@ -0,0 +1,49 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ *
+ * ssdfs-utils -- SSDFS file system utilities.
+ *
+ * include/maptbl.h - PEB mapping table declarations.
+ *
+ * Copyright (c) 2014-2019 HGST, a Western Digital Company.
+ *              http://www.hgst.com/
+ * Copyright (c) 2014-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ *
+ * (C) Copyright 2014-2019, HGST, Inc., All rights reserved.
+ *
+ * Created by HGST, San Jose Research Center, Storage Architecture Group
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ *
+ * Acknowledgement: Cyril Guyot
+ *                  Zvonimir Bandic
+ */
+
+#ifndef _SSDFS_MAPTBL_H
+#define _SSDFS_MAPTBL_H
+
+/* lib/maptbl.c */
+u16 DEFINE_PEB_INDEX_IN_PORTION(u16 stripe_index, u16 item_index);
+void ssdfs_maptbl_prepare_lebtbl_fragment(u8 *ptr, u64 pebs_per_volume,
+					  u16 lebs_per_portion,
+					  u16 portion_index,
+					  u16 mempage_index);
+void ssdfs_maptbl_prepare_pebtbl_fragment(u8 *ptr, u64 pebs_per_volume,
+					  u64 pebs_per_portion,
+					  u16 stripes_per_portion,
+					  u16 reserved_pebs_pct,
+					  u16 portion_index,
+					  u16 stripe_index);
+void ssdfs_maptbl_define_pebs_as_used(u8 *pebtbl, u16 peb_index, u16 count,
+				      int peb_type, int peb_state);
+void ssdfs_maptbl_define_pebs_as_pre_erased(u8 *pebtbl, u16 peb_index,
+					    u16 count);
+void ssdfs_maptbl_define_lebs_as_mapped(u8 *lebtbl, u16 leb_desc_index,
+					u16 physical_index, u16 count);
+void ssdfs_maptbl_define_leb_as_migrating(u8 *lebtbl, u16 leb_desc_index,
+					  u16 physical_index,
+					  u16 relation_index);
+void ssdfs_maptbl_calculate_lebtbl_checksum(u8 *ptr);
+void ssdfs_maptbl_calculate_pebtbl_checksum(u8 *ptr);
+
+#endif /* _SSDFS_MAPTBL_H */
@@ -112,6 +112,26 @@ struct ssdfs_time_range {
 #define SSDFS_ANY_MONTH				U32_MAX
 #define SSDFS_ANY_YEAR				U32_MAX
 
+/*
+ * struct ssdfs_inode_id_range - range of inode IDs
+ * @start: first inode ID in the range
+ * @end: last inode ID in the range (inclusive)
+ */
+struct ssdfs_inode_id_range {
+	u64 start;
+	u64 end;
+};
+
+/*
+ * struct ssdfs_inode_filter - filter of inode IDs
+ * @ranges: sorted array of non-overlapping inode ID ranges
+ * @count: number of ranges in the array (zero means any inode)
+ */
+struct ssdfs_inode_filter {
+	struct ssdfs_inode_id_range *ranges;
+	int count;
+};
+
 /*
  * struct ssdfs_environment - tool's environment
  * @show_info: show info messages
@@ -253,6 +273,9 @@ struct ssdfs_raw_area_environment {
  * @seg_hdr: segment header area
  * @desc: array of log's area descriptors
  * @content: extracted dump of data
+ * @log.offset: offset of prefetched log's content from PEB's beginning
+ * @log.size: size of prefetched log's content in bytes
+ * @log.buffer: buffer with prefetched log's content
  */
 struct ssdfs_raw_dump_environment {
 	u64 peb_offset;
@@ -261,6 +284,12 @@ struct ssdfs_raw_dump_environment {
 	struct ssdfs_raw_area_environment desc[SSDFS_SEG_HDR_DESC_MAX];
 
 	struct ssdfs_raw_buffer content;
+
+	struct {
+		u32 offset;
+		u32 size;
+		struct ssdfs_raw_buffer buffer;
+	} log;
 };
 
 #define SSDFS_CONTENT_BUFFER(area) \
@@ -282,6 +311,8 @@ struct ssdfs_raw_dump_environment {
 					area_index)->area.content.uncompressed))
 #define SSDFS_DUMP_DATA(dump_env) \
 	((struct ssdfs_raw_buffer *)(&dump_env->content))
+#define SSDFS_PREFETCHED_LOG(dump_env) \
+	((struct ssdfs_raw_buffer *)(&dump_env->log.buffer))
 
 union ssdfs_metadata_header {
 	struct ssdfs_segment_header seg_hdr;
@@ -334,6 +365,7 @@ struct ssdfs_file_environment {
  * @seg_id: segment ID
  * @leb_id: LEB ID
  * @peb_id: PEB ID
+ * @relation_peb_id: source PEB ID during migration
  * @type: PEB type
  * @index: PEB index in segment
  * @peb_creation_timestamp: PEB creation timestamp
@@ -343,6 +375,7 @@ struct ssdfs_metadata_peb_item {
 	u64 seg_id;
 	u64 leb_id;
 	u64 peb_id;
+	u64 relation_peb_id;
 	int type;
 	u64 peb_creation_timestamp;
 	u64 volume_creation_timestamp;
@@ -373,6 +406,7 @@ struct ssdfs_metadata_map {
  * @checkpoint_folder: checkpoint folder environment
  * @data_file: data file environment
  * @timestamp: timestamp defining the state of files
+ * @inode_filter: inode IDs that should be recovered
  * @metadata_map: metadata map
  *
  * @name_buf: name buffer
@@ -389,6 +423,7 @@ struct ssdfs_thread_state {
 	struct ssdfs_folder_environment checkpoint_folder;
 	struct ssdfs_file_environment data_file;
 	struct ssdfs_time_range timestamp;
+	struct ssdfs_inode_filter inode_filter;
 	struct ssdfs_metadata_map metadata_map;
 
 	char name_buf[SSDFS_MAX_NAME_LEN + 1];
@@ -1329,6 +1364,7 @@ int zns_check_nand_geometry(int fd, struct ssdfs_nand_geometry *info,
 			    int is_debug);
 int zns_check_peb(int fd, u64 offset, u32 erasesize,
 		  int need_close_zone, int is_debug);
+int zns_get_max_active_zones(int fd, u32 *max_active_zones, int is_debug);
 
 static const struct ssdfs_device_ops mtd_ops = {
 	.read = mtd_read,
@@ -0,0 +1,403 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ *
+ * ssdfs-utils -- SSDFS file system utilities.
+ *
+ * lib/maptbl.c - PEB mapping table functionality.
+ *
+ * Copyright (c) 2014-2019 HGST, a Western Digital Company.
+ *              http://www.hgst.com/
+ * Copyright (c) 2014-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ *
+ * (C) Copyright 2014-2019, HGST, Inc., All rights reserved.
+ *
+ * Created by HGST, San Jose Research Center, Storage Architecture Group
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ *
+ * Acknowledgement: Cyril Guyot
+ *                  Zvonimir Bandic
+ */
+
+#include "ssdfs_tools.h"
+#include "maptbl.h"
+
+u16 DEFINE_PEB_INDEX_IN_PORTION(u16 stripe_index, u16 item_index)
+{
+	u32 peb_index;
+
+	peb_index = SSDFS_PEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
+	peb_index *= stripe_index;
+	peb_index += item_index;
+
+	BUG_ON(peb_index >= U16_MAX);
+
+	return (u16)peb_index;
+}
+
+/*
+ * ssdfs_maptbl_prepare_lebtbl_fragment() - prepare LEB table's fragment
+ * @ptr: pointer on memory page of the fragment
+ * @pebs_per_volume: number of PEBs in the volume
+ * @lebs_per_portion: number of LEBs in the portion
+ * @portion_index: index of the portion
+ * @mempage_index: index of memory page in the LEB table of portion
+ *
+ * This method initializes the header of the fragment and
+ * marks all LEB descriptors of the fragment as unmapped.
+ */
+void ssdfs_maptbl_prepare_lebtbl_fragment(u8 *ptr, u64 pebs_per_volume,
+					  u16 lebs_per_portion,
+					  u16 portion_index,
+					  u16 mempage_index)
+{
+	struct ssdfs_leb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
+	u32 leb_desc_per_mempage;
+	u64 start_portion_leb;
+	u64 start_fragment_leb;
+	u64 lebs_count;
+	u32 bytes_count;
+
+	leb_desc_per_mempage = SSDFS_LEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
+
+	start_portion_leb = (u64)lebs_per_portion * portion_index;
+	start_fragment_leb = start_portion_leb +
+				((u64)leb_desc_per_mempage * mempage_index);
+
+	if (pebs_per_volume <= start_fragment_leb)
+		lebs_count = 0;
+	else {
+		lebs_count = pebs_per_volume - start_fragment_leb;
+		lebs_count = min_t(u64, lebs_count, lebs_per_portion);
+		lebs_count = min_t(u64, lebs_count, leb_desc_per_mempage);
+	}
+
+	bytes_count = hdr_size;
+	bytes_count += lebs_count * sizeof(struct ssdfs_leb_descriptor);
+
+	hdr = (struct ssdfs_leb_table_fragment_header *)ptr;
+
+	hdr->magic = cpu_to_le16(SSDFS_LEB_TABLE_MAGIC);
+	hdr->flags = 0;
+
+	if (mempage_index == 0)
+		hdr->start_leb = cpu_to_le64(start_portion_leb);
+	else
+		hdr->start_leb = cpu_to_le64(start_fragment_leb);
+
+	BUG_ON(lebs_count >= U16_MAX);
+	hdr->lebs_count = cpu_to_le16(lebs_count);
+
+	hdr->mapped_lebs = 0;
+	hdr->migrating_lebs = 0;
+
+	hdr->portion_id = cpu_to_le16(portion_index);
+	hdr->fragment_id = cpu_to_le16(mempage_index);
+
+	hdr->bytes_count = cpu_to_le32(bytes_count);
+
+	memset(ptr + hdr_size, 0xFF, PAGE_CACHE_SIZE - hdr_size);
+}
+
+/*
+ * ssdfs_maptbl_prepare_pebtbl_fragment() - prepare PEB table's fragment
+ * @ptr: pointer on memory page of the stripe
+ * @pebs_per_volume: number of PEBs in the volume
+ * @pebs_per_portion: number of PEBs in the portion
+ * @stripes_per_portion: number of stripes in the portion
+ * @reserved_pebs_pct: percentage of reserved PEBs in the stripe
+ * @portion_index: index of the portion
+ * @stripe_index: index of the stripe in the portion
+ *
+ * This method initializes the header of the stripe. PEB descriptors
+ * and bitmaps of the stripe are expected to be zeroed by the caller.
+ */
+void ssdfs_maptbl_prepare_pebtbl_fragment(u8 *ptr, u64 pebs_per_volume,
+					  u64 pebs_per_portion,
+					  u16 stripes_per_portion,
+					  u16 reserved_pebs_pct,
+					  u16 portion_index,
+					  u16 stripe_index)
+{
+	struct ssdfs_peb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	u64 reserved_pebs;
+	u32 peb_desc_per_stripe;
+	u64 start_peb;
+	u64 pebs_count;
+	u32 bytes_count;
+	u64 rest_pebs;
+
+	BUG_ON(stripe_index >= stripes_per_portion);
+
+	rest_pebs = pebs_per_volume - (pebs_per_portion * portion_index);
+	rest_pebs = min_t(u64, rest_pebs, pebs_per_portion);
+
+	peb_desc_per_stripe = rest_pebs / stripes_per_portion;
+	if (rest_pebs % stripes_per_portion)
+		peb_desc_per_stripe++;
+
+	start_peb = ((u64)pebs_per_portion * portion_index) +
+			((u64)peb_desc_per_stripe * stripe_index);
+
+	if (pebs_per_volume <= start_peb)
+		pebs_count = 0;
+	else {
+		pebs_count = pebs_per_volume -
+			(pebs_per_portion * portion_index);
+		pebs_count = min_t(u64, pebs_count, pebs_per_portion);
+		pebs_count += pebs_count % stripes_per_portion;
+		pebs_count /= stripes_per_portion;
+
+		if ((start_peb + pebs_count) > pebs_per_volume)
+			pebs_count = pebs_per_volume - start_peb;
+	}
+
+	bytes_count = hdr_size;
+	bytes_count += pebs_count * sizeof(struct ssdfs_peb_descriptor);
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)ptr;
+
+	hdr->magic = cpu_to_le16(SSDFS_PEB_TABLE_MAGIC);
+	hdr->flags = 0;
+
+	hdr->recover_months = SSDFS_PEB_RECOVER_MONTHS_DEFAULT;
+	hdr->recover_threshold = SSDFS_PEBTBL_FIRST_RECOVER_TRY;
+
+	hdr->start_peb = cpu_to_le64(start_peb);
+	BUG_ON(pebs_count >= U16_MAX);
+	hdr->pebs_count = cpu_to_le16(pebs_count);
+
+	reserved_pebs = (pebs_count * reserved_pebs_pct) / 100;
+	BUG_ON(reserved_pebs >= U16_MAX);
+	hdr->last_selected_peb = cpu_to_le16(0);
+	hdr->reserved_pebs = cpu_to_le16((u16)reserved_pebs);
+
+	hdr->stripe_id = cpu_to_le16(stripe_index);
+	hdr->portion_id = cpu_to_le16(portion_index);
+	hdr->fragment_id = cpu_to_le16(stripe_index);
+
+	hdr->bytes_count = cpu_to_le32(bytes_count);
+}
+
+/*
+ * ssdfs_maptbl_define_pebs_as_used() - mark sequence of PEBs as used
+ * @pebtbl: pointer on PEB table's stripe
+ * @peb_index: index of the first PEB in the stripe
+ * @count: number of PEBs in the sequence
+ * @peb_type: PEB type (SSDFS_MAPTBL_*_PEB_TYPE)
+ * @peb_state: PEB state (SSDFS_MAPTBL_*_STATE)
+ */
+void ssdfs_maptbl_define_pebs_as_used(u8 *pebtbl, u16 peb_index, u16 count,
+				      int peb_type, int peb_state)
+{
+	struct ssdfs_peb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	struct ssdfs_peb_descriptor *desc_array, *desc;
+	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
+	u16 pebs_count;
+	u16 last_selected_peb;
+	unsigned long *bmap;
+	u32 bytes_count;
+	u16 i;
+
+	BUG_ON(peb_type <= SSDFS_MAPTBL_UNKNOWN_PEB_TYPE ||
+		peb_type >= SSDFS_MAPTBL_PEB_TYPE_MAX);
+	BUG_ON(peb_state <= SSDFS_MAPTBL_UNKNOWN_PEB_STATE ||
+		peb_state >= SSDFS_MAPTBL_PEB_STATE_MAX);
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
+	BUG_ON(hdr->magic != cpu_to_le16(SSDFS_PEB_TABLE_MAGIC));
+	pebs_count = le16_to_cpu(hdr->pebs_count);
+	last_selected_peb = le16_to_cpu(hdr->last_selected_peb);
+	BUG_ON(last_selected_peb >= pebs_count);
+	BUG_ON(count == 0);
+	BUG_ON(((u32)peb_index + count) > pebs_count);
+	bytes_count = le32_to_cpu(hdr->bytes_count);
+
+	BUG_ON(bytes_count != (hdr_size + (pebs_count * desc_size)));
+
+	desc_array = (struct ssdfs_peb_descriptor *)(pebtbl + hdr_size);
+
+	for (i = 0; i < count; i++) {
+		desc = &desc_array[peb_index + i];
+
+		BUG_ON(le8_to_cpu(desc->state) !=
+				SSDFS_MAPTBL_UNKNOWN_PEB_STATE);
+		BUG_ON(le8_to_cpu(desc->type) !=
+				SSDFS_MAPTBL_UNKNOWN_PEB_TYPE);
+
+		desc->type = cpu_to_le8((u8)peb_type);
+		desc->state = cpu_to_le8((u8)peb_state);
+	}
+
+	hdr->last_selected_peb = cpu_to_le16(last_selected_peb);
+
+	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
+	__bitmap_set(bmap, peb_index, count);
+}
+
+/*
+ * ssdfs_maptbl_define_pebs_as_pre_erased() - mark PEBs as pre-erased
+ * @pebtbl: pointer on PEB table's stripe
+ * @peb_index: index of the first PEB in the stripe
+ * @count: number of PEBs in the sequence
+ */
+void ssdfs_maptbl_define_pebs_as_pre_erased(u8 *pebtbl, u16 peb_index,
+					    u16 count)
+{
+	struct ssdfs_peb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	struct ssdfs_peb_descriptor *desc_array, *desc;
+	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
+	unsigned long *bmap;
+	u16 pebs_count;
+	u16 last_selected_peb;
+	u32 bytes_count;
+	u16 i;
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
+	BUG_ON(hdr->magic != cpu_to_le16(SSDFS_PEB_TABLE_MAGIC));
+	pebs_count = le16_to_cpu(hdr->pebs_count);
+	last_selected_peb = le16_to_cpu(hdr->last_selected_peb);
+	BUG_ON(last_selected_peb >= pebs_count);
+	BUG_ON(count == 0);
+	BUG_ON(((u32)peb_index + count) > pebs_count);
+	bytes_count = le32_to_cpu(hdr->bytes_count);
+
+	BUG_ON(bytes_count != (hdr_size + (pebs_count * desc_size)));
+
+	desc_array = (struct ssdfs_peb_descriptor *)(pebtbl + hdr_size);
+
+	for (i = 0; i < count; i++) {
+		desc = &desc_array[peb_index + i];
+
+		BUG_ON(le8_to_cpu(desc->state) !=
+				SSDFS_MAPTBL_UNKNOWN_PEB_STATE);
+		BUG_ON(le8_to_cpu(desc->type) !=
+				SSDFS_MAPTBL_UNKNOWN_PEB_TYPE);
+
+		desc->type = cpu_to_le8(SSDFS_MAPTBL_UNKNOWN_PEB_TYPE);
+		desc->state = cpu_to_le8(SSDFS_MAPTBL_PRE_ERASE_STATE);
+	}
+
+	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_DIRTY_BMAP][0];
+	__bitmap_set(bmap, peb_index, count);
+}
+
+static
+struct ssdfs_leb_descriptor *
+ssdfs_maptbl_get_leb_desc_array(u8 *lebtbl, u16 leb_desc_index, u16 count)
+{
+	struct ssdfs_leb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
+	size_t desc_size = sizeof(struct ssdfs_leb_descriptor);
+	u16 lebs_count;
+	u16 mapped_lebs, migrating_lebs;
+	u32 bytes_count;
+
+	hdr = (struct ssdfs_leb_table_fragment_header *)lebtbl;
+	BUG_ON(hdr->magic != cpu_to_le16(SSDFS_LEB_TABLE_MAGIC));
+
+	lebs_count = le16_to_cpu(hdr->lebs_count);
+	BUG_ON(lebs_count == 0);
+	mapped_lebs = le16_to_cpu(hdr->mapped_lebs);
+	BUG_ON(mapped_lebs > lebs_count);
+	migrating_lebs = le16_to_cpu(hdr->migrating_lebs);
+	BUG_ON(migrating_lebs > lebs_count);
+	BUG_ON((mapped_lebs + migrating_lebs + count) > lebs_count);
+	BUG_ON(((u32)leb_desc_index + count) > lebs_count);
+	bytes_count = le32_to_cpu(hdr->bytes_count);
+	BUG_ON(bytes_count != (hdr_size + (lebs_count * desc_size)));
+
+	return (struct ssdfs_leb_descriptor *)(lebtbl + hdr_size);
+}
+
+/*
+ * ssdfs_maptbl_define_lebs_as_mapped() - map sequence of LEBs
+ * @lebtbl: pointer on LEB table's fragment
+ * @leb_desc_index: index of the first LEB in the fragment
+ * @physical_index: index of the first PEB in the portion
+ * @count: number of LEBs in the sequence
+ */
+void ssdfs_maptbl_define_lebs_as_mapped(u8 *lebtbl, u16 leb_desc_index,
+					u16 physical_index, u16 count)
+{
+	struct ssdfs_leb_table_fragment_header *hdr;
+	struct ssdfs_leb_descriptor *desc_array, *desc;
+	u16 i;
+
+	desc_array = ssdfs_maptbl_get_leb_desc_array(lebtbl, leb_desc_index,
+						     count);
+
+	for (i = 0; i < count; i++) {
+		desc = &desc_array[leb_desc_index + i];
+
+		desc->physical_index = cpu_to_le16(physical_index + i);
+		desc->relation_index = cpu_to_le16(U16_MAX);
+	}
+
+	hdr = (struct ssdfs_leb_table_fragment_header *)lebtbl;
+	hdr->mapped_lebs = cpu_to_le16(le16_to_cpu(hdr->mapped_lebs) + count);
+}
+
+/*
+ * ssdfs_maptbl_define_leb_as_migrating() - map LEB under migration
+ * @lebtbl: pointer on LEB table's fragment
+ * @leb_desc_index: index of LEB in the fragment
+ * @physical_index: index of source PEB in the portion
+ * @relation_index: index of destination PEB in the portion
+ */
+void ssdfs_maptbl_define_leb_as_migrating(u8 *lebtbl, u16 leb_desc_index,
+					  u16 physical_index,
+					  u16 relation_index)
+{
+	struct ssdfs_leb_table_fragment_header *hdr;
+	struct ssdfs_leb_descriptor *desc_array, *desc;
+
+	desc_array = ssdfs_maptbl_get_leb_desc_array(lebtbl, leb_desc_index, 1);
+
+	desc = &desc_array[leb_desc_index];
+	desc->physical_index = cpu_to_le16(physical_index);
+	desc->relation_index = cpu_to_le16(relation_index);
+
+	hdr = (struct ssdfs_leb_table_fragment_header *)lebtbl;
+	hdr->migrating_lebs = cpu_to_le16(le16_to_cpu(hdr->migrating_lebs) + 1);
+}
+
+void ssdfs_maptbl_calculate_lebtbl_checksum(u8 *ptr)
+{
+	struct ssdfs_leb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
+	u32 bytes_count;
+
+	hdr = (struct ssdfs_leb_table_fragment_header *)ptr;
+
+	BUG_ON(le16_to_cpu(hdr->magic) != SSDFS_LEB_TABLE_MAGIC);
+
+	bytes_count = le32_to_cpu(hdr->bytes_count);
+
+	BUG_ON(bytes_count < hdr_size);
+
+	hdr->checksum = 0;
+	hdr->checksum = ssdfs_crc32_le(ptr, bytes_count);
+}
+
+void ssdfs_maptbl_calculate_pebtbl_checksum(u8 *ptr)
+{
+	struct ssdfs_peb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	u32 bytes_count;
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)ptr;
+
+	BUG_ON(le16_to_cpu(hdr->magic) != SSDFS_PEB_TABLE_MAGIC);
+
+	bytes_count = le32_to_cpu(hdr->bytes_count);
+
+	BUG_ON(bytes_count < hdr_size);
+
+	hdr->checksum = 0;
+	hdr->checksum = ssdfs_crc32_le(ptr, bytes_count);
+}
@@ -498,6 +498,10 @@ int ssdfs_create_raw_dump_environment(struct ssdfs_environment *env,
 
 	ssdfs_create_raw_buffer(&raw_dump->content, 0);
 
+	raw_dump->log.offset = U32_MAX;
+	raw_dump->log.size = 0;
+	ssdfs_create_raw_buffer(&raw_dump->log.buffer, 0);
+
 	return 0;
 
 free_buffers:
@@ -546,6 +550,7 @@ void ssdfs_destroy_raw_dump_environment(struct ssdfs_raw_dump_environment *env)
 		}
 
 		ssdfs_destroy_raw_buffer(&env->content);
+		ssdfs_destroy_raw_buffer(&env->log.buffer);
 
 		memset(env, 0, sizeof(struct ssdfs_raw_dump_environment));
 	}
@@ -12,6 +12,10 @@
  * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
  */
 
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <stdio.h>
+#include <limits.h>
 #include <linux/fs.h>
 #include <linux/blkzoned.h>
 
@@ -226,3 +230,74 @@ int zns_check_peb(int fd, u64 offset, u32 erasesize,
 
 	return 0;
 }
+
+static int zns_read_queue_limit(int fd, const char *name, u32 *value)
+{
+	struct stat st;
+	char path[PATH_MAX];
+	FILE *fp;
+	int res;
+
+	if (fstat(fd, &st) < 0)
+		return -errno;
+
+	if (!S_ISBLK(st.st_mode))
+		return -ENOTBLK;
+
+	snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/queue/%s",
+		 major(st.st_rdev), minor(st.st_rdev), name);
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return -errno;
+
+	res = fscanf(fp, "%u", value);
+	fclose(fp);
+
+	return res == 1 ? 0 : -EIO;
+}
+
+/*
+ * zns_get_max_active_zones() - get limit of active zones
+ * @fd: file descriptor of ZNS device
+ * @max_active_zones: limit of active zones [out]
+ * @is_debug: show debug output?
+ *
+ * This method retrieves the limit of active zones from sysfs. If the
+ * device has no active zones limit, then the open zones limit is used.
+ * The zero value means that the device has no limits at all.
+ *
+ * RETURN:
+ * [success] - @max_active_zones contains the limit.
+ * [failure] - error code:
+ *
+ * %-ENOTBLK    - file is not a block device.
+ * %-ENOENT     - sysfs has no information about the device.
+ */
+int zns_get_max_active_zones(int fd, u32 *max_active_zones, int is_debug)
+{
+	u32 max_open_zones = 0;
+	int err;
+
+	*max_active_zones = 0;
+
+	err = zns_read_queue_limit(fd, "max_active_zones", max_active_zones);
+	if (err) {
+		SSDFS_DBG(is_debug,
+			  "fail to get max_active_zones: err %d\n", err);
+		return err;
+	}
+
+	if (*max_active_zones == 0) {
+		err = zns_read_queue_limit(fd, "max_open_zones",
+					   &max_open_zones);
+		if (!err)
+			*max_active_zones = max_open_zones;
+	}
+
+	SSDFS_DBG(is_debug,
+		  "max_active_zones %u, max_open_zones %u\n",
+		  *max_active_zones, max_open_zones);
+
+	return 0;
+}
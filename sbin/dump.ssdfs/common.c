@@ -23,11 +23,19 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdarg.h>
 
 #include "dumpfs.h"
 
 #define SSDFS_DUMPFS_PEB_SEARCH_SHIFT	(1)
 
+static const char *ssdfs_dumpfs_file_extension[SSDFS_DUMPFS_FORMAT_MAX] = {
+	[SSDFS_DUMPFS_TEXT_FORMAT]	= "txt",
+	[SSDFS_DUMPFS_JSON_FORMAT]	= "json",
+	[SSDFS_DUMPFS_CBOR_FORMAT]	= "cbor",
+	[SSDFS_DUMPFS_BINARY_FORMAT]	= "bin",
+};
+
 int ssdfs_dumpfs_open_file(struct ssdfs_dumpfs_environment *env,
 			   char *file_name)
 {
@@ -47,9 +55,10 @@ int ssdfs_dumpfs_open_file(struct ssdfs_dumpfs_environment *env,
 	if (env->output_folder == NULL) {
 		if (file_name == NULL) {
 			snprintf(buf, SSDFS_DUMPFS_PATH_LEN - 1,
-				 "peb-%llu-log-%u-dump.txt",
+				 "peb-%llu-log-%u-dump.%s",
 				 env->peb.id,
-				 env->peb.log_index);
+				 env->peb.log_index,
+				 ssdfs_dumpfs_file_extension[env->format]);
 		} else {
 			snprintf(buf, SSDFS_DUMPFS_PATH_LEN - 1,
 				 "%s", file_name);
@@ -57,10 +66,11 @@ int ssdfs_dumpfs_open_file(struct ssdfs_dumpfs_environment *env,
 	} else {
 		if (file_name == NULL) {
 			snprintf(buf, SSDFS_DUMPFS_PATH_LEN - 1,
-				 "%s/peb-%llu-log-%u-dump.txt",
+				 "%s/peb-%llu-log-%u-dump.%s",
 				 env->output_folder,
 				 env->peb.id,
-				 env->peb.log_index);
+				 env->peb.log_index,
+				 ssdfs_dumpfs_file_extension[env->format]);
 		} else {
 			snprintf(buf, SSDFS_DUMPFS_PATH_LEN - 1,
 				 "%s/%s",
@@ -93,119 +103,400 @@ void ssdfs_dumpfs_close_file(struct ssdfs_dumpfs_environment *env)
 	if (!env->dump_into_files)
 		return;
 
+	ssdfs_dumpfs_flush_output(env);
+
 	fclose(env->stream);
 	close(env->fd);
 }
 
-int ssdfs_dumpfs_read_blk_desc_array(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf)
+/*
+ * ssdfs_dumpfs_output_reserve() - reserve space in output buffer
+ * @env: dumpfs environment
+ * @len: number of bytes for reservation
+ *
+ * This method returns pointer on @len contiguous bytes at the end
+ * of output buffer. The next chunk is used if the current one hasn't
+ * enough space and the output is flushed if all chunks are full.
+ * The caller should call ssdfs_dumpfs_output_commit() for bytes
+ * that have been really used.
+ *
+ * RETURN:
+ * [success] - pointer on reserved space.
+ * [failure] - NULL.
+ */
+char *ssdfs_dumpfs_output_reserve(struct ssdfs_dumpfs_environment *env,
+				  u32 len)
 {
-	u64 offset;
-	int err;
+	struct ssdfs_dumpfs_output_buffer *output = &env->output;
+	struct iovec *chunk;
 
-	SSDFS_DBG(env->base.show_debug,
-		  "peb_id: %llu, peb_size %u\n",
-		  peb_id, peb_size);
+	if (len > SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE) {
+		SSDFS_ERR("len %u > chunk size %u\n",
+			  len, SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE);
+		return NULL;
+	}
 
-	offset = peb_id * peb_size;
-	offset += area_offset;
+	if (output->count > 0) {
+		chunk = &output->chunks[output->count - 1];
 
-	err = env->base.dev_ops->read(env->base.fd, offset, size,
-				      buf, env->base.show_debug);
-	if (err) {
-		SSDFS_ERR("fail to read block descriptors array: "
-			  "offset %llu, err %d\n",
-			  offset, err);
-		return err;
+		if ((SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE - chunk->iov_len) >= len)
+			return (char *)chunk->iov_base + chunk->iov_len;
 	}
 
-	return 0;
+	if (output->count >= SSDFS_DUMPFS_OUTPUT_CHUNKS_MAX) {
+		if (ssdfs_dumpfs_flush_output(env))
+			return NULL;
+	}
+
+	chunk = &output->chunks[output->count];
+
+	if (output->count >= output->allocated) {
+		chunk->iov_base = malloc(SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE);
+		if (!chunk->iov_base) {
+			SSDFS_ERR("fail to allocate output chunk\n");
+			return NULL;
+		}
+
+		output->allocated++;
+	}
+
+	chunk->iov_len = 0;
+	output->count++;
+
+	return chunk->iov_base;
 }
 
-int ssdfs_dumpfs_read_blk2off_table(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf)
+void ssdfs_dumpfs_output_commit(struct ssdfs_dumpfs_environment *env,
+				u32 len)
 {
-	u64 offset;
-	int err;
+	struct ssdfs_dumpfs_output_buffer *output = &env->output;
 
-	SSDFS_DBG(env->base.show_debug,
-		  "peb_id: %llu, peb_size %u\n",
-		  peb_id, peb_size);
+	BUG_ON(output->count == 0);
 
-	offset = peb_id * peb_size;
-	offset += area_offset;
+	output->chunks[output->count - 1].iov_len += len;
+}
 
-	err = env->base.dev_ops->read(env->base.fd, offset, size,
-				      buf, env->base.show_debug);
-	if (err) {
-		SSDFS_ERR("fail to read blk2off table: "
-			  "offset %llu, err %d\n",
-			  offset, err);
-		return err;
+/*
+ * ssdfs_dumpfs_output_write() - add bytes into output buffer
+ * @env: dumpfs environment
+ * @ptr: pointer on bytes
+ * @len: number of bytes
+ *
+ * RETURN:
+ * [success] - number of added bytes.
+ * [failure] - error code.
+ */
+int ssdfs_dumpfs_output_write(struct ssdfs_dumpfs_environment *env,
+			      const void *ptr, size_t len)
+{
+	const char *src = (const char *)ptr;
+	size_t written = 0;
+
+	while (written < len) {
+		struct iovec *chunk;
+		size_t room;
+		char *dst;
+
+		dst = ssdfs_dumpfs_output_reserve(env, 1);
+		if (!dst)
+			return -ENOMEM;
+
+		chunk = &env->output.chunks[env->output.count - 1];
+		room = SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE - chunk->iov_len;
+		room = min_t(size_t, room, len - written);
+
+		memcpy(dst, src + written, room);
+		ssdfs_dumpfs_output_commit(env, (u32)room);
+		written += room;
 	}
 
-	return 0;
+	return (int)min_t(size_t, written, INT_MAX);
 }
 
-int ssdfs_dumpfs_read_block_bitmap(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf)
+/*
+ * ssdfs_dumpfs_output_printf() - add formatted string into output buffer
+ * @env: dumpfs environment
+ * @fmt: format string
+ *
+ * String is formatted directly into the output chunk.
+ *
+ * RETURN:
+ * [success] - number of added bytes.
+ * [failure] - error code.
+ */
+int ssdfs_dumpfs_output_printf(struct ssdfs_dumpfs_environment *env,
+				const char *fmt, ...)
 {
-	u64 offset;
-	int err;
+	struct iovec *chunk;
+	va_list args;
+	char *dst;
+	char *str = NULL;
+	u32 room;
+	int len;
+
+	dst = ssdfs_dumpfs_output_reserve(env, 1);
+	if (!dst)
+		return -ENOMEM;
+
+	chunk = &env->output.chunks[env->output.count - 1];
+	room = SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE - chunk->iov_len;
+
+	va_start(args, fmt);
+	len = vsnprintf(dst, room, fmt, args);
+	va_end(args);
+
+	if (len < 0)
+		return len;
+	else if ((u32)len < room)
+		goto commit_string;
+
+	if ((u32)len < SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE) {
+		/* string is placed into the next chunk */
+		dst = ssdfs_dumpfs_output_reserve(env, (u32)len + 1);
+		if (!dst)
+			return -ENOMEM;
+
+		va_start(args, fmt);
+		len = vsnprintf(dst, (u32)len + 1, fmt, args);
+		va_end(args);
+
+		goto commit_string;
+	}
 
-	SSDFS_DBG(env->base.show_debug,
-		  "peb_id: %llu, peb_size %u\n",
-		  peb_id, peb_size);
+	str = malloc((size_t)len + 1);
+	if (!str)
+		return -ENOMEM;
 
-	offset = peb_id * peb_size;
-	offset += area_offset;
+	va_start(args, fmt);
+	len = vsnprintf(str, (size_t)len + 1, fmt, args);
+	va_end(args);
 
-	err = env->base.dev_ops->read(env->base.fd, offset, size,
-				      buf, env->base.show_debug);
-	if (err) {
-		SSDFS_ERR("fail to read block bitmap: "
-			  "offset %llu, err %d\n",
-			  offset, err);
-		return err;
+	if (len < 0) {
+		free(str);
+		return len;
 	}
 
-	return 0;
+	len = ssdfs_dumpfs_output_write(env, str, len);
+	free(str);
+	return len;
+
+commit_string:
+	ssdfs_dumpfs_output_commit(env, (u32)len);
+	return len;
+}
+
+/*
+ * ssdfs_dumpfs_flush_output() - write output buffer
+ * @env: dumpfs environment
+ *
+ * This method writes all chunks of output buffer by one writev()
+ * into the opened file, into the private stream of thread or
+ * into standard output.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_dumpfs_flush_output(struct ssdfs_dumpfs_environment *env)
+{
+	struct ssdfs_dumpfs_output_buffer *output = &env->output;
+	struct iovec chunks[SSDFS_DUMPFS_OUTPUT_CHUNKS_MAX];
+	struct iovec *iov = chunks;
+	int iovcnt = output->count;
+	FILE *stream;
+	int fd;
+	int i;
+	int err = 0;
+
+	if (output->count == 0)
+		return 0;
+
+	if (env->dump_into_files) {
+		stream = env->stream;
+		fd = env->fd;
+	} else if (env->peb_output) {
+		for (i = 0; i < output->count; i++) {
+			struct iovec *chunk = &output->chunks[i];
+
+			if (fwrite(chunk->iov_base, 1, chunk->iov_len,
+				   env->peb_output) != chunk->iov_len) {
+				err = EIO;
+				SSDFS_ERR("fail to write output\n");
+				goto reset_output;
+			}
+		}
+
+		goto reset_output;
+	} else {
+		stream = stdout;
+		fd = STDOUT_FILENO;
+	}
+
+	if (!stream || fd < 0) {
+		err = EBADF;
+		SSDFS_ERR("output file is not opened\n");
+		goto reset_output;
+	}
+
+	/* text of stream should precede the buffered output */
+	fflush(stream);
+
+	memcpy(chunks, output->chunks, sizeof(struct iovec) * iovcnt);
+
+	while (iovcnt > 0) {
+		ssize_t written = writev(fd, iov, iovcnt);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+
+			err = errno;
+			SSDFS_ERR("fail to write output: %s\n",
+				  strerror(errno));
+			goto reset_output;
+		}
+
+		while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt > 0) {
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+reset_output:
+	for (i = 0; i < output->count; i++)
+		output->chunks[i].iov_len = 0;
+
+	output->count = 0;
+
+	return err;
+}
+
+void ssdfs_dumpfs_free_output(struct ssdfs_dumpfs_environment *env)
+{
+	struct ssdfs_dumpfs_output_buffer *output = &env->output;
+	int i;
+
+	for (i = 0; i < output->allocated; i++)
+		free(output->chunks[i].iov_base);
+
+	memset(output, 0, sizeof(struct ssdfs_dumpfs_output_buffer));
+}
+
+/*
+ * ssdfs_dumpfs_forget_areas() - forget the read areas of the log
+ * @env: pointer on environment
+ */
+void ssdfs_dumpfs_forget_areas(struct ssdfs_dumpfs_environment *env)
+{
+	struct ssdfs_dumpfs_area_directory *dir = &env->area_dir;
+	int i;
+
+	for (i = 0; i < dir->count; i++)
+		free(dir->areas[i].buf);
+
+	memset(dir, 0, sizeof(struct ssdfs_dumpfs_area_directory));
 }
 
-int ssdfs_dumpfs_read_maptbl_cache(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf)
+/*
+ * ssdfs_dumpfs_get_area() - get content of the log's area
+ * @env: pointer on environment
+ * @area_offset: area offset in PEB in bytes
+ * @area_size: area size in bytes
+ * @area_buf: pointer on area's content [out]
+ *
+ * This function reads the area of the current log on the first
+ * request only. The next requests of the same area receive
+ * the content from the area directory. The returned buffer
+ * belongs to the directory and it cannot be modified or freed
+ * by the caller.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-ENOSPC     - area directory is full.
+ * %-EIO        - fail to read the area.
+ */
+int ssdfs_dumpfs_get_area(struct ssdfs_dumpfs_environment *env,
+			  u32 area_offset, u32 area_size,
+			  void **area_buf)
 {
+	struct ssdfs_dumpfs_area_directory *dir = &env->area_dir;
+	struct ssdfs_dumpfs_area *area;
 	u64 offset;
+	int i;
 	int err;
 
 	SSDFS_DBG(env->base.show_debug,
-		  "peb_id: %llu, peb_size %u\n",
-		  peb_id, peb_size);
+		  "peb_id %llu, log_offset %u, "
+		  "area_offset %u, area_size %u\n",
+		  env->peb.id, env->peb.log_offset,
+		  area_offset, area_size);
 
-	offset = peb_id * peb_size;
+	*area_buf = NULL;
+
+	if (dir->count > 0 &&
+	    (dir->peb_id != env->peb.id ||
+	     dir->log_offset != env->peb.log_offset)) {
+		ssdfs_dumpfs_forget_areas(env);
+	}
+
+	for (i = 0; i < dir->count; i++) {
+		area = &dir->areas[i];
+
+		if (area->offset == area_offset &&
+		    area->size == area_size) {
+			*area_buf = area->buf;
+			return 0;
+		}
+	}
+
+	if (dir->count >= SSDFS_DUMPFS_AREA_DIR_CAPACITY) {
+		SSDFS_ERR("area directory is full: count %u\n",
+			  dir->count);
+		return -ENOSPC;
+	}
+
+	area = &dir->areas[dir->count];
+
+	area->buf = malloc(area_size);
+	if (!area->buf) {
+		SSDFS_ERR("fail to allocate memory: "
+			  "size %u\n", area_size);
+		return -ENOMEM;
+	}
+
+	memset(area->buf, 0, area_size);
+
+	offset = env->peb.id * env->peb.peb_size;
 	offset += area_offset;
 
-	err = env->base.dev_ops->read(env->base.fd, offset, size,
-				      buf, env->base.show_debug);
+	err = env->base.dev_ops->read(env->base.fd, offset, area_size,
+				      area->buf, env->base.show_debug);
 	if (err) {
-		SSDFS_ERR("fail to read mapping table cache: "
-			  "offset %llu, err %d\n",
-			  offset, err);
+		SSDFS_ERR("fail to read area: "
+			  "offset %llu, size %u, err %d\n",
+			  offset, area_size, err);
+		free(area->buf);
+		area->buf = NULL;
 		return err;
 	}
 
+	area->offset = area_offset;
+	area->size = area_size;
+
+	dir->peb_id = env->peb.id;
+	dir->log_offset = env->peb.log_offset;
+	dir->count++;
+
+	*area_buf = area->buf;
 	return 0;
 }
 
@@ -237,59 +528,111 @@ int ssdfs_dumpfs_read_logical_block(struct ssdfs_dumpfs_environment *env,
 	return 0;
 }
 
-int ssdfs_dumpfs_read_log_footer(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf)
+/*
+ * ssdfs_dumpfs_unpack_fragment() - get uncompressed content of fragment
+ * @env: pointer on environment
+ * @frag: fragment descriptor
+ * @data: fragment's content on volume
+ * @fragment: pointer on uncompressed content [out]
+ * @uncompr_data: allocated buffer that should be freed by caller [out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_dumpfs_unpack_fragment(struct ssdfs_dumpfs_environment *env,
+				 struct ssdfs_fragment_desc *frag,
+				 u8 *data, u8 **fragment,
+				 u8 **uncompr_data)
 {
-	u64 offset;
+	u32 compr_size = le16_to_cpu(frag->compr_size);
+	u32 uncompr_size = le16_to_cpu(frag->uncompr_size);
 	int err;
 
-	SSDFS_DBG(env->base.show_debug,
-		  "peb_id: %llu, peb_size %u\n",
-		  peb_id, peb_size);
+	*fragment = data;
+	*uncompr_data = NULL;
 
-	offset = peb_id * peb_size;
-	offset += area_offset;
+	switch (frag->type) {
+	case SSDFS_FRAGMENT_UNCOMPR_BLOB:
+	case SSDFS_DATA_BLK_DESC:
+	case SSDFS_BLK2OFF_EXTENT_DESC:
+	case SSDFS_BLK2OFF_DESC:
+		return 0;
 
-	err = env->base.dev_ops->read(env->base.fd, offset, size,
-				      buf, env->base.show_debug);
-	if (err) {
-		SSDFS_ERR("fail to read log footer: "
-			  "offset %llu, err %d\n",
-			  offset, err);
-		return err;
+	case SSDFS_FRAGMENT_ZLIB_BLOB:
+	case SSDFS_DATA_BLK_DESC_ZLIB:
+	case SSDFS_BLK2OFF_EXTENT_DESC_ZLIB:
+	case SSDFS_BLK2OFF_DESC_ZLIB:
+	case SSDFS_FRAGMENT_LZO_BLOB:
+	case SSDFS_DATA_BLK_DESC_LZO:
+	case SSDFS_BLK2OFF_EXTENT_DESC_LZO:
+	case SSDFS_BLK2OFF_DESC_LZO:
+	case SSDFS_FRAGMENT_LZ4_BLOB:
+	case SSDFS_DATA_BLK_DESC_LZ4:
+	case SSDFS_BLK2OFF_EXTENT_DESC_LZ4:
+	case SSDFS_BLK2OFF_DESC_LZ4:
+	case SSDFS_FRAGMENT_ZSTD_BLOB:
+	case SSDFS_DATA_BLK_DESC_ZSTD:
+	case SSDFS_BLK2OFF_EXTENT_DESC_ZSTD:
+	case SSDFS_BLK2OFF_DESC_ZSTD:
+		/* decompress below */
+		break;
+
+	default:
+		SSDFS_ERR("unexpected fragment type %#x\n",
+			  frag->type);
+		return -ERANGE;
 	}
 
-	return 0;
-}
-
-int ssdfs_dumpfs_read_partial_log_footer(struct ssdfs_dumpfs_environment *env,
-					 u64 peb_id, u32 peb_size,
-					 u32 log_offset, u32 log_size,
-					 u32 area_offset, u32 size,
-					 void *buf)
-{
-	u64 offset;
-	int err;
-
-	SSDFS_DBG(env->base.show_debug,
-		  "peb_id: %llu, peb_size %u\n",
-		  peb_id, peb_size);
+	*uncompr_data = malloc(uncompr_size);
+	if (!*uncompr_data) {
+		SSDFS_ERR("fail to allocate memory\n");
+		return -ENOMEM;
+	}
 
-	offset = peb_id * peb_size;
-	offset += area_offset;
+	switch (frag->type) {
+	case SSDFS_FRAGMENT_ZLIB_BLOB:
+	case SSDFS_DATA_BLK_DESC_ZLIB:
+	case SSDFS_BLK2OFF_EXTENT_DESC_ZLIB:
+	case SSDFS_BLK2OFF_DESC_ZLIB:
+		err = ssdfs_zlib_decompress(data, *uncompr_data,
+					    compr_size, uncompr_size,
+					    env->base.show_debug);
+		break;
+
+	case SSDFS_FRAGMENT_LZO_BLOB:
+	case SSDFS_DATA_BLK_DESC_LZO:
+	case SSDFS_BLK2OFF_EXTENT_DESC_LZO:
+	case SSDFS_BLK2OFF_DESC_LZO:
+		err = ssdfs_lzo_decompress(data, *uncompr_data,
+					   compr_size, uncompr_size,
+					   env->base.show_debug);
+		break;
+
+	case SSDFS_FRAGMENT_LZ4_BLOB:
+	case SSDFS_DATA_BLK_DESC_LZ4:
+	case SSDFS_BLK2OFF_EXTENT_DESC_LZ4:
+	case SSDFS_BLK2OFF_DESC_LZ4:
+		err = ssdfs_lz4_decompress(data, *uncompr_data,
+					   compr_size, uncompr_size,
+					   env->base.show_debug);
+		break;
+
+	default:
+		err = ssdfs_zstd_decompress(data, *uncompr_data,
+					    compr_size, uncompr_size,
+					    env->base.show_debug);
+		break;
+	}
 
-	err = env->base.dev_ops->read(env->base.fd, offset, size,
-				      buf, env->base.show_debug);
 	if (err) {
-		SSDFS_ERR("fail to read partial log footer: "
-			  "offset %llu, err %d\n",
-			  offset, err);
+		SSDFS_ERR("fail to decompress: err %d\n", err);
+		free(*uncompr_data);
+		*uncompr_data = NULL;
 		return err;
 	}
 
+	*fragment = *uncompr_data;
 	return 0;
 }
 
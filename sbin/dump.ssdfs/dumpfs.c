@@ -81,6 +81,7 @@ int main(int argc, char *argv[])
 		.peb.show_all_logs = SSDFS_TRUE,
 		.peb.log_offset = 0,
 		.peb.log_size = U32_MAX,
+		.peb.log_size_inherited = SSDFS_FALSE,
 		.peb.log_index = 0,
 		.peb.logs_count = U32_MAX,
 		.peb.parse_flags = 0,
@@ -94,6 +95,11 @@ int main(int argc, char *argv[])
 		.stream = NULL,
 		.output_folder = NULL,
 		.dump_into_files = SSDFS_FALSE,
+		.threads = SSDFS_DUMPFS_DEFAULT_THREADS,
+		.peb_output = NULL,
+		.format = SSDFS_DUMPFS_TEXT_FORMAT,
+		.filter.areas = 0,
+		.filter.blk_id = U32_MAX,
 	};
 	struct ssdfs_dumpfs_environment *env_ptr;
 	int err = 0;
@@ -135,6 +141,10 @@ int main(int argc, char *argv[])
 		err = ssdfs_dumpfs_show_peb_dump(env_ptr);
 		break;
 
+	case SSDFS_DUMP_STATS_COMMAND:
+		err = ssdfs_dumpfs_show_volume_stats(env_ptr);
+		break;
+
 	case SSDFS_RAW_DUMP_COMMAND:
 		err = ssdfs_dumpfs_open_file(env_ptr, "raw_dump.bin");
 		if (err) {
@@ -159,6 +169,9 @@ close_opened_file:
 	}
 
 destroy_buffers:
+	ssdfs_dumpfs_flush_output(env_ptr);
+	ssdfs_dumpfs_free_output(env_ptr);
+	ssdfs_dumpfs_forget_areas(env_ptr);
 	ssdfs_dumpfs_destroy_buffers(env_ptr);
 
 close_device:
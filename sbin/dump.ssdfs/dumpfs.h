@@ -30,7 +30,11 @@
 
 #define dumpfs_fmt(fmt) "dump.ssdfs: " SSDFS_UTILS_VERSION ": " fmt
 
+#include <pthread.h>
+#include <sys/uio.h>
+
 #include "ssdfs_tools.h"
+#include "blkbmap.h"
 
 #define SSDFS_DUMPFS_INFO(show, fmt, ...) \
 	do { \
@@ -43,6 +47,7 @@ enum SSDFS_DUMPFS_COMMANDS {
 	SSDFS_DUMP_GRANULARITY_COMMAND,
 	SSDFS_DUMP_PEB_COMMAND,
 	SSDFS_RAW_DUMP_COMMAND,
+	SSDFS_DUMP_STATS_COMMAND,
 	SSDFS_DUMP_COMMAND_MAX
 };
 
@@ -58,6 +63,14 @@ enum SSDFS_DUMPFS_PARSE_FLAGS {
 	SSDFS_PARSE_FLAGS_MAX		= 0xFF
 };
 
+enum SSDFS_DUMPFS_OUTPUT_FORMATS {
+	SSDFS_DUMPFS_TEXT_FORMAT,
+	SSDFS_DUMPFS_JSON_FORMAT,
+	SSDFS_DUMPFS_CBOR_FORMAT,
+	SSDFS_DUMPFS_BINARY_FORMAT,
+	SSDFS_DUMPFS_FORMAT_MAX
+};
+
 #define SSDFS_PARSE_ALL_MASK \
 	(SSDFS_PARSE_HEADER | SSDFS_PARSE_LOG_FOOTER | \
 	 SSDFS_PARSE_BLOCK_BITMAP | SSDFS_PARSE_BLK2OFF_TABLE | \
@@ -72,6 +85,7 @@ enum SSDFS_DUMPFS_PARSE_FLAGS {
  * @show_all_logs: should all logs be shown?
  * @log_offset: log offset in bytes
  * @log_size: log's size in bytes
+ * @log_size_inherited: log's size is inherited from previous PEB
  * @log_index: index of extracting log
  * @logs_count: count of logs in the range
  * @parse_flags: what should be parsed?
@@ -84,6 +98,7 @@ struct ssdfs_peb_dump_environment {
 	int show_all_logs;
 	u32 log_offset;
 	u32 log_size;
+	int log_size_inherited;
 	u32 log_index;
 	u32 logs_count;
 
@@ -105,6 +120,147 @@ struct ssdfs_dumpfs_raw_dump_environment {
 	u32 buf_size;
 };
 
+#define SSDFS_DUMPFS_OUTPUT_CHUNK_SIZE		(256 * 1024)
+#define SSDFS_DUMPFS_OUTPUT_CHUNKS_MAX		(64)
+
+/*
+ * struct ssdfs_dumpfs_output_buffer - buffered text output
+ * @chunks: memory chunks with prepared output
+ * @count: number of chunks with output
+ * @allocated: number of allocated chunks
+ *
+ * Output is collected in chunks and it is written by one
+ * writev() when log's dump is finished or all chunks are full.
+ */
+struct ssdfs_dumpfs_output_buffer {
+	struct iovec chunks[SSDFS_DUMPFS_OUTPUT_CHUNKS_MAX];
+	u32 count;
+	u32 allocated;
+};
+
+/*
+ * struct ssdfs_dumpfs_filter - filter of PEB dump
+ * @areas: mask of areas that should be parsed (0 means any)
+ * @blk_id: logical block for lookup (U32_MAX means any)
+ */
+struct ssdfs_dumpfs_filter {
+	u32 areas;
+	u32 blk_id;
+};
+
+#define SSDFS_DUMPFS_BLK_FILTER(env) \
+	((env)->filter.blk_id != U32_MAX)
+
+#define SSDFS_DUMPFS_AREA_DIR_CAPACITY \
+	(SSDFS_SEG_HDR_DESC_MAX + SSDFS_LOG_FOOTER_DESC_MAX)
+
+/*
+ * struct ssdfs_dumpfs_area - area of log
+ * @offset: area offset in PEB in bytes
+ * @size: area size in bytes
+ * @buf: area's content
+ */
+struct ssdfs_dumpfs_area {
+	u32 offset;
+	u32 size;
+	void *buf;
+};
+
+/*
+ * struct ssdfs_dumpfs_area_directory - directory of log's areas
+ * @peb_id: PEB's identification number
+ * @log_offset: log offset in bytes
+ * @count: number of read areas
+ * @areas: read areas of the log
+ *
+ * Area is read on the first access only and every formatter
+ * of the log shares the same area's content.
+ */
+struct ssdfs_dumpfs_area_directory {
+	u64 peb_id;
+	u32 log_offset;
+	u32 count;
+	struct ssdfs_dumpfs_area areas[SSDFS_DUMPFS_AREA_DIR_CAPACITY];
+};
+
+/* Areas with compression statistics */
+enum {
+	SSDFS_DUMPFS_BLK_BMAP_STATS,
+	SSDFS_DUMPFS_BLK2OFF_STATS,
+	SSDFS_DUMPFS_BLK_DESC_STATS,
+	SSDFS_DUMPFS_COMPR_STATS_MAX
+};
+
+/*
+ * struct ssdfs_dumpfs_compr_stats - compression statistics of area
+ * @fragments: number of fragments
+ * @compr_bytes: size of fragments on volume in bytes
+ * @uncompr_bytes: size of uncompressed fragments in bytes
+ */
+struct ssdfs_dumpfs_compr_stats {
+	u64 fragments;
+	u64 compr_bytes;
+	u64 uncompr_bytes;
+};
+
+/*
+ * struct ssdfs_dumpfs_maptbl_stats - PEB table fragment's statistics
+ * @start_peb: starting PEB of the fragment
+ * @cno: checkpoint of the log that stores the fragment
+ * @peb_id: PEB that stores the fragment
+ * @states: number of PEBs in every state
+ */
+struct ssdfs_dumpfs_maptbl_stats {
+	u64 start_peb;
+	u64 cno;
+	u64 peb_id;
+	u32 states[SSDFS_MAPTBL_PEB_STATE_MAX];
+};
+
+/* The last item counts PEBs with unknown segment type */
+#define SSDFS_DUMPFS_SEG_TYPES_MAX	(SSDFS_LAST_KNOWN_SEG_TYPE + 2)
+
+/*
+ * struct ssdfs_dumpfs_volume_stats - volume statistics
+ * @pebs: number of scanned PEBs
+ * @empty_pebs: number of PEBs without logs
+ * @seg_types: number of PEBs of every segment type
+ * @logs: number of logs
+ * @full_logs: number of logs with segment header
+ * @partial_logs: number of logs with partial log header
+ * @corrupted_logs: number of logs with corrupted header
+ * @min_logs: minimal number of logs in PEB with logs
+ * @max_logs: maximal number of logs in PEB
+ * @area_bytes: size of areas of every type in bytes
+ * @compr: compression statistics of areas
+ * @blk_states: number of blocks in every state (PEB's last log)
+ * @cno: checkpoint of the log under processing
+ * @maptbl: PEB table fragments
+ * @maptbl_count: number of PEB table fragments
+ * @maptbl_capacity: capacity of PEB table fragments array
+ */
+struct ssdfs_dumpfs_volume_stats {
+	u64 pebs;
+	u64 empty_pebs;
+	u64 seg_types[SSDFS_DUMPFS_SEG_TYPES_MAX];
+
+	u64 logs;
+	u64 full_logs;
+	u64 partial_logs;
+	u64 corrupted_logs;
+	u32 min_logs;
+	u32 max_logs;
+
+	u64 area_bytes[SSDFS_SEG_HDR_DESC_MAX];
+	struct ssdfs_dumpfs_compr_stats compr[SSDFS_DUMPFS_COMPR_STATS_MAX];
+	u64 blk_states[SSDFS_BLK_STATE_MAX];
+
+	u64 cno;
+	struct ssdfs_dumpfs_maptbl_stats *maptbl;
+	u32 maptbl_count;
+	u32 maptbl_capacity;
+};
+
 /*
  * struct ssdfs_dumpfs_environment - dumpfs environment
  * @base: basic environment
@@ -116,6 +272,13 @@ struct ssdfs_dumpfs_raw_dump_environment {
  * @fd: file descriptor to store dump output
  * @stream: file stream
  * @output_folder: path to the output folder
+ * @threads: number of threads for PEBs dumping
+ * @peb_output: private output stream of thread (NULL means stdout)
+ * @format: format of output
+ * @output: buffered output of thread
+ * @filter: filter of PEB dump
+ * @area_dir: directory of log's areas
+ * @stats: volume statistics under collection (NULL means none)
  */
 struct ssdfs_dumpfs_environment {
 	struct ssdfs_environment base;
@@ -129,61 +292,231 @@ struct ssdfs_dumpfs_environment {
 	int fd;
 	FILE *stream;
 	const char *output_folder;
+
+	u32 threads;
+	FILE *peb_output;
+
+	int format;
+	struct ssdfs_dumpfs_output_buffer output;
+
+	struct ssdfs_dumpfs_filter filter;
+	struct ssdfs_dumpfs_area_directory area_dir;
+
+	struct ssdfs_dumpfs_volume_stats *stats;
+};
+
+#define SSDFS_DUMPFS_DEFAULT_THREADS		(1)
+#define SSDFS_DUMPFS_PEB_OUTPUTS_PER_THREAD	(2)
+
+/*
+ * struct ssdfs_dumpfs_peb_output - output of dumped PEB
+ * @buf: buffer with PEB's dump
+ * @size: size of dump in bytes
+ * @err: code of error
+ * @is_ready: is PEB's dump ready for emitting?
+ * @log_size: log's size at the end of PEB's dump
+ * @log_size_inherited: log's size hasn't been defined by PEB
+ * @log_size_checked: has inherited log's size been checked?
+ * @needs_rerun: PEB's dump depends on inherited log's size
+ *
+ * Thread doesn't know the log's size that PEB inherits from
+ * previous PEB. The thread dumps PEB with speculative log's size
+ * and the emitter dumps PEB again if the dump depends on it.
+ */
+struct ssdfs_dumpfs_peb_output {
+	char *buf;
+	size_t size;
+	int err;
+	int is_ready;
+
+	u32 log_size;
+	int log_size_inherited;
+	int log_size_checked;
+	int needs_rerun;
 };
 
+/*
+ * struct ssdfs_dumpfs_peb_dump_pool - shared state of PEB dumping threads
+ * @lock: lock of shared state
+ * @cond: condition of shared state's change
+ * @start_peb: first PEB of the range
+ * @pebs_count: number of PEBs in the range
+ * @max_logs: maximal number of logs in PEB for processing
+ * @log_index: index of the first log for dumping
+ * @next_peb: index of the next PEB for dumping
+ * @emitted: number of emitted PEBs
+ * @window: capacity of outputs ring
+ * @outputs: ring of PEBs' outputs
+ */
+struct ssdfs_dumpfs_peb_dump_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	u64 start_peb;
+	u64 pebs_count;
+	u32 max_logs;
+	int log_index;
+
+	u64 next_peb;
+	u64 emitted;
+
+	u32 window;
+	struct ssdfs_dumpfs_peb_output *outputs;
+};
+
+/*
+ * struct ssdfs_dumpfs_peb_dump_job - PEB dumping thread
+ * @id: thread ID
+ * @thread: thread descriptor
+ * @err: code of error
+ * @pool: shared state of PEB dumping threads
+ * @env: private copy of dumpfs environment
+ */
+struct ssdfs_dumpfs_peb_dump_job {
+	unsigned int id;
+	pthread_t thread;
+	int err;
+
+	struct ssdfs_dumpfs_peb_dump_pool *pool;
+	struct ssdfs_dumpfs_environment env;
+};
+
+/*
+ * Thread doesn't know the log's size of previous PEB. Any defined
+ * value is good for a guess because PEB is dumped again if the dump
+ * depends on the value.
+ */
+#define SSDFS_DUMPFS_SPECULATIVE_LOG_SIZE(env) \
+	((env)->peb.peb_size)
+
+#define SSDFS_DUMPFS_STDOUT(env) \
+	((env)->peb_output ? (env)->peb_output : stdout)
+
+#define SSDFS_DUMPFS_STRUCTURED(env) \
+	((env)->format != SSDFS_DUMPFS_TEXT_FORMAT)
+
 #define SSDFS_DUMPFS_DUMP(env, fmt, ...)({ \
 	int res; \
-	if (env->dump_into_files) { \
-		res = fprintf(env->stream, fmt, ##__VA_ARGS__); \
+	if (SSDFS_DUMPFS_STRUCTURED(env) || (env)->stats) { \
+		res = 0; \
 	} else { \
-		res = fprintf(stdout, fmt, ##__VA_ARGS__); \
+		res = ssdfs_dumpfs_output_printf(env, fmt, ##__VA_ARGS__); \
 	} \
 	res; \
 })
 
+enum SSDFS_DUMPFS_RECORD_TYPES {
+	SSDFS_DUMPFS_UNKNOWN_RECORD,
+	SSDFS_DUMPFS_SEGMENT_HEADER_RECORD,
+	SSDFS_DUMPFS_PARTIAL_LOG_HEADER_RECORD,
+	SSDFS_DUMPFS_LOG_FOOTER_RECORD,
+	SSDFS_DUMPFS_BLOCK_BITMAP_RECORD,
+	SSDFS_DUMPFS_BLK2OFF_TABLE_RECORD,
+	SSDFS_DUMPFS_MAPTBL_FRAGMENT_RECORD,
+	SSDFS_DUMPFS_SEGBMAP_FRAGMENT_RECORD,
+	SSDFS_DUMPFS_RECORD_TYPE_MAX
+};
+
+#define SSDFS_DUMPFS_RECORD_MAGIC		(0x53445243) /* SDRC */
+
+/*
+ * struct ssdfs_dumpfs_record_header - header of binary record
+ * @magic: record magic
+ * @type: record type
+ * @fields_count: number of fields in the record
+ * @bytes_count: size of the record (header included) in bytes
+ * @log_index: index of the log in PEB
+ * @peb_id: PEB's identification number
+ * @log_offset: log offset in bytes
+ * @reserved: reserved field
+ *
+ * Every field follows the header as: name length (u8), name,
+ * value type (u8), value length (le32), value.
+ */
+struct ssdfs_dumpfs_record_header {
+/* 0x0000 */
+	__le32 magic;
+	__le16 type;
+	__le16 fields_count;
+
+/* 0x0008 */
+	__le32 bytes_count;
+	__le32 log_index;
+
+/* 0x0010 */
+	__le64 peb_id;
+
+/* 0x0018 */
+	__le32 log_offset;
+	__le32 reserved;
+
+/* 0x0020 */
+} __attribute__((packed));
+
+/* Binary record's value types */
+enum {
+	SSDFS_DUMPFS_U64_VALUE		= 1,
+	SSDFS_DUMPFS_STRING_VALUE	= 2,
+	SSDFS_DUMPFS_BYTES_VALUE	= 3,
+};
+
+#define SSDFS_DUMPFS_RECORD_DEFAULT_SIZE	(4096)
+
+/*
+ * struct ssdfs_dumpfs_record - structured record under construction
+ * @format: format of output
+ * @type: record type
+ * @buf: buffer with preformatted record
+ * @size: size of record in bytes
+ * @capacity: capacity of buffer in bytes
+ * @fields_count: number of fields in the record
+ * @err: code of error
+ */
+struct ssdfs_dumpfs_record {
+	int format;
+	int type;
+	u8 *buf;
+	size_t size;
+	size_t capacity;
+	u16 fields_count;
+	int err;
+};
+
+typedef int (*metadata_parse_func)(struct ssdfs_dumpfs_environment *env,
+				   u8 *frag_buf, u32 frag_size);
+
 /* common.c */
 int ssdfs_dumpfs_open_file(struct ssdfs_dumpfs_environment *env,
 			   char *file_name);
 void ssdfs_dumpfs_close_file(struct ssdfs_dumpfs_environment *env);
+char *ssdfs_dumpfs_output_reserve(struct ssdfs_dumpfs_environment *env,
+				  u32 len);
+void ssdfs_dumpfs_output_commit(struct ssdfs_dumpfs_environment *env,
+				u32 len);
+int ssdfs_dumpfs_output_printf(struct ssdfs_dumpfs_environment *env,
+				const char *fmt, ...)
+				__attribute__((format(printf, 2, 3)));
+int ssdfs_dumpfs_output_write(struct ssdfs_dumpfs_environment *env,
+			      const void *ptr, size_t len);
+int ssdfs_dumpfs_flush_output(struct ssdfs_dumpfs_environment *env);
+void ssdfs_dumpfs_free_output(struct ssdfs_dumpfs_environment *env);
+int ssdfs_dumpfs_get_area(struct ssdfs_dumpfs_environment *env,
+			  u32 area_offset, u32 area_size,
+			  void **area_buf);
+void ssdfs_dumpfs_forget_areas(struct ssdfs_dumpfs_environment *env);
+int ssdfs_dumpfs_unpack_fragment(struct ssdfs_dumpfs_environment *env,
+				 struct ssdfs_fragment_desc *frag,
+				 u8 *data, u8 **fragment,
+				 u8 **uncompr_data);
 int ssdfs_dumpfs_read_partial_log_header(struct ssdfs_dumpfs_environment *env,
 					 u64 peb_id, u32 peb_size,
 					 u32 log_offset, u32 size,
 					 void *buf);
-int ssdfs_dumpfs_read_block_bitmap(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf);
-int ssdfs_dumpfs_read_blk2off_table(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf);
-int ssdfs_dumpfs_read_blk_desc_array(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf);
-int ssdfs_dumpfs_read_maptbl_cache(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf);
 int ssdfs_dumpfs_read_logical_block(struct ssdfs_dumpfs_environment *env,
 				    u64 peb_id, u32 peb_size,
 				    u32 log_offset, u32 log_size,
 				    u32 block_offset, u32 size,
 				    void *buf);
-int ssdfs_dumpfs_read_log_footer(struct ssdfs_dumpfs_environment *env,
-				   u64 peb_id, u32 peb_size,
-				   u32 log_offset, u32 log_size,
-				   u32 area_offset, u32 size,
-				   void *buf);
-int ssdfs_dumpfs_read_partial_log_footer(struct ssdfs_dumpfs_environment *env,
-					 u64 peb_id, u32 peb_size,
-					 u32 log_offset, u32 log_size,
-					 u32 area_offset, u32 size,
-					 void *buf);
 int ssdfs_dumpfs_find_any_valid_peb(struct ssdfs_dumpfs_environment *env,
 				    struct ssdfs_segment_header *hdr);
 void ssdfs_dumpfs_show_key_volume_details(struct ssdfs_dumpfs_environment *env,
@@ -199,8 +532,31 @@ void parse_options(int argc, char *argv[],
 int ssdfs_dumpfs_show_granularity(struct ssdfs_dumpfs_environment *env);
 
 /* show_peb_dump.c */
+int is_ssdfs_dumpfs_area_valid(struct ssdfs_metadata_descriptor *desc);
+int ssdfs_dumpfs_read_log_bytes(struct ssdfs_dumpfs_environment *env,
+				union ssdfs_metadata_header *buf);
+int __ssdfs_dumpfs_parse_metadata(struct ssdfs_dumpfs_environment *env,
+				  struct ssdfs_metadata_descriptor *desc_array,
+				  metadata_parse_func do_parsing);
 int ssdfs_dumpfs_show_peb_dump(struct ssdfs_dumpfs_environment *env);
 
+/* show_stats.c */
+int ssdfs_dumpfs_show_volume_stats(struct ssdfs_dumpfs_environment *env);
+
+/* show_records.c */
+int ssdfs_dumpfs_record_start(struct ssdfs_dumpfs_environment *env,
+			      struct ssdfs_dumpfs_record *rec,
+			      int type);
+void ssdfs_dumpfs_record_add_u64(struct ssdfs_dumpfs_record *rec,
+				 const char *name, u64 value);
+void ssdfs_dumpfs_record_add_string(struct ssdfs_dumpfs_record *rec,
+				    const char *name, const char *str);
+void ssdfs_dumpfs_record_add_bytes(struct ssdfs_dumpfs_record *rec,
+				   const char *name,
+				   const void *ptr, u32 len);
+int ssdfs_dumpfs_record_finish(struct ssdfs_dumpfs_environment *env,
+			       struct ssdfs_dumpfs_record *rec);
+
 /* show_raw_dump.c */
 int ssdfs_dumpfs_show_raw_string(struct ssdfs_dumpfs_environment *env,
 				 u64 offset, const u8 *ptr, u32 len);
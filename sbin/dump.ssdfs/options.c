@@ -39,8 +39,15 @@ void print_usage(void)
 	SSDFS_INFO("Usage: dump.ssdfs <options> [<device> | <image-file>]\n");
 	SSDFS_INFO("Options:\n");
 	SSDFS_INFO("\t [-d|--debug]\t\t  show debug output.\n");
+	SSDFS_INFO("\t [-f|--filter area=header|log_footer|block_bitmap|"
+		   "blk2off|block_state|maptbl_cache|maptbl|segbmap,"
+		   "blk_id=value]\t  filter PEB dump.\n");
+	SSDFS_INFO("\t [-F|--format text|json|cbor|binary]\t  "
+		   "define format of PEB dump.\n");
 	SSDFS_INFO("\t [-g|--granularity]\t\t  show key volume's details.\n");
 	SSDFS_INFO("\t [-h|--help]\t\t  display help message and exit.\n");
+	SSDFS_INFO("\t [-j|--threads]\t\t  define threads number "
+		   "for PEBs dumping or scanning.\n");
 	SSDFS_INFO("\t [-o|--output-folder]\t\t  define output folder.\n");
 	SSDFS_INFO("\t [-p|--peb id=value,peb_count=value,size=value,"
 		   "log_index=value,log_count=value,log_size=value,"
@@ -51,6 +58,7 @@ void print_usage(void)
 	SSDFS_INFO("\t [-q|--quiet]\t\t  quiet execution (useful for scripts).\n");
 	SSDFS_INFO("\t [-r|--raw-dump show,offset=value,size=value]\t  "
 		   "show raw dump.\n");
+	SSDFS_INFO("\t [-s|--stats]\t\t  show volume's statistics.\n");
 	SSDFS_INFO("\t [-V|--version]\t\t  print version and exit.\n");
 }
 
@@ -71,15 +79,20 @@ void parse_options(int argc, char *argv[],
 	int c;
 	int oi = 1;
 	char *p;
-	char sopts[] = "dgho:p:qr:V";
+	char *format_value;
+	char sopts[] = "df:F:ghj:o:p:qr:sV";
 	static const struct option lopts[] = {
 		{"debug", 0, NULL, 'd'},
+		{"filter", 1, NULL, 'f'},
+		{"format", 1, NULL, 'F'},
 		{"granularity", 0, NULL, 'g'},
 		{"help", 0, NULL, 'h'},
+		{"threads", 1, NULL, 'j'},
 		{"output-folder", 1, NULL, 'o'},
 		{"peb", 1, NULL, 'p'},
 		{"quiet", 0, NULL, 'q'},
 		{"raw-dump", 1, NULL, 'r'},
+		{"stats", 0, NULL, 's'},
 		{"version", 0, NULL, 'V'},
 		{ }
 	};
@@ -125,6 +138,53 @@ void parse_options(int argc, char *argv[],
 		RAW_DUMP_OFFSET_OPT,
 		RAW_DUMP_SIZE_OPT,
 	};
+	char *const format_tokens[] = {
+		[SSDFS_DUMPFS_TEXT_FORMAT]	= "text",
+		[SSDFS_DUMPFS_JSON_FORMAT]	= "json",
+		[SSDFS_DUMPFS_CBOR_FORMAT]	= "cbor",
+		[SSDFS_DUMPFS_BINARY_FORMAT]	= "binary",
+		NULL
+	};
+	enum {
+		FILTER_AREA_OPT = 0,
+		FILTER_BLK_ID_OPT,
+	};
+	char *const filter_tokens[] = {
+		[FILTER_AREA_OPT]		= "area",
+		[FILTER_BLK_ID_OPT]		= "blk_id",
+		NULL
+	};
+	enum {
+		FILTER_HEADER_AREA = 0,
+		FILTER_LOG_FOOTER_AREA,
+		FILTER_BLOCK_BITMAP_AREA,
+		FILTER_BLK2OFF_AREA,
+		FILTER_BLOCK_STATE_AREA,
+		FILTER_MAPTBL_CACHE_AREA,
+		FILTER_MAPTBL_AREA,
+		FILTER_SEGBMAP_AREA,
+	};
+	char *const filter_area_tokens[] = {
+		[FILTER_HEADER_AREA]		= "header",
+		[FILTER_LOG_FOOTER_AREA]	= "log_footer",
+		[FILTER_BLOCK_BITMAP_AREA]	= "block_bitmap",
+		[FILTER_BLK2OFF_AREA]		= "blk2off",
+		[FILTER_BLOCK_STATE_AREA]	= "block_state",
+		[FILTER_MAPTBL_CACHE_AREA]	= "maptbl_cache",
+		[FILTER_MAPTBL_AREA]		= "maptbl",
+		[FILTER_SEGBMAP_AREA]		= "segbmap",
+		NULL
+	};
+	const u32 filter_area_flags[] = {
+		[FILTER_HEADER_AREA]		= SSDFS_PARSE_HEADER,
+		[FILTER_LOG_FOOTER_AREA]	= SSDFS_PARSE_LOG_FOOTER,
+		[FILTER_BLOCK_BITMAP_AREA]	= SSDFS_PARSE_BLOCK_BITMAP,
+		[FILTER_BLK2OFF_AREA]		= SSDFS_PARSE_BLK2OFF_TABLE,
+		[FILTER_BLOCK_STATE_AREA]	= SSDFS_PARSE_BLOCK_STATE_AREA,
+		[FILTER_MAPTBL_CACHE_AREA]	= SSDFS_PARSE_MAPTBL_CACHE_AREA,
+		[FILTER_MAPTBL_AREA]		= SSDFS_PARSE_MAPPING_TABLE,
+		[FILTER_SEGBMAP_AREA]		= SSDFS_PARSE_SEGMENT_BITMAP,
+	};
 	char *const raw_dump_tokens[] = {
 		[RAW_DUMP_SHOW_OPT]		= "show",
 		[RAW_DUMP_OFFSET_OPT]		= "offset",
@@ -139,12 +199,74 @@ void parse_options(int argc, char *argv[],
 		case 'd':
 			env->base.show_debug = SSDFS_TRUE;
 			break;
+		case 'f':
+			p = optarg;
+			while (*p != '\0') {
+				struct ssdfs_dumpfs_filter *filter;
+				char *value;
+				char *area_value;
+				u64 count;
+				int area;
+
+				filter = &env->filter;
+				switch (getsubopt(&p, filter_tokens, &value)) {
+				case FILTER_AREA_OPT:
+					if (!value) {
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+
+					area = getsubopt(&value, filter_area_tokens,
+							 &area_value);
+					if (area < 0 || *value != '\0') {
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+
+					filter->areas |= filter_area_flags[area];
+					break;
+				case FILTER_BLK_ID_OPT:
+					if (!value) {
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+
+					count = atol(value);
+					if (count >= U32_MAX) {
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+
+					filter->blk_id = (u32)count;
+					break;
+				default:
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'F':
+			p = optarg;
+			env->format = getsubopt(&p, format_tokens,
+						&format_value);
+			if (env->format < 0 || *p != '\0') {
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'g':
 			env->command = SSDFS_DUMP_GRANULARITY_COMMAND;
 			break;
 		case 'h':
 			print_usage();
 			exit(EXIT_SUCCESS);
+		case 'j':
+			env->threads = atoi(optarg);
+			if (env->threads == 0 || env->threads >= U16_MAX) {
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'o':
 			env->dump_into_files = SSDFS_TRUE;
 			env->output_folder = optarg;
@@ -161,6 +283,7 @@ void parse_options(int argc, char *argv[],
 				break;
 
 			case SSDFS_DUMP_PEB_COMMAND:
+			case SSDFS_DUMP_STATS_COMMAND:
 				/* do nothing */
 				break;
 			default:
@@ -251,6 +374,7 @@ void parse_options(int argc, char *argv[],
 
 			case SSDFS_DUMP_PEB_COMMAND:
 			case SSDFS_RAW_DUMP_COMMAND:
+			case SSDFS_DUMP_STATS_COMMAND:
 				/* do nothing */
 				break;
 
@@ -285,6 +409,9 @@ void parse_options(int argc, char *argv[],
 				};
 			};
 			break;
+		case 's':
+			env->command = SSDFS_DUMP_STATS_COMMAND;
+			break;
 		case 'V':
 			print_version();
 			exit(EXIT_SUCCESS);
@@ -298,4 +425,56 @@ void parse_options(int argc, char *argv[],
 		print_usage();
 		exit(EXIT_FAILURE);
 	}
+
+	if (env->command == SSDFS_DUMP_STATS_COMMAND &&
+	    env->is_raw_dump_requested) {
+		SSDFS_ERR("raw dump is not supported by volume's statistics\n");
+		print_usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if (env->filter.areas != 0 || SSDFS_DUMPFS_BLK_FILTER(env)) {
+		struct ssdfs_peb_dump_environment *peb = &env->peb;
+		u32 areas = env->filter.areas;
+
+		if (env->command != SSDFS_DUMP_PEB_COMMAND) {
+			SSDFS_ERR("filter is supported by PEB dump only\n");
+			print_usage();
+			exit(EXIT_FAILURE);
+		}
+
+		if (SSDFS_DUMPFS_BLK_FILTER(env)) {
+			if (SSDFS_DUMPFS_STRUCTURED(env)) {
+				SSDFS_ERR("blk_id filter is supported "
+					  "by text format only\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+
+			/* blocks are looked up in these areas */
+			if (areas == 0) {
+				areas = SSDFS_PARSE_BLOCK_BITMAP |
+					SSDFS_PARSE_BLK2OFF_TABLE;
+			}
+		}
+
+		if (peb->parse_flags == 0)
+			peb->parse_flags = areas;
+		else
+			peb->parse_flags &= areas;
+	}
+
+	if (SSDFS_DUMPFS_STRUCTURED(env)) {
+		/* records contain raw bytes already */
+		if (env->command != SSDFS_DUMP_PEB_COMMAND ||
+		    env->is_raw_dump_requested) {
+			SSDFS_ERR("structured format is supported "
+				  "by PEB dump without raw dump only\n");
+			print_usage();
+			exit(EXIT_FAILURE);
+		}
+
+		/* output stream is for records only */
+		env->base.show_info = SSDFS_FALSE;
+	}
 }
@@ -26,7 +26,6 @@
  *                     Show PEB dump command                            *
  ************************************************************************/
 
-static
 int is_ssdfs_dumpfs_area_valid(struct ssdfs_metadata_descriptor *desc)
 {
 	u32 area_offset = le32_to_cpu(desc->offset);
@@ -862,6 +861,29 @@ ssdfs_dumpfs_parse_block_bitmap_fragment(struct ssdfs_dumpfs_environment *env,
 	return 0;
 }
 
+static
+int ssdfs_dumpfs_show_block_bitmap_record(struct ssdfs_dumpfs_environment *env,
+					  struct ssdfs_block_bitmap_header *hdr)
+{
+	struct ssdfs_dumpfs_record rec;
+	u32 bytes_count = le32_to_cpu(hdr->bytes_count);
+	int err;
+
+	err = ssdfs_dumpfs_record_start(env, &rec,
+					SSDFS_DUMPFS_BLOCK_BITMAP_RECORD);
+	if (err)
+		return err;
+
+	ssdfs_dumpfs_record_add_u64(&rec, "fragments_count",
+				    le16_to_cpu(hdr->fragments_count));
+	ssdfs_dumpfs_record_add_u64(&rec, "bytes_count", bytes_count);
+	ssdfs_dumpfs_record_add_u64(&rec, "flags", hdr->flags);
+	ssdfs_dumpfs_record_add_u64(&rec, "type", hdr->type);
+	ssdfs_dumpfs_record_add_bytes(&rec, "raw", hdr, bytes_count);
+
+	return ssdfs_dumpfs_record_finish(env, &rec);
+}
+
 static
 int ssdfs_dumpfs_parse_block_bitmap(struct ssdfs_dumpfs_environment *env,
 				    void *area_buf, u32 area_size)
@@ -887,6 +909,9 @@ int ssdfs_dumpfs_parse_block_bitmap(struct ssdfs_dumpfs_environment *env,
 		return -EINVAL;
 	}
 
+	if (SSDFS_DUMPFS_STRUCTURED(env))
+		return ssdfs_dumpfs_show_block_bitmap_record(env, hdr);
+
 	SSDFS_DUMPFS_DUMP(env, "BLOCK BITMAP:\n");
 
 	ssdfs_dumpfs_parse_magic(env, &hdr->magic);
@@ -980,6 +1005,179 @@ int ssdfs_dumpfs_parse_block_bitmap(struct ssdfs_dumpfs_environment *env,
 	return 0;
 }
 
+static
+void ssdfs_dumpfs_show_block_state(struct ssdfs_dumpfs_environment *env,
+				   u8 state)
+{
+	switch (state) {
+	case SSDFS_BLK_FREE:
+		SSDFS_DUMPFS_DUMP(env, "BLOCK STATE: SSDFS_BLK_FREE\n");
+		break;
+
+	case SSDFS_BLK_PRE_ALLOCATED:
+		SSDFS_DUMPFS_DUMP(env, "BLOCK STATE: SSDFS_BLK_PRE_ALLOCATED\n");
+		break;
+
+	case SSDFS_BLK_VALID:
+		SSDFS_DUMPFS_DUMP(env, "BLOCK STATE: SSDFS_BLK_VALID\n");
+		break;
+
+	case SSDFS_BLK_INVALID:
+		SSDFS_DUMPFS_DUMP(env, "BLOCK STATE: SSDFS_BLK_INVALID\n");
+		break;
+
+	default:
+		SSDFS_DUMPFS_DUMP(env, "BLOCK STATE: UNKNOWN\n");
+		break;
+	}
+}
+
+/*
+ * ssdfs_dumpfs_find_block_state() - find state of requested block
+ * @env: pointer on environment
+ * @area_buf: block bitmap area
+ * @area_size: size of block bitmap area in bytes
+ *
+ * This function looks for the block state of @env->filter.blk_id
+ * in every fragment of block bitmap. Only the fragment that
+ * contains the requested block is decompressed.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_dumpfs_find_block_state(struct ssdfs_dumpfs_environment *env,
+				  void *area_buf, u32 area_size)
+{
+	struct ssdfs_block_bitmap_header *hdr =
+			(struct ssdfs_block_bitmap_header *)area_buf;
+	size_t bmap_frag_size = sizeof(struct ssdfs_block_bitmap_fragment);
+	size_t frag_desc_size = sizeof(struct ssdfs_fragment_desc);
+	u16 bmap_fragments = le16_to_cpu(hdr->fragments_count);
+	u32 blk_id = env->filter.blk_id;
+	u32 byte_index;
+	u32 offset;
+	int found = SSDFS_FALSE;
+	int i, j;
+	int err;
+
+	byte_index = blk_id / SSDFS_ITEMS_PER_BYTE(SSDFS_BLK_STATE_BITS);
+
+	SSDFS_DUMPFS_DUMP(env, "BLOCK BITMAP: BLK_ID %u\n", blk_id);
+
+	offset = sizeof(struct ssdfs_block_bitmap_header);
+
+	for (i = 0; i < bmap_fragments; i++) {
+		struct ssdfs_block_bitmap_fragment *bmap_frag;
+		u16 fragments_count;
+		u32 data_offset;
+		u32 bytes_before = 0;
+
+		if ((offset + bmap_frag_size) > area_size) {
+			SSDFS_ERR("corrupted block bitmap: "
+				  "offset %u, area_size %u\n",
+				  offset, area_size);
+			return -EIO;
+		}
+
+		bmap_frag = (struct ssdfs_block_bitmap_fragment *)((u8 *)area_buf +
+								  offset);
+		fragments_count = le16_to_cpu(bmap_frag->chain_hdr.fragments_count);
+		data_offset = offset + bmap_frag_size;
+		data_offset += (u32)fragments_count * frag_desc_size;
+
+		if (data_offset > area_size) {
+			SSDFS_ERR("corrupted block bitmap: "
+				  "data_offset %u, area_size %u\n",
+				  data_offset, area_size);
+			return -EIO;
+		}
+
+		for (j = 0; j < fragments_count; j++) {
+			struct ssdfs_fragment_desc *frag;
+			u8 *fragment;
+			u8 *uncompr_data;
+			u32 compr_size;
+			u32 uncompr_size;
+			u8 state;
+			int shift;
+
+			frag = (struct ssdfs_fragment_desc *)((u8 *)area_buf +
+					offset + bmap_frag_size +
+					(j * frag_desc_size));
+			compr_size = le16_to_cpu(frag->compr_size);
+			uncompr_size = le16_to_cpu(frag->uncompr_size);
+
+			if ((data_offset + compr_size) > area_size) {
+				SSDFS_ERR("corrupted block bitmap: "
+					  "data_offset %u, compr_size %u, "
+					  "area_size %u\n",
+					  data_offset, compr_size, area_size);
+				return -EIO;
+			}
+
+			if (byte_index < bytes_before ||
+			    byte_index >= (bytes_before + uncompr_size)) {
+				data_offset += compr_size;
+				bytes_before += uncompr_size;
+				continue;
+			}
+
+			err = ssdfs_dumpfs_unpack_fragment(env, frag,
+						(u8 *)area_buf + data_offset,
+						&fragment, &uncompr_data);
+			if (err) {
+				SSDFS_ERR("fail to unpack fragment: "
+					  "index %d, err %d\n", j, err);
+				return err;
+			}
+
+			shift = (blk_id %
+				 SSDFS_ITEMS_PER_BYTE(SSDFS_BLK_STATE_BITS)) *
+				SSDFS_BLK_STATE_BITS;
+			state = fragment[byte_index - bytes_before];
+			state = (state >> shift) & SSDFS_BLK_STATE_MASK;
+
+			if (uncompr_data)
+				free(uncompr_data);
+
+			SSDFS_DUMPFS_DUMP(env, "PEB_INDEX: %u\n",
+					  le16_to_cpu(bmap_frag->peb_index));
+
+			switch (bmap_frag->type) {
+			case SSDFS_SRC_BLK_BMAP:
+				SSDFS_DUMPFS_DUMP(env,
+					"FRAGMENT TYPE: SSDFS_SRC_BLK_BMAP\n");
+				break;
+
+			case SSDFS_DST_BLK_BMAP:
+				SSDFS_DUMPFS_DUMP(env,
+					"FRAGMENT TYPE: SSDFS_DST_BLK_BMAP\n");
+				break;
+
+			default:
+				SSDFS_DUMPFS_DUMP(env,
+					"FRAGMENT TYPE: UNKNOWN\n");
+				break;
+			}
+
+			ssdfs_dumpfs_show_block_state(env, state);
+
+			found = SSDFS_TRUE;
+			data_offset += compr_size;
+			bytes_before += uncompr_size;
+		}
+
+		offset = data_offset;
+	}
+
+	if (!found)
+		SSDFS_DUMPFS_DUMP(env, "BLOCK STATE: NOT FOUND\n");
+
+	return 0;
+}
+
 static
 int ssdfs_dumpfs_parse_block_bitmap_area(struct ssdfs_dumpfs_environment *env,
 					 struct ssdfs_metadata_descriptor *desc)
@@ -994,24 +1192,8 @@ int ssdfs_dumpfs_parse_block_bitmap_area(struct ssdfs_dumpfs_environment *env,
 	area_size = le32_to_cpu(desc->size);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			err = -ENOMEM;
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			goto finish_parse_block_bitmap_area;
-		}
-
-		memset(area_buf, 0, area_size);
-
-		err = ssdfs_dumpfs_read_block_bitmap(env,
-						     env->peb.id,
-						     env->peb.peb_size,
-						     env->peb.log_offset,
-						     env->peb.log_size,
-						     area_offset,
-						     area_size,
-						     area_buf);
+		err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+					    &area_buf);
 		if (err) {
 			SSDFS_ERR("fail to read block bitmap: "
 				  "peb_id %llu, peb_size %u, "
@@ -1021,6 +1203,20 @@ int ssdfs_dumpfs_parse_block_bitmap_area(struct ssdfs_dumpfs_environment *env,
 			goto finish_parse_block_bitmap;
 		}
 
+		if (SSDFS_DUMPFS_BLK_FILTER(env)) {
+			err = ssdfs_dumpfs_find_block_state(env, area_buf,
+							    area_size);
+			if (err) {
+				SSDFS_ERR("fail to find block state: "
+					  "peb_id %llu, log_index %u, "
+					  "blk_id %u, err %d\n",
+					  env->peb.id, env->peb.log_index,
+					  env->filter.blk_id, err);
+			}
+
+			goto finish_parse_block_bitmap;
+		}
+
 		err = ssdfs_dumpfs_parse_block_bitmap(env, area_buf, area_size);
 		if (err) {
 			SSDFS_ERR("fail to parse block bitmap: "
@@ -1030,9 +1226,6 @@ int ssdfs_dumpfs_parse_block_bitmap_area(struct ssdfs_dumpfs_environment *env,
 		}
 
 finish_parse_block_bitmap:
-		free(area_buf);
-		area_buf = NULL;
-
 		SSDFS_DUMPFS_DUMP(env, "\n");
 
 		if (env->is_raw_dump_requested) {
@@ -1057,6 +1250,90 @@ finish_parse_block_bitmap_area:
 	return err;
 }
 
+static
+void ssdfs_dumpfs_show_phys_offset_descriptor(struct ssdfs_dumpfs_environment *env,
+					u32 offset_id,
+					struct ssdfs_phys_offset_descriptor *off_desc)
+{
+	SSDFS_DUMPFS_DUMP(env, "OFFSET ID: %u\n", offset_id);
+	SSDFS_DUMPFS_DUMP(env, "LOGICAL OFFSET: %u page(s)\n",
+		    le32_to_cpu(off_desc->page_desc.logical_offset));
+	SSDFS_DUMPFS_DUMP(env, "LOGICAL BLOCK: %u\n",
+		    le16_to_cpu(off_desc->page_desc.logical_blk));
+	SSDFS_DUMPFS_DUMP(env, "PEB_PAGE: %u\n",
+		    le16_to_cpu(off_desc->page_desc.peb_page));
+
+	SSDFS_DUMPFS_DUMP(env, "LOG_START_PAGE: %u\n",
+		    le16_to_cpu(off_desc->blk_state.log_start_page));
+
+	switch (off_desc->blk_state.log_area) {
+	case SSDFS_LOG_BLK_DESC_AREA:
+		SSDFS_DUMPFS_DUMP(env,
+			"LOG AREA TYPE: SSDFS_LOG_BLK_DESC_AREA\n");
+		break;
+
+	case SSDFS_LOG_MAIN_AREA:
+		SSDFS_DUMPFS_DUMP(env,
+			"LOG AREA TYPE: SSDFS_LOG_MAIN_AREA\n");
+		break;
+
+	case SSDFS_LOG_DIFFS_AREA:
+		SSDFS_DUMPFS_DUMP(env,
+			"LOG AREA TYPE: SSDFS_LOG_DIFFS_AREA\n");
+		break;
+
+	case SSDFS_LOG_JOURNAL_AREA:
+		SSDFS_DUMPFS_DUMP(env,
+			"LOG AREA TYPE: SSDFS_LOG_JOURNAL_AREA\n");
+		break;
+
+	default:
+		SSDFS_DUMPFS_DUMP(env, "LOG AREA TYPE: UNKNOWN\n");
+		break;
+	}
+
+	SSDFS_DUMPFS_DUMP(env, "PEB_MIGRATION_ID: %u\n",
+		    off_desc->blk_state.peb_migration_id);
+	SSDFS_DUMPFS_DUMP(env, "BYTE_OFFSET: %u\n",
+		    le32_to_cpu(off_desc->blk_state.byte_offset));
+
+	SSDFS_DUMPFS_DUMP(env, "\n");
+}
+
+static
+void ssdfs_dumpfs_show_translation_extent(struct ssdfs_dumpfs_environment *env,
+					  int index,
+					  struct ssdfs_translation_extent *extent)
+{
+	SSDFS_DUMPFS_DUMP(env, "EXTENT#%d:\n", index);
+	SSDFS_DUMPFS_DUMP(env, "LOGICAL BLOCK: %u\n",
+			  le16_to_cpu(extent->logical_blk));
+	SSDFS_DUMPFS_DUMP(env, "OFFSET_ID: %u\n",
+			  le16_to_cpu(extent->offset_id));
+	SSDFS_DUMPFS_DUMP(env, "LENGTH: %u\n",
+			  le16_to_cpu(extent->len));
+	SSDFS_DUMPFS_DUMP(env, "SEQUENCE_ID: %u\n",
+			  extent->sequence_id);
+
+	switch (extent->state) {
+	case SSDFS_LOGICAL_BLK_FREE:
+		SSDFS_DUMPFS_DUMP(env,
+			"EXTENT STATE: SSDFS_LOGICAL_BLK_FREE\n");
+		break;
+
+	case SSDFS_LOGICAL_BLK_USED:
+		SSDFS_DUMPFS_DUMP(env,
+			"EXTENT STATE: SSDFS_LOGICAL_BLK_USED\n");
+		break;
+
+	default:
+		SSDFS_DUMPFS_DUMP(env, "EXTENT STATE: UNKNOWN\n");
+		break;
+	}
+
+	SSDFS_DUMPFS_DUMP(env, "\n");
+}
+
 static
 int ssdfs_dumpfs_parse_blk2off_table_fragment(struct ssdfs_dumpfs_environment *env,
 					      struct ssdfs_fragment_desc *frag_desc,
@@ -1280,49 +1557,8 @@ int ssdfs_dumpfs_parse_blk2off_table_fragment(struct ssdfs_dumpfs_environment *e
 							pot_desc_size +
 							(off_desc_size * i));
 
-		SSDFS_DUMPFS_DUMP(env, "OFFSET ID: %u\n", start_id + i);
-		SSDFS_DUMPFS_DUMP(env, "LOGICAL OFFSET: %u page(s)\n",
-			    le32_to_cpu(off_desc->page_desc.logical_offset));
-		SSDFS_DUMPFS_DUMP(env, "LOGICAL BLOCK: %u\n",
-			    le16_to_cpu(off_desc->page_desc.logical_blk));
-		SSDFS_DUMPFS_DUMP(env, "PEB_PAGE: %u\n",
-			    le16_to_cpu(off_desc->page_desc.peb_page));
-
-		SSDFS_DUMPFS_DUMP(env, "LOG_START_PAGE: %u\n",
-			    le16_to_cpu(off_desc->blk_state.log_start_page));
-
-		switch (off_desc->blk_state.log_area) {
-		case SSDFS_LOG_BLK_DESC_AREA:
-			SSDFS_DUMPFS_DUMP(env,
-				"LOG AREA TYPE: SSDFS_LOG_BLK_DESC_AREA\n");
-			break;
-
-		case SSDFS_LOG_MAIN_AREA:
-			SSDFS_DUMPFS_DUMP(env,
-				"LOG AREA TYPE: SSDFS_LOG_MAIN_AREA\n");
-			break;
-
-		case SSDFS_LOG_DIFFS_AREA:
-			SSDFS_DUMPFS_DUMP(env,
-				"LOG AREA TYPE: SSDFS_LOG_DIFFS_AREA\n");
-			break;
-
-		case SSDFS_LOG_JOURNAL_AREA:
-			SSDFS_DUMPFS_DUMP(env,
-				"LOG AREA TYPE: SSDFS_LOG_JOURNAL_AREA\n");
-			break;
-
-		default:
-			SSDFS_DUMPFS_DUMP(env, "LOG AREA TYPE: UNKNOWN\n");
-			break;
-		}
-
-		SSDFS_DUMPFS_DUMP(env, "PEB_MIGRATION_ID: %u\n",
-			    off_desc->blk_state.peb_migration_id);
-		SSDFS_DUMPFS_DUMP(env, "BYTE_OFFSET: %u\n",
-			    le32_to_cpu(off_desc->blk_state.byte_offset));
-
-		SSDFS_DUMPFS_DUMP(env, "\n");
+		ssdfs_dumpfs_show_phys_offset_descriptor(env, start_id + i,
+							 off_desc);
 	}
 
 	SSDFS_DUMPFS_DUMP(env, "\n");
@@ -1486,33 +1722,7 @@ int ssdfs_dumpfs_parse_extents_fragment(struct ssdfs_dumpfs_environment *env,
 	SSDFS_DUMPFS_DUMP(env, "\n");
 
 	for (i = 0; i < extents_count; i++) {
-		SSDFS_DUMPFS_DUMP(env, "EXTENT#%d:\n", i);
-		SSDFS_DUMPFS_DUMP(env, "LOGICAL BLOCK: %u\n",
-				  le16_to_cpu(extents[i].logical_blk));
-		SSDFS_DUMPFS_DUMP(env, "OFFSET_ID: %u\n",
-				  le16_to_cpu(extents[i].offset_id));
-		SSDFS_DUMPFS_DUMP(env, "LENGTH: %u\n",
-				  le16_to_cpu(extents[i].len));
-		SSDFS_DUMPFS_DUMP(env, "SEQUENCE_ID: %u\n",
-				  extents[i].sequence_id);
-
-		switch (extents[i].state) {
-		case SSDFS_LOGICAL_BLK_FREE:
-			SSDFS_DUMPFS_DUMP(env,
-				"EXTENT STATE: SSDFS_LOGICAL_BLK_FREE\n");
-			break;
-
-		case SSDFS_LOGICAL_BLK_USED:
-			SSDFS_DUMPFS_DUMP(env,
-				"EXTENT STATE: SSDFS_LOGICAL_BLK_USED\n");
-			break;
-
-		default:
-			SSDFS_DUMPFS_DUMP(env, "EXTENT STATE: UNKNOWN\n");
-			break;
-		}
-
-		SSDFS_DUMPFS_DUMP(env, "\n");
+		ssdfs_dumpfs_show_translation_extent(env, i, &extents[i]);
 	}
 
 	*parsed_bytes += compr_size;
@@ -1525,6 +1735,35 @@ finish_parse_extent_fragment:
 	return err;
 }
 
+static
+int ssdfs_dumpfs_show_blk2off_table_record(struct ssdfs_dumpfs_environment *env,
+					   void *area_buf, u32 area_size)
+{
+	struct ssdfs_blk2off_table_header *hdr;
+	struct ssdfs_dumpfs_record rec;
+	int err;
+
+	hdr = (struct ssdfs_blk2off_table_header *)area_buf;
+
+	err = ssdfs_dumpfs_record_start(env, &rec,
+					SSDFS_DUMPFS_BLK2OFF_TABLE_RECORD);
+	if (err)
+		return err;
+
+	ssdfs_dumpfs_record_add_u64(&rec, "flags",
+				    le16_to_cpu(hdr->check.flags));
+	ssdfs_dumpfs_record_add_u64(&rec, "compr_bytes",
+				    le32_to_cpu(hdr->chain_hdr.compr_bytes));
+	ssdfs_dumpfs_record_add_u64(&rec, "uncompr_bytes",
+				    le32_to_cpu(hdr->chain_hdr.uncompr_bytes));
+	ssdfs_dumpfs_record_add_u64(&rec, "fragments_count",
+				    le16_to_cpu(hdr->chain_hdr.fragments_count));
+	ssdfs_dumpfs_record_add_u64(&rec, "area_size", area_size);
+	ssdfs_dumpfs_record_add_bytes(&rec, "raw", area_buf, area_size);
+
+	return ssdfs_dumpfs_record_finish(env, &rec);
+}
+
 static
 int ssdfs_dumpfs_parse_blk2off_table(struct ssdfs_dumpfs_environment *env,
 				     void *area_buf, u32 area_size)
@@ -1551,6 +1790,11 @@ int ssdfs_dumpfs_parse_blk2off_table(struct ssdfs_dumpfs_environment *env,
 		return -EINVAL;
 	}
 
+	if (SSDFS_DUMPFS_STRUCTURED(env)) {
+		return ssdfs_dumpfs_show_blk2off_table_record(env, area_buf,
+							      area_size);
+	}
+
 	do {
 		next_fragment_exist = SSDFS_FALSE;
 
@@ -1695,6 +1939,241 @@ int ssdfs_dumpfs_parse_blk2off_table(struct ssdfs_dumpfs_environment *env,
 	return 0;
 }
 
+static
+int ssdfs_dumpfs_find_in_extents_fragment(struct ssdfs_dumpfs_environment *env,
+					  struct ssdfs_fragment_desc *frag_desc,
+					  u8 *data, u32 *offset_id)
+{
+	struct ssdfs_translation_extent *extents;
+	size_t extent_desc_size = sizeof(struct ssdfs_translation_extent);
+	u32 blk_id = env->filter.blk_id;
+	u8 *fragment;
+	u8 *uncompr_data;
+	u32 extents_count;
+	int i;
+	int err;
+
+	err = ssdfs_dumpfs_unpack_fragment(env, frag_desc, data,
+					   &fragment, &uncompr_data);
+	if (err)
+		return err;
+
+	if (uncompr_data)
+		extents_count = le16_to_cpu(frag_desc->uncompr_size);
+	else
+		extents_count = le16_to_cpu(frag_desc->compr_size);
+
+	extents_count /= extent_desc_size;
+	extents = (struct ssdfs_translation_extent *)fragment;
+
+	for (i = 0; i < extents_count; i++) {
+		u32 logical_blk = le16_to_cpu(extents[i].logical_blk);
+		u32 len = le16_to_cpu(extents[i].len);
+
+		if (blk_id < logical_blk || blk_id >= (logical_blk + len))
+			continue;
+
+		ssdfs_dumpfs_show_translation_extent(env, i, &extents[i]);
+
+		*offset_id = le16_to_cpu(extents[i].offset_id);
+		*offset_id += blk_id - logical_blk;
+	}
+
+	if (uncompr_data)
+		free(uncompr_data);
+
+	return 0;
+}
+
+static
+int ssdfs_dumpfs_find_in_offsets_fragment(struct ssdfs_dumpfs_environment *env,
+					  struct ssdfs_fragment_desc *frag_desc,
+					  u8 *data, u32 offset_id)
+{
+	struct ssdfs_phys_offset_table_header *pot_table;
+	size_t pot_desc_size = sizeof(struct ssdfs_phys_offset_table_header);
+	struct ssdfs_phys_offset_descriptor *off_desc;
+	size_t off_desc_size = sizeof(struct ssdfs_phys_offset_descriptor);
+	u32 blk_id = env->filter.blk_id;
+	u8 *fragment;
+	u8 *uncompr_data;
+	u32 uncompr_size = le16_to_cpu(frag_desc->uncompr_size);
+	u16 start_id;
+	u16 id_count;
+	int found = SSDFS_FALSE;
+	int i;
+	int err;
+
+	if (uncompr_size < pot_desc_size) {
+		SSDFS_ERR("uncompr_size %u < pot_desc_size %zu\n",
+			  uncompr_size, pot_desc_size);
+		return -EINVAL;
+	}
+
+	err = ssdfs_dumpfs_unpack_fragment(env, frag_desc, data,
+					   &fragment, &uncompr_data);
+	if (err)
+		return err;
+
+	pot_table = (struct ssdfs_phys_offset_table_header *)fragment;
+	start_id = le16_to_cpu(pot_table->start_id);
+	id_count = le16_to_cpu(pot_table->id_count);
+
+	if (uncompr_size < (pot_desc_size + (off_desc_size * id_count))) {
+		err = -ERANGE;
+		SSDFS_ERR("uncompr_size %u, id_count %u, off_desc_size %zu\n",
+			  uncompr_size, id_count, off_desc_size);
+		goto finish_find_in_fragment;
+	}
+
+	for (i = 0; i < id_count; i++) {
+		off_desc =
+			(struct ssdfs_phys_offset_descriptor *)(fragment +
+							pot_desc_size +
+							(off_desc_size * i));
+
+		if (offset_id != U32_MAX) {
+			if (offset_id != (start_id + i))
+				continue;
+		} else if (le16_to_cpu(off_desc->page_desc.logical_blk) !=
+								blk_id) {
+			continue;
+		}
+
+		ssdfs_dumpfs_show_phys_offset_descriptor(env, start_id + i,
+							 off_desc);
+		found = SSDFS_TRUE;
+	}
+
+	if (!found)
+		err = -ENOENT;
+
+finish_find_in_fragment:
+	if (uncompr_data)
+		free(uncompr_data);
+
+	return err;
+}
+
+/*
+ * ssdfs_dumpfs_find_blk2off_block() - find logical block in blk2off table
+ * @env: pointer on environment
+ * @area_buf: blk2off table area
+ * @area_size: size of blk2off table area in bytes
+ *
+ * This function shows the translation extent and the physical
+ * offset descriptor of @env->filter.blk_id. The offset ID of
+ * the translation extent selects the physical offset descriptor
+ * and the search stops on the fragment that contains it.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_dumpfs_find_blk2off_block(struct ssdfs_dumpfs_environment *env,
+				    void *area_buf, u32 area_size)
+{
+	struct ssdfs_blk2off_table_header *hdr;
+	struct ssdfs_fragment_desc *frag_desc;
+	size_t hdr_size = sizeof(struct ssdfs_blk2off_table_header);
+	u32 offset_id = U32_MAX;
+	u32 parsed_bytes = 0;
+	u32 compr_size;
+	int next_fragment_exist;
+	int found = SSDFS_FALSE;
+	u16 fragments_count;
+	int i;
+	int err;
+
+	SSDFS_DUMPFS_DUMP(env, "BLK2OFF TABLE: LOGICAL BLOCK %u\n",
+			  env->filter.blk_id);
+
+	do {
+		next_fragment_exist = SSDFS_FALSE;
+
+		if ((parsed_bytes + hdr_size) > area_size) {
+			SSDFS_ERR("parsed_bytes %u, hdr_size %zu, "
+				  "area_size %u\n",
+				  parsed_bytes, hdr_size, area_size);
+			return -E2BIG;
+		}
+
+		hdr = (struct ssdfs_blk2off_table_header *)((u8 *)area_buf +
+								parsed_bytes);
+		fragments_count = le16_to_cpu(hdr->chain_hdr.fragments_count);
+		fragments_count = min_t(u16, fragments_count,
+					SSDFS_BLK2OFF_TBL_MAX);
+
+		parsed_bytes += hdr_size;
+
+		for (i = 0; i < fragments_count; i++) {
+			frag_desc = &hdr->blk[i];
+			compr_size = le16_to_cpu(frag_desc->compr_size);
+
+			switch (frag_desc->type) {
+			case SSDFS_BLK2OFF_EXTENT_DESC:
+			case SSDFS_BLK2OFF_EXTENT_DESC_ZLIB:
+			case SSDFS_BLK2OFF_EXTENT_DESC_LZO:
+			case SSDFS_BLK2OFF_EXTENT_DESC_LZ4:
+			case SSDFS_BLK2OFF_EXTENT_DESC_ZSTD:
+				if ((parsed_bytes + compr_size) > area_size)
+					return -E2BIG;
+
+				err = ssdfs_dumpfs_find_in_extents_fragment(env,
+						frag_desc,
+						(u8 *)area_buf + parsed_bytes,
+						&offset_id);
+				if (err) {
+					SSDFS_ERR("fail to find in fragment: "
+						  "index %d, err %d\n",
+						  i, err);
+				}
+
+				parsed_bytes += compr_size;
+				break;
+
+			case SSDFS_BLK2OFF_DESC:
+			case SSDFS_BLK2OFF_DESC_ZLIB:
+			case SSDFS_BLK2OFF_DESC_LZO:
+			case SSDFS_BLK2OFF_DESC_LZ4:
+			case SSDFS_BLK2OFF_DESC_ZSTD:
+				if ((parsed_bytes + compr_size) > area_size)
+					return -E2BIG;
+
+				err = ssdfs_dumpfs_find_in_offsets_fragment(env,
+						frag_desc,
+						(u8 *)area_buf + parsed_bytes,
+						offset_id);
+				if (!err) {
+					found = SSDFS_TRUE;
+
+					/* offset ID is unique */
+					if (offset_id != U32_MAX)
+						return 0;
+				} else if (err != -ENOENT) {
+					SSDFS_ERR("fail to find in fragment: "
+						  "index %d, err %d\n",
+						  i, err);
+				}
+
+				parsed_bytes += compr_size;
+				break;
+
+			case SSDFS_NEXT_TABLE_DESC:
+				parsed_bytes = le32_to_cpu(frag_desc->offset);
+				next_fragment_exist = SSDFS_TRUE;
+				break;
+			}
+		}
+	} while (next_fragment_exist == SSDFS_TRUE);
+
+	if (!found)
+		SSDFS_DUMPFS_DUMP(env, "OFFSET ID: NOT FOUND\n");
+
+	return 0;
+}
+
 static
 int ssdfs_dumpfs_parse_blk2off_area(struct ssdfs_dumpfs_environment *env,
 				    struct ssdfs_metadata_descriptor *desc)
@@ -1713,24 +2192,8 @@ int ssdfs_dumpfs_parse_blk2off_area(struct ssdfs_dumpfs_environment *env,
 		  area_offset, area_size);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			err = -ENOMEM;
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			goto finish_parse_blk2off_area;
-		}
-
-		memset(area_buf, 0, area_size);
-
-		err = ssdfs_dumpfs_read_blk2off_table(env,
-						     env->peb.id,
-						     env->peb.peb_size,
-						     env->peb.log_offset,
-						     env->peb.log_size,
-						     area_offset,
-						     area_size,
-						     area_buf);
+		err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+					    &area_buf);
 		if (err) {
 			SSDFS_ERR("fail to read blk2off table: "
 				  "peb_id %llu, peb_size %u, "
@@ -1740,6 +2203,20 @@ int ssdfs_dumpfs_parse_blk2off_area(struct ssdfs_dumpfs_environment *env,
 			goto finish_parse_blk2off_table;
 		}
 
+		if (SSDFS_DUMPFS_BLK_FILTER(env)) {
+			err = ssdfs_dumpfs_find_blk2off_block(env, area_buf,
+							      area_size);
+			if (err) {
+				SSDFS_ERR("fail to find logical block: "
+					  "peb_id %llu, log_index %u, "
+					  "blk_id %u, err %d\n",
+					  env->peb.id, env->peb.log_index,
+					  env->filter.blk_id, err);
+			}
+
+			goto finish_parse_blk2off_table;
+		}
+
 		err = ssdfs_dumpfs_parse_blk2off_table(env, area_buf,
 							area_size);
 		if (err) {
@@ -1750,9 +2227,6 @@ int ssdfs_dumpfs_parse_blk2off_area(struct ssdfs_dumpfs_environment *env,
 		}
 
 finish_parse_blk2off_table:
-		free(area_buf);
-		area_buf = NULL;
-
 		SSDFS_DUMPFS_DUMP(env, "\n");
 
 		if (env->is_raw_dump_requested) {
@@ -1777,6 +2251,38 @@ finish_parse_blk2off_area:
 	return err;
 }
 
+static
+int ssdfs_dumpfs_show_log_footer_record(struct ssdfs_dumpfs_environment *env,
+					struct ssdfs_log_footer *footer)
+{
+	struct ssdfs_volume_state *vs = &footer->volume_state;
+	struct ssdfs_dumpfs_record rec;
+	int err;
+
+	err = ssdfs_dumpfs_record_start(env, &rec,
+					SSDFS_DUMPFS_LOG_FOOTER_RECORD);
+	if (err)
+		return err;
+
+	ssdfs_dumpfs_record_add_u64(&rec, "timestamp",
+				    le64_to_cpu(footer->timestamp));
+	ssdfs_dumpfs_record_add_u64(&rec, "cno", le64_to_cpu(footer->cno));
+	ssdfs_dumpfs_record_add_u64(&rec, "log_bytes",
+				    le32_to_cpu(footer->log_bytes));
+	ssdfs_dumpfs_record_add_u64(&rec, "log_flags",
+				    le32_to_cpu(footer->log_flags));
+	ssdfs_dumpfs_record_add_u64(&rec, "peb_create_time",
+				    le64_to_cpu(footer->peb_create_time));
+	ssdfs_dumpfs_record_add_u64(&rec, "nsegs", le64_to_cpu(vs->nsegs));
+	ssdfs_dumpfs_record_add_u64(&rec, "free_pages",
+				    le64_to_cpu(vs->free_pages));
+	ssdfs_dumpfs_record_add_u64(&rec, "state", le16_to_cpu(vs->state));
+	ssdfs_dumpfs_record_add_bytes(&rec, "raw", footer,
+				      sizeof(struct ssdfs_log_footer));
+
+	return ssdfs_dumpfs_record_finish(env, &rec);
+}
+
 static
 int __ssdfs_dumpfs_parse_log_footer(struct ssdfs_dumpfs_environment *env,
 				    u32 area_offset,
@@ -1803,6 +2309,9 @@ int __ssdfs_dumpfs_parse_log_footer(struct ssdfs_dumpfs_environment *env,
 	log_footer = (struct ssdfs_log_footer *)area_buf;
 	vs = &log_footer->volume_state;
 
+	if (SSDFS_DUMPFS_STRUCTURED(env))
+		return ssdfs_dumpfs_show_log_footer_record(env, log_footer);
+
 	SSDFS_DUMPFS_DUMP(env, "LOG FOOTER:\n");
 
 	ssdfs_dumpfs_parse_magic(env, &log_footer->volume_state.magic);
@@ -2998,6 +3507,48 @@ void ssdfs_dumpfs_parse_segbmap_sb_header(struct ssdfs_dumpfs_environment *env,
 	}
 }
 
+static
+int ssdfs_dumpfs_show_segment_header_record(struct ssdfs_dumpfs_environment *env,
+					    struct ssdfs_segment_header *hdr)
+{
+	struct ssdfs_volume_header *vh = &hdr->volume_hdr;
+	struct ssdfs_dumpfs_record rec;
+	int err;
+
+	err = ssdfs_dumpfs_record_start(env, &rec,
+					SSDFS_DUMPFS_SEGMENT_HEADER_RECORD);
+	if (err)
+		return err;
+
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_id", le64_to_cpu(hdr->seg_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "leb_id", le64_to_cpu(hdr->leb_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "hdr_peb_id",
+				    le64_to_cpu(hdr->peb_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "relation_peb_id",
+				    le64_to_cpu(hdr->relation_peb_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_type",
+				    le16_to_cpu(hdr->seg_type));
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_flags",
+				    le32_to_cpu(hdr->seg_flags));
+	ssdfs_dumpfs_record_add_u64(&rec, "log_pages",
+				    le16_to_cpu(hdr->log_pages));
+	ssdfs_dumpfs_record_add_u64(&rec, "timestamp",
+				    le64_to_cpu(hdr->timestamp));
+	ssdfs_dumpfs_record_add_u64(&rec, "cno", le64_to_cpu(hdr->cno));
+	ssdfs_dumpfs_record_add_u64(&rec, "peb_create_time",
+				    le64_to_cpu(hdr->peb_create_time));
+	ssdfs_dumpfs_record_add_u64(&rec, "page_size", 1 << vh->log_pagesize);
+	ssdfs_dumpfs_record_add_u64(&rec, "erase_size",
+				    1 << vh->log_erasesize);
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_size", 1 << vh->log_segsize);
+	ssdfs_dumpfs_record_add_u64(&rec, "create_time",
+				    le64_to_cpu(vh->create_time));
+	ssdfs_dumpfs_record_add_bytes(&rec, "raw", hdr,
+				      sizeof(struct ssdfs_segment_header));
+
+	return ssdfs_dumpfs_record_finish(env, &rec);
+}
+
 static
 void ssdfs_dumpfs_parse_segment_header(struct ssdfs_dumpfs_environment *env,
 					struct ssdfs_segment_header *hdr)
@@ -3025,6 +3576,11 @@ void ssdfs_dumpfs_parse_segment_header(struct ssdfs_dumpfs_environment *env,
 	SSDFS_DBG(env->base.show_debug,
 		  "parse segment header\n");
 
+	if (SSDFS_DUMPFS_STRUCTURED(env)) {
+		ssdfs_dumpfs_show_segment_header_record(env, hdr);
+		return;
+	}
+
 	seg_id = le64_to_cpu(hdr->seg_id);
 	leb_id = le64_to_cpu(hdr->leb_id);
 	peb_id = le64_to_cpu(hdr->peb_id);
@@ -3303,24 +3859,9 @@ int ssdfs_dumpfs_read_footer_log_bytes(struct ssdfs_dumpfs_environment *env,
 	seg_flags = le32_to_cpu(buf->seg_hdr.seg_flags);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			return -ENOMEM;
-		}
-
-		memset(area_buf, 0, area_size);
-
 		if (seg_flags & SSDFS_PARTIAL_HEADER_INSTEAD_FOOTER) {
-			err = ssdfs_dumpfs_read_partial_log_footer(env,
-							   env->peb.id,
-							   env->peb.peb_size,
-							   env->peb.log_offset,
-							   env->peb.log_size,
-							   area_offset,
-							   area_size,
-							   area_buf);
+			err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+						    &area_buf);
 			if (err) {
 				SSDFS_ERR("fail to read partial log footer: "
 					  "peb_id %llu, peb_size %u, "
@@ -3329,45 +3870,36 @@ int ssdfs_dumpfs_read_footer_log_bytes(struct ssdfs_dumpfs_environment *env,
 					  env->peb.id, env->peb.peb_size,
 					  env->peb.log_index,
 					  env->peb.log_offset, err);
-				goto finish_read_log_size;
+				return err;
 			}
 
 			pl_hdr = (struct ssdfs_partial_log_header *)area_buf;
 			env->peb.log_size = le32_to_cpu(pl_hdr->log_bytes);
+			env->peb.log_size_inherited = SSDFS_FALSE;
 		} else if (seg_flags & SSDFS_LOG_HAS_FOOTER) {
-			err = ssdfs_dumpfs_read_log_footer(env,
-							   env->peb.id,
-							   env->peb.peb_size,
-							   env->peb.log_offset,
-							   env->peb.log_size,
-							   area_offset,
-							   area_size,
-							   area_buf);
+			err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+						    &area_buf);
 			if (err) {
 				SSDFS_ERR("fail to read log footer: "
 					  "peb_id %llu, peb_size %u, "
 					  "log_offset %u, err %d\n",
 					  env->peb.id, env->peb.peb_size,
 					  env->peb.log_offset, err);
-				goto finish_read_log_size;
+				return err;
 			}
 
 			footer = (struct ssdfs_log_footer *)area_buf;
 			env->peb.log_size = le32_to_cpu(footer->log_bytes);
+			env->peb.log_size_inherited = SSDFS_FALSE;
 		} else {
 			err = -EIO;
 			SSDFS_ERR("segment header is corrupted\n");
 		}
-
-finish_read_log_size:
-		free(area_buf);
-		area_buf = NULL;
 	}
 
 	return err;
 }
 
-static
 int ssdfs_dumpfs_read_log_bytes(struct ssdfs_dumpfs_environment *env,
 				union ssdfs_metadata_header *buf)
 {
@@ -3404,6 +3936,7 @@ int ssdfs_dumpfs_read_log_bytes(struct ssdfs_dumpfs_environment *env,
 		} else if (key == SSDFS_PARTIAL_LOG_HDR_MAGIC) {
 			env->peb.log_size =
 				le32_to_cpu(buf->pl_hdr.log_bytes);
+			env->peb.log_size_inherited = SSDFS_FALSE;
 		} else if (key == SSDFS_PADDING_HDR_MAGIC) {
 			SSDFS_DBG(env->base.show_debug,
 				  "found padding block\n");
@@ -3425,6 +3958,45 @@ int ssdfs_dumpfs_read_log_bytes(struct ssdfs_dumpfs_environment *env,
 	return 0;
 }
 
+static int
+ssdfs_dumpfs_show_partial_log_header_record(struct ssdfs_dumpfs_environment *env,
+					struct ssdfs_partial_log_header *pl_hdr)
+{
+	struct ssdfs_dumpfs_record rec;
+	int err;
+
+	err = ssdfs_dumpfs_record_start(env, &rec,
+					SSDFS_DUMPFS_PARTIAL_LOG_HEADER_RECORD);
+	if (err)
+		return err;
+
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_id",
+				    le64_to_cpu(pl_hdr->seg_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "leb_id",
+				    le64_to_cpu(pl_hdr->leb_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "hdr_peb_id",
+				    le64_to_cpu(pl_hdr->peb_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "relation_peb_id",
+				    le64_to_cpu(pl_hdr->relation_peb_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_type",
+				    le16_to_cpu(pl_hdr->seg_type));
+	ssdfs_dumpfs_record_add_u64(&rec, "pl_flags",
+				    le32_to_cpu(pl_hdr->pl_flags));
+	ssdfs_dumpfs_record_add_u64(&rec, "log_pages",
+				    le16_to_cpu(pl_hdr->log_pages));
+	ssdfs_dumpfs_record_add_u64(&rec, "log_bytes",
+				    le32_to_cpu(pl_hdr->log_bytes));
+	ssdfs_dumpfs_record_add_u64(&rec, "sequence_id",
+				    le32_to_cpu(pl_hdr->sequence_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "timestamp",
+				    le64_to_cpu(pl_hdr->timestamp));
+	ssdfs_dumpfs_record_add_u64(&rec, "cno", le64_to_cpu(pl_hdr->cno));
+	ssdfs_dumpfs_record_add_bytes(&rec, "raw", pl_hdr,
+				sizeof(struct ssdfs_partial_log_header));
+
+	return ssdfs_dumpfs_record_finish(env, &rec);
+}
+
 static int
 __ssdfs_dumpfs_parse_partial_log_header(struct ssdfs_dumpfs_environment *env,
 					u32 area_offset,
@@ -3462,6 +4034,9 @@ __ssdfs_dumpfs_parse_partial_log_header(struct ssdfs_dumpfs_environment *env,
 
 	pl_hdr = (struct ssdfs_partial_log_header *)area_buf;
 
+	if (SSDFS_DUMPFS_STRUCTURED(env))
+		return ssdfs_dumpfs_show_partial_log_header_record(env, pl_hdr);
+
 	seg_id = le64_to_cpu(pl_hdr->seg_id);
 	leb_id = le64_to_cpu(pl_hdr->leb_id);
 	peb_id = le64_to_cpu(pl_hdr->peb_id);
@@ -3749,25 +4324,9 @@ int ssdfs_dumpfs_parse_log_footer(struct ssdfs_dumpfs_environment *env,
 	area_size = le32_to_cpu(desc->size);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			err = -ENOMEM;
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			goto fail_parse_log_footer;
-		}
-
-		memset(area_buf, 0, area_size);
-
 		if (is_log_partial) {
-			err = ssdfs_dumpfs_read_partial_log_footer(env,
-							   env->peb.id,
-							   env->peb.peb_size,
-							   env->peb.log_offset,
-							   env->peb.log_size,
-							   area_offset,
-							   area_size,
-							   area_buf);
+			err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+						    &area_buf);
 			if (err) {
 				SSDFS_ERR("fail to read partial log footer: "
 					  "peb_id %llu, peb_size %u, "
@@ -3792,14 +4351,8 @@ int ssdfs_dumpfs_parse_log_footer(struct ssdfs_dumpfs_environment *env,
 				goto finish_parse_log_footer;
 			}
 		} else {
-			err = ssdfs_dumpfs_read_log_footer(env,
-							   env->peb.id,
-							   env->peb.peb_size,
-							   env->peb.log_offset,
-							   env->peb.log_size,
-							   area_offset,
-							   area_size,
-							   area_buf);
+			err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+						    &area_buf);
 			if (err) {
 				SSDFS_ERR("fail to read log footer: "
 					  "peb_id %llu, peb_size %u, "
@@ -3826,9 +4379,6 @@ int ssdfs_dumpfs_parse_log_footer(struct ssdfs_dumpfs_environment *env,
 		}
 
 finish_parse_log_footer:
-		free(area_buf);
-		area_buf = NULL;
-
 		if (err)
 			goto fail_parse_log_footer;
 	}
@@ -4219,8 +4769,85 @@ int ssdfs_dumpfs_parse_peb_tbl_fragment(struct ssdfs_dumpfs_environment *env,
 	return err;
 }
 
-typedef int (*metadata_parse_func)(struct ssdfs_dumpfs_environment *env,
-				   u8 *frag_buf, u32 frag_size);
+static
+int ssdfs_dumpfs_show_maptbl_fragment_record(struct ssdfs_dumpfs_environment *env,
+					     u8 *frag_buf, u32 frag_size)
+{
+	struct ssdfs_leb_table_fragment_header *leb_hdr;
+	struct ssdfs_peb_table_fragment_header *peb_hdr;
+	struct ssdfs_dumpfs_record rec;
+	u16 magic;
+	int err;
+
+	magic = le16_to_cpu(*(__le16 *)frag_buf);
+
+	if (magic == SSDFS_LEB_TABLE_MAGIC) {
+		if (frag_size < sizeof(struct ssdfs_leb_table_fragment_header))
+			goto corrupted_fragment;
+	} else if (magic == SSDFS_PEB_TABLE_MAGIC) {
+		if (frag_size < sizeof(struct ssdfs_peb_table_fragment_header))
+			goto corrupted_fragment;
+	} else {
+		SSDFS_ERR("unexpected magic %#x\n",
+			  magic);
+		return -EIO;
+	}
+
+	err = ssdfs_dumpfs_record_start(env, &rec,
+					SSDFS_DUMPFS_MAPTBL_FRAGMENT_RECORD);
+	if (err)
+		return err;
+
+	if (magic == SSDFS_LEB_TABLE_MAGIC) {
+		leb_hdr = (struct ssdfs_leb_table_fragment_header *)frag_buf;
+
+		ssdfs_dumpfs_record_add_string(&rec, "fragment_type",
+						"leb_table");
+		ssdfs_dumpfs_record_add_u64(&rec, "start_leb",
+					    le64_to_cpu(leb_hdr->start_leb));
+		ssdfs_dumpfs_record_add_u64(&rec, "lebs_count",
+					    le16_to_cpu(leb_hdr->lebs_count));
+		ssdfs_dumpfs_record_add_u64(&rec, "mapped_lebs",
+					    le16_to_cpu(leb_hdr->mapped_lebs));
+		ssdfs_dumpfs_record_add_u64(&rec, "migrating_lebs",
+					le16_to_cpu(leb_hdr->migrating_lebs));
+		ssdfs_dumpfs_record_add_u64(&rec, "portion_id",
+					    le16_to_cpu(leb_hdr->portion_id));
+		ssdfs_dumpfs_record_add_u64(&rec, "fragment_id",
+					    le16_to_cpu(leb_hdr->fragment_id));
+		ssdfs_dumpfs_record_add_u64(&rec, "bytes_count",
+					    le32_to_cpu(leb_hdr->bytes_count));
+	} else {
+		peb_hdr = (struct ssdfs_peb_table_fragment_header *)frag_buf;
+
+		ssdfs_dumpfs_record_add_string(&rec, "fragment_type",
+						"peb_table");
+		ssdfs_dumpfs_record_add_u64(&rec, "start_peb",
+					    le64_to_cpu(peb_hdr->start_peb));
+		ssdfs_dumpfs_record_add_u64(&rec, "pebs_count",
+					    le16_to_cpu(peb_hdr->pebs_count));
+		ssdfs_dumpfs_record_add_u64(&rec, "reserved_pebs",
+					le16_to_cpu(peb_hdr->reserved_pebs));
+		ssdfs_dumpfs_record_add_u64(&rec, "stripe_id",
+					    le16_to_cpu(peb_hdr->stripe_id));
+		ssdfs_dumpfs_record_add_u64(&rec, "portion_id",
+					    le16_to_cpu(peb_hdr->portion_id));
+		ssdfs_dumpfs_record_add_u64(&rec, "fragment_id",
+					    le16_to_cpu(peb_hdr->fragment_id));
+		ssdfs_dumpfs_record_add_u64(&rec, "bytes_count",
+					    le32_to_cpu(peb_hdr->bytes_count));
+	}
+
+	ssdfs_dumpfs_record_add_bytes(&rec, "raw", frag_buf, frag_size);
+
+	return ssdfs_dumpfs_record_finish(env, &rec);
+
+corrupted_fragment:
+	SSDFS_ERR("corrupted fragment: "
+		  "magic %#x, frag_size %u\n",
+		  magic, frag_size);
+	return -EIO;
+}
 
 static
 int ssdfs_dumpfs_parse_maptbl_fragment(struct ssdfs_dumpfs_environment *env,
@@ -4231,6 +4858,11 @@ int ssdfs_dumpfs_parse_maptbl_fragment(struct ssdfs_dumpfs_environment *env,
 
 	frag_size = min_t(u32, frag_size, env->base.page_size);
 
+	if (SSDFS_DUMPFS_STRUCTURED(env)) {
+		return ssdfs_dumpfs_show_maptbl_fragment_record(env, frag_buf,
+								frag_size);
+	}
+
 	magic = le16_to_cpu(*(__le16 *)frag_buf);
 
 	if (magic == SSDFS_LEB_TABLE_MAGIC) {
@@ -4292,8 +4924,54 @@ int ssdfs_segbmap_get_state_from_byte(u8 *byte_ptr, u32 byte_item)
 {
 	u32 shift;
 
-	shift = byte_item * SSDFS_SEG_STATE_BITS;
-	return (int)((*byte_ptr >> shift) & SSDFS_SEG_STATE_MASK);
+	shift = byte_item * SSDFS_SEG_STATE_BITS;
+	return (int)((*byte_ptr >> shift) & SSDFS_SEG_STATE_MASK);
+}
+
+static
+int ssdfs_dumpfs_show_segbmap_fragment_record(struct ssdfs_dumpfs_environment *env,
+					      u8 *frag_buf, u32 frag_size)
+{
+	struct ssdfs_segbmap_fragment_header *hdr;
+	struct ssdfs_dumpfs_record rec;
+	int err;
+
+	if (frag_size < sizeof(struct ssdfs_segbmap_fragment_header)) {
+		SSDFS_ERR("corrupted fragment: frag_size %u\n",
+			  frag_size);
+		return -EIO;
+	}
+
+	hdr = (struct ssdfs_segbmap_fragment_header *)frag_buf;
+
+	err = ssdfs_dumpfs_record_start(env, &rec,
+					SSDFS_DUMPFS_SEGBMAP_FRAGMENT_RECORD);
+	if (err)
+		return err;
+
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_index",
+				    le16_to_cpu(hdr->seg_index));
+	ssdfs_dumpfs_record_add_u64(&rec, "peb_index",
+				    le16_to_cpu(hdr->peb_index));
+	ssdfs_dumpfs_record_add_u64(&rec, "flags", hdr->flags);
+	ssdfs_dumpfs_record_add_u64(&rec, "seg_type", hdr->seg_type);
+	ssdfs_dumpfs_record_add_u64(&rec, "start_item",
+				    le64_to_cpu(hdr->start_item));
+	ssdfs_dumpfs_record_add_u64(&rec, "sequence_id",
+				    le16_to_cpu(hdr->sequence_id));
+	ssdfs_dumpfs_record_add_u64(&rec, "fragment_bytes",
+				    le16_to_cpu(hdr->fragment_bytes));
+	ssdfs_dumpfs_record_add_u64(&rec, "total_segs",
+				    le16_to_cpu(hdr->total_segs));
+	ssdfs_dumpfs_record_add_u64(&rec, "clean_or_using_segs",
+				    le16_to_cpu(hdr->clean_or_using_segs));
+	ssdfs_dumpfs_record_add_u64(&rec, "used_or_dirty_segs",
+				    le16_to_cpu(hdr->used_or_dirty_segs));
+	ssdfs_dumpfs_record_add_u64(&rec, "bad_segs",
+				    le16_to_cpu(hdr->bad_segs));
+	ssdfs_dumpfs_record_add_bytes(&rec, "raw", frag_buf, frag_size);
+
+	return ssdfs_dumpfs_record_finish(env, &rec);
 }
 
 static
@@ -4315,6 +4993,11 @@ int ssdfs_dumpfs_parse_segbmap_fragment(struct ssdfs_dumpfs_environment *env,
 
 	frag_size = min_t(u32, frag_size, env->base.page_size);
 
+	if (SSDFS_DUMPFS_STRUCTURED(env)) {
+		return ssdfs_dumpfs_show_segbmap_fragment_record(env, frag_buf,
+								 frag_size);
+	}
+
 	hdr = (struct ssdfs_segbmap_fragment_header *)frag_buf;
 
 	SSDFS_DUMPFS_DUMP(env, "SEGMENT BITMAP HEADER:\n");
@@ -5087,7 +5770,6 @@ int ssdfs_dumpfs_parse_metadata_blocks(struct ssdfs_dumpfs_environment *env,
 	return err;
 }
 
-static
 int __ssdfs_dumpfs_parse_metadata(struct ssdfs_dumpfs_environment *env,
 				  struct ssdfs_metadata_descriptor *desc_array,
 				  metadata_parse_func do_parsing)
@@ -5122,24 +5804,8 @@ int __ssdfs_dumpfs_parse_metadata(struct ssdfs_dumpfs_environment *env,
 		return 0;
 	}
 
-	area_buf = malloc(area_size);
-	if (!area_buf) {
-		err = -ENOMEM;
-		SSDFS_ERR("fail to allocate memory: "
-			  "size %u\n", area_size);
-		goto finish_parse_metadata;
-	}
-
-	memset(area_buf, 0, area_size);
-
-	err = ssdfs_dumpfs_read_blk_desc_array(env,
-						env->peb.id,
-						env->peb.peb_size,
-						env->peb.log_offset,
-						env->peb.log_size,
-						area_offset,
-						area_size,
-						area_buf);
+	err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+				    &area_buf);
 	if (err) {
 		SSDFS_ERR("fail to read block descriptors: "
 			  "peb_id %llu, peb_size %u, "
@@ -5304,10 +5970,6 @@ finish_parse_fragment:
 	}
 
 finish_parse_metadata:
-	if (area_buf)
-		free(area_buf);
-	area_buf = NULL;
-
 	SSDFS_DUMPFS_DUMP(env, "\n");
 
 	return err;
@@ -5443,24 +6105,8 @@ parse_block_state_area:
 	area_size = le32_to_cpu(desc->size);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			err = -ENOMEM;
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			goto close_opened_file;
-		}
-
-		memset(area_buf, 0, area_size);
-
-		err = ssdfs_dumpfs_read_blk_desc_array(env,
-						     env->peb.id,
-						     env->peb.peb_size,
-						     env->peb.log_offset,
-						     env->peb.log_size,
-						     area_offset,
-						     area_size,
-						     area_buf);
+		err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+					    &area_buf);
 		if (err) {
 			SSDFS_ERR("fail to read block descriptors: "
 				  "peb_id %llu, peb_size %u, "
@@ -5484,9 +6130,6 @@ parse_block_state_area:
 		}
 
 finish_parse_blk_desc_array:
-		free(area_buf);
-		area_buf = NULL;
-
 		if (err)
 			goto close_opened_file;
 
@@ -5518,24 +6161,8 @@ parse_maptbl_cache_area:
 	area_size = le32_to_cpu(desc->size);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			err = -ENOMEM;
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			goto close_opened_file;
-		}
-
-		memset(area_buf, 0, area_size);
-
-		err = ssdfs_dumpfs_read_maptbl_cache(env,
-						     env->peb.id,
-						     env->peb.peb_size,
-						     env->peb.log_offset,
-						     env->peb.log_size,
-						     area_offset,
-						     area_size,
-						     area_buf);
+		err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+					    &area_buf);
 		if (err) {
 			SSDFS_ERR("fail to read mapping table cache: "
 				  "peb_id %llu, peb_size %u, "
@@ -5559,9 +6186,6 @@ parse_maptbl_cache_area:
 		}
 
 finish_parse_maptbl_cache:
-		free(area_buf);
-		area_buf = NULL;
-
 		if (err)
 			goto close_opened_file;
 
@@ -5765,24 +6389,8 @@ parse_block_state_area:
 	area_size = le32_to_cpu(desc->size);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			err = -ENOMEM;
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			goto close_opened_file;
-		}
-
-		memset(area_buf, 0, area_size);
-
-		err = ssdfs_dumpfs_read_blk_desc_array(env,
-						     env->peb.id,
-						     env->peb.peb_size,
-						     env->peb.log_offset,
-						     env->peb.log_size,
-						     area_offset,
-						     area_size,
-						     area_buf);
+		err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+					    &area_buf);
 		if (err) {
 			SSDFS_ERR("fail to read block descriptors: "
 				  "peb_id %llu, peb_size %u, "
@@ -5806,9 +6414,6 @@ parse_block_state_area:
 		}
 
 finish_parse_blk_desc_array:
-		free(area_buf);
-		area_buf = NULL;
-
 		if (err)
 			goto close_opened_file;
 
@@ -5863,24 +6468,8 @@ parse_log_footer:
 	area_size = le32_to_cpu(desc->size);
 
 	if (is_ssdfs_dumpfs_area_valid(desc)) {
-		area_buf = malloc(area_size);
-		if (!area_buf) {
-			err = -ENOMEM;
-			SSDFS_ERR("fail to allocate memory: "
-				  "size %u\n", area_size);
-			goto close_opened_file;
-		}
-
-		memset(area_buf, 0, area_size);
-
-		err = ssdfs_dumpfs_read_log_footer(env,
-						   env->peb.id,
-						   env->peb.peb_size,
-						   env->peb.log_offset,
-						   env->peb.log_size,
-						   area_offset,
-						   area_size,
-						   area_buf);
+		err = ssdfs_dumpfs_get_area(env, area_offset, area_size,
+					    &area_buf);
 		if (err) {
 			SSDFS_ERR("fail to read log footer: "
 				  "peb_id %llu, peb_size %u, "
@@ -5906,9 +6495,6 @@ parse_log_footer:
 		}
 
 finish_parse_log_footer:
-		free(area_buf);
-		area_buf = NULL;
-
 		if (err)
 			goto close_opened_file;
 	}
@@ -5944,6 +6530,418 @@ finish_parse_partial_log:
 	return err;
 }
 
+/*
+ * ssdfs_dumpfs_show_peb_logs() - dump logs of one PEB
+ * @env: dumpfs environment
+ * @max_logs: maximal number of logs in PEB for processing
+ * @log_index: index of the first log for dumping
+ * @speculation: speculative dump's state (NULL for exact dump)
+ *
+ * This method dumps logs of PEB with @env->peb.id. PEB inherits
+ * the log's size from previous PEB. If @speculation is not NULL,
+ * then inherited log's size is only a guess and the method stops
+ * dumping when the dump starts to depend on this value.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code of the last processed log:
+ *
+ * %-EAGAIN     - dump depends on inherited log's size.
+ */
+static
+int ssdfs_dumpfs_show_peb_logs(struct ssdfs_dumpfs_environment *env,
+			       u32 max_logs, int log_index,
+			       struct ssdfs_dumpfs_peb_output *speculation)
+{
+	union ssdfs_metadata_header buf;
+	int i;
+	int err = 0;
+
+	env->peb.log_index = 0;
+	env->peb.logs_count = max_logs;
+	env->peb.log_offset = 0;
+	env->peb.log_size_inherited = SSDFS_TRUE;
+
+	if (env->base.show_info) {
+		fprintf(SSDFS_DUMPFS_STDOUT(env),
+			dumpfs_fmt("DUMPING PEB %llu\n"),
+			env->peb.id);
+	}
+
+	SSDFS_DBG(env->base.show_debug,
+		  "peb_id %llu, pebs_count %llu, "
+		  "log_index %u, logs_count %u\n",
+		  env->peb.id, env->peb.pebs_count,
+		  env->peb.log_index, env->peb.logs_count);
+
+	for (i = 0; i < max_logs; i++) {
+		SSDFS_DBG(env->base.show_debug,
+			  "peb_id %llu, pebs_count %llu, "
+			  "log_index %u, max_logs %u\n",
+			  env->peb.id, env->peb.pebs_count,
+			  i, max_logs);
+
+		if (env->peb.log_offset >= env->peb.peb_size) {
+			SSDFS_DBG(env->base.show_debug,
+				  "peb_id %llu, pebs_count %llu, "
+				  "log_index %u, logs_count %u\n",
+				  env->peb.id, env->peb.pebs_count,
+				  env->peb.log_index, env->peb.logs_count);
+			return err;
+		}
+
+		err = ssdfs_dumpfs_read_log_bytes(env, &buf);
+		if (err == -ENODATA) {
+			SSDFS_DBG(env->base.show_debug,
+				  "LOG ABSENT: peb_id: %llu, log_index %u, "
+				  "log_offset %u\n",
+				  env->peb.id, env->peb.log_index,
+				  env->peb.log_offset);
+			return err;
+		} else if (err) {
+			SSDFS_ERR("fail to read log's size in bytes: "
+				  "peb_id %llu, peb_size %u, "
+				  "log_offset %u, err %d\n",
+				  env->peb.id, env->peb.peb_size,
+				  env->peb.log_offset, err);
+			return err;
+		}
+
+		if (speculation && env->peb.log_size_inherited) {
+			if (le32_to_cpu(buf.magic.common) != SSDFS_SUPER_MAGIC)
+				speculation->log_size_checked = SSDFS_TRUE;
+		}
+
+		if (i < log_index) {
+			goto try_next_log;
+		}
+
+		if (le32_to_cpu(buf.magic.common) == SSDFS_SUPER_MAGIC &&
+		    speculation && env->peb.log_size_inherited) {
+			speculation->needs_rerun = SSDFS_TRUE;
+			return -EAGAIN;
+		}
+
+		if (le32_to_cpu(buf.magic.common) == SSDFS_SUPER_MAGIC &&
+		    le16_to_cpu(buf.magic.key) == SSDFS_SEGMENT_HDR_MAGIC) {
+			err = ssdfs_dumpfs_parse_full_log(env, &buf);
+			ssdfs_dumpfs_flush_output(env);
+			if (err) {
+				SSDFS_ERR("fail to parse the full log: "
+					  "err %d\n", err);
+				return err;
+			}
+		} else if (le32_to_cpu(buf.magic.common) == SSDFS_SUPER_MAGIC &&
+			   le16_to_cpu(buf.magic.key) == SSDFS_PARTIAL_LOG_HDR_MAGIC) {
+			err = ssdfs_dumpfs_parse_partial_log(env, &buf);
+			ssdfs_dumpfs_flush_output(env);
+			if (err) {
+				SSDFS_ERR("fail to parse the partial log: "
+					  "err %d\n", err);
+				return err;
+			}
+		} else {
+			SSDFS_DBG(env->base.show_debug,
+				  "LOG ABSENT: peb_id: %llu, log_index %u, "
+				  "log_offset %u\n",
+				  env->peb.id, env->peb.log_index,
+				  env->peb.log_offset);
+			return err;
+		}
+
+try_next_log:
+		if (speculation && env->peb.log_size_inherited) {
+			speculation->needs_rerun = SSDFS_TRUE;
+			return -EAGAIN;
+		}
+
+		SSDFS_DBG(env->base.show_debug,
+			  "CURRENT LOG: peb_id %llu, pebs_count %llu, "
+			  "log_index %u, logs_count %u, "
+			  "log_size %u, log_offset %u\n",
+			  env->peb.id, env->peb.pebs_count,
+			  env->peb.log_index, env->peb.logs_count,
+			  env->peb.log_size,
+			  env->peb.log_offset);
+
+		env->peb.log_index++;
+		env->peb.logs_count--;
+		env->peb.log_offset += env->peb.log_size;
+
+		SSDFS_DBG(env->base.show_debug,
+			  "NEXT LOG: peb_id %llu, pebs_count %llu, "
+			  "log_index %u, logs_count %u, "
+			  "log_size %u, log_offset %u\n",
+			  env->peb.id, env->peb.pebs_count,
+			  env->peb.log_index, env->peb.logs_count,
+			  env->peb.log_size,
+			  env->peb.log_offset);
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_dumpfs_peb_dump_thread() - thread of PEBs dumping
+ * @arg: pointer on thread's job
+ *
+ * Thread takes the next PEB of the range, dumps it into
+ * private memory stream and stores the result into the
+ * ring of outputs. The thread waits if the ring has no space
+ * for PEB's output because the emitter hasn't emitted
+ * previous PEBs yet.
+ */
+static
+void *ssdfs_dumpfs_peb_dump_thread(void *arg)
+{
+	struct ssdfs_dumpfs_peb_dump_job *job =
+				(struct ssdfs_dumpfs_peb_dump_job *)arg;
+	struct ssdfs_dumpfs_peb_dump_pool *pool;
+	struct ssdfs_dumpfs_environment *env;
+
+	if (!job)
+		pthread_exit((void *)1);
+
+	pool = job->pool;
+	env = &job->env;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "thread %u\n", job->id);
+
+	job->err = 0;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->next_peb < pool->pebs_count) {
+		struct ssdfs_dumpfs_peb_output result;
+		u64 index = pool->next_peb++;
+
+		while (index >= (pool->emitted + pool->window))
+			pthread_cond_wait(&pool->cond, &pool->lock);
+
+		pthread_mutex_unlock(&pool->lock);
+
+		memset(&result, 0, sizeof(struct ssdfs_dumpfs_peb_output));
+
+		env->peb.id = pool->start_peb + index;
+		env->peb.pebs_count = pool->pebs_count - index;
+		env->peb.log_size = SSDFS_DUMPFS_SPECULATIVE_LOG_SIZE(env);
+
+		env->peb_output = open_memstream(&result.buf, &result.size);
+		if (!env->peb_output) {
+			result.err = errno;
+			result.needs_rerun = SSDFS_TRUE;
+			SSDFS_ERR("fail to create memory stream: %s\n",
+				  strerror(errno));
+		} else {
+			result.err = ssdfs_dumpfs_show_peb_logs(env,
+							pool->max_logs,
+							pool->log_index,
+							&result);
+			ssdfs_dumpfs_flush_output(env);
+			fclose(env->peb_output);
+			env->peb_output = NULL;
+		}
+
+		result.log_size = env->peb.log_size;
+		result.log_size_inherited = env->peb.log_size_inherited;
+		result.is_ready = SSDFS_TRUE;
+
+		pthread_mutex_lock(&pool->lock);
+		pool->outputs[index % pool->window] = result;
+		pthread_cond_broadcast(&pool->cond);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	pthread_exit((void *)0);
+}
+
+/*
+ * ssdfs_dumpfs_show_pebs_concurrently() - dump PEBs by pool of threads
+ * @env: dumpfs environment
+ * @max_logs: maximal number of logs in PEB for processing
+ * @log_index: index of the first log for dumping
+ *
+ * PEBs are read and parsed by pool of threads. Every PEB is dumped
+ * into private buffer and the calling thread emits the buffers in
+ * PEBs order. The calling thread tracks the log's size that every
+ * PEB inherits from previous one and it dumps PEB again if thread's
+ * guess of inherited log's size could change the dump. As a result,
+ * the output is the same as the output of PEBs dumping by one thread.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code of the last PEB.
+ */
+static
+int ssdfs_dumpfs_show_pebs_concurrently(struct ssdfs_dumpfs_environment *env,
+					u32 max_logs, int log_index)
+{
+	struct ssdfs_dumpfs_peb_dump_pool pool;
+	struct ssdfs_dumpfs_peb_dump_job *jobs = NULL;
+	u64 volume_pebs;
+	u32 log_size;
+	u32 threads;
+	u32 started = 0;
+	u64 i;
+	int err = 0;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "peb_id %llu, pebs_count %llu, threads %u\n",
+		  env->peb.id, env->peb.pebs_count, env->threads);
+
+	volume_pebs = env->base.fs_size / env->peb.peb_size;
+
+	memset(&pool, 0, sizeof(struct ssdfs_dumpfs_peb_dump_pool));
+	pool.start_peb = env->peb.id;
+	pool.max_logs = max_logs;
+	pool.log_index = log_index;
+
+	if (env->peb.id < volume_pebs) {
+		pool.pebs_count = min_t(u64, env->peb.pebs_count,
+					volume_pebs - env->peb.id);
+	}
+
+	if (pool.pebs_count == 0)
+		return 0;
+
+	threads = (u32)min_t(u64, env->threads, pool.pebs_count);
+	pool.window = threads * SSDFS_DUMPFS_PEB_OUTPUTS_PER_THREAD;
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+
+	pool.outputs = calloc(pool.window,
+			      sizeof(struct ssdfs_dumpfs_peb_output));
+	if (!pool.outputs) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate outputs ring: %s\n",
+			  strerror(errno));
+		goto destroy_pool;
+	}
+
+	jobs = calloc(threads, sizeof(struct ssdfs_dumpfs_peb_dump_job));
+	if (!jobs) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate jobs: %s\n",
+			  strerror(errno));
+		goto free_outputs;
+	}
+
+	for (i = 0; i < threads; i++) {
+		struct ssdfs_dumpfs_peb_dump_job *job = &jobs[i];
+
+		job->id = i;
+		job->pool = &pool;
+		memcpy(&job->env, env, sizeof(struct ssdfs_dumpfs_environment));
+		job->env.fd = -1;
+		job->env.stream = NULL;
+		job->env.peb_output = NULL;
+		memset(&job->env.output, 0,
+			sizeof(struct ssdfs_dumpfs_output_buffer));
+		memset(&job->env.area_dir, 0,
+			sizeof(struct ssdfs_dumpfs_area_directory));
+
+		if (env->is_raw_dump_requested) {
+			job->env.raw_dump.buf = calloc(1, env->raw_dump.buf_size);
+			if (!job->env.raw_dump.buf) {
+				err = -ENOMEM;
+				SSDFS_ERR("fail to allocate raw dump's buffer: "
+					  "size %u, err: %s\n",
+					  env->raw_dump.buf_size,
+					  strerror(errno));
+				break;
+			}
+		}
+
+		err = pthread_create(&job->thread, NULL,
+				     ssdfs_dumpfs_peb_dump_thread,
+				     (void *)job);
+		if (err) {
+			SSDFS_ERR("fail to create thread %llu: %s\n",
+				  i, strerror(err));
+			if (env->is_raw_dump_requested)
+				free(job->env.raw_dump.buf);
+			break;
+		}
+
+		started++;
+	}
+
+	if (started == 0) {
+		if (!err)
+			err = -ECHILD;
+		goto free_jobs;
+	}
+
+	err = 0;
+	log_size = env->peb.log_size;
+
+	for (i = 0; i < pool.pebs_count; i++) {
+		struct ssdfs_dumpfs_peb_output *output;
+
+		pthread_mutex_lock(&pool.lock);
+
+		output = &pool.outputs[i % pool.window];
+		while (!output->is_ready)
+			pthread_cond_wait(&pool.cond, &pool.lock);
+
+		pthread_mutex_unlock(&pool.lock);
+
+		if (output->needs_rerun ||
+		    (output->log_size_checked && log_size == U32_MAX)) {
+			env->peb.id = pool.start_peb + i;
+			env->peb.pebs_count = pool.pebs_count - i;
+			env->peb.log_size = log_size;
+
+			err = ssdfs_dumpfs_show_peb_logs(env, max_logs,
+							 log_index, NULL);
+			log_size = env->peb.log_size;
+		} else {
+			if (output->buf && output->size > 0) {
+				fwrite(output->buf, 1, output->size,
+				       SSDFS_DUMPFS_STDOUT(env));
+			}
+
+			err = output->err;
+
+			if (!output->log_size_inherited)
+				log_size = output->log_size;
+		}
+
+		free(output->buf);
+
+		pthread_mutex_lock(&pool.lock);
+		memset(output, 0, sizeof(struct ssdfs_dumpfs_peb_output));
+		pool.emitted++;
+		pthread_cond_broadcast(&pool.cond);
+		pthread_mutex_unlock(&pool.lock);
+	}
+
+	for (i = 0; i < started; i++) {
+		pthread_join(jobs[i].thread, NULL);
+
+		ssdfs_dumpfs_free_output(&jobs[i].env);
+		ssdfs_dumpfs_forget_areas(&jobs[i].env);
+
+		if (env->is_raw_dump_requested)
+			free(jobs[i].env.raw_dump.buf);
+	}
+
+free_jobs:
+	free(jobs);
+
+free_outputs:
+	free(pool.outputs);
+
+destroy_pool:
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+
+	return err;
+}
+
 int ssdfs_dumpfs_show_peb_dump(struct ssdfs_dumpfs_environment *env)
 {
 	union ssdfs_metadata_header buf;
@@ -5953,7 +6951,6 @@ int ssdfs_dumpfs_show_peb_dump(struct ssdfs_dumpfs_environment *env)
 	u32 logs_count;
 	u32 max_logs;
 	int step = 2;
-	int i;
 	int err = 0;
 
 	SSDFS_DBG(env->base.show_debug,
@@ -6034,12 +7031,14 @@ int ssdfs_dumpfs_show_peb_dump(struct ssdfs_dumpfs_environment *env)
 		max_logs = 1;
 	}
 
+	if (env->threads > 1) {
+		err = ssdfs_dumpfs_show_pebs_concurrently(env, max_logs,
+							  log_index);
+		goto stop_peb_dumping;
+	}
+
 	while (env->peb.pebs_count > 0) {
-		if (env->peb.id < (env->base.fs_size / env->peb.peb_size)) {
-			env->peb.log_index = 0;
-			env->peb.logs_count = max_logs;
-			env->peb.log_offset = 0;
-		} else {
+		if (env->peb.id >= (env->base.fs_size / env->peb.peb_size)) {
 			SSDFS_DBG(env->base.show_debug,
 				  "STOP PEB DUMPING: "
 				  "peb_id %llu, pebs_count %llu, "
@@ -6049,103 +7048,8 @@ int ssdfs_dumpfs_show_peb_dump(struct ssdfs_dumpfs_environment *env)
 			goto stop_peb_dumping;
 		}
 
-		SSDFS_DUMPFS_INFO(env->base.show_info,
-				  "DUMPING PEB %llu\n",
-				  env->peb.id);
-
-		SSDFS_DBG(env->base.show_debug,
-			  "peb_id %llu, pebs_count %llu, "
-			  "log_index %u, logs_count %u\n",
-			  env->peb.id, env->peb.pebs_count,
-			  env->peb.log_index, env->peb.logs_count);
-
-		for (i = 0; i < max_logs; i++) {
-			SSDFS_DBG(env->base.show_debug,
-				  "peb_id %llu, pebs_count %llu, "
-				  "log_index %u, max_logs %u\n",
-				  env->peb.id, env->peb.pebs_count,
-				  i, max_logs);
-
-			if (env->peb.log_offset >= env->peb.peb_size) {
-				SSDFS_DBG(env->base.show_debug,
-					  "peb_id %llu, pebs_count %llu, "
-					  "log_index %u, logs_count %u\n",
-					  env->peb.id, env->peb.pebs_count,
-					  env->peb.log_index, env->peb.logs_count);
-				goto try_next_peb;
-			}
-
-			err = ssdfs_dumpfs_read_log_bytes(env, &buf);
-			if (err == -ENODATA) {
-				SSDFS_DBG(env->base.show_debug,
-					  "LOG ABSENT: peb_id: %llu, log_index %u, "
-					  "log_offset %u\n",
-					  env->peb.id, env->peb.log_index,
-					  env->peb.log_offset);
-					goto try_next_peb;
-			} else if (err) {
-				SSDFS_ERR("fail to read log's size in bytes: "
-					  "peb_id %llu, peb_size %u, "
-					  "log_offset %u, err %d\n",
-					  env->peb.id, env->peb.peb_size,
-					  env->peb.log_offset, err);
-				goto try_next_peb;
-			}
-
-			if (i < log_index) {
-				goto try_next_log;
-			}
-
-			if (le32_to_cpu(buf.magic.common) == SSDFS_SUPER_MAGIC &&
-			    le16_to_cpu(buf.magic.key) == SSDFS_SEGMENT_HDR_MAGIC) {
-				err = ssdfs_dumpfs_parse_full_log(env, &buf);
-				if (err) {
-					SSDFS_ERR("fail to parse the full log: "
-						  "err %d\n", err);
-					goto try_next_peb;
-				}
-			} else if (le32_to_cpu(buf.magic.common) == SSDFS_SUPER_MAGIC &&
-				   le16_to_cpu(buf.magic.key) == SSDFS_PARTIAL_LOG_HDR_MAGIC) {
-				err = ssdfs_dumpfs_parse_partial_log(env, &buf);
-				if (err) {
-					SSDFS_ERR("fail to parse the partial log: "
-						  "err %d\n", err);
-					goto try_next_peb;
-				}
-			} else {
-				SSDFS_DBG(env->base.show_debug,
-					  "LOG ABSENT: peb_id: %llu, log_index %u, "
-					  "log_offset %u\n",
-					  env->peb.id, env->peb.log_index,
-					  env->peb.log_offset);
-					goto try_next_peb;
-			}
-
-try_next_log:
-			SSDFS_DBG(env->base.show_debug,
-				  "CURRENT LOG: peb_id %llu, pebs_count %llu, "
-				  "log_index %u, logs_count %u, "
-				  "log_size %u, log_offset %u\n",
-				  env->peb.id, env->peb.pebs_count,
-				  env->peb.log_index, env->peb.logs_count,
-				  env->peb.log_size,
-				  env->peb.log_offset);
-
-			env->peb.log_index++;
-			env->peb.logs_count--;
-			env->peb.log_offset += env->peb.log_size;
-
-			SSDFS_DBG(env->base.show_debug,
-				  "NEXT LOG: peb_id %llu, pebs_count %llu, "
-				  "log_index %u, logs_count %u, "
-				  "log_size %u, log_offset %u\n",
-				  env->peb.id, env->peb.pebs_count,
-				  env->peb.log_index, env->peb.logs_count,
-				  env->peb.log_size,
-				  env->peb.log_offset);
-		}
+		err = ssdfs_dumpfs_show_peb_logs(env, max_logs, log_index, NULL);
 
-try_next_peb:
 		env->peb.id++;
 		env->peb.pebs_count--;
 	}
@@ -32,94 +32,84 @@
 #define IS_PRINT(ptr) \
 	(isprint(*(ptr)) ? *(ptr) : '.')
 
+/* offset (up to 16 digits), hex bytes, characters and delimiters */
+#define SSDFS_DUMPFS_RAW_LINE_MAX	(128)
+
+static const char ssdfs_dumpfs_upper_hex[] = "0123456789ABCDEF";
+static const char ssdfs_dumpfs_lower_hex[] = "0123456789abcdef";
+
+/*
+ * ssdfs_dumpfs_show_raw_string() - show one line of raw dump
+ * @env: dumpfs environment
+ * @offset: offset of the line
+ * @ptr: pointer on bytes
+ * @len: number of bytes
+ *
+ * The line is formatted by table lookups directly into
+ * output buffer as "%08llX  " offset, "%02x " bytes
+ * and printable characters.
+ *
+ * RETURN:
+ * [success] - number of shown bytes.
+ * [failure] - error code.
+ */
 int ssdfs_dumpfs_show_raw_string(struct ssdfs_dumpfs_environment *env,
 				 u64 offset, const u8 *ptr, u32 len)
 {
-	ssize_t printed = 0;
-	int res = 0;
+	char *line;
+	char *dst;
+	int digits = 8;
 	int i;
 
+	line = ssdfs_dumpfs_output_reserve(env, SSDFS_DUMPFS_RAW_LINE_MAX);
+	if (!line)
+		return -ENOMEM;
+
+	dst = line;
+
 	/* Show offset */
-	if (env->dump_into_files)
-		res = fprintf(env->stream, "%08llX  ", offset);
-	else
-		res = printf("%08llX  ", offset);
+	while (digits < 16 && (offset >> (digits * 4)) != 0)
+		digits++;
+
+	for (i = digits - 1; i >= 0; i--)
+		*dst++ = ssdfs_dumpfs_upper_hex[(offset >> (i * 4)) & 0xF];
 
-	if (res < 0)
-		return res;
+	*dst++ = ' ';
+	*dst++ = ' ';
 
 	len = min_t(u32, len, SSDFS_DUMPFS_RAW_STRING_LEN);
 
 	for (i = 0; i < SSDFS_DUMPFS_RAW_STRING_LEN; i++) {
-		if (i == SSDFS_DUMPFS_RAW_STRING_LEN / 2) {
-			if (env->dump_into_files)
-				res = fprintf(env->stream, " ");
-			else
-				res = printf(" ");
-
-			if (res < 0)
-				return res;
-		}
+		if (i == SSDFS_DUMPFS_RAW_STRING_LEN / 2)
+			*dst++ = ' ';
 
 		if (i >= len) {
-			if (env->dump_into_files)
-				res = fprintf(env->stream, "   ");
-			else
-				res = printf("   ");
-
-			if (res < 0)
-				return res;
+			*dst++ = ' ';
+			*dst++ = ' ';
 		} else {
-			if (env->dump_into_files)
-				res = fprintf(env->stream, "%02x ", *(ptr + i));
-			else
-				res = printf("%02x ", *(ptr + i));
-
-			if (res < 0)
-				return res;
+			*dst++ = ssdfs_dumpfs_lower_hex[ptr[i] >> 4];
+			*dst++ = ssdfs_dumpfs_lower_hex[ptr[i] & 0xF];
 		}
 
-		printed++;
+		*dst++ = ' ';
 	}
 
-	if (env->dump_into_files)
-		res = fprintf(env->stream, " |");
-	else
-		res = printf(" |");
-
-	if (res < 0)
-		return res;
+	*dst++ = ' ';
+	*dst++ = '|';
 
 	for (i = 0; i < SSDFS_DUMPFS_RAW_STRING_LEN; i++) {
-		if (i >= len) {
-			if (env->dump_into_files)
-				res = fprintf(env->stream, " ");
-			else
-				res = printf(" ");
-
-			if (res < 0)
-				return res;
-		} else {
-			if (env->dump_into_files) {
-				res = fprintf(env->stream,
-						"%c", IS_PRINT(ptr + i));
-			} else
-				res = printf("%c", IS_PRINT(ptr + i));
-
-			if (res < 0)
-				return res;
-		}
+		if (i >= len)
+			*dst++ = ' ';
+		else
+			*dst++ = IS_PRINT(ptr + i);
 	}
 
-	if (env->dump_into_files)
-		res = fprintf(env->stream, "|\n");
-	else
-		res = printf("|\n");
+	*dst++ = '|';
+	*dst++ = '\n';
 
-	if (res < 0)
-		return res;
+	ssdfs_dumpfs_output_commit(env, (u32)(dst - line));
 
-	return printed;
+	return SSDFS_DUMPFS_RAW_STRING_LEN;
 }
 
 int ssdfs_dumpfs_show_raw_dump(struct ssdfs_dumpfs_environment *env)
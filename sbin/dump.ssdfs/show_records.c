@@ -0,0 +1,545 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ *
+ * ssdfs-utils -- SSDFS file system utilities.
+ *
+ * sbin/dump.ssdfs/show_records.c - show structured records.
+ *
+ * Copyright (c) 2014-2019 HGST, a Western Digital Company.
+ *              http://www.hgst.com/
+ * Copyright (c) 2014-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ *
+ * (C) Copyright 2014-2019, HGST, Inc., All rights reserved.
+ *
+ * Created by HGST, San Jose Research Center, Storage Architecture Group
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ *
+ * Acknowledgement: Cyril Guyot
+ *                  Zvonimir Bandic
+ */
+
+#include "dumpfs.h"
+
+/************************************************************************
+ *                   Structured records functionality                   *
+ ************************************************************************/
+
+/*
+ * Record is formatted into one memory buffer and the buffer
+ * is added into output by one call. JSON records are JSON Lines,
+ * CBOR records are a CBOR sequence of maps, binary records are
+ * sequence of struct ssdfs_dumpfs_record_header with fields.
+ */
+
+/* CBOR major types */
+#define SSDFS_CBOR_UNSIGNED_INT		(0)
+#define SSDFS_CBOR_BYTE_STRING		(2)
+#define SSDFS_CBOR_TEXT_STRING		(3)
+#define SSDFS_CBOR_INDEFINITE_MAP	(0xBF)
+#define SSDFS_CBOR_BREAK		(0xFF)
+
+/* CBOR head: initial byte + up to 8 bytes of argument */
+#define SSDFS_CBOR_HEAD_MAX		(9)
+
+/* Maximal number of decimal digits of u64 */
+#define SSDFS_DUMPFS_U64_DIGITS_MAX	(20)
+
+static const char *ssdfs_dumpfs_record_name[SSDFS_DUMPFS_RECORD_TYPE_MAX] = {
+	[SSDFS_DUMPFS_UNKNOWN_RECORD]		= "unknown",
+	[SSDFS_DUMPFS_SEGMENT_HEADER_RECORD]	= "segment_header",
+	[SSDFS_DUMPFS_PARTIAL_LOG_HEADER_RECORD] = "partial_log_header",
+	[SSDFS_DUMPFS_LOG_FOOTER_RECORD]	= "log_footer",
+	[SSDFS_DUMPFS_BLOCK_BITMAP_RECORD]	= "block_bitmap",
+	[SSDFS_DUMPFS_BLK2OFF_TABLE_RECORD]	= "blk2off_table",
+	[SSDFS_DUMPFS_MAPTBL_FRAGMENT_RECORD]	= "maptbl_fragment",
+	[SSDFS_DUMPFS_SEGBMAP_FRAGMENT_RECORD]	= "segbmap_fragment",
+};
+
+static const char ssdfs_dumpfs_hex_digits[] = "0123456789abcdef";
+
+/*
+ * ssdfs_dumpfs_record_reserve() - reserve space in the record
+ * @rec: pointer on record
+ * @bytes: number of bytes for reservation
+ *
+ * This method tries to reserve @bytes at the end of the record
+ * and it grows the buffer if it's necessary. The record is
+ * marked as broken in the case of failure.
+ *
+ * RETURN:
+ * [success] - pointer on reserved space.
+ * [failure] - NULL.
+ */
+static
+u8 *ssdfs_dumpfs_record_reserve(struct ssdfs_dumpfs_record *rec,
+				size_t bytes)
+{
+	size_t capacity;
+	u8 *buf;
+
+	if (rec->err)
+		return NULL;
+
+	if ((rec->size + bytes) <= rec->capacity)
+		return rec->buf + rec->size;
+
+	capacity = max_t(size_t, rec->capacity, SSDFS_DUMPFS_RECORD_DEFAULT_SIZE);
+
+	while (capacity < (rec->size + bytes))
+		capacity *= 2;
+
+	buf = realloc(rec->buf, capacity);
+	if (!buf) {
+		rec->err = -ENOMEM;
+		return NULL;
+	}
+
+	rec->buf = buf;
+	rec->capacity = capacity;
+
+	return rec->buf + rec->size;
+}
+
+static
+void ssdfs_dumpfs_record_put(struct ssdfs_dumpfs_record *rec,
+			     const void *ptr, size_t len)
+{
+	u8 *dst = ssdfs_dumpfs_record_reserve(rec, len);
+
+	if (!dst)
+		return;
+
+	memcpy(dst, ptr, len);
+	rec->size += len;
+}
+
+static
+void ssdfs_dumpfs_record_put_decimal(struct ssdfs_dumpfs_record *rec,
+				     u64 value)
+{
+	char digits[SSDFS_DUMPFS_U64_DIGITS_MAX];
+	int i = SSDFS_DUMPFS_U64_DIGITS_MAX;
+
+	do {
+		digits[--i] = '0' + (value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	ssdfs_dumpfs_record_put(rec, &digits[i],
+				SSDFS_DUMPFS_U64_DIGITS_MAX - i);
+}
+
+/*
+ * ssdfs_dumpfs_record_put_json_string() - put quoted and escaped string
+ * @rec: pointer on record
+ * @str: string
+ */
+static
+void ssdfs_dumpfs_record_put_json_string(struct ssdfs_dumpfs_record *rec,
+					 const char *str)
+{
+	size_t len = strlen(str);
+	u8 *dst;
+	size_t i;
+
+	/* every character takes 6 bytes (\u00XX) in the worst case */
+	dst = ssdfs_dumpfs_record_reserve(rec, (len * 6) + 2);
+	if (!dst)
+		return;
+
+	*dst++ = '"';
+
+	for (i = 0; i < len; i++) {
+		u8 ch = (u8)str[i];
+
+		if (ch == '"' || ch == '\\') {
+			*dst++ = '\\';
+			*dst++ = ch;
+		} else if (ch < 0x20) {
+			*dst++ = '\\';
+			*dst++ = 'u';
+			*dst++ = '0';
+			*dst++ = '0';
+			*dst++ = ssdfs_dumpfs_hex_digits[ch >> 4];
+			*dst++ = ssdfs_dumpfs_hex_digits[ch & 0xF];
+		} else
+			*dst++ = ch;
+	}
+
+	*dst++ = '"';
+
+	rec->size = dst - rec->buf;
+}
+
+static
+void ssdfs_dumpfs_record_put_json_name(struct ssdfs_dumpfs_record *rec,
+				       const char *name)
+{
+	ssdfs_dumpfs_record_put(rec, ",", 1);
+	ssdfs_dumpfs_record_put_json_string(rec, name);
+	ssdfs_dumpfs_record_put(rec, ":", 1);
+}
+
+/*
+ * ssdfs_dumpfs_record_put_cbor_head() - put CBOR data item's head
+ * @rec: pointer on record
+ * @major: CBOR major type
+ * @value: argument of data item
+ */
+static
+void ssdfs_dumpfs_record_put_cbor_head(struct ssdfs_dumpfs_record *rec,
+				       u8 major, u64 value)
+{
+	u8 head[SSDFS_CBOR_HEAD_MAX];
+	int bytes;
+	int i;
+
+	if (value < 24) {
+		head[0] = (major << 5) | (u8)value;
+		ssdfs_dumpfs_record_put(rec, head, 1);
+		return;
+	} else if (value <= U8_MAX) {
+		head[0] = (major << 5) | 24;
+		bytes = 1;
+	} else if (value <= U16_MAX) {
+		head[0] = (major << 5) | 25;
+		bytes = 2;
+	} else if (value <= U32_MAX) {
+		head[0] = (major << 5) | 26;
+		bytes = 4;
+	} else {
+		head[0] = (major << 5) | 27;
+		bytes = 8;
+	}
+
+	/* CBOR uses network byte order */
+	for (i = bytes; i > 0; i--) {
+		head[i] = (u8)(value & 0xFF);
+		value >>= 8;
+	}
+
+	ssdfs_dumpfs_record_put(rec, head, bytes + 1);
+}
+
+static
+void ssdfs_dumpfs_record_put_cbor_string(struct ssdfs_dumpfs_record *rec,
+					 const char *str)
+{
+	size_t len = strlen(str);
+
+	ssdfs_dumpfs_record_put_cbor_head(rec, SSDFS_CBOR_TEXT_STRING, len);
+	ssdfs_dumpfs_record_put(rec, str, len);
+}
+
+/*
+ * ssdfs_dumpfs_record_put_binary_field() - put field of binary record
+ * @rec: pointer on record
+ * @name: field's name
+ * @type: field's value type
+ * @len: length of field's value in bytes
+ *
+ * This method puts the field's description. The caller is
+ * responsible for putting the value.
+ */
+static
+void ssdfs_dumpfs_record_put_binary_field(struct ssdfs_dumpfs_record *rec,
+					  const char *name,
+					  u8 type, u32 len)
+{
+	size_t name_len = min_t(size_t, strlen(name), U8_MAX);
+	u8 name_len8 = (u8)name_len;
+	__le32 value_len = cpu_to_le32(len);
+
+	ssdfs_dumpfs_record_put(rec, &name_len8, sizeof(u8));
+	ssdfs_dumpfs_record_put(rec, name, name_len);
+	ssdfs_dumpfs_record_put(rec, &type, sizeof(u8));
+	ssdfs_dumpfs_record_put(rec, &value_len, sizeof(__le32));
+}
+
+/*
+ * ssdfs_dumpfs_record_start() - start structured record
+ * @env: dumpfs environment
+ * @rec: pointer on record
+ * @type: record type
+ *
+ * This method prepares the record's buffer and it puts
+ * the record's type and the log's position in PEB.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_dumpfs_record_start(struct ssdfs_dumpfs_environment *env,
+			      struct ssdfs_dumpfs_record *rec,
+			      int type)
+{
+	struct ssdfs_dumpfs_record_header hdr;
+	const char *name;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "format %#x, type %#x\n",
+		  env->format, type);
+
+	memset(rec, 0, sizeof(struct ssdfs_dumpfs_record));
+
+	if (type <= SSDFS_DUMPFS_UNKNOWN_RECORD ||
+	    type >= SSDFS_DUMPFS_RECORD_TYPE_MAX) {
+		SSDFS_ERR("invalid record type %#x\n", type);
+		return -EINVAL;
+	}
+
+	rec->format = env->format;
+	rec->type = type;
+	name = ssdfs_dumpfs_record_name[type];
+
+	switch (rec->format) {
+	case SSDFS_DUMPFS_JSON_FORMAT:
+		ssdfs_dumpfs_record_put(rec, "{\"record\":", 10);
+		ssdfs_dumpfs_record_put_json_string(rec, name);
+		ssdfs_dumpfs_record_put_json_name(rec, "peb_id");
+		ssdfs_dumpfs_record_put_decimal(rec, env->peb.id);
+		ssdfs_dumpfs_record_put_json_name(rec, "log_index");
+		ssdfs_dumpfs_record_put_decimal(rec, env->peb.log_index);
+		ssdfs_dumpfs_record_put_json_name(rec, "log_offset");
+		ssdfs_dumpfs_record_put_decimal(rec, env->peb.log_offset);
+		break;
+
+	case SSDFS_DUMPFS_CBOR_FORMAT:
+		ssdfs_dumpfs_record_put(rec,
+				&(u8){SSDFS_CBOR_INDEFINITE_MAP}, 1);
+		ssdfs_dumpfs_record_put_cbor_string(rec, "record");
+		ssdfs_dumpfs_record_put_cbor_string(rec, name);
+		ssdfs_dumpfs_record_put_cbor_string(rec, "peb_id");
+		ssdfs_dumpfs_record_put_cbor_head(rec, SSDFS_CBOR_UNSIGNED_INT,
+						  env->peb.id);
+		ssdfs_dumpfs_record_put_cbor_string(rec, "log_index");
+		ssdfs_dumpfs_record_put_cbor_head(rec, SSDFS_CBOR_UNSIGNED_INT,
+						  env->peb.log_index);
+		ssdfs_dumpfs_record_put_cbor_string(rec, "log_offset");
+		ssdfs_dumpfs_record_put_cbor_head(rec, SSDFS_CBOR_UNSIGNED_INT,
+						  env->peb.log_offset);
+		break;
+
+	case SSDFS_DUMPFS_BINARY_FORMAT:
+		memset(&hdr, 0, sizeof(struct ssdfs_dumpfs_record_header));
+		hdr.magic = cpu_to_le32(SSDFS_DUMPFS_RECORD_MAGIC);
+		hdr.type = cpu_to_le16((u16)type);
+		hdr.log_index = cpu_to_le32(env->peb.log_index);
+		hdr.peb_id = cpu_to_le64(env->peb.id);
+		hdr.log_offset = cpu_to_le32(env->peb.log_offset);
+		ssdfs_dumpfs_record_put(rec, &hdr,
+				sizeof(struct ssdfs_dumpfs_record_header));
+		break;
+
+	default:
+		SSDFS_ERR("unexpected format %#x\n", rec->format);
+		return -EINVAL;
+	}
+
+	return rec->err;
+}
+
+/*
+ * ssdfs_dumpfs_record_add_u64() - add numeric field into record
+ * @rec: pointer on record
+ * @name: field's name
+ * @value: field's value
+ */
+void ssdfs_dumpfs_record_add_u64(struct ssdfs_dumpfs_record *rec,
+				 const char *name, u64 value)
+{
+	__le64 le_value;
+
+	switch (rec->format) {
+	case SSDFS_DUMPFS_JSON_FORMAT:
+		ssdfs_dumpfs_record_put_json_name(rec, name);
+		ssdfs_dumpfs_record_put_decimal(rec, value);
+		break;
+
+	case SSDFS_DUMPFS_CBOR_FORMAT:
+		ssdfs_dumpfs_record_put_cbor_string(rec, name);
+		ssdfs_dumpfs_record_put_cbor_head(rec, SSDFS_CBOR_UNSIGNED_INT,
+						  value);
+		break;
+
+	case SSDFS_DUMPFS_BINARY_FORMAT:
+		le_value = cpu_to_le64(value);
+		ssdfs_dumpfs_record_put_binary_field(rec, name,
+						     SSDFS_DUMPFS_U64_VALUE,
+						     sizeof(__le64));
+		ssdfs_dumpfs_record_put(rec, &le_value, sizeof(__le64));
+		break;
+
+	default:
+		BUG();
+	}
+
+	rec->fields_count++;
+}
+
+/*
+ * ssdfs_dumpfs_record_add_string() - add string field into record
+ * @rec: pointer on record
+ * @name: field's name
+ * @str: field's value
+ */
+void ssdfs_dumpfs_record_add_string(struct ssdfs_dumpfs_record *rec,
+				    const char *name, const char *str)
+{
+	size_t len;
+
+	switch (rec->format) {
+	case SSDFS_DUMPFS_JSON_FORMAT:
+		ssdfs_dumpfs_record_put_json_name(rec, name);
+		ssdfs_dumpfs_record_put_json_string(rec, str);
+		break;
+
+	case SSDFS_DUMPFS_CBOR_FORMAT:
+		ssdfs_dumpfs_record_put_cbor_string(rec, name);
+		ssdfs_dumpfs_record_put_cbor_string(rec, str);
+		break;
+
+	case SSDFS_DUMPFS_BINARY_FORMAT:
+		len = strlen(str);
+		ssdfs_dumpfs_record_put_binary_field(rec, name,
+						     SSDFS_DUMPFS_STRING_VALUE,
+						     (u32)len);
+		ssdfs_dumpfs_record_put(rec, str, len);
+		break;
+
+	default:
+		BUG();
+	}
+
+	rec->fields_count++;
+}
+
+/*
+ * ssdfs_dumpfs_record_add_bytes() - add raw bytes into record
+ * @rec: pointer on record
+ * @name: field's name
+ * @ptr: pointer on bytes
+ * @len: number of bytes
+ *
+ * JSON record keeps the bytes as hex string.
+ */
+void ssdfs_dumpfs_record_add_bytes(struct ssdfs_dumpfs_record *rec,
+				   const char *name,
+				   const void *ptr, u32 len)
+{
+	const u8 *src = (const u8 *)ptr;
+	u8 *dst;
+	u32 i;
+
+	switch (rec->format) {
+	case SSDFS_DUMPFS_JSON_FORMAT:
+		ssdfs_dumpfs_record_put_json_name(rec, name);
+
+		dst = ssdfs_dumpfs_record_reserve(rec, ((size_t)len * 2) + 2);
+		if (!dst)
+			break;
+
+		*dst++ = '"';
+		for (i = 0; i < len; i++) {
+			*dst++ = ssdfs_dumpfs_hex_digits[src[i] >> 4];
+			*dst++ = ssdfs_dumpfs_hex_digits[src[i] & 0xF];
+		}
+		*dst++ = '"';
+
+		rec->size = dst - rec->buf;
+		break;
+
+	case SSDFS_DUMPFS_CBOR_FORMAT:
+		ssdfs_dumpfs_record_put_cbor_string(rec, name);
+		ssdfs_dumpfs_record_put_cbor_head(rec, SSDFS_CBOR_BYTE_STRING,
+						  len);
+		ssdfs_dumpfs_record_put(rec, ptr, len);
+		break;
+
+	case SSDFS_DUMPFS_BINARY_FORMAT:
+		ssdfs_dumpfs_record_put_binary_field(rec, name,
+						     SSDFS_DUMPFS_BYTES_VALUE,
+						     len);
+		ssdfs_dumpfs_record_put(rec, ptr, len);
+		break;
+
+	default:
+		BUG();
+	}
+
+	rec->fields_count++;
+}
+
+/*
+ * ssdfs_dumpfs_record_finish() - finish and emit structured record
+ * @env: dumpfs environment
+ * @rec: pointer on record
+ *
+ * This method closes the record, adds it into output
+ * buffer by one call and frees the record's buffer.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int ssdfs_dumpfs_record_finish(struct ssdfs_dumpfs_environment *env,
+			       struct ssdfs_dumpfs_record *rec)
+{
+	struct ssdfs_dumpfs_record_header *hdr;
+	int err = 0;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "type %#x, fields_count %u, size %zu\n",
+		  rec->type, rec->fields_count, rec->size);
+
+	switch (rec->format) {
+	case SSDFS_DUMPFS_JSON_FORMAT:
+		ssdfs_dumpfs_record_put(rec, "}\n", 2);
+		break;
+
+	case SSDFS_DUMPFS_CBOR_FORMAT:
+		ssdfs_dumpfs_record_put(rec, &(u8){SSDFS_CBOR_BREAK}, 1);
+		break;
+
+	case SSDFS_DUMPFS_BINARY_FORMAT:
+		if (rec->err)
+			break;
+
+		hdr = (struct ssdfs_dumpfs_record_header *)rec->buf;
+		hdr->fields_count = cpu_to_le16(rec->fields_count);
+		hdr->bytes_count = cpu_to_le32((u32)rec->size);
+		break;
+
+	default:
+		BUG();
+	}
+
+	if (rec->err) {
+		err = rec->err;
+		SSDFS_ERR("fail to prepare record: "
+			  "type %#x, err %d\n",
+			  rec->type, err);
+		goto free_record;
+	}
+
+	if (ssdfs_dumpfs_output_write(env, rec->buf, rec->size) < 0) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to add record: "
+			  "type %#x, size %zu\n",
+			  rec->type, rec->size);
+		goto free_record;
+	}
+
+free_record:
+	free(rec->buf);
+	rec->buf = NULL;
+	rec->size = rec->capacity = 0;
+
+	return err;
+}
@@ -0,0 +1,1038 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ *
+ * ssdfs-utils -- SSDFS file system utilities.
+ *
+ * sbin/dump.ssdfs/show_stats.c - show volume statistics command.
+ *
+ * Copyright (c) 2014-2019 HGST, a Western Digital Company.
+ *              http://www.hgst.com/
+ * Copyright (c) 2014-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ *
+ * (C) Copyright 2014-2019, HGST, Inc., All rights reserved.
+ *
+ * Created by HGST, San Jose Research Center, Storage Architecture Group
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ *
+ * Acknowledgement: Cyril Guyot
+ *                  Zvonimir Bandic
+ */
+
+#include <string.h>
+
+#include "dumpfs.h"
+
+/************************************************************************
+ *                   Show volume statistics command                     *
+ ************************************************************************/
+
+static const char *seg_type_names[SSDFS_DUMPFS_SEG_TYPES_MAX] = {
+	[SSDFS_UNKNOWN_SEG_TYPE]		= "SSDFS_UNKNOWN_SEG_TYPE",
+	[SSDFS_SB_SEG_TYPE]			= "SSDFS_SB_SEG_TYPE",
+	[SSDFS_INITIAL_SNAPSHOT_SEG_TYPE]	= "SSDFS_INITIAL_SNAPSHOT_SEG_TYPE",
+	[SSDFS_SEGBMAP_SEG_TYPE]		= "SSDFS_SEGBMAP_SEG_TYPE",
+	[SSDFS_MAPTBL_SEG_TYPE]			= "SSDFS_MAPTBL_SEG_TYPE",
+	[SSDFS_LEAF_NODE_SEG_TYPE]		= "SSDFS_LEAF_NODE_SEG_TYPE",
+	[SSDFS_HYBRID_NODE_SEG_TYPE]		= "SSDFS_HYBRID_NODE_SEG_TYPE",
+	[SSDFS_INDEX_NODE_SEG_TYPE]		= "SSDFS_INDEX_NODE_SEG_TYPE",
+	[SSDFS_USER_DATA_SEG_TYPE]		= "SSDFS_USER_DATA_SEG_TYPE",
+	[SSDFS_LAST_KNOWN_SEG_TYPE + 1]		= "CORRUPTED_SEG_TYPE",
+};
+
+static const char *area_names[SSDFS_SEG_HDR_DESC_MAX] = {
+	[SSDFS_BLK_BMAP_INDEX]			= "BLOCK BITMAP",
+	[SSDFS_SNAPSHOT_RULES_AREA_INDEX]	= "SNAPSHOT RULES",
+	[SSDFS_OFF_TABLE_INDEX]			= "OFFSETS TABLE",
+	[SSDFS_COLD_PAYLOAD_AREA_INDEX]		= "COLD PAYLOAD",
+	[SSDFS_WARM_PAYLOAD_AREA_INDEX]		= "WARM PAYLOAD",
+	[SSDFS_HOT_PAYLOAD_AREA_INDEX]		= "HOT PAYLOAD",
+	[SSDFS_BLK_DESC_AREA_INDEX]		= "BLOCK DESCRIPTORS",
+	[SSDFS_MAPTBL_CACHE_INDEX]		= "MAPTBL CACHE",
+	[SSDFS_LOG_FOOTER_INDEX]		= "LOG FOOTER",
+};
+
+static const char *compr_area_names[SSDFS_DUMPFS_COMPR_STATS_MAX] = {
+	[SSDFS_DUMPFS_BLK_BMAP_STATS]		= "BLOCK BITMAP",
+	[SSDFS_DUMPFS_BLK2OFF_STATS]		= "OFFSETS TABLE",
+	[SSDFS_DUMPFS_BLK_DESC_STATS]		= "BLOCK DESCRIPTORS",
+};
+
+static const char *blk_state_names[SSDFS_BLK_STATE_MAX] = {
+	[SSDFS_BLK_FREE]			= "SSDFS_BLK_FREE",
+	[SSDFS_BLK_PRE_ALLOCATED]		= "SSDFS_BLK_PRE_ALLOCATED",
+	[SSDFS_BLK_INVALID]			= "SSDFS_BLK_INVALID",
+	[SSDFS_BLK_VALID]			= "SSDFS_BLK_VALID",
+};
+
+static const char *peb_state_names[SSDFS_MAPTBL_PEB_STATE_MAX] = {
+	[SSDFS_MAPTBL_UNKNOWN_PEB_STATE] =
+		"SSDFS_MAPTBL_UNKNOWN_PEB_STATE",
+	[SSDFS_MAPTBL_BAD_PEB_STATE] =
+		"SSDFS_MAPTBL_BAD_PEB_STATE",
+	[SSDFS_MAPTBL_CLEAN_PEB_STATE] =
+		"SSDFS_MAPTBL_CLEAN_PEB_STATE",
+	[SSDFS_MAPTBL_USING_PEB_STATE] =
+		"SSDFS_MAPTBL_USING_PEB_STATE",
+	[SSDFS_MAPTBL_USED_PEB_STATE] =
+		"SSDFS_MAPTBL_USED_PEB_STATE",
+	[SSDFS_MAPTBL_PRE_DIRTY_PEB_STATE] =
+		"SSDFS_MAPTBL_PRE_DIRTY_PEB_STATE",
+	[SSDFS_MAPTBL_DIRTY_PEB_STATE] =
+		"SSDFS_MAPTBL_DIRTY_PEB_STATE",
+	[SSDFS_MAPTBL_MIGRATION_SRC_USING_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_SRC_USING_STATE",
+	[SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE",
+	[SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE",
+	[SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE",
+	[SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE",
+	[SSDFS_MAPTBL_MIGRATION_DST_USING_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_DST_USING_STATE",
+	[SSDFS_MAPTBL_MIGRATION_DST_USED_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_DST_USED_STATE",
+	[SSDFS_MAPTBL_MIGRATION_DST_PRE_DIRTY_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_DST_PRE_DIRTY_STATE",
+	[SSDFS_MAPTBL_MIGRATION_DST_DIRTY_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_DST_DIRTY_STATE",
+	[SSDFS_MAPTBL_PRE_ERASE_STATE] =
+		"SSDFS_MAPTBL_PRE_ERASE_STATE",
+	[SSDFS_MAPTBL_UNDER_ERASE_STATE] =
+		"SSDFS_MAPTBL_UNDER_ERASE_STATE",
+	[SSDFS_MAPTBL_SNAPSHOT_STATE] =
+		"SSDFS_MAPTBL_SNAPSHOT_STATE",
+	[SSDFS_MAPTBL_RECOVERING_STATE] =
+		"SSDFS_MAPTBL_RECOVERING_STATE",
+	[SSDFS_MAPTBL_USING_INVALIDATED_PEB_STATE] =
+		"SSDFS_MAPTBL_USING_INVALIDATED_PEB_STATE",
+	[SSDFS_MAPTBL_MIGRATION_SRC_USING_INVALIDATED_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_SRC_USING_INVALIDATED_STATE",
+	[SSDFS_MAPTBL_MIGRATION_DST_USING_INVALIDATED_STATE] =
+		"SSDFS_MAPTBL_MIGRATION_DST_USING_INVALIDATED_STATE",
+};
+
+static inline
+int is_ssdfs_dumpfs_migration_state(int state)
+{
+	switch (state) {
+	case SSDFS_MAPTBL_MIGRATION_SRC_USING_STATE:
+	case SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE:
+	case SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE:
+	case SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE:
+	case SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE:
+	case SSDFS_MAPTBL_MIGRATION_DST_USING_STATE:
+	case SSDFS_MAPTBL_MIGRATION_DST_USED_STATE:
+	case SSDFS_MAPTBL_MIGRATION_DST_PRE_DIRTY_STATE:
+	case SSDFS_MAPTBL_MIGRATION_DST_DIRTY_STATE:
+	case SSDFS_MAPTBL_MIGRATION_SRC_USING_INVALIDATED_STATE:
+	case SSDFS_MAPTBL_MIGRATION_DST_USING_INVALIDATED_STATE:
+		return SSDFS_TRUE;
+	}
+
+	return SSDFS_FALSE;
+}
+
+static inline
+void ssdfs_dumpfs_account_fragment(struct ssdfs_dumpfs_compr_stats *compr,
+				   struct ssdfs_fragment_desc *frag)
+{
+	compr->fragments++;
+	compr->compr_bytes += le16_to_cpu(frag->compr_size);
+	compr->uncompr_bytes += le16_to_cpu(frag->uncompr_size);
+}
+
+/*
+ * ssdfs_dumpfs_block_bitmap_stats() - account block bitmap area
+ * @env: pointer on environment
+ * @area_buf: block bitmap area
+ * @area_size: size of block bitmap area in bytes
+ * @blk_states: array of block state counters [out]
+ *
+ * This function accounts the compression of block bitmap's fragments
+ * if @blk_states is NULL. Otherwise, it decompresses the fragments
+ * of source bitmap and counts the blocks in every state.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_dumpfs_block_bitmap_stats(struct ssdfs_dumpfs_environment *env,
+				    void *area_buf, u32 area_size,
+				    u64 *blk_states)
+{
+	struct ssdfs_block_bitmap_header *hdr =
+			(struct ssdfs_block_bitmap_header *)area_buf;
+	struct ssdfs_dumpfs_compr_stats *compr;
+	size_t bmap_frag_size = sizeof(struct ssdfs_block_bitmap_fragment);
+	size_t frag_desc_size = sizeof(struct ssdfs_fragment_desc);
+	u16 bmap_fragments;
+	u32 offset;
+	int i, j, k;
+	int err;
+
+	if (area_size < sizeof(struct ssdfs_block_bitmap_header))
+		return -EIO;
+
+	compr = &env->stats->compr[SSDFS_DUMPFS_BLK_BMAP_STATS];
+	bmap_fragments = le16_to_cpu(hdr->fragments_count);
+	offset = sizeof(struct ssdfs_block_bitmap_header);
+
+	for (i = 0; i < bmap_fragments; i++) {
+		struct ssdfs_block_bitmap_fragment *bmap_frag;
+		u16 fragments_count;
+		u32 data_offset;
+
+		if ((offset + bmap_frag_size) > area_size)
+			return -EIO;
+
+		bmap_frag = (struct ssdfs_block_bitmap_fragment *)((u8 *)area_buf +
+								  offset);
+		fragments_count = le16_to_cpu(bmap_frag->chain_hdr.fragments_count);
+		data_offset = offset + bmap_frag_size;
+		data_offset += (u32)fragments_count * frag_desc_size;
+
+		if (data_offset > area_size)
+			return -EIO;
+
+		for (j = 0; j < fragments_count; j++) {
+			struct ssdfs_fragment_desc *frag;
+			u8 *fragment;
+			u8 *uncompr_data;
+			u32 compr_size;
+			u32 uncompr_size;
+
+			frag = (struct ssdfs_fragment_desc *)((u8 *)area_buf +
+					offset + bmap_frag_size +
+					(j * frag_desc_size));
+			compr_size = le16_to_cpu(frag->compr_size);
+			uncompr_size = le16_to_cpu(frag->uncompr_size);
+
+			if ((data_offset + compr_size) > area_size)
+				return -EIO;
+
+			if (!blk_states) {
+				ssdfs_dumpfs_account_fragment(compr, frag);
+				goto next_fragment;
+			}
+
+			if (bmap_frag->type != SSDFS_SRC_BLK_BMAP)
+				goto next_fragment;
+
+			err = ssdfs_dumpfs_unpack_fragment(env, frag,
+						(u8 *)area_buf + data_offset,
+						&fragment, &uncompr_data);
+			if (err)
+				return err;
+
+			for (k = 0; k < uncompr_size; k++) {
+				u8 byte = fragment[k];
+				int shift;
+
+				for (shift = 0; shift < BITS_PER_BYTE;
+				     shift += SSDFS_BLK_STATE_BITS) {
+					blk_states[(byte >> shift) &
+						   SSDFS_BLK_STATE_MASK]++;
+				}
+			}
+
+			if (uncompr_data)
+				free(uncompr_data);
+
+next_fragment:
+			data_offset += compr_size;
+		}
+
+		offset = data_offset;
+	}
+
+	return 0;
+}
+
+static
+int ssdfs_dumpfs_blk2off_table_stats(struct ssdfs_dumpfs_environment *env,
+				     void *area_buf, u32 area_size)
+{
+	struct ssdfs_blk2off_table_header *hdr;
+	struct ssdfs_dumpfs_compr_stats *compr;
+	size_t hdr_size = sizeof(struct ssdfs_blk2off_table_header);
+	u32 hdr_offset = 0;
+	u32 next_offset;
+	u16 fragments_count;
+	int i;
+
+	compr = &env->stats->compr[SSDFS_DUMPFS_BLK2OFF_STATS];
+
+	do {
+		if ((hdr_offset + hdr_size) > area_size)
+			return -EIO;
+
+		hdr = (struct ssdfs_blk2off_table_header *)((u8 *)area_buf +
+								hdr_offset);
+		fragments_count = le16_to_cpu(hdr->chain_hdr.fragments_count);
+
+		if (fragments_count > SSDFS_BLK2OFF_TBL_MAX)
+			return -ERANGE;
+
+		next_offset = U32_MAX;
+
+		for (i = 0; i < fragments_count; i++) {
+			struct ssdfs_fragment_desc *frag = &hdr->blk[i];
+
+			if (frag->type == SSDFS_NEXT_TABLE_DESC)
+				next_offset = le32_to_cpu(frag->offset);
+			else
+				ssdfs_dumpfs_account_fragment(compr, frag);
+		}
+
+		if (next_offset == U32_MAX)
+			break;
+
+		if (next_offset <= hdr_offset)
+			return -EIO;
+
+		hdr_offset = next_offset;
+	} while (hdr_offset < area_size);
+
+	return 0;
+}
+
+static
+int ssdfs_dumpfs_blk_desc_area_stats(struct ssdfs_dumpfs_environment *env,
+				     void *area_buf, u32 area_size)
+{
+	struct ssdfs_area_block_table *area_hdr;
+	struct ssdfs_dumpfs_compr_stats *compr;
+	struct ssdfs_fragment_desc *frag;
+	size_t area_hdr_size = sizeof(struct ssdfs_area_block_table);
+	u32 hdr_offset = 0;
+	u32 next_offset;
+	u16 fragments_count;
+	int i;
+
+	compr = &env->stats->compr[SSDFS_DUMPFS_BLK_DESC_STATS];
+
+	do {
+		if ((hdr_offset + area_hdr_size) > area_size)
+			return -EIO;
+
+		area_hdr = (struct ssdfs_area_block_table *)((u8 *)area_buf +
+								hdr_offset);
+		fragments_count = le16_to_cpu(area_hdr->chain_hdr.fragments_count);
+
+		if (fragments_count > SSDFS_BLK_TABLE_MAX)
+			return -ERANGE;
+
+		fragments_count = min_t(u16, fragments_count,
+					SSDFS_NEXT_BLK_TABLE_INDEX);
+
+		for (i = 0; i < fragments_count; i++)
+			ssdfs_dumpfs_account_fragment(compr, &area_hdr->blk[i]);
+
+		if (!(le16_to_cpu(area_hdr->chain_hdr.flags) &
+						SSDFS_MULTIPLE_HDR_CHAIN))
+			break;
+
+		frag = &area_hdr->blk[SSDFS_NEXT_BLK_TABLE_INDEX];
+
+		if (frag->type != SSDFS_NEXT_TABLE_DESC)
+			return -ERANGE;
+
+		next_offset = le32_to_cpu(frag->offset);
+		if (next_offset <= hdr_offset)
+			return -EIO;
+
+		hdr_offset = next_offset;
+	} while (hdr_offset < area_size);
+
+	return 0;
+}
+
+static
+int ssdfs_dumpfs_log_areas_stats(struct ssdfs_dumpfs_environment *env,
+				 struct ssdfs_metadata_descriptor *desc_array)
+{
+	struct ssdfs_dumpfs_volume_stats *stats = env->stats;
+	struct ssdfs_metadata_descriptor *desc;
+	void *area_buf = NULL;
+	u32 area_size;
+	int i;
+	int err;
+
+	for (i = 0; i < SSDFS_SEG_HDR_DESC_MAX; i++) {
+		desc = &desc_array[i];
+
+		if (is_ssdfs_dumpfs_area_valid(desc))
+			stats->area_bytes[i] += le32_to_cpu(desc->size);
+	}
+
+	for (i = 0; i < SSDFS_SEG_HDR_DESC_MAX; i++) {
+		desc = &desc_array[i];
+
+		switch (i) {
+		case SSDFS_BLK_BMAP_INDEX:
+		case SSDFS_OFF_TABLE_INDEX:
+		case SSDFS_BLK_DESC_AREA_INDEX:
+			/* area has chain of fragments */
+			break;
+
+		default:
+			continue;
+		}
+
+		if (!is_ssdfs_dumpfs_area_valid(desc))
+			continue;
+
+		area_size = le32_to_cpu(desc->size);
+
+		err = ssdfs_dumpfs_get_area(env, le32_to_cpu(desc->offset),
+					    area_size, &area_buf);
+		if (err)
+			return err;
+
+		switch (i) {
+		case SSDFS_BLK_BMAP_INDEX:
+			err = ssdfs_dumpfs_block_bitmap_stats(env, area_buf,
+							      area_size, NULL);
+			break;
+
+		case SSDFS_OFF_TABLE_INDEX:
+			err = ssdfs_dumpfs_blk2off_table_stats(env, area_buf,
+							       area_size);
+			break;
+
+		default:
+			err = ssdfs_dumpfs_blk_desc_area_stats(env, area_buf,
+							       area_size);
+			break;
+		}
+
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static
+int ssdfs_dumpfs_peb_tbl_fragment_stats(struct ssdfs_dumpfs_environment *env,
+					u8 *frag_buf, u32 frag_size)
+{
+	struct ssdfs_dumpfs_volume_stats *stats = env->stats;
+	struct ssdfs_peb_table_fragment_header *hdr;
+	struct ssdfs_peb_descriptor *desc;
+	struct ssdfs_dumpfs_maptbl_stats *item;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
+	u16 pebs_count;
+	int i;
+
+	if (frag_size < hdr_size)
+		return 0;
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)frag_buf;
+
+	if (le16_to_cpu(hdr->magic) != SSDFS_PEB_TABLE_MAGIC) {
+		/* LEB table's fragment */
+		return 0;
+	}
+
+	pebs_count = le16_to_cpu(hdr->pebs_count);
+	pebs_count = min_t(u32, pebs_count,
+			   (frag_size - hdr_size) / desc_size);
+
+	if (stats->maptbl_count >= stats->maptbl_capacity) {
+		struct ssdfs_dumpfs_maptbl_stats *maptbl;
+		u32 capacity = stats->maptbl_capacity * 2;
+
+		if (capacity == 0)
+			capacity = 16;
+
+		maptbl = realloc(stats->maptbl,
+				 capacity * sizeof(*maptbl));
+		if (!maptbl) {
+			SSDFS_ERR("fail to allocate memory\n");
+			return -ENOMEM;
+		}
+
+		stats->maptbl = maptbl;
+		stats->maptbl_capacity = capacity;
+	}
+
+	item = &stats->maptbl[stats->maptbl_count++];
+	memset(item, 0, sizeof(struct ssdfs_dumpfs_maptbl_stats));
+	item->start_peb = le64_to_cpu(hdr->start_peb);
+	item->cno = stats->cno;
+	item->peb_id = env->peb.id;
+
+	for (i = 0; i < pebs_count; i++) {
+		desc = (struct ssdfs_peb_descriptor *)(frag_buf + hdr_size +
+							(i * desc_size));
+
+		if (desc->state < SSDFS_MAPTBL_PEB_STATE_MAX)
+			item->states[desc->state]++;
+		else
+			item->states[SSDFS_MAPTBL_UNKNOWN_PEB_STATE]++;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_dumpfs_collect_peb_stats() - collect statistics of PEB
+ * @env: pointer on environment
+ *
+ * This function walks through the logs of @env->peb.id and adds
+ * the details of every log into @env->stats. The corrupted log
+ * stops the walk and it is counted in statistics.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_dumpfs_collect_peb_stats(struct ssdfs_dumpfs_environment *env)
+{
+	struct ssdfs_dumpfs_volume_stats *stats = env->stats;
+	union ssdfs_metadata_header buf;
+	struct ssdfs_metadata_descriptor *desc_array;
+	struct ssdfs_metadata_descriptor last_bmap;
+	u32 last_bmap_log_offset = U32_MAX;
+	void *area_buf = NULL;
+	u16 seg_type = SSDFS_UNKNOWN_SEG_TYPE;
+	u16 log_pages;
+	u8 log_pagesize;
+	u32 logs = 0;
+	int err = 0;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "peb_id %llu\n", env->peb.id);
+
+	env->peb.log_index = 0;
+	env->peb.log_offset = 0;
+	env->peb.log_size = env->peb.peb_size;
+
+	while (env->peb.log_offset < env->peb.peb_size) {
+		u16 type;
+
+		env->peb.log_size_inherited = SSDFS_TRUE;
+
+		err = ssdfs_dumpfs_read_log_bytes(env, &buf);
+		if (err == -ENODATA) {
+			err = 0;
+			break;
+		} else if (err) {
+			stats->corrupted_logs++;
+			break;
+		}
+
+		if (le32_to_cpu(buf.magic.common) != SSDFS_SUPER_MAGIC)
+			break;
+
+		if (le16_to_cpu(buf.magic.key) == SSDFS_SEGMENT_HDR_MAGIC) {
+			desc_array = buf.seg_hdr.desc_array;
+			log_pages = le16_to_cpu(buf.seg_hdr.log_pages);
+			log_pagesize = buf.seg_hdr.volume_hdr.log_pagesize;
+			type = le16_to_cpu(buf.seg_hdr.seg_type);
+			stats->cno = le64_to_cpu(buf.seg_hdr.cno);
+			stats->full_logs++;
+		} else {
+			desc_array = buf.pl_hdr.desc_array;
+			log_pages = le16_to_cpu(buf.pl_hdr.log_pages);
+			log_pagesize = buf.pl_hdr.log_pagesize;
+			type = le16_to_cpu(buf.pl_hdr.seg_type);
+			stats->cno = le64_to_cpu(buf.pl_hdr.cno);
+			stats->partial_logs++;
+		}
+
+		if (logs == 0)
+			seg_type = type;
+
+		logs++;
+		stats->logs++;
+
+		if (env->peb.log_size_inherited)
+			env->peb.log_size = (u32)log_pages << log_pagesize;
+
+		err = ssdfs_dumpfs_log_areas_stats(env, desc_array);
+		if (err == -ENOMEM)
+			return err;
+		else if (err) {
+			stats->corrupted_logs++;
+			err = 0;
+			goto try_next_log;
+		}
+
+		if (type == SSDFS_MAPTBL_SEG_TYPE) {
+			env->base.page_size = 1 << log_pagesize;
+
+			err = __ssdfs_dumpfs_parse_metadata(env, desc_array,
+					ssdfs_dumpfs_peb_tbl_fragment_stats);
+			if (err == -ENOMEM)
+				return err;
+			else if (err) {
+				stats->corrupted_logs++;
+				err = 0;
+				goto try_next_log;
+			}
+		}
+
+		if (is_ssdfs_dumpfs_area_valid(&desc_array[SSDFS_BLK_BMAP_INDEX])) {
+			last_bmap = desc_array[SSDFS_BLK_BMAP_INDEX];
+			last_bmap_log_offset = env->peb.log_offset;
+		}
+
+try_next_log:
+		if (env->peb.log_size == 0)
+			break;
+
+		env->peb.log_index++;
+		env->peb.log_offset += env->peb.log_size;
+	}
+
+	stats->pebs++;
+
+	if (logs == 0) {
+		stats->empty_pebs++;
+		return 0;
+	}
+
+	if (seg_type > SSDFS_LAST_KNOWN_SEG_TYPE)
+		seg_type = SSDFS_LAST_KNOWN_SEG_TYPE + 1;
+
+	stats->seg_types[seg_type]++;
+
+	if (stats->min_logs == 0 || logs < stats->min_logs)
+		stats->min_logs = logs;
+	if (logs > stats->max_logs)
+		stats->max_logs = logs;
+
+	if (last_bmap_log_offset == U32_MAX)
+		return 0;
+
+	env->peb.log_offset = last_bmap_log_offset;
+
+	err = ssdfs_dumpfs_get_area(env, le32_to_cpu(last_bmap.offset),
+				    le32_to_cpu(last_bmap.size),
+				    &area_buf);
+	if (!err) {
+		err = ssdfs_dumpfs_block_bitmap_stats(env, area_buf,
+						le32_to_cpu(last_bmap.size),
+						stats->blk_states);
+	}
+
+	if (err == -ENOMEM)
+		return err;
+	else if (err) {
+		SSDFS_ERR("fail to count block states: "
+			  "peb_id %llu, log_offset %u, err %d\n",
+			  env->peb.id, env->peb.log_offset, err);
+	}
+
+	return 0;
+}
+
+static
+void *ssdfs_dumpfs_stats_thread(void *arg)
+{
+	struct ssdfs_dumpfs_peb_dump_job *job =
+				(struct ssdfs_dumpfs_peb_dump_job *)arg;
+	struct ssdfs_dumpfs_peb_dump_pool *pool;
+	struct ssdfs_dumpfs_environment *env;
+	int err;
+
+	if (!job)
+		pthread_exit((void *)1);
+
+	pool = job->pool;
+	env = &job->env;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "thread %u\n", job->id);
+
+	job->err = 0;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->next_peb < pool->pebs_count) {
+		u64 index = pool->next_peb++;
+
+		pthread_mutex_unlock(&pool->lock);
+
+		env->peb.id = pool->start_peb + index;
+
+		err = ssdfs_dumpfs_collect_peb_stats(env);
+		if (err)
+			job->err = err;
+
+		pthread_mutex_lock(&pool->lock);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	pthread_exit((void *)0);
+}
+
+static
+int ssdfs_dumpfs_merge_stats(struct ssdfs_dumpfs_volume_stats *dst,
+			     struct ssdfs_dumpfs_volume_stats *src)
+{
+	int i;
+
+	dst->pebs += src->pebs;
+	dst->empty_pebs += src->empty_pebs;
+
+	for (i = 0; i < SSDFS_DUMPFS_SEG_TYPES_MAX; i++)
+		dst->seg_types[i] += src->seg_types[i];
+
+	dst->logs += src->logs;
+	dst->full_logs += src->full_logs;
+	dst->partial_logs += src->partial_logs;
+	dst->corrupted_logs += src->corrupted_logs;
+
+	if (src->min_logs != 0 &&
+	    (dst->min_logs == 0 || src->min_logs < dst->min_logs))
+		dst->min_logs = src->min_logs;
+	if (src->max_logs > dst->max_logs)
+		dst->max_logs = src->max_logs;
+
+	for (i = 0; i < SSDFS_SEG_HDR_DESC_MAX; i++)
+		dst->area_bytes[i] += src->area_bytes[i];
+
+	for (i = 0; i < SSDFS_DUMPFS_COMPR_STATS_MAX; i++) {
+		dst->compr[i].fragments += src->compr[i].fragments;
+		dst->compr[i].compr_bytes += src->compr[i].compr_bytes;
+		dst->compr[i].uncompr_bytes += src->compr[i].uncompr_bytes;
+	}
+
+	for (i = 0; i < SSDFS_BLK_STATE_MAX; i++)
+		dst->blk_states[i] += src->blk_states[i];
+
+	if (src->maptbl_count == 0)
+		return 0;
+
+	if ((dst->maptbl_count + src->maptbl_count) > dst->maptbl_capacity) {
+		struct ssdfs_dumpfs_maptbl_stats *maptbl;
+		u32 capacity = dst->maptbl_count + src->maptbl_count;
+
+		maptbl = realloc(dst->maptbl, capacity * sizeof(*maptbl));
+		if (!maptbl) {
+			SSDFS_ERR("fail to allocate memory\n");
+			return -ENOMEM;
+		}
+
+		dst->maptbl = maptbl;
+		dst->maptbl_capacity = capacity;
+	}
+
+	memcpy(&dst->maptbl[dst->maptbl_count], src->maptbl,
+		src->maptbl_count * sizeof(struct ssdfs_dumpfs_maptbl_stats));
+	dst->maptbl_count += src->maptbl_count;
+
+	return 0;
+}
+
+static
+int ssdfs_dumpfs_maptbl_stats_cmp(const void *item1, const void *item2)
+{
+	const struct ssdfs_dumpfs_maptbl_stats *frag1 = item1;
+	const struct ssdfs_dumpfs_maptbl_stats *frag2 = item2;
+
+	if (frag1->start_peb != frag2->start_peb)
+		return frag1->start_peb < frag2->start_peb ? -1 : 1;
+
+	/* the newest copy of fragment goes first */
+	if (frag1->cno != frag2->cno)
+		return frag1->cno > frag2->cno ? -1 : 1;
+
+	if (frag1->peb_id != frag2->peb_id)
+		return frag1->peb_id > frag2->peb_id ? -1 : 1;
+
+	return 0;
+}
+
+static inline
+void ssdfs_dumpfs_show_ratio(struct ssdfs_dumpfs_environment *env,
+			     const char *name, u64 dividend, u64 divisor)
+{
+	u64 ratio = 0;
+
+	if (divisor != 0)
+		ratio = (dividend * 100) / divisor;
+
+	SSDFS_DUMPFS_DUMP(env, "%s: %llu.%02llu\n",
+			  name, ratio / 100, ratio % 100);
+}
+
+static
+void ssdfs_dumpfs_show_stats_report(struct ssdfs_dumpfs_environment *env,
+				    struct ssdfs_dumpfs_volume_stats *stats)
+{
+	u64 peb_states[SSDFS_MAPTBL_PEB_STATE_MAX] = {0};
+	u64 maptbl_fragments = 0;
+	u64 migrating_pebs = 0;
+	u32 i;
+	int j;
+
+	if (stats->maptbl_count > 0) {
+		qsort(stats->maptbl, stats->maptbl_count,
+		      sizeof(struct ssdfs_dumpfs_maptbl_stats),
+		      ssdfs_dumpfs_maptbl_stats_cmp);
+	}
+
+	for (i = 0; i < stats->maptbl_count; i++) {
+		struct ssdfs_dumpfs_maptbl_stats *item = &stats->maptbl[i];
+
+		if (i > 0 && item->start_peb == stats->maptbl[i - 1].start_peb)
+			continue;
+
+		maptbl_fragments++;
+
+		for (j = 0; j < SSDFS_MAPTBL_PEB_STATE_MAX; j++) {
+			peb_states[j] += item->states[j];
+
+			if (is_ssdfs_dumpfs_migration_state(j))
+				migrating_pebs += item->states[j];
+		}
+	}
+
+	SSDFS_DUMPFS_DUMP(env, "VOLUME STATISTICS:\n");
+	SSDFS_DUMPFS_DUMP(env, "PEB_SIZE: %u bytes\n", env->peb.peb_size);
+	SSDFS_DUMPFS_DUMP(env, "START_PEB: %llu\n", env->peb.id);
+	SSDFS_DUMPFS_DUMP(env, "PEBS: %llu\n", stats->pebs);
+	SSDFS_DUMPFS_DUMP(env, "EMPTY PEBS: %llu\n", stats->empty_pebs);
+	SSDFS_DUMPFS_DUMP(env, "\n");
+
+	SSDFS_DUMPFS_DUMP(env, "PEBS PER SEGMENT TYPE:\n");
+	for (j = 0; j < SSDFS_DUMPFS_SEG_TYPES_MAX; j++) {
+		SSDFS_DUMPFS_DUMP(env, "%s: %llu\n",
+				  seg_type_names[j], stats->seg_types[j]);
+	}
+	SSDFS_DUMPFS_DUMP(env, "\n");
+
+	SSDFS_DUMPFS_DUMP(env, "LOGS: %llu\n", stats->logs);
+	SSDFS_DUMPFS_DUMP(env, "FULL LOGS: %llu\n", stats->full_logs);
+	SSDFS_DUMPFS_DUMP(env, "PARTIAL LOGS: %llu\n", stats->partial_logs);
+	SSDFS_DUMPFS_DUMP(env, "CORRUPTED LOGS: %llu\n",
+			  stats->corrupted_logs);
+	SSDFS_DUMPFS_DUMP(env, "MIN LOGS PER PEB: %u\n", stats->min_logs);
+	SSDFS_DUMPFS_DUMP(env, "MAX LOGS PER PEB: %u\n", stats->max_logs);
+	ssdfs_dumpfs_show_ratio(env, "AVERAGE LOGS PER PEB", stats->logs,
+				stats->pebs - stats->empty_pebs);
+	SSDFS_DUMPFS_DUMP(env, "\n");
+
+	SSDFS_DUMPFS_DUMP(env, "AREAS SIZE:\n");
+	for (j = 0; j < SSDFS_SEG_HDR_DESC_MAX; j++) {
+		SSDFS_DUMPFS_DUMP(env, "%s: %llu bytes\n",
+				  area_names[j], stats->area_bytes[j]);
+	}
+	SSDFS_DUMPFS_DUMP(env, "\n");
+
+	SSDFS_DUMPFS_DUMP(env, "AREAS COMPRESSION:\n");
+	for (j = 0; j < SSDFS_DUMPFS_COMPR_STATS_MAX; j++) {
+		struct ssdfs_dumpfs_compr_stats *compr = &stats->compr[j];
+
+		SSDFS_DUMPFS_DUMP(env, "%s: fragments %llu, "
+				  "compr_bytes %llu, uncompr_bytes %llu\n",
+				  compr_area_names[j], compr->fragments,
+				  compr->compr_bytes, compr->uncompr_bytes);
+		ssdfs_dumpfs_show_ratio(env, "COMPRESSION RATIO",
+					compr->uncompr_bytes,
+					compr->compr_bytes);
+	}
+	SSDFS_DUMPFS_DUMP(env, "\n");
+
+	SSDFS_DUMPFS_DUMP(env, "BLOCK STATES (LAST LOG OF PEB):\n");
+	for (j = 0; j < SSDFS_BLK_STATE_MAX; j++) {
+		SSDFS_DUMPFS_DUMP(env, "%s: %llu\n",
+				  blk_state_names[j], stats->blk_states[j]);
+	}
+	SSDFS_DUMPFS_DUMP(env, "\n");
+
+	SSDFS_DUMPFS_DUMP(env, "MAPPING TABLE:\n");
+	SSDFS_DUMPFS_DUMP(env, "PEB TABLE FRAGMENTS: %llu\n",
+			  maptbl_fragments);
+	for (j = 0; j < SSDFS_MAPTBL_PEB_STATE_MAX; j++) {
+		if (peb_states[j] == 0)
+			continue;
+
+		SSDFS_DUMPFS_DUMP(env, "%s: %llu\n",
+				  peb_state_names[j], peb_states[j]);
+	}
+	SSDFS_DUMPFS_DUMP(env, "MIGRATING PEBS: %llu\n", migrating_pebs);
+}
+
+/*
+ * ssdfs_dumpfs_show_volume_stats() - show statistics of volume
+ * @env: pointer on environment
+ *
+ * PEBs of the range are scanned by pool of threads. Every thread
+ * collects private statistics and the statistics are merged
+ * when all PEBs are scanned. Scanning doesn't depend on order
+ * of PEBs, so the report is the same for any number of threads.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_dumpfs_show_volume_stats(struct ssdfs_dumpfs_environment *env)
+{
+	struct ssdfs_dumpfs_peb_dump_pool pool;
+	struct ssdfs_dumpfs_peb_dump_job *jobs = NULL;
+	struct ssdfs_dumpfs_volume_stats *stats = NULL;
+	struct ssdfs_dumpfs_volume_stats total;
+	struct ssdfs_segment_header sg_buf;
+	u64 volume_pebs;
+	u32 threads;
+	u32 started = 0;
+	int step = 2;
+	u32 i;
+	int err = 0;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "command: %#x\n",
+		  env->command);
+
+	if (env->peb.peb_size == U32_MAX) {
+		SSDFS_DUMPFS_INFO(env->base.show_info,
+				  "[00%d]\tFIND FIRST VALID PEB...\n",
+				  step);
+
+		err = ssdfs_dumpfs_find_any_valid_peb(env, &sg_buf);
+		if (err) {
+			SSDFS_INFO("PLEASE, DEFINE PEB SIZE\n");
+			print_usage();
+			return err;
+		}
+
+		SSDFS_DUMPFS_INFO(env->base.show_info,
+				  "[00%d]\t[SUCCESS]\n",
+				  step);
+		step++;
+
+		env->peb.peb_size = 1 << sg_buf.volume_hdr.log_erasesize;
+	}
+
+	SSDFS_DUMPFS_INFO(env->base.show_info,
+			  "[00%d]\tCOLLECT VOLUME STATISTICS...\n",
+			  step);
+
+	memset(&total, 0, sizeof(struct ssdfs_dumpfs_volume_stats));
+	memset(&pool, 0, sizeof(struct ssdfs_dumpfs_peb_dump_pool));
+
+	volume_pebs = env->base.fs_size / env->peb.peb_size;
+
+	pool.start_peb = env->peb.id;
+
+	if (env->peb.id < volume_pebs) {
+		pool.pebs_count = min_t(u64, env->peb.pebs_count,
+					volume_pebs - env->peb.id);
+	}
+
+	if (pool.pebs_count == 0)
+		goto show_report;
+
+	threads = (u32)min_t(u64, env->threads, pool.pebs_count);
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+
+	stats = calloc(threads, sizeof(struct ssdfs_dumpfs_volume_stats));
+	if (!stats) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate statistics: %s\n",
+			  strerror(errno));
+		goto destroy_pool;
+	}
+
+	jobs = calloc(threads, sizeof(struct ssdfs_dumpfs_peb_dump_job));
+	if (!jobs) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate jobs: %s\n",
+			  strerror(errno));
+		goto free_stats;
+	}
+
+	for (i = 0; i < threads; i++) {
+		struct ssdfs_dumpfs_peb_dump_job *job = &jobs[i];
+
+		job->id = i;
+		job->pool = &pool;
+		memcpy(&job->env, env, sizeof(struct ssdfs_dumpfs_environment));
+		job->env.fd = -1;
+		job->env.stream = NULL;
+		job->env.peb_output = NULL;
+		memset(&job->env.output, 0,
+			sizeof(struct ssdfs_dumpfs_output_buffer));
+		memset(&job->env.area_dir, 0,
+			sizeof(struct ssdfs_dumpfs_area_directory));
+		job->env.stats = &stats[i];
+
+		err = pthread_create(&job->thread, NULL,
+				     ssdfs_dumpfs_stats_thread,
+				     (void *)job);
+		if (err) {
+			SSDFS_ERR("fail to create thread %u: %s\n",
+				  i, strerror(err));
+			break;
+		}
+
+		started++;
+	}
+
+	if (started == 0) {
+		if (!err)
+			err = -ECHILD;
+		goto free_jobs;
+	}
+
+	err = 0;
+
+	for (i = 0; i < started; i++) {
+		pthread_join(jobs[i].thread, NULL);
+
+		ssdfs_dumpfs_forget_areas(&jobs[i].env);
+
+		if (jobs[i].err)
+			err = jobs[i].err;
+	}
+
+	for (i = 0; i < started; i++) {
+		int res = ssdfs_dumpfs_merge_stats(&total, &stats[i]);
+
+		if (res)
+			err = res;
+	}
+
+free_jobs:
+	free(jobs);
+
+free_stats:
+	for (i = 0; stats && i < threads; i++)
+		free(stats[i].maptbl);
+	free(stats);
+
+destroy_pool:
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+
+	if (err)
+		goto free_total;
+
+show_report:
+	SSDFS_DUMPFS_INFO(env->base.show_info,
+			  "[00%d]\t[SUCCESS]\n",
+			  step);
+
+	ssdfs_dumpfs_show_stats_report(env, &total);
+
+free_total:
+	free(total.maptbl);
+
+	return err;
+}
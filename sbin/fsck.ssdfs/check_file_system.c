@@ -13,6 +13,7 @@
  */
 
 #include "fsck.h"
+#include "segbmap.h"
 
 enum {
 	SSDFS_FSCK_CHECK_RESULT_UNKNOWN,
@@ -38,132 +39,4631 @@ void ssdfs_fsck_destroy_check_result(struct ssdfs_fsck_environment *env)
 
 typedef int (*check_fn)(struct ssdfs_fsck_environment *env);
 
+/*
+ * ssdfs_fsck_get_checked_creation_point() - get creation point of volume
+ * @env: fsck environment
+ *
+ * Creation points are sorted by volume creation time. The stale
+ * volume found by whole volume search could be the first one.
+ * So, the creation point is selected by creation time of found
+ * valid PEB.
+ */
+struct ssdfs_fsck_volume_creation_point *
+ssdfs_fsck_get_checked_creation_point(struct ssdfs_fsck_environment *env)
+{
+	struct ssdfs_fsck_volume_creation_array *array;
+	union ssdfs_metadata_header *found_peb;
+	u64 create_time;
+	int i;
+
+	array = &env->detection_result.array;
+	found_peb = &env->detection_result.found_valid_peb;
+	create_time = le64_to_cpu(found_peb->seg_hdr.volume_hdr.create_time);
+
+	for (i = 0; i < array->count; i++) {
+		if (array->creation_points[i].volume_creation_timestamp ==
+								create_time)
+			return &array->creation_points[i];
+	}
+
+	if (array->count > 0)
+		return &array->creation_points[0];
+
+	return NULL;
+}
+
+/*
+ * is_ssdfs_fsck_csum_valid() - check checksum of metadata structure
+ * @check: checksum descriptor inside of @buf
+ * @buf: metadata structure
+ * @buf_size: size of @buf in bytes
+ *
+ * Unlike is_csum_valid(), the mismatch is not reported as error
+ * because fsck accounts corrupted structures by itself.
+ */
+static
+int is_ssdfs_fsck_csum_valid(struct ssdfs_metadata_check *check,
+			     void *buf, u32 buf_size)
+{
+	u16 bytes = le16_to_cpu(check->bytes);
+	__le32 csum, calculated;
+
+	if (!(le16_to_cpu(check->flags) & SSDFS_CRC32) ||
+	    bytes == 0 || bytes > buf_size)
+		return SSDFS_FALSE;
+
+	csum = check->csum;
+	check->csum = 0;
+	calculated = ssdfs_crc32_le(buf, bytes);
+	check->csum = csum;
+
+	return csum == calculated;
+}
+
+/*
+ * is_base_snapshot_segment_corrupted() - check base snapshot segment
+ * @env: fsck environment
+ *
+ * The segment header of the initial PEB is located right after
+ * the reserved VBR area. Its magic, segment type, geometry and
+ * checksum are checked. Content of logs is not checked yet.
+ */
+static
+int is_base_snapshot_segment_corrupted(struct ssdfs_fsck_environment *env)
+{
+	struct ssdfs_fsck_base_snapshot_segment_corruption *result;
+	union ssdfs_metadata_header hdr;
+	struct ssdfs_segment_header *seg_hdr = &hdr.seg_hdr;
+	struct ssdfs_volume_header *vh = &seg_hdr->volume_hdr;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "Try to find base snapshot segment corruption(s)\n");
+
+	result = &env->check_result.corruption.base_snapshot_seg;
+	result->invalid_header = SSDFS_FALSE;
+	result->corrupted_header = SSDFS_FALSE;
+
+	err = ssdfs_read_segment_header(&env->base,
+					SSDFS_INITIAL_SNAPSHOT_SEG,
+					env->base.erase_size, 0,
+					sizeof(hdr), &hdr);
+	if (err) {
+		SSDFS_ERR("fail to read base snapshot segment's header: "
+			  "err %d\n", err);
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		return result->state;
+	}
+
+	if (le32_to_cpu(hdr.magic.common) != SSDFS_SUPER_MAGIC ||
+	    le16_to_cpu(hdr.magic.key) != SSDFS_SEGMENT_HDR_MAGIC ||
+	    le16_to_cpu(seg_hdr->seg_type) !=
+				SSDFS_INITIAL_SNAPSHOT_SEG_TYPE ||
+	    (1U << vh->log_pagesize) != env->base.page_size ||
+	    (1U << vh->log_erasesize) != env->base.erase_size) {
+		result->invalid_header = SSDFS_TRUE;
+	} else if (!is_ssdfs_fsck_csum_valid(&vh->check, seg_hdr,
+					sizeof(struct ssdfs_segment_header))) {
+		result->corrupted_header = SSDFS_TRUE;
+	}
+
+	SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+			"base snapshot segment: invalid header %d, "
+			"corrupted header %d\n",
+			result->invalid_header, result->corrupted_header);
+
+	if (result->invalid_header || result->corrupted_header) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		env->check_result.corruption.mask |=
+				SSDFS_FSCK_BASE_SNAPSHOT_SEGMENT_CORRUPTED;
+	} else
+		result->state = SSDFS_FSCK_CHECK_RESULT_SUCCESS;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "finished: state %#x\n", result->state);
+
+	return result->state;
+}
+
+#define SSDFS_FSCK_SEGBMAP_FRAGMENT_ABSENT	(0)
+#define SSDFS_FSCK_SEGBMAP_FRAGMENT_LOADED	(1)
+#define SSDFS_FSCK_SEGBMAP_FRAGMENT_VALID	(2)
+#define SSDFS_FSCK_SEGBMAP_FRAGMENT_COMPRESSED	(3)
+
+#define SSDFS_FSCK_SEGBMAP_FRAG_COMPR_MASK \
+	(SSDFS_SEGBMAP_FRAG_ZLIB_COMPR | SSDFS_SEGBMAP_FRAG_LZO_COMPR | \
+	 SSDFS_SEGBMAP_FRAG_LZ4_COMPR | SSDFS_SEGBMAP_FRAG_ZSTD_COMPR)
+
+/*
+ * Segment states are processed by 64-bit words. Every word
+ * contains 16 states (4 bits per state) and the lowest bit
+ * of every state in word is selected by this mask.
+ */
+#define SSDFS_FSCK_SEG_STATES_PER_WORD		(16)
+#define SSDFS_FSCK_SEG_STATE_LSB_MASK		0x1111111111111111ULL
+
+#define SSDFS_FSCK_SEG_STATE_BIT(state)		(1U << (state))
+#define SSDFS_FSCK_SEG_STATE_RETIRED \
+	(SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_USED) | \
+	 SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_PRE_DIRTY) | \
+	 SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_DIRTY))
+
+/*
+ * Segment states that are expected for segments
+ * with metadata PEBs of every segment type.
+ */
+static const u32 segbmap_expected_states[SSDFS_LAST_KNOWN_SEG_TYPE] = {
+	[SSDFS_SB_SEG_TYPE] = SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_RESERVED) |
+				SSDFS_FSCK_SEG_STATE_RETIRED,
+	[SSDFS_INITIAL_SNAPSHOT_SEG_TYPE] =
+				SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_RESERVED) |
+				SSDFS_FSCK_SEG_STATE_RETIRED,
+	[SSDFS_SEGBMAP_SEG_TYPE] =
+				SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_RESERVED) |
+				SSDFS_FSCK_SEG_STATE_RETIRED,
+	[SSDFS_MAPTBL_SEG_TYPE] = SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_RESERVED) |
+				SSDFS_FSCK_SEG_STATE_RETIRED,
+	[SSDFS_LEAF_NODE_SEG_TYPE] =
+			SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_LEAF_NODE_USING) |
+			SSDFS_FSCK_SEG_STATE_RETIRED,
+	[SSDFS_HYBRID_NODE_SEG_TYPE] =
+			SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_HYBRID_NODE_USING) |
+			SSDFS_FSCK_SEG_STATE_RETIRED,
+	[SSDFS_INDEX_NODE_SEG_TYPE] =
+			SSDFS_FSCK_SEG_STATE_BIT(SSDFS_SEG_INDEX_NODE_USING) |
+			SSDFS_FSCK_SEG_STATE_RETIRED,
+};
+
+/*
+ * struct ssdfs_fsck_segbmap_copy - loaded copy of segment bitmap
+ * @fragments: fragments' buffer
+ * @state: state of every fragment in buffer
+ */
+struct ssdfs_fsck_segbmap_copy {
+	u8 *fragments;
+	u8 *state;
+};
+
+/*
+ * struct ssdfs_fsck_segbmap_check - segment bitmap check environment
+ * @env: fsck environment
+ * @creation_point: volume creation point
+ * @segbmap: detected segment bitmap
+ * @segs_count: number of segment bitmap's segments
+ * @copies_count: number of segment bitmap's copies
+ * @fragment_size: size of fragment in bytes
+ * @fragments_count: number of fragments in segment bitmap
+ * @fragments_per_seg: number of fragments in segment
+ * @items_per_fragment: number of segment states in fragment
+ * @nsegs: number of segments in volume
+ * @copies: loaded copies of segment bitmap
+ */
+struct ssdfs_fsck_segbmap_check {
+	struct ssdfs_fsck_environment *env;
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_segment_bitmap_detection *segbmap;
+	u32 segs_count;
+	int copies_count;
+	u32 fragment_size;
+	u16 fragments_count;
+	u16 fragments_per_seg;
+	u32 items_per_fragment;
+	u64 nsegs;
+	struct ssdfs_fsck_segbmap_copy copies[SSDFS_SEGBMAP_SEG_COPY_MAX];
+};
+
+/*
+ * struct ssdfs_fsck_segbmap_job - segment bitmap check's thread
+ * @check: segment bitmap check environment
+ * @thread: thread descriptor
+ * @id: thread ID
+ * @err: code of error
+ * @start: first item (segment or fragment) of thread
+ * @count: number of items (segments or fragments) of thread
+ * @result: found corruptions
+ */
+struct ssdfs_fsck_segbmap_job {
+	struct ssdfs_fsck_segbmap_check *check;
+	pthread_t thread;
+	int id;
+	int err;
+	u32 start;
+	u32 count;
+	struct ssdfs_fsck_segment_bitmap_corruption result;
+};
+
+typedef void *(*segbmap_job_fn)(void *arg);
+typedef void (*peb_payload_fn)(void *job, u32 index, int copy_index,
+				u8 *area, u32 area_size);
+
+static inline
+u32 ssdfs_fsck_count_seg_states(u64 mask)
+{
+	return (u32)__builtin_popcountll(mask);
+}
+
+/*
+ * ssdfs_fsck_seg_states_equal() - find states equal to requested one
+ * @word: word of segment states
+ * @state: requested state
+ *
+ * The lowest bit of every state in returned mask is set
+ * if the state is equal to requested one.
+ */
+static inline
+u64 ssdfs_fsck_seg_states_equal(u64 word, int state)
+{
+	u64 diff = word ^ (SSDFS_FSCK_SEG_STATE_LSB_MASK * (u64)state);
+
+	diff |= diff >> 1;
+	diff |= diff >> 2;
+
+	return ~diff & SSDFS_FSCK_SEG_STATE_LSB_MASK;
+}
+
+/*
+ * ssdfs_fsck_seg_states_invalid() - find unknown states
+ * @word: word of segment states
+ *
+ * The lowest bit of every state in returned mask is set
+ * if the state is not less than %SSDFS_SEG_STATE_MAX (0xB).
+ */
+static inline
+u64 ssdfs_fsck_seg_states_invalid(u64 word)
+{
+	u64 mask = (word >> 3) & ((word >> 2) | ((word >> 1) & word));
+
+	return mask & SSDFS_FSCK_SEG_STATE_LSB_MASK;
+}
+
+static inline
+u64 ssdfs_fsck_seg_states_differ(u64 word1, u64 word2)
+{
+	u64 diff = word1 ^ word2;
+
+	diff |= diff >> 1;
+	diff |= diff >> 2;
+
+	return diff & SSDFS_FSCK_SEG_STATE_LSB_MASK;
+}
+
+static inline
+u64 ssdfs_fsck_get_seg_states_word(u8 *states, u32 item,
+				   u32 items_count, u64 *lsb_mask)
+{
+	u32 items_per_byte = SSDFS_ITEMS_PER_BYTE(SSDFS_SEG_STATE_BITS);
+	u32 rest = items_count - item;
+	__le64 raw;
+
+	memcpy(&raw, states + (item / items_per_byte), sizeof(__le64));
+
+	*lsb_mask = SSDFS_FSCK_SEG_STATE_LSB_MASK;
+	if (rest < SSDFS_FSCK_SEG_STATES_PER_WORD)
+		*lsb_mask &= (1ULL << (rest * SSDFS_SEG_STATE_BITS)) - 1;
+
+	return le64_to_cpu(raw);
+}
+
+static inline
+u8 *ssdfs_fsck_segbmap_fragment(struct ssdfs_fsck_segbmap_check *check,
+				int copy_index, u32 sequence_id)
+{
+	return check->copies[copy_index].fragments +
+			((size_t)sequence_id * check->fragment_size);
+}
+
+static inline
+u32 ssdfs_fsck_segbmap_fragment_items(struct ssdfs_fsck_segbmap_check *check,
+				      u32 sequence_id)
+{
+	u64 start_item = (u64)sequence_id * check->items_per_fragment;
+
+	if (start_item >= check->nsegs)
+		return 0;
+
+	return (u32)min_t(u64, check->items_per_fragment,
+			  check->nsegs - start_item);
+}
+
+static inline
+int is_ssdfs_fsck_log_header(union ssdfs_metadata_header *hdr)
+{
+	u16 key = le16_to_cpu(hdr->magic.key);
+
+	if (le32_to_cpu(hdr->magic.common) != SSDFS_SUPER_MAGIC)
+		return SSDFS_FALSE;
+
+	return key == SSDFS_SEGMENT_HDR_MAGIC ||
+		key == SSDFS_PARTIAL_LOG_HDR_MAGIC;
+}
+
+/*
+ * ssdfs_fsck_segbmap_store_fragments() - store fragments of log
+ * @arg: thread of segment bitmap check
+ * @seg_index: segment index in segment bitmap's chain
+ * @copy_index: copy index (main or backup)
+ * @area: content of log's payload area
+ * @area_size: size of payload area in bytes
+ *
+ * Fragments are stored by sequence ID. Every segment of
+ * the chain contains its own range of sequence IDs. As a result,
+ * threads never store the same fragment. The fragment of later
+ * log replaces the fragment of previous one.
+ */
+static
+void ssdfs_fsck_segbmap_store_fragments(void *arg,
+					u32 seg_index, int copy_index,
+					u8 *area, u32 area_size)
+{
+	struct ssdfs_fsck_segbmap_job *job = (struct ssdfs_fsck_segbmap_job *)arg;
+	struct ssdfs_fsck_segbmap_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_segbmap_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_segbmap_fragment_header);
+	u32 page_size = env->base.page_size;
+	u32 start_id = seg_index * check->fragments_per_seg;
+	u32 end_id = min_t(u32, start_id + check->fragments_per_seg,
+			   check->fragments_count);
+	u32 offset;
+
+	for (offset = 0; (offset + hdr_size) <= area_size;
+						offset += page_size) {
+		u32 bytes = min_t(u32, area_size - offset,
+				  check->fragment_size);
+		u16 sequence_id;
+		u8 *fragment;
+
+		hdr = (struct ssdfs_segbmap_fragment_header *)(area + offset);
+
+		if (le16_to_cpu(hdr->magic) != SSDFS_SEGBMAP_HDR_MAGIC) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid fragment's magic: "
+				  "seg_index %u, copy_index %d, offset %u\n",
+				  seg_index, copy_index, offset);
+			job->result.invalid_fragments++;
+			continue;
+		}
+
+		sequence_id = le16_to_cpu(hdr->sequence_id);
+
+		if (sequence_id < start_id || sequence_id >= end_id) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid sequence_id %u: "
+				  "seg_index %u, start_id %u, end_id %u\n",
+				  sequence_id, seg_index, start_id, end_id);
+			job->result.invalid_fragments++;
+			continue;
+		}
+
+		fragment = ssdfs_fsck_segbmap_fragment(check, copy_index,
+							sequence_id);
+		memset(fragment, 0, check->fragment_size);
+		memcpy(fragment, hdr, bytes);
+
+		check->copies[copy_index].state[sequence_id] =
+					SSDFS_FSCK_SEGBMAP_FRAGMENT_LOADED;
+	}
+}
+
+/*
+ * ssdfs_fsck_load_peb_payload() - process payload of every log of PEB
+ * @env: fsck environment
+ * @job: thread of check
+ * @index: index of PEB's segment or PEB in metadata structure's chain
+ * @copy_index: copy index (main or backup)
+ * @peb_id: PEB ID
+ * @fn: payload processing function
+ *
+ * Logs are processed from the PEB's beginning. So, payload
+ * of later log is processed after payload of previous one.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_fsck_load_peb_payload(struct ssdfs_fsck_environment *env,
+				void *job, u32 index, int copy_index,
+				u64 peb_id, peb_payload_fn fn)
+{
+	struct ssdfs_metadata_descriptor *desc_array;
+	struct ssdfs_metadata_descriptor *desc;
+	union ssdfs_metadata_header hdr;
+	u32 peb_size = env->base.erase_size;
+	u32 page_size = env->base.page_size;
+	u32 log_offset = 0;
+	u32 log_end;
+	u8 *area = NULL;
+	int i;
+	int err = 0;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "index %u, copy_index %d, peb_id %llu\n",
+		  index, copy_index, peb_id);
+
+	area = malloc(peb_size);
+	if (!area) {
+		SSDFS_ERR("fail to allocate memory: size %u\n",
+			  peb_size);
+		return -ENOMEM;
+	}
+
+	while (log_offset < peb_size) {
+		err = ssdfs_read_segment_header(&env->base, peb_id, peb_size,
+						log_offset, sizeof(hdr), &hdr);
+		if (err) {
+			SSDFS_ERR("fail to read log header: "
+				  "peb_id %llu, log_offset %u, err %d\n",
+				  peb_id, log_offset, err);
+			goto free_area;
+		}
+
+		if (!is_ssdfs_fsck_log_header(&hdr))
+			break;
+
+		if (le16_to_cpu(hdr.magic.key) == SSDFS_SEGMENT_HDR_MAGIC)
+			desc_array = hdr.seg_hdr.desc_array;
+		else
+			desc_array = hdr.pl_hdr.desc_array;
+
+		log_end = log_offset;
+
+		for (i = 0; i < SSDFS_SEG_HDR_DESC_MAX; i++) {
+			desc = &desc_array[i];
+
+			if (!is_ssdfs_fsck_area_valid(desc))
+				continue;
+
+			log_end = max_t(u32, log_end,
+					le32_to_cpu(desc->offset) +
+					le32_to_cpu(desc->size));
+		}
+
+		desc = &desc_array[SSDFS_COLD_PAYLOAD_AREA_INDEX];
+
+		if (is_ssdfs_fsck_area_valid(desc) &&
+		    (le32_to_cpu(desc->offset) + le32_to_cpu(desc->size)) <=
+								peb_size) {
+			u32 area_offset = le32_to_cpu(desc->offset);
+			u32 area_size = le32_to_cpu(desc->size);
+
+			err = ssdfs_read_area_content(&env->base,
+						      peb_id, peb_size,
+						      area_offset, area_size,
+						      area);
+			if (err) {
+				SSDFS_ERR("fail to read payload: "
+					  "peb_id %llu, offset %u, "
+					  "size %u, err %d\n",
+					  peb_id, area_offset,
+					  area_size, err);
+				goto free_area;
+			}
+
+			fn(job, index, copy_index, area, area_size);
+		}
+
+		log_end = ((log_end + page_size - 1) / page_size) * page_size;
+
+		if (log_end <= log_offset)
+			break;
+
+		log_offset = log_end;
+	}
+
+free_area:
+	free(area);
+	return err;
+}
+
+static
+void *ssdfs_fsck_segbmap_load_segments(void *arg)
+{
+	struct ssdfs_fsck_segbmap_job *job = (struct ssdfs_fsck_segbmap_job *)arg;
+	struct ssdfs_fsck_segbmap_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_segbmap_sb_header *sb_hdr = &check->segbmap->segbmap_sb_hdr;
+	u16 fragments_per_peb = le16_to_cpu(sb_hdr->fragments_per_peb);
+	u32 lebs_per_seg = env->seg_size / env->base.erase_size;
+	u32 i, j;
+
+	for (i = job->start; i < (job->start + job->count); i++) {
+		u32 seg_index = i / check->copies_count;
+		int copy_index = i % check->copies_count;
+		u32 processed_fragments = 0;
+		u64 seg_id;
+
+		seg_id = le64_to_cpu(sb_hdr->segs[seg_index][copy_index]);
+		if (seg_id >= U64_MAX)
+			continue;
+
+		for (j = 0; j < lebs_per_seg; j++) {
+			u64 leb_id = (seg_id * lebs_per_seg) + j;
+			u64 peb_id;
+
+			if (processed_fragments >= check->fragments_per_seg)
+				break;
+
+			peb_id = __ssdfs_maptbl_cache_convert_leb2peb(env,
+							check->creation_point,
+							leb_id);
+			if (peb_id >= U64_MAX) {
+				SSDFS_DBG(env->base.show_debug,
+					  "unknown PEB: seg_id %llu, "
+					  "leb_id %llu\n",
+					  seg_id, leb_id);
+				goto next_leb;
+			}
+
+			job->err = ssdfs_fsck_load_peb_payload(env, job,
+						seg_index, copy_index, peb_id,
+						ssdfs_fsck_segbmap_store_fragments);
+			if (job->err) {
+				SSDFS_ERR("fail to load PEB: "
+					  "peb_id %llu, err %d\n",
+					  peb_id, job->err);
+				pthread_exit((void *)1);
+			}
+
+next_leb:
+			processed_fragments += fragments_per_peb;
+		}
+	}
+
+	pthread_exit((void *)0);
+}
+
+/*
+ * ssdfs_fsck_segbmap_check_fragment_copy() - check fragment of copy
+ * @job: thread of segment bitmap check
+ * @copy_index: copy index (main or backup)
+ * @sequence_id: fragment's sequence ID
+ *
+ * This method checks the fragment's header and checksum and
+ * compares counters of header with states of fragment.
+ * Invalid fragment is excluded from further checking.
+ */
+static
+void ssdfs_fsck_segbmap_check_fragment_copy(struct ssdfs_fsck_segbmap_job *job,
+					    int copy_index, u32 sequence_id)
+{
+	struct ssdfs_fsck_segbmap_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_fsck_segment_bitmap_corruption *result = &job->result;
+	struct ssdfs_segbmap_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_segbmap_fragment_header);
+	u32 items_per_byte = SSDFS_ITEMS_PER_BYTE(SSDFS_SEG_STATE_BITS);
+	u8 *state = &check->copies[copy_index].state[sequence_id];
+	u8 *fragment;
+	u32 items_count;
+	u16 fragment_bytes;
+	u32 used_or_dirty = 0;
+	u32 bad = 0;
+	u64 invalid = 0;
+	u64 lsb_mask;
+	__le32 csum;
+	u32 i;
+
+	if (*state != SSDFS_FSCK_SEGBMAP_FRAGMENT_LOADED)
+		return;
+
+	fragment = ssdfs_fsck_segbmap_fragment(check, copy_index, sequence_id);
+	hdr = (struct ssdfs_segbmap_fragment_header *)fragment;
+	items_count = ssdfs_fsck_segbmap_fragment_items(check, sequence_id);
+	fragment_bytes = le16_to_cpu(hdr->fragment_bytes);
+
+	if (items_count == 0 ||
+	    le16_to_cpu(hdr->seg_index) !=
+			(sequence_id / check->fragments_per_seg) ||
+	    le64_to_cpu(hdr->start_item) !=
+			((u64)sequence_id * check->items_per_fragment) ||
+	    le16_to_cpu(hdr->total_segs) != items_count ||
+	    fragment_bytes <= hdr_size ||
+	    fragment_bytes > check->fragment_size) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid fragment's header: "
+			  "copy_index %d, sequence_id %u, seg_index %u, "
+			  "start_item %llu, total_segs %u, "
+			  "fragment_bytes %u\n",
+			  copy_index, sequence_id,
+			  le16_to_cpu(hdr->seg_index),
+			  le64_to_cpu(hdr->start_item),
+			  le16_to_cpu(hdr->total_segs),
+			  fragment_bytes);
+		result->invalid_fragments++;
+		*state = SSDFS_FSCK_SEGBMAP_FRAGMENT_ABSENT;
+		return;
+	}
+
+	if (hdr->flags & SSDFS_FSCK_SEGBMAP_FRAG_COMPR_MASK) {
+		result->compressed_fragments++;
+		*state = SSDFS_FSCK_SEGBMAP_FRAGMENT_COMPRESSED;
+		return;
+	}
+
+	if (fragment_bytes < (hdr_size + ((items_count + items_per_byte - 1) /
+							items_per_byte))) {
+		SSDFS_DBG(env->base.show_debug,
+			  "fragment is too short: "
+			  "copy_index %d, sequence_id %u, "
+			  "fragment_bytes %u, items_count %u\n",
+			  copy_index, sequence_id,
+			  fragment_bytes, items_count);
+		result->invalid_fragments++;
+		*state = SSDFS_FSCK_SEGBMAP_FRAGMENT_ABSENT;
+		return;
+	}
+
+	csum = hdr->checksum;
+	hdr->checksum = 0;
+	if (csum != ssdfs_crc32_le(fragment, fragment_bytes)) {
+		hdr->checksum = csum;
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid checksum: "
+			  "copy_index %d, sequence_id %u\n",
+			  copy_index, sequence_id);
+		result->corrupted_fragments++;
+		*state = SSDFS_FSCK_SEGBMAP_FRAGMENT_ABSENT;
+		return;
+	}
+	hdr->checksum = csum;
+
+	for (i = 0; i < items_count; i += SSDFS_FSCK_SEG_STATES_PER_WORD) {
+		u64 word = ssdfs_fsck_get_seg_states_word(fragment + hdr_size,
+							  i, items_count,
+							  &lsb_mask);
+		u64 mask;
+
+		mask = ssdfs_fsck_seg_states_equal(word, SSDFS_SEG_USED);
+		mask |= ssdfs_fsck_seg_states_equal(word, SSDFS_SEG_PRE_DIRTY);
+		mask |= ssdfs_fsck_seg_states_equal(word, SSDFS_SEG_DIRTY);
+		used_or_dirty += ssdfs_fsck_count_seg_states(mask & lsb_mask);
+
+		mask = ssdfs_fsck_seg_states_equal(word, SSDFS_SEG_BAD);
+		bad += ssdfs_fsck_count_seg_states(mask & lsb_mask);
+
+		mask = ssdfs_fsck_seg_states_invalid(word);
+		invalid += ssdfs_fsck_count_seg_states(mask & lsb_mask);
+	}
+
+	result->invalid_states += invalid;
+
+	if (le16_to_cpu(hdr->used_or_dirty_segs) != used_or_dirty ||
+	    le16_to_cpu(hdr->bad_segs) != bad ||
+	    ((u32)le16_to_cpu(hdr->clean_or_using_segs) +
+	     le16_to_cpu(hdr->used_or_dirty_segs) +
+	     le16_to_cpu(hdr->bad_segs)) != items_count) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid counters: "
+			  "copy_index %d, sequence_id %u, "
+			  "clean_or_using_segs %u, "
+			  "used_or_dirty_segs %u (found %u), "
+			  "bad_segs %u (found %u), total_segs %u\n",
+			  copy_index, sequence_id,
+			  le16_to_cpu(hdr->clean_or_using_segs),
+			  le16_to_cpu(hdr->used_or_dirty_segs),
+			  used_or_dirty,
+			  le16_to_cpu(hdr->bad_segs), bad,
+			  items_count);
+		result->invalid_counters++;
+	}
+
+	*state = SSDFS_FSCK_SEGBMAP_FRAGMENT_VALID;
+}
+
+static
+void ssdfs_fsck_segbmap_compare_copies(struct ssdfs_fsck_segbmap_job *job,
+					u32 sequence_id)
+{
+	struct ssdfs_fsck_segbmap_check *check = job->check;
+	size_t hdr_size = sizeof(struct ssdfs_segbmap_fragment_header);
+	u8 *main_states, *copy_states;
+	u32 items_count;
+	u64 differ = 0;
+	u64 lsb_mask;
+	u32 i;
+
+	main_states = ssdfs_fsck_segbmap_fragment(check, SSDFS_MAIN_SEGBMAP_SEG,
+						  sequence_id) + hdr_size;
+	copy_states = ssdfs_fsck_segbmap_fragment(check, SSDFS_COPY_SEGBMAP_SEG,
+						  sequence_id) + hdr_size;
+	items_count = ssdfs_fsck_segbmap_fragment_items(check, sequence_id);
+
+	for (i = 0; i < items_count; i += SSDFS_FSCK_SEG_STATES_PER_WORD) {
+		u64 word1, word2;
+
+		word1 = ssdfs_fsck_get_seg_states_word(main_states, i,
+						       items_count, &lsb_mask);
+		word2 = ssdfs_fsck_get_seg_states_word(copy_states, i,
+						       items_count, &lsb_mask);
+
+		differ += ssdfs_fsck_count_seg_states(
+				ssdfs_fsck_seg_states_differ(word1, word2) &
+				lsb_mask);
+	}
+
+	if (differ > 0) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "copies are inconsistent: "
+			  "sequence_id %u, segments %llu\n",
+			  sequence_id, differ);
+		job->result.inconsistent_fragments++;
+		job->result.inconsistent_segs += differ;
+	}
+}
+
+static
+void *ssdfs_fsck_segbmap_check_fragments(void *arg)
+{
+	struct ssdfs_fsck_segbmap_job *job = (struct ssdfs_fsck_segbmap_job *)arg;
+	struct ssdfs_fsck_segbmap_check *check = job->check;
+	u32 i;
+	int j;
+
+	for (i = job->start; i < (job->start + job->count); i++) {
+		int valid_copies = 0;
+		int found_copies = 0;
+
+		for (j = 0; j < check->copies_count; j++) {
+			ssdfs_fsck_segbmap_check_fragment_copy(job, j, i);
+
+			switch (check->copies[j].state[i]) {
+			case SSDFS_FSCK_SEGBMAP_FRAGMENT_VALID:
+				valid_copies++;
+				found_copies++;
+				break;
+
+			case SSDFS_FSCK_SEGBMAP_FRAGMENT_COMPRESSED:
+				found_copies++;
+				break;
+
+			default:
+				/* do nothing */
+				break;
+			}
+		}
+
+		if (found_copies == 0)
+			job->result.lost_fragments++;
+		else if (valid_copies == SSDFS_SEGBMAP_SEG_COPY_MAX)
+			ssdfs_fsck_segbmap_compare_copies(job, i);
+	}
+
+	pthread_exit((void *)0);
+}
+
+/*
+ * ssdfs_fsck_segbmap_run_jobs() - execute segment bitmap check's threads
+ * @check: segment bitmap check environment
+ * @items_count: number of items (segments or fragments)
+ * @fn: thread function
+ * @result: found corruptions [out]
+ *
+ * Items are distributed between threads by ranges of equal size.
+ * Corruptions found by every thread are added into @result.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EAGAIN     - fail to create thread.
+ * %-EIO        - thread has failed.
+ */
+static
+int ssdfs_fsck_segbmap_run_jobs(struct ssdfs_fsck_segbmap_check *check,
+				u32 items_count, segbmap_job_fn fn,
+				struct ssdfs_fsck_segment_bitmap_corruption *result)
+{
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_fsck_segbmap_job *jobs;
+	u32 threads = max_t(u32, env->threads.capacity, 1);
+	u32 items_per_thread;
+	int created = 0;
+	int i;
+	int err = 0;
+
+	threads = min_t(u32, threads, items_count);
+	if (threads == 0)
+		return 0;
+
+	items_per_thread = (items_count + threads - 1) / threads;
+
+	jobs = calloc(threads, sizeof(struct ssdfs_fsck_segbmap_job));
+	if (!jobs) {
+		SSDFS_ERR("fail to allocate threads pool: %s\n",
+			  strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < threads; i++) {
+		jobs[i].check = check;
+		jobs[i].id = i;
+		jobs[i].start = i * items_per_thread;
+
+		if (jobs[i].start >= items_count)
+			break;
+
+		jobs[i].count = min_t(u32, items_per_thread,
+				      items_count - jobs[i].start);
+
+		err = pthread_create(&jobs[i].thread, NULL, fn,
+				     (void *)&jobs[i]);
+		if (err) {
+			SSDFS_ERR("fail to create thread %d: %s\n",
+				  i, strerror(err));
+			err = -EAGAIN;
+			break;
+		}
+
+		created++;
+	}
+
+	for (i = 0; i < created; i++) {
+		struct ssdfs_fsck_segment_bitmap_corruption *found;
+
+		pthread_join(jobs[i].thread, NULL);
+
+		if (jobs[i].err != 0) {
+			SSDFS_ERR("thread %d has failed: err %d\n",
+				  i, jobs[i].err);
+			err = -EIO;
+		}
+
+		found = &jobs[i].result;
+		result->lost_fragments += found->lost_fragments;
+		result->invalid_fragments += found->invalid_fragments;
+		result->corrupted_fragments += found->corrupted_fragments;
+		result->compressed_fragments += found->compressed_fragments;
+		result->inconsistent_fragments += found->inconsistent_fragments;
+		result->inconsistent_segs += found->inconsistent_segs;
+		result->invalid_counters += found->invalid_counters;
+		result->invalid_states += found->invalid_states;
+	}
+
+	free(jobs);
+	return err;
+}
+
+/*
+ * ssdfs_fsck_segbmap_get_state() - get state of segment
+ * @check: segment bitmap check environment
+ * @seg_id: segment ID
+ *
+ * The state is taken from the main copy. The backup copy
+ * is used if fragment of the main copy is invalid.
+ *
+ * RETURN:
+ * [success] - segment state.
+ * [failure] - error code:
+ *
+ * %-ERANGE     - segment ID is out of segment bitmap.
+ * %-ENODATA    - no valid fragment contains the segment.
+ */
+static
+int ssdfs_fsck_segbmap_get_state(struct ssdfs_fsck_segbmap_check *check,
+				 u64 seg_id)
+{
+	size_t hdr_size = sizeof(struct ssdfs_segbmap_fragment_header);
+	u32 items_per_byte = SSDFS_ITEMS_PER_BYTE(SSDFS_SEG_STATE_BITS);
+	u32 sequence_id;
+	u32 item;
+	int i;
+
+	if (seg_id >= check->nsegs)
+		return -ERANGE;
+
+	sequence_id = seg_id / check->items_per_fragment;
+	item = seg_id % check->items_per_fragment;
+
+	if (sequence_id >= check->fragments_count)
+		return -ERANGE;
+
+	for (i = 0; i < check->copies_count; i++) {
+		u8 *byte;
+
+		if (check->copies[i].state[sequence_id] !=
+					SSDFS_FSCK_SEGBMAP_FRAGMENT_VALID)
+			continue;
+
+		byte = ssdfs_fsck_segbmap_fragment(check, i, sequence_id);
+		byte += hdr_size + (item / items_per_byte);
+
+		return (*byte >> ((item % items_per_byte) *
+					SSDFS_SEG_STATE_BITS)) &
+							SSDFS_SEG_STATE_MASK;
+	}
+
+	return -ENODATA;
+}
+
+static
+void ssdfs_fsck_segbmap_check_seg_state(struct ssdfs_fsck_segbmap_check *check,
+					u64 seg_id, u64 peb_id, int seg_type,
+					struct ssdfs_fsck_segment_bitmap_corruption *result)
+{
+	int state;
+
+	if (seg_type <= SSDFS_UNKNOWN_SEG_TYPE ||
+	    seg_type >= SSDFS_LAST_KNOWN_SEG_TYPE)
+		return;
+
+	state = ssdfs_fsck_segbmap_get_state(check, seg_id);
+	if (state < 0) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "unable to get segment state: "
+			  "seg_id %llu, err %d\n",
+			  seg_id, state);
+		return;
+	}
+
+	result->checked_pebs++;
+
+	if (!(segbmap_expected_states[seg_type] &
+				SSDFS_FSCK_SEG_STATE_BIT(state))) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "unexpected segment state: "
+			  "seg_id %llu, peb_id %llu, seg_type %#x, "
+			  "state %#x\n",
+			  seg_id, peb_id, seg_type, state);
+		result->state_mismatches++;
+	}
+}
+
+static
+void ssdfs_fsck_segbmap_check_found_log(struct ssdfs_fsck_segbmap_check *check,
+					struct ssdfs_fsck_found_log *log,
+					struct ssdfs_fsck_segment_bitmap_corruption *result)
+{
+	struct ssdfs_segment_header *hdr = &log->header.seg_hdr;
+
+	if (log->peb_id >= U64_MAX)
+		return;
+
+	if (le16_to_cpu(log->header.magic.key) != SSDFS_SEGMENT_HDR_MAGIC)
+		return;
+
+	ssdfs_fsck_segbmap_check_seg_state(check,
+					   le64_to_cpu(hdr->seg_id),
+					   log->peb_id,
+					   le16_to_cpu(hdr->seg_type),
+					   result);
+}
+
+/*
+ * ssdfs_fsck_segbmap_cross_check() - compare segment bitmap with volume
+ * @check: segment bitmap check environment
+ * @creation_point: volume creation point
+ * @result: found corruptions [out]
+ *
+ * Every segment with metadata PEB has to be in the state
+ * that is expected for the segment type. Segments are taken
+ * from the metadata PEBs map of whole volume search. If the
+ * map is not prepared, then segments of the found metadata
+ * structures' logs are checked.
+ */
+static
+void ssdfs_fsck_segbmap_cross_check(struct ssdfs_fsck_segbmap_check *check,
+			struct ssdfs_fsck_volume_creation_point *creation_point,
+			struct ssdfs_fsck_segment_bitmap_corruption *result)
+{
+	struct ssdfs_segbmap_sb_header *sb_hdr = &check->segbmap->segbmap_sb_hdr;
+	struct ssdfs_fsck_logs_pair_array *maptbl_pairs;
+	struct ssdfs_metadata_map *map;
+	u64 seg_id;
+	int i, j;
+
+	if (creation_point->found_metadata &
+				SSDFS_FSCK_METADATA_PEB_MAP_PREPARED) {
+		for (i = 0; i < SSDFS_LAST_KNOWN_SEG_TYPE; i++) {
+			map = &creation_point->metadata_map[i];
+
+			for (j = 0; j < map->count; j++) {
+				ssdfs_fsck_segbmap_check_seg_state(check,
+							map->array[j].seg_id,
+							map->array[j].peb_id,
+							i, result);
+			}
+		}
+
+		return;
+	}
+
+	for (i = 0; i < check->segs_count; i++) {
+		for (j = 0; j < check->copies_count; j++) {
+			seg_id = le64_to_cpu(sb_hdr->segs[i][j]);
+
+			if (seg_id >= U64_MAX)
+				continue;
+
+			ssdfs_fsck_segbmap_check_seg_state(check, seg_id,
+							U64_MAX,
+							SSDFS_SEGBMAP_SEG_TYPE,
+							result);
+		}
+	}
+
+	ssdfs_fsck_segbmap_check_found_log(check,
+					&creation_point->base_snapshot_seg.log,
+					result);
+
+	for (i = 0; i < SSDFS_SB_SEG_COPY_MAX; i++) {
+		ssdfs_fsck_segbmap_check_found_log(check,
+				&creation_point->superblock_seg.logs[i],
+				result);
+	}
+
+	maptbl_pairs = &creation_point->maptbl.array;
+
+	for (i = 0; i < maptbl_pairs->count; i++) {
+		for (j = 0; j < SSDFS_FSCK_LOGS_NUMBER_MAX; j++) {
+			ssdfs_fsck_segbmap_check_found_log(check,
+					&maptbl_pairs->pairs[i].logs[j],
+					result);
+		}
+	}
+}
+
+static
+int ssdfs_fsck_segbmap_init_check(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_volume_creation_point *creation_point,
+			struct ssdfs_fsck_segbmap_check *check)
+{
+	struct ssdfs_segbmap_sb_header *sb_hdr;
+	size_t hdr_size = sizeof(struct ssdfs_segbmap_fragment_header);
+	int i;
+
+	memset(check, 0, sizeof(struct ssdfs_fsck_segbmap_check));
+
+	check->env = env;
+	check->creation_point = creation_point;
+	check->segbmap = &creation_point->segbmap;
+	sb_hdr = &check->segbmap->segbmap_sb_hdr;
+
+	check->segs_count = check->segbmap->segs_count;
+	check->copies_count = 1;
+	if (le16_to_cpu(sb_hdr->flags) & SSDFS_SEGBMAP_HAS_COPY)
+		check->copies_count = SSDFS_SEGBMAP_SEG_COPY_MAX;
+
+	check->fragment_size = le16_to_cpu(sb_hdr->fragment_size);
+	check->fragments_count = le16_to_cpu(sb_hdr->fragments_count);
+	check->fragments_per_seg = le16_to_cpu(sb_hdr->fragments_per_seg);
+
+	if (env->seg_size == 0 || env->base.erase_size == 0 ||
+	    env->seg_size < env->base.erase_size) {
+		SSDFS_ERR("invalid geometry: seg_size %u, erase_size %u\n",
+			  env->seg_size, env->base.erase_size);
+		return -EINVAL;
+	}
+
+	check->nsegs = env->base.fs_size / env->seg_size;
+
+	if (check->segs_count == 0 ||
+	    check->segs_count > SSDFS_SEGBMAP_SEGS ||
+	    check->fragment_size <= hdr_size ||
+	    check->fragment_size > env->base.page_size ||
+	    check->fragments_count == 0 ||
+	    check->fragments_per_seg == 0 ||
+	    le16_to_cpu(sb_hdr->fragments_per_peb) == 0) {
+		SSDFS_ERR("invalid segment bitmap's header: "
+			  "segs_count %u, fragment_size %u, "
+			  "fragments_count %u, fragments_per_seg %u, "
+			  "fragments_per_peb %u\n",
+			  check->segs_count, check->fragment_size,
+			  check->fragments_count, check->fragments_per_seg,
+			  le16_to_cpu(sb_hdr->fragments_per_peb));
+		return -EINVAL;
+	}
+
+	check->items_per_fragment =
+		ssdfs_segbmap_items_per_fragment(check->fragment_size);
+
+	for (i = 0; i < check->copies_count; i++) {
+		struct ssdfs_fsck_segbmap_copy *copy = &check->copies[i];
+
+		copy->fragments = calloc(check->fragments_count,
+					 check->fragment_size);
+		copy->state = calloc(check->fragments_count, sizeof(u8));
+
+		if (!copy->fragments || !copy->state) {
+			SSDFS_ERR("fail to allocate memory: "
+				  "fragments_count %u, fragment_size %u\n",
+				  check->fragments_count,
+				  check->fragment_size);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static
+void ssdfs_fsck_segbmap_destroy_check(struct ssdfs_fsck_segbmap_check *check)
+{
+	int i;
+
+	for (i = 0; i < SSDFS_SEGBMAP_SEG_COPY_MAX; i++) {
+		free(check->copies[i].fragments);
+		check->copies[i].fragments = NULL;
+		free(check->copies[i].state);
+		check->copies[i].state = NULL;
+	}
+}
+
+static
+int is_segment_bitmap_corrupted(struct ssdfs_fsck_environment *env)
+{
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_segment_bitmap_corruption *result;
+	struct ssdfs_fsck_segbmap_check check;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "Try to find segment bitmap corruption(s)\n");
+
+	result = &env->check_result.corruption.segment_bitmap;
+	creation_point = ssdfs_fsck_get_checked_creation_point(env);
+
+	if (!creation_point ||
+	    !(creation_point->found_metadata &
+				SSDFS_FSCK_SEGMENT_BITMAP_FOUND)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "segment bitmap has not been found\n");
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto finish_check;
+	}
+
+	err = ssdfs_fsck_segbmap_init_check(env, creation_point, &check);
+	if (err == -EINVAL) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto destroy_check;
+	} else if (err) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto destroy_check;
+	}
+
+	err = ssdfs_fsck_segbmap_run_jobs(&check,
+					  check.segs_count * check.copies_count,
+					  ssdfs_fsck_segbmap_load_segments,
+					  result);
+	if (err) {
+		SSDFS_ERR("fail to load segment bitmap: err %d\n", err);
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto destroy_check;
+	}
+
+	err = ssdfs_fsck_segbmap_run_jobs(&check, check.fragments_count,
+					  ssdfs_fsck_segbmap_check_fragments,
+					  result);
+	if (err) {
+		SSDFS_ERR("fail to check segment bitmap: err %d\n", err);
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto destroy_check;
+	}
+
+	ssdfs_fsck_segbmap_cross_check(&check, creation_point, result);
+
+	SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+			"segment bitmap: fragments %u, copies %d, "
+			"lost %u, invalid %u, corrupted %u, "
+			"compressed %u, inconsistent %u (segments %llu), "
+			"invalid counters %u, invalid states %llu, "
+			"checked PEBs %llu, state mismatches %llu\n",
+			check.fragments_count, check.copies_count,
+			result->lost_fragments, result->invalid_fragments,
+			result->corrupted_fragments,
+			result->compressed_fragments,
+			result->inconsistent_fragments,
+			result->inconsistent_segs,
+			result->invalid_counters, result->invalid_states,
+			result->checked_pebs, result->state_mismatches);
+
+	if (result->lost_fragments || result->invalid_fragments ||
+	    result->corrupted_fragments || result->inconsistent_fragments ||
+	    result->invalid_counters || result->invalid_states ||
+	    result->state_mismatches)
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	else
+		result->state = SSDFS_FSCK_CHECK_RESULT_SUCCESS;
+
+destroy_check:
+	ssdfs_fsck_segbmap_destroy_check(&check);
+
+finish_check:
+	SSDFS_DBG(env->base.show_debug,
+		  "finished: state %#x\n", result->state);
+
+	if (result->state == SSDFS_FSCK_CHECK_RESULT_CORRUPTION) {
+		env->check_result.corruption.mask |=
+				SSDFS_FSCK_SEGMENT_BITMAP_CORRUPTED;
+	}
+
+	return result->state;
+}
+
+#define SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT	(0)
+#define SSDFS_FSCK_MAPTBL_FRAGMENT_LOADED	(1)
+#define SSDFS_FSCK_MAPTBL_FRAGMENT_VALID	(2)
+#define SSDFS_FSCK_MAPTBL_FRAGMENT_COMPRESSED	(3)
+
+/* Role of PEB in mapping table */
+#define SSDFS_FSCK_MAPTBL_PEB_DESCRIBED		(1 << 0)
+#define SSDFS_FSCK_MAPTBL_PEB_MAPPED		(1 << 1)
+#define SSDFS_FSCK_MAPTBL_PEB_MIGRATING		(1 << 2)
+#define SSDFS_FSCK_MAPTBL_PEB_RELATION		(1 << 3)
+#define SSDFS_FSCK_MAPTBL_PEB_IN_USE \
+	(SSDFS_FSCK_MAPTBL_PEB_MAPPED | SSDFS_FSCK_MAPTBL_PEB_RELATION)
+
+#define SSDFS_FSCK_PEB_STATE_BIT(state)		(1U << (state))
+
+#define SSDFS_FSCK_PEB_MAPPED_STATES \
+	(SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_USING_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_USED_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_PRE_DIRTY_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_DIRTY_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_SNAPSHOT_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_RECOVERING_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_USING_INVALIDATED_PEB_STATE))
+#define SSDFS_FSCK_PEB_MIGRATION_SRC_STATES \
+	(SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_SRC_USING_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_SRC_USED_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_SRC_PRE_DIRTY_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_SRC_DIRTY_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_SRC_USING_INVALIDATED_STATE))
+#define SSDFS_FSCK_PEB_MIGRATION_DST_STATES \
+	(SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_DST_CLEAN_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_DST_USING_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_DST_USED_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_DST_PRE_DIRTY_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_DST_DIRTY_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_MIGRATION_DST_USING_INVALIDATED_STATE))
+#define SSDFS_FSCK_PEB_MIGRATION_STATES \
+	(SSDFS_FSCK_PEB_MIGRATION_SRC_STATES | \
+	 SSDFS_FSCK_PEB_MIGRATION_DST_STATES)
+#define SSDFS_FSCK_PEB_STALE_STATES \
+	(SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_DIRTY_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_PRE_ERASE_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_UNDER_ERASE_STATE))
+#define SSDFS_FSCK_PEB_UNMAPPED_STATES \
+	(SSDFS_FSCK_PEB_STALE_STATES | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_UNKNOWN_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_BAD_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_CLEAN_PEB_STATE) | \
+	 SSDFS_FSCK_PEB_STATE_BIT(SSDFS_MAPTBL_RECOVERING_STATE))
+
+/*
+ * struct ssdfs_fsck_maptbl_job - mapping table check's thread
+ * @check: mapping table check environment
+ * @thread: thread descriptor
+ * @id: thread ID
+ * @err: code of error
+ * @start: first mapping table's PEB of thread
+ * @count: number of mapping table's PEBs of thread
+ * @fragments: fragments of portions of processed PEB
+ * @state: state of every fragment in buffer
+ * @result: found corruptions
+ */
+struct ssdfs_fsck_maptbl_job {
+	struct ssdfs_fsck_maptbl_check *check;
+	pthread_t thread;
+	int id;
+	int err;
+	u32 start;
+	u32 count;
+	u8 *fragments;
+	u8 *state;
+	struct ssdfs_fsck_mapping_table_corruption result;
+};
+
+static inline
+u8 *ssdfs_fsck_maptbl_fragment(struct ssdfs_fsck_maptbl_job *job,
+				u32 index)
+{
+	u32 page_size = job->check->env->base.page_size;
+
+	return job->fragments + ((size_t)index * page_size);
+}
+
+static inline
+u32 ssdfs_fsck_maptbl_portions(struct ssdfs_fsck_maptbl_check *check,
+				u32 peb_index)
+{
+	u32 start_portion = peb_index * check->portions_per_peb;
+
+	if (start_portion >= check->portions_count)
+		return 0;
+
+	return min_t(u32, check->portions_per_peb,
+		     check->portions_count - start_portion);
+}
+
+/*
+ * ssdfs_fsck_maptbl_store_fragments() - store fragments of log
+ * @arg: thread of mapping table check
+ * @peb_index: PEB index in mapping table's chain
+ * @copy_index: copy index (main or backup)
+ * @area: content of log's payload area
+ * @area_size: size of payload area in bytes
+ *
+ * Fragments are stored by portion ID and fragment ID of header.
+ * The fragment of later log replaces the fragment of previous
+ * one. The valid fragment of main copy is never replaced by
+ * the fragment of backup copy.
+ */
+static
+void ssdfs_fsck_maptbl_store_fragments(void *arg,
+					u32 peb_index, int copy_index,
+					u8 *area, u32 area_size)
+{
+	struct ssdfs_fsck_maptbl_job *job = (struct ssdfs_fsck_maptbl_job *)arg;
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_leb_table_fragment_header *lebtbl_hdr;
+	struct ssdfs_peb_table_fragment_header *pebtbl_hdr;
+	size_t lebtbl_hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
+	size_t pebtbl_hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	u32 page_size = env->base.page_size;
+	u32 start_portion = peb_index * check->portions_per_peb;
+	u32 end_portion = start_portion +
+				ssdfs_fsck_maptbl_portions(check, peb_index);
+	u32 offset;
+
+	for (offset = 0; (offset + lebtbl_hdr_size) <= area_size;
+						offset += page_size) {
+		u32 bytes = min_t(u32, area_size - offset, page_size);
+		u16 portion_id;
+		u32 index;
+		u16 magic;
+		u8 *fragment;
+
+		magic = le16_to_cpu(*(__le16 *)(area + offset));
+
+		if (magic == SSDFS_LEB_TABLE_MAGIC) {
+			lebtbl_hdr = (struct ssdfs_leb_table_fragment_header *)
+								(area + offset);
+			portion_id = le16_to_cpu(lebtbl_hdr->portion_id);
+			index = le16_to_cpu(lebtbl_hdr->fragment_id);
+
+			if (index >= check->lebtbl_fragments)
+				goto invalid_fragment;
+		} else if (magic == SSDFS_PEB_TABLE_MAGIC &&
+			   bytes >= pebtbl_hdr_size) {
+			pebtbl_hdr = (struct ssdfs_peb_table_fragment_header *)
+								(area + offset);
+			portion_id = le16_to_cpu(pebtbl_hdr->portion_id);
+			index = le16_to_cpu(pebtbl_hdr->stripe_id);
+
+			if (index >= check->stripes_per_portion)
+				goto invalid_fragment;
+
+			index += check->lebtbl_fragments;
+		} else
+			goto invalid_fragment;
+
+		if (portion_id < start_portion || portion_id >= end_portion)
+			goto invalid_fragment;
+
+		index += (portion_id - start_portion) *
+					check->fragments_per_portion;
+
+		if (job->state[index] == SSDFS_FSCK_MAPTBL_FRAGMENT_VALID)
+			continue;
+
+		fragment = ssdfs_fsck_maptbl_fragment(job, index);
+		memset(fragment, 0, page_size);
+		memcpy(fragment, area + offset, bytes);
+
+		job->state[index] = SSDFS_FSCK_MAPTBL_FRAGMENT_LOADED;
+		continue;
+
+invalid_fragment:
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid fragment: "
+			  "peb_index %u, copy_index %d, offset %u, "
+			  "magic %#x\n",
+			  peb_index, copy_index, offset, magic);
+		job->result.invalid_fragments++;
+	}
+}
+
+static
+int ssdfs_fsck_check_lebtbl_fragment(struct ssdfs_fsck_maptbl_job *job,
+				     u8 *fragment, u32 portion_id,
+				     u16 fragment_id)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_leb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
+	size_t desc_size = sizeof(struct ssdfs_leb_descriptor);
+	u32 leb_desc_per_fragment;
+	u64 start_leb, end_leb;
+	u64 portion_leb;
+	u16 lebs_count;
+	u32 bytes_count;
+
+	hdr = (struct ssdfs_leb_table_fragment_header *)fragment;
+
+	if (le16_to_cpu(hdr->flags) & SSDFS_FSCK_LEBTBL_FRAG_COMPR_MASK)
+		return SSDFS_FSCK_MAPTBL_FRAGMENT_COMPRESSED;
+
+	leb_desc_per_fragment = SSDFS_LEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
+	lebs_count = le16_to_cpu(hdr->lebs_count);
+	bytes_count = le32_to_cpu(hdr->bytes_count);
+	start_leb = le64_to_cpu(hdr->start_leb);
+	end_leb = start_leb + lebs_count;
+	portion_leb = (u64)portion_id * check->lebs_per_portion;
+
+	if (bytes_count != (hdr_size + (lebs_count * desc_size)) ||
+	    bytes_count > check->env->base.page_size ||
+	    lebs_count > leb_desc_per_fragment ||
+	    le16_to_cpu(hdr->mapped_lebs) > lebs_count ||
+	    le16_to_cpu(hdr->migrating_lebs) > lebs_count)
+		return SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT;
+
+	if (lebs_count > 0 &&
+	    (start_leb != (portion_leb +
+			   ((u64)leb_desc_per_fragment * fragment_id)) ||
+	     end_leb > check->lebs_count ||
+	     end_leb > (portion_leb + check->lebs_per_portion)))
+		return SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT;
+
+	return SSDFS_FSCK_MAPTBL_FRAGMENT_VALID;
+}
+
+static
+int ssdfs_fsck_check_pebtbl_fragment(struct ssdfs_fsck_maptbl_job *job,
+				     u8 *fragment, u32 portion_id,
+				     u16 stripe_id)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_peb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
+	u64 start_peb, end_peb;
+	u64 portion_peb;
+	u16 pebs_count;
+	u32 bytes_count;
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)fragment;
+
+	if (hdr->flags & SSDFS_FSCK_PEBTBL_FRAG_COMPR_MASK)
+		return SSDFS_FSCK_MAPTBL_FRAGMENT_COMPRESSED;
+
+	pebs_count = le16_to_cpu(hdr->pebs_count);
+	bytes_count = le32_to_cpu(hdr->bytes_count);
+	start_peb = le64_to_cpu(hdr->start_peb);
+	end_peb = start_peb + pebs_count;
+	portion_peb = (u64)portion_id * check->pebs_per_portion;
+
+	if (bytes_count != (hdr_size + (pebs_count * desc_size)) ||
+	    bytes_count > check->env->base.page_size ||
+	    pebs_count > SSDFS_PEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE) ||
+	    le16_to_cpu(hdr->stripe_id) != stripe_id)
+		return SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT;
+
+	if (pebs_count > 0 &&
+	    (start_peb < portion_peb ||
+	     end_peb > check->pebs_count ||
+	     end_peb > (portion_peb + check->pebs_per_portion)))
+		return SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT;
+
+	return SSDFS_FSCK_MAPTBL_FRAGMENT_VALID;
+}
+
+/*
+ * ssdfs_fsck_maptbl_check_fragment() - check fragment of portion
+ * @job: thread of mapping table check
+ * @peb_index: PEB index in mapping table's chain
+ * @copy_index: copy index (main or backup)
+ * @index: fragment index in thread's buffer
+ *
+ * This method checks the fragment's header and checksum.
+ * Invalid fragment is excluded from further checking.
+ */
+static
+void ssdfs_fsck_maptbl_check_fragment(struct ssdfs_fsck_maptbl_job *job,
+				      u32 peb_index, int copy_index,
+				      u32 index)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	u8 *state = &job->state[index];
+	u16 fragment_id = index % check->fragments_per_portion;
+	u32 portion_id;
+	u8 *fragment;
+	__le32 csum, calculated;
+
+	if (*state != SSDFS_FSCK_MAPTBL_FRAGMENT_LOADED)
+		return;
+
+	portion_id = (peb_index * check->portions_per_peb) +
+				(index / check->fragments_per_portion);
+	fragment = ssdfs_fsck_maptbl_fragment(job, index);
+
+	if (fragment_id < check->lebtbl_fragments) {
+		struct ssdfs_leb_table_fragment_header *hdr;
+
+		hdr = (struct ssdfs_leb_table_fragment_header *)fragment;
+		csum = hdr->checksum;
+		hdr->checksum = 0;
+		calculated = ssdfs_crc32_le(fragment,
+				min_t(u32, le32_to_cpu(hdr->bytes_count),
+				      env->base.page_size));
+		hdr->checksum = csum;
+
+		*state = ssdfs_fsck_check_lebtbl_fragment(job, fragment,
+							  portion_id,
+							  fragment_id);
+	} else {
+		struct ssdfs_peb_table_fragment_header *hdr;
+
+		hdr = (struct ssdfs_peb_table_fragment_header *)fragment;
+		csum = hdr->checksum;
+		hdr->checksum = 0;
+		calculated = ssdfs_crc32_le(fragment,
+				min_t(u32, le32_to_cpu(hdr->bytes_count),
+				      env->base.page_size));
+		hdr->checksum = csum;
+
+		*state = ssdfs_fsck_check_pebtbl_fragment(job, fragment,
+						portion_id,
+						fragment_id - check->lebtbl_fragments);
+	}
+
+	switch (*state) {
+	case SSDFS_FSCK_MAPTBL_FRAGMENT_COMPRESSED:
+		job->result.compressed_fragments++;
+		return;
+
+	case SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT:
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid fragment's header: "
+			  "copy_index %d, portion_id %u, fragment_id %u\n",
+			  copy_index, portion_id, fragment_id);
+		job->result.invalid_fragments++;
+		return;
+
+	default:
+		/* continue logic */
+		break;
+	}
+
+	if (csum != calculated) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid checksum: "
+			  "copy_index %d, portion_id %u, fragment_id %u\n",
+			  copy_index, portion_id, fragment_id);
+		job->result.corrupted_fragments++;
+		*state = SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT;
+	}
+}
+
+/*
+ * ssdfs_fsck_maptbl_index2peb() - convert PEB table's index into PEB ID
+ * @job: thread of mapping table check
+ * @base: index of portion's first fragment in thread's buffer
+ * @index: PEB table's offset till PEB's descriptor
+ *
+ * RETURN:
+ * [success] - PEB ID.
+ * [failure] - U64_MAX.
+ */
+static
+u64 ssdfs_fsck_maptbl_index2peb(struct ssdfs_fsck_maptbl_job *job,
+				u32 base, u16 index)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_peb_table_fragment_header *hdr;
+	u32 peb_desc_per_fragment;
+	u16 stripe_id;
+	u16 item;
+
+	peb_desc_per_fragment = SSDFS_PEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
+	stripe_id = index / peb_desc_per_fragment;
+	item = index % peb_desc_per_fragment;
+
+	if (stripe_id >= check->stripes_per_portion)
+		return U64_MAX;
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)
+		ssdfs_fsck_maptbl_fragment(job, base + check->lebtbl_fragments +
+						stripe_id);
+
+	if (item >= le16_to_cpu(hdr->pebs_count))
+		return U64_MAX;
+
+	return le64_to_cpu(hdr->start_peb) + item;
+}
+
+static inline
+void ssdfs_fsck_maptbl_map_peb(struct ssdfs_fsck_maptbl_job *job,
+				u64 leb_id, u64 peb_id, u8 role)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+
+	if (check->peb2leb[peb_id] != U64_MAX) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "PEB is mapped several times: "
+			  "peb_id %llu, leb_id %llu, leb_id %llu\n",
+			  peb_id, check->peb2leb[peb_id], leb_id);
+		job->result.duplicate_pebs++;
+		return;
+	}
+
+	check->peb2leb[peb_id] = leb_id;
+	check->peb_flags[peb_id] |= role;
+}
+
+/*
+ * ssdfs_fsck_maptbl_map_lebs() - build LEB/PEB arrays of portion
+ * @job: thread of mapping table check
+ * @base: index of portion's first fragment in thread's buffer
+ *
+ * Every LEB descriptor is scattered into the item of PEB
+ * that is referenced by PEB table's index. The busy item
+ * means that several LEBs are mapped on the same PEB.
+ */
+static
+void ssdfs_fsck_maptbl_map_lebs(struct ssdfs_fsck_maptbl_job *job, u32 base)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_fsck_mapping_table_corruption *result = &job->result;
+	struct ssdfs_leb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
+	struct ssdfs_leb_descriptor *desc;
+	u16 i, j;
+
+	for (i = 0; i < check->lebtbl_fragments; i++) {
+		u8 *fragment = ssdfs_fsck_maptbl_fragment(job, base + i);
+		u16 lebs_count, mapped_lebs, migrating_lebs;
+		u64 start_leb;
+		u32 physical = 0;
+		u32 relations = 0;
+
+		hdr = (struct ssdfs_leb_table_fragment_header *)fragment;
+		desc = (struct ssdfs_leb_descriptor *)(fragment + hdr_size);
+		start_leb = le64_to_cpu(hdr->start_leb);
+		lebs_count = le16_to_cpu(hdr->lebs_count);
+		mapped_lebs = le16_to_cpu(hdr->mapped_lebs);
+		migrating_lebs = le16_to_cpu(hdr->migrating_lebs);
+
+		for (j = 0; j < lebs_count; j++) {
+			u16 physical_index = le16_to_cpu(desc[j].physical_index);
+			u16 relation_index = le16_to_cpu(desc[j].relation_index);
+			u64 leb_id = start_leb + j;
+			u64 peb_id;
+
+			if (physical_index == U16_MAX) {
+				if (relation_index != U16_MAX)
+					result->invalid_indexes++;
+				continue;
+			}
+
+			peb_id = ssdfs_fsck_maptbl_index2peb(job, base,
+							     physical_index);
+			if (peb_id >= U64_MAX) {
+				SSDFS_DBG(check->env->base.show_debug,
+					  "invalid physical index: "
+					  "leb_id %llu, physical_index %u\n",
+					  leb_id, physical_index);
+				result->invalid_indexes++;
+				continue;
+			}
+
+			physical++;
+			check->leb2peb[leb_id] = peb_id;
+			ssdfs_fsck_maptbl_map_peb(job, leb_id, peb_id,
+						  SSDFS_FSCK_MAPTBL_PEB_MAPPED);
+
+			if (relation_index == U16_MAX)
+				continue;
+
+			relations++;
+			check->peb_flags[peb_id] |=
+					SSDFS_FSCK_MAPTBL_PEB_MIGRATING;
+
+			peb_id = ssdfs_fsck_maptbl_index2peb(job, base,
+							     relation_index);
+			if (peb_id >= U64_MAX) {
+				SSDFS_DBG(check->env->base.show_debug,
+					  "invalid relation index: "
+					  "leb_id %llu, relation_index %u\n",
+					  leb_id, relation_index);
+				result->invalid_indexes++;
+				continue;
+			}
+
+			ssdfs_fsck_maptbl_map_peb(job, leb_id, peb_id,
+						  SSDFS_FSCK_MAPTBL_PEB_RELATION);
+		}
+
+		/*
+		 * The LEB under migration could be counted
+		 * as mapped LEB or as migrating LEB only.
+		 */
+		if (migrating_lebs != relations ||
+		    mapped_lebs > physical ||
+		    physical > ((u32)mapped_lebs + migrating_lebs)) {
+			SSDFS_DBG(check->env->base.show_debug,
+				  "invalid counters: start_leb %llu, "
+				  "mapped_lebs %u, migrating_lebs %u, "
+				  "physical %u, relations %u\n",
+				  start_leb, mapped_lebs, migrating_lebs,
+				  physical, relations);
+			result->invalid_counters++;
+		}
+
+		result->mapped_lebs += physical;
+		result->migrating_lebs += relations;
+	}
+}
+
+static
+void ssdfs_fsck_maptbl_check_peb_state(struct ssdfs_fsck_maptbl_job *job,
+					u64 peb_id, int is_used)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_fsck_mapping_table_corruption *result = &job->result;
+	u8 flags = check->peb_flags[peb_id];
+	u8 state = check->peb_state[peb_id];
+	u8 type = check->peb_type[peb_id];
+	u32 state_bit = 0;
+	u32 expected;
+
+	if (flags & SSDFS_FSCK_MAPTBL_PEB_RELATION)
+		expected = SSDFS_FSCK_PEB_MIGRATION_DST_STATES;
+	else if (flags & SSDFS_FSCK_MAPTBL_PEB_MIGRATING)
+		expected = SSDFS_FSCK_PEB_MIGRATION_SRC_STATES;
+	else if (flags & SSDFS_FSCK_MAPTBL_PEB_MAPPED)
+		expected = SSDFS_FSCK_PEB_MAPPED_STATES;
+	else
+		expected = SSDFS_FSCK_PEB_UNMAPPED_STATES;
+
+	if (state < SSDFS_MAPTBL_PEB_STATE_MAX)
+		state_bit = SSDFS_FSCK_PEB_STATE_BIT(state);
+
+	if (!(expected & state_bit)) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "unexpected PEB state: "
+			  "peb_id %llu, state %#x, flags %#x\n",
+			  peb_id, state, flags);
+
+		if ((state_bit & SSDFS_FSCK_PEB_MIGRATION_STATES) ||
+		    (flags & (SSDFS_FSCK_MAPTBL_PEB_MIGRATING |
+			      SSDFS_FSCK_MAPTBL_PEB_RELATION)))
+			result->invalid_migrations++;
+		else
+			result->invalid_states++;
+	}
+
+	if ((flags & SSDFS_FSCK_MAPTBL_PEB_IN_USE) &&
+	    (type == SSDFS_MAPTBL_UNKNOWN_PEB_TYPE ||
+	     type >= SSDFS_MAPTBL_PEB_TYPE_MAX)) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "unexpected PEB type: "
+			  "peb_id %llu, type %#x\n",
+			  peb_id, type);
+		result->invalid_states++;
+	}
+
+	if (!is_used != !(flags & SSDFS_FSCK_MAPTBL_PEB_IN_USE)) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "unexpected bit in used PEBs bitmap: "
+			  "peb_id %llu, is_used %d, flags %#x\n",
+			  peb_id, is_used, flags);
+		result->bitmap_mismatches++;
+	}
+}
+
+/*
+ * ssdfs_fsck_maptbl_check_pebs() - check PEB descriptors of portion
+ * @job: thread of mapping table check
+ * @base: index of portion's first fragment in thread's buffer
+ *
+ * The state of every PEB has to correspond to the role of PEB
+ * that is defined by LEB descriptors of portion: mapped PEB,
+ * source or destination PEB of migration, or unmapped PEB.
+ */
+static
+void ssdfs_fsck_maptbl_check_pebs(struct ssdfs_fsck_maptbl_job *job, u32 base)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_peb_table_fragment_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	struct ssdfs_peb_descriptor *desc;
+	u16 i, j;
+
+	for (i = 0; i < check->stripes_per_portion; i++) {
+		u8 *fragment;
+		u8 *bmap;
+		u64 start_peb;
+		u16 pebs_count;
+
+		fragment = ssdfs_fsck_maptbl_fragment(job, base +
+						check->lebtbl_fragments + i);
+		hdr = (struct ssdfs_peb_table_fragment_header *)fragment;
+		desc = (struct ssdfs_peb_descriptor *)(fragment + hdr_size);
+		bmap = hdr->bmaps[SSDFS_PEBTBL_USED_BMAP];
+		start_peb = le64_to_cpu(hdr->start_peb);
+		pebs_count = le16_to_cpu(hdr->pebs_count);
+
+		for (j = 0; j < pebs_count; j++) {
+			u64 peb_id = start_peb + j;
+			int is_used;
+
+			if (check->peb_flags[peb_id] &
+					SSDFS_FSCK_MAPTBL_PEB_DESCRIBED) {
+				SSDFS_DBG(check->env->base.show_debug,
+					  "PEB is described several times: "
+					  "peb_id %llu\n", peb_id);
+				job->result.duplicate_pebs++;
+				continue;
+			}
+
+			check->peb_flags[peb_id] |=
+					SSDFS_FSCK_MAPTBL_PEB_DESCRIBED;
+			check->peb_state[peb_id] = le8_to_cpu(desc[j].state);
+			check->peb_type[peb_id] = le8_to_cpu(desc[j].type);
+
+			is_used = (bmap[j / BITS_PER_BYTE] >>
+					(j % BITS_PER_BYTE)) & 1;
+
+			ssdfs_fsck_maptbl_check_peb_state(job, peb_id,
+							  is_used);
+		}
+	}
+}
+
+/*
+ * ssdfs_fsck_maptbl_load_peb() - load portions of mapping table's PEB
+ * @job: thread of mapping table check
+ * @peb_index: PEB index in mapping table's chain
+ *
+ * The fragments are loaded from the main copy. The backup copy
+ * is read only if some fragment of the main copy is invalid.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_fsck_maptbl_load_peb(struct ssdfs_fsck_maptbl_job *job,
+				u32 peb_index)
+{
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	u32 fragments_count;
+	u32 valid_fragments = 0;
+	u32 i;
+	int j;
+	int err;
+
+	fragments_count = ssdfs_fsck_maptbl_portions(check, peb_index) *
+					check->fragments_per_portion;
+
+	memset(job->state, SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT,
+		(size_t)check->portions_per_peb * check->fragments_per_portion);
+
+	for (j = 0; j < check->copies_count; j++) {
+		u64 leb_id, peb_id;
+
+		if (valid_fragments >= fragments_count)
+			break;
+
+		if (peb_index >= check->chain_len)
+			break;
+
+		leb_id = check->chain[j][peb_index];
+		peb_id = __ssdfs_maptbl_cache_convert_leb2peb(env,
+							check->creation_point,
+							leb_id);
+		if (peb_id >= U64_MAX) {
+			SSDFS_DBG(env->base.show_debug,
+				  "unknown PEB: leb_id %llu\n",
+				  leb_id);
+			continue;
+		}
+
+		err = ssdfs_fsck_load_peb_payload(env, job, peb_index, j,
+					peb_id, ssdfs_fsck_maptbl_store_fragments);
+		if (err) {
+			SSDFS_ERR("fail to load PEB: "
+				  "peb_id %llu, err %d\n",
+				  peb_id, err);
+			return err;
+		}
+
+		valid_fragments = 0;
+
+		for (i = 0; i < fragments_count; i++) {
+			ssdfs_fsck_maptbl_check_fragment(job, peb_index, j, i);
+
+			if (job->state[i] == SSDFS_FSCK_MAPTBL_FRAGMENT_VALID)
+				valid_fragments++;
+		}
+	}
+
+	for (i = 0; i < fragments_count; i++) {
+		if (job->state[i] == SSDFS_FSCK_MAPTBL_FRAGMENT_ABSENT)
+			job->result.lost_fragments++;
+	}
+
+	return 0;
+}
+
+static
+void *ssdfs_fsck_maptbl_check_portions(void *arg)
+{
+	struct ssdfs_fsck_maptbl_job *job = (struct ssdfs_fsck_maptbl_job *)arg;
+	struct ssdfs_fsck_maptbl_check *check = job->check;
+	u32 page_size = check->env->base.page_size;
+	u32 fragments_per_peb;
+	u32 i, j, k;
+
+	fragments_per_peb = (u32)check->portions_per_peb *
+					check->fragments_per_portion;
+
+	job->fragments = malloc((size_t)fragments_per_peb * page_size);
+	job->state = malloc(fragments_per_peb);
+
+	if (!job->fragments || !job->state) {
+		SSDFS_ERR("fail to allocate memory: "
+			  "fragments %u, page_size %u\n",
+			  fragments_per_peb, page_size);
+		job->err = -ENOMEM;
+		goto finish_check;
+	}
+
+	for (i = job->start; i < (job->start + job->count); i++) {
+		u32 portions = ssdfs_fsck_maptbl_portions(check, i);
+
+		job->err = ssdfs_fsck_maptbl_load_peb(job, i);
+		if (job->err)
+			goto finish_check;
+
+		for (j = 0; j < portions; j++) {
+			u32 base = j * check->fragments_per_portion;
+
+			for (k = 0; k < check->fragments_per_portion; k++) {
+				if (job->state[base + k] !=
+					SSDFS_FSCK_MAPTBL_FRAGMENT_VALID)
+					break;
+			}
+
+			/* portion is checked only as a whole */
+			if (k < check->fragments_per_portion)
+				continue;
+
+			ssdfs_fsck_maptbl_map_lebs(job, base);
+			ssdfs_fsck_maptbl_check_pebs(job, base);
+		}
+	}
+
+finish_check:
+	free(job->fragments);
+	job->fragments = NULL;
+	free(job->state);
+	job->state = NULL;
+
+	pthread_exit((void *)(long)(job->err != 0));
+}
+
+static
+void ssdfs_fsck_maptbl_add_result(struct ssdfs_fsck_mapping_table_corruption *result,
+				  struct ssdfs_fsck_mapping_table_corruption *found)
+{
+	result->lost_fragments += found->lost_fragments;
+	result->invalid_fragments += found->invalid_fragments;
+	result->corrupted_fragments += found->corrupted_fragments;
+	result->compressed_fragments += found->compressed_fragments;
+	result->invalid_counters += found->invalid_counters;
+	result->mapped_lebs += found->mapped_lebs;
+	result->migrating_lebs += found->migrating_lebs;
+	result->invalid_indexes += found->invalid_indexes;
+	result->duplicate_pebs += found->duplicate_pebs;
+	result->invalid_states += found->invalid_states;
+	result->invalid_migrations += found->invalid_migrations;
+	result->bitmap_mismatches += found->bitmap_mismatches;
+}
+
+/*
+ * ssdfs_fsck_maptbl_run_jobs() - execute mapping table check's threads
+ * @check: mapping table check environment
+ * @result: found corruptions [out]
+ *
+ * Mapping table's PEBs are distributed between threads
+ * by ranges of equal size. Corruptions found by every thread
+ * are added into @result.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EAGAIN     - fail to create thread.
+ * %-EIO        - thread has failed.
+ */
+static
+int ssdfs_fsck_maptbl_run_jobs(struct ssdfs_fsck_maptbl_check *check,
+			struct ssdfs_fsck_mapping_table_corruption *result)
+{
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_fsck_maptbl_job *jobs;
+	u32 items_count = check->maptbl_pebs;
+	u32 threads = max_t(u32, env->threads.capacity, 1);
+	u32 items_per_thread;
+	int created = 0;
+	int i;
+	int err = 0;
+
+	threads = min_t(u32, threads, items_count);
+	if (threads == 0)
+		return 0;
+
+	items_per_thread = (items_count + threads - 1) / threads;
+
+	jobs = calloc(threads, sizeof(struct ssdfs_fsck_maptbl_job));
+	if (!jobs) {
+		SSDFS_ERR("fail to allocate threads pool: %s\n",
+			  strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < threads; i++) {
+		jobs[i].check = check;
+		jobs[i].id = i;
+		jobs[i].start = i * items_per_thread;
+
+		if (jobs[i].start >= items_count)
+			break;
+
+		jobs[i].count = min_t(u32, items_per_thread,
+				      items_count - jobs[i].start);
+
+		err = pthread_create(&jobs[i].thread, NULL,
+				     ssdfs_fsck_maptbl_check_portions,
+				     (void *)&jobs[i]);
+		if (err) {
+			SSDFS_ERR("fail to create thread %d: %s\n",
+				  i, strerror(err));
+			err = -EAGAIN;
+			break;
+		}
+
+		created++;
+	}
+
+	for (i = 0; i < created; i++) {
+		pthread_join(jobs[i].thread, NULL);
+
+		if (jobs[i].err != 0) {
+			SSDFS_ERR("thread %d has failed: err %d\n",
+				  i, jobs[i].err);
+			err = -EIO;
+		}
+
+		ssdfs_fsck_maptbl_add_result(result, &jobs[i].result);
+	}
+
+	free(jobs);
+	return err;
+}
+
+/*
+ * ssdfs_fsck_maptbl_check_item() - compare metadata PEB with mapping table
+ * @check: mapping table check environment
+ * @item: metadata PEB descriptor found on volume
+ * @result: found corruptions [out]
+ *
+ * The segment header of PEB defines the LEB and the type of PEB.
+ * The mapping table has to map the LEB on this PEB. The migration
+ * destination PEB has to refer to the source PEB of the LEB.
+ * The stale log in PEB that waits for erase is ignored.
+ */
+static
+void ssdfs_fsck_maptbl_check_item(struct ssdfs_fsck_maptbl_check *check,
+				  struct ssdfs_metadata_peb_item *item,
+				  struct ssdfs_fsck_mapping_table_corruption *result)
+{
+	u64 leb_id = item->leb_id;
+	u64 peb_id = item->peb_id;
+	u8 flags;
+
+	if (peb_id >= check->pebs_count || leb_id >= check->lebs_count) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "out of mapping table: "
+			  "leb_id %llu, peb_id %llu\n",
+			  leb_id, peb_id);
+		result->checked_pebs++;
+		result->peb_mismatches++;
+		return;
+	}
+
+	flags = check->peb_flags[peb_id];
+
+	if (!(flags & SSDFS_FSCK_MAPTBL_PEB_DESCRIBED)) {
+		/* portion is lost */
+		return;
+	}
+
+	result->checked_pebs++;
+
+	if (check->peb2leb[peb_id] != leb_id) {
+		u8 state = check->peb_state[peb_id];
+
+		if (!(flags & SSDFS_FSCK_MAPTBL_PEB_IN_USE) &&
+		    state < SSDFS_MAPTBL_PEB_STATE_MAX &&
+		    (SSDFS_FSCK_PEB_STATE_BIT(state) &
+					SSDFS_FSCK_PEB_STALE_STATES))
+			return;
+
+		SSDFS_DBG(check->env->base.show_debug,
+			  "PEB is not mapped on LEB: "
+			  "leb_id %llu, peb_id %llu, mapped leb_id %llu\n",
+			  leb_id, peb_id, check->peb2leb[peb_id]);
+		result->peb_mismatches++;
+		return;
+	}
+
+	if (check->peb_type[peb_id] != item->type) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "unexpected PEB type: "
+			  "peb_id %llu, type %#x, expected %#x\n",
+			  peb_id, check->peb_type[peb_id], item->type);
+		result->type_mismatches++;
+	}
+
+	if ((flags & SSDFS_FSCK_MAPTBL_PEB_RELATION) &&
+	    item->relation_peb_id != check->leb2peb[leb_id]) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "invalid migration pair: "
+			  "leb_id %llu, peb_id %llu, relation_peb_id %llu, "
+			  "source peb_id %llu\n",
+			  leb_id, peb_id, item->relation_peb_id,
+			  check->leb2peb[leb_id]);
+		result->invalid_migrations++;
+	}
+}
+
+static
+void ssdfs_fsck_maptbl_check_found_log(struct ssdfs_fsck_maptbl_check *check,
+					struct ssdfs_fsck_found_log *log,
+					struct ssdfs_fsck_mapping_table_corruption *result)
+{
+	struct ssdfs_segment_header *hdr = &log->header.seg_hdr;
+	struct ssdfs_metadata_peb_item item;
+
+	if (log->peb_id >= U64_MAX)
+		return;
+
+	if (le16_to_cpu(log->header.magic.key) != SSDFS_SEGMENT_HDR_MAGIC)
+		return;
+
+	item.seg_id = le64_to_cpu(hdr->seg_id);
+	item.leb_id = le64_to_cpu(hdr->leb_id);
+	item.peb_id = log->peb_id;
+	item.relation_peb_id = le64_to_cpu(hdr->relation_peb_id);
+	item.type = SEG2PEB_TYPE(le16_to_cpu(hdr->seg_type));
+
+	ssdfs_fsck_maptbl_check_item(check, &item, result);
+}
+
+/*
+ * ssdfs_fsck_maptbl_cross_check() - compare mapping table with volume
+ * @check: mapping table check environment
+ * @result: found corruptions [out]
+ *
+ * Metadata PEBs are taken from the metadata PEBs map of whole
+ * volume search. If the map is not prepared, then PEBs of the found
+ * metadata structures' logs are checked. Every item is compared
+ * with the items of LEB/PEB arrays by index. So, the check is linear
+ * in the number of found PEBs. The LEB/PEB pairs of mapping table
+ * cache are checked too.
+ */
+static
+void ssdfs_fsck_maptbl_cross_check(struct ssdfs_fsck_maptbl_check *check,
+			struct ssdfs_fsck_mapping_table_corruption *result)
+{
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_mapping_table_cache *maptbl_cache;
+	struct ssdfs_fsck_logs_pair_array *pairs;
+	struct ssdfs_leb2peb_pair *pair;
+	struct ssdfs_metadata_map *map;
+	u32 pairs_count;
+	int i, j;
+
+	creation_point = check->creation_point;
+
+	if (creation_point->found_metadata &
+				SSDFS_FSCK_METADATA_PEB_MAP_PREPARED) {
+		for (i = 0; i < SSDFS_FSCK_METADATA_MAP_MAX; i++) {
+			map = &creation_point->metadata_map[i];
+
+			for (j = 0; j < map->count; j++) {
+				ssdfs_fsck_maptbl_check_item(check,
+							     &map->array[j],
+							     result);
+			}
+		}
+	} else {
+		ssdfs_fsck_maptbl_check_found_log(check,
+				&creation_point->base_snapshot_seg.log,
+				result);
+
+		for (i = 0; i < SSDFS_SB_SEG_COPY_MAX; i++) {
+			ssdfs_fsck_maptbl_check_found_log(check,
+				&creation_point->superblock_seg.logs[i],
+				result);
+		}
+
+		pairs = &creation_point->maptbl.array;
+
+		for (i = 0; i < pairs->count; i++) {
+			for (j = 0; j < SSDFS_FSCK_LOGS_NUMBER_MAX; j++) {
+				ssdfs_fsck_maptbl_check_found_log(check,
+						&pairs->pairs[i].logs[j],
+						result);
+			}
+		}
+	}
+
+	if (!(creation_point->found_metadata & SSDFS_FSCK_MAPTBL_CACHE_FOUND))
+		return;
+
+	maptbl_cache = &creation_point->maptbl_cache;
+	pair = (struct ssdfs_leb2peb_pair *)maptbl_cache->data;
+	pairs_count = le16_to_cpu(maptbl_cache->hdr.items_count);
+
+	if (!pair)
+		return;
+
+	pairs_count = min_t(u32, pairs_count,
+			    maptbl_cache->bytes_count /
+				sizeof(struct ssdfs_leb2peb_pair));
+
+	for (i = 0; i < pairs_count; i++) {
+		u64 leb_id = le64_to_cpu(pair[i].leb_id);
+		u64 peb_id = le64_to_cpu(pair[i].peb_id);
+
+		if (leb_id < check->lebs_count && peb_id < check->pebs_count) {
+			if (!(check->peb_flags[peb_id] &
+					SSDFS_FSCK_MAPTBL_PEB_DESCRIBED))
+				continue;
+
+			if (check->peb2leb[peb_id] == leb_id)
+				continue;
+		}
+
+		SSDFS_DBG(check->env->base.show_debug,
+			  "mapping table cache is inconsistent: "
+			  "leb_id %llu, peb_id %llu\n",
+			  leb_id, peb_id);
+		result->cache_mismatches++;
+	}
+}
+
+static
+int ssdfs_fsck_maptbl_build_chain(struct ssdfs_fsck_maptbl_check *check,
+				  int copy_index)
+{
+	struct ssdfs_maptbl_sb_header *sb_hdr;
+	struct ssdfs_meta_area_extent *extent;
+	u32 lebs_per_seg;
+	u32 capacity = 0;
+	u32 count = 0;
+	u64 start_id;
+	u32 len;
+	u32 i, j;
+
+	sb_hdr = &check->creation_point->maptbl.maptbl_sb_hdr;
+	lebs_per_seg = check->env->seg_size / check->env->base.erase_size;
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < MAPTBL_LIMIT1; j++) {
+			u32 k;
+
+			extent = &sb_hdr->extents[j][copy_index];
+			start_id = le64_to_cpu(extent->start_id);
+			len = le32_to_cpu(extent->len);
+
+			switch (le16_to_cpu(extent->type)) {
+			case SSDFS_SEG_EXTENT_TYPE:
+				start_id *= lebs_per_seg;
+				len *= lebs_per_seg;
+				break;
+
+			case SSDFS_PEB_EXTENT_TYPE:
+				/* LEB IDs */
+				break;
+
+			default:
+				continue;
+			}
+
+			if (len > check->lebs_count)
+				return -EINVAL;
+
+			for (k = 0; k < len; k++) {
+				if (check->chain[copy_index])
+					check->chain[copy_index][count] =
+								start_id + k;
+				count++;
+			}
+		}
+
+		if (check->chain[copy_index])
+			break;
+
+		if (count == 0)
+			return -EINVAL;
+
+		capacity = count;
+		count = 0;
+
+		check->chain[copy_index] = calloc(capacity, sizeof(u64));
+		if (!check->chain[copy_index]) {
+			SSDFS_ERR("fail to allocate memory: "
+				  "chain_len %u\n", capacity);
+			return -ENOMEM;
+		}
+	}
+
+	if (copy_index == SSDFS_MAIN_MAPTBL_SEG)
+		check->chain_len = count;
+	else
+		check->chain_len = min_t(u32, check->chain_len, count);
+
+	return 0;
+}
+
+int ssdfs_fsck_maptbl_init_check(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_volume_creation_point *creation_point,
+			struct ssdfs_fsck_maptbl_check *check)
+{
+	struct ssdfs_maptbl_sb_header *sb_hdr;
+	u32 page_size = env->base.page_size;
+	u64 volume_pebs;
+	u32 portion_pages;
+	int i;
+	int err;
+
+	memset(check, 0, sizeof(struct ssdfs_fsck_maptbl_check));
+
+	check->env = env;
+	check->creation_point = creation_point;
+	sb_hdr = &creation_point->maptbl.maptbl_sb_hdr;
+
+	if (env->seg_size == 0 || env->base.erase_size == 0 ||
+	    env->seg_size < env->base.erase_size || page_size == 0) {
+		SSDFS_ERR("invalid geometry: seg_size %u, erase_size %u, "
+			  "page_size %u\n",
+			  env->seg_size, env->base.erase_size, page_size);
+		return -EINVAL;
+	}
+
+	volume_pebs = env->base.fs_size / env->base.erase_size;
+
+	check->copies_count = 1;
+	if (le16_to_cpu(sb_hdr->flags) & SSDFS_MAPTBL_HAS_COPY)
+		check->copies_count = SSDFS_MAPTBL_SEG_COPY_MAX;
+
+	check->portions_count = le32_to_cpu(sb_hdr->fragments_count);
+	check->portion_size = le32_to_cpu(sb_hdr->fragment_bytes);
+	check->portions_per_peb = le16_to_cpu(sb_hdr->fragments_per_peb);
+	check->stripes_per_portion = le16_to_cpu(sb_hdr->stripes_per_fragment);
+	check->lebs_per_portion = le16_to_cpu(sb_hdr->lebs_per_fragment);
+	check->pebs_per_portion = le16_to_cpu(sb_hdr->pebs_per_fragment);
+	check->lebs_count = le64_to_cpu(sb_hdr->lebs_count);
+	check->pebs_count = le64_to_cpu(sb_hdr->pebs_count);
+
+	portion_pages = check->portion_size / page_size;
+
+	if (check->portions_count == 0 ||
+	    check->portions_count > U16_MAX ||
+	    check->portions_per_peb == 0 ||
+	    check->portion_size == 0 ||
+	    (check->portion_size % page_size) != 0 ||
+	    page_size < sizeof(struct ssdfs_peb_table_fragment_header) ||
+	    check->stripes_per_portion == 0 ||
+	    portion_pages <= check->stripes_per_portion ||
+	    portion_pages > U16_MAX ||
+	    ((u64)check->portions_per_peb * check->portion_size) >
+						env->base.erase_size ||
+	    check->lebs_per_portion == 0 ||
+	    check->pebs_per_portion == 0 ||
+	    check->lebs_count == 0 || check->lebs_count > volume_pebs ||
+	    check->pebs_count == 0 || check->pebs_count > volume_pebs) {
+		SSDFS_ERR("invalid mapping table's header: "
+			  "fragments_count %u, fragment_bytes %u, "
+			  "fragments_per_peb %u, stripes_per_fragment %u, "
+			  "lebs_per_fragment %u, pebs_per_fragment %u, "
+			  "lebs_count %llu, pebs_count %llu\n",
+			  check->portions_count, check->portion_size,
+			  check->portions_per_peb, check->stripes_per_portion,
+			  check->lebs_per_portion, check->pebs_per_portion,
+			  check->lebs_count, check->pebs_count);
+		return -EINVAL;
+	}
+
+	check->fragments_per_portion = (u16)portion_pages;
+	check->lebtbl_fragments = (u16)portion_pages -
+					check->stripes_per_portion;
+	check->maptbl_pebs = (check->portions_count +
+				check->portions_per_peb - 1) /
+					check->portions_per_peb;
+
+	for (i = 0; i < check->copies_count; i++) {
+		err = ssdfs_fsck_maptbl_build_chain(check, i);
+		if (err == -EINVAL) {
+			SSDFS_ERR("invalid mapping table's extents: "
+				  "copy_index %d\n", i);
+			return err;
+		} else if (err)
+			return err;
+	}
+
+	check->leb2peb = malloc(check->lebs_count * sizeof(u64));
+	check->peb2leb = malloc(check->pebs_count * sizeof(u64));
+	check->peb_state = calloc(check->pebs_count, sizeof(u8));
+	check->peb_type = calloc(check->pebs_count, sizeof(u8));
+	check->peb_flags = calloc(check->pebs_count, sizeof(u8));
+
+	if (!check->leb2peb || !check->peb2leb || !check->peb_state ||
+	    !check->peb_type || !check->peb_flags) {
+		SSDFS_ERR("fail to allocate memory: "
+			  "lebs_count %llu, pebs_count %llu\n",
+			  check->lebs_count, check->pebs_count);
+		return -ENOMEM;
+	}
+
+	memset(check->leb2peb, 0xFF, check->lebs_count * sizeof(u64));
+	memset(check->peb2leb, 0xFF, check->pebs_count * sizeof(u64));
+
+	return 0;
+}
+
+void ssdfs_fsck_maptbl_destroy_check(struct ssdfs_fsck_maptbl_check *check)
+{
+	int i;
+
+	for (i = 0; i < SSDFS_MAPTBL_SEG_COPY_MAX; i++) {
+		free(check->chain[i]);
+		check->chain[i] = NULL;
+	}
+
+	free(check->leb2peb);
+	check->leb2peb = NULL;
+	free(check->peb2leb);
+	check->peb2leb = NULL;
+	free(check->peb_state);
+	check->peb_state = NULL;
+	free(check->peb_type);
+	check->peb_type = NULL;
+	free(check->peb_flags);
+	check->peb_flags = NULL;
+}
+
+static
+int is_mapping_table_corrupted(struct ssdfs_fsck_environment *env)
+{
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_mapping_table_corruption *result;
+	struct ssdfs_fsck_maptbl_check check;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "Try to find mapping table corruption(s)\n");
+
+	result = &env->check_result.corruption.mapping_table;
+	creation_point = ssdfs_fsck_get_checked_creation_point(env);
+
+	if (!creation_point ||
+	    !(creation_point->found_metadata &
+				SSDFS_FSCK_MAPPING_TBL_FOUND)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "mapping table has not been found\n");
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto finish_check;
+	}
+
+	err = ssdfs_fsck_maptbl_init_check(env, creation_point, &check);
+	if (err == -EINVAL) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto destroy_check;
+	} else if (err) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto destroy_check;
+	}
+
+	err = ssdfs_fsck_maptbl_run_jobs(&check, result);
+	if (err) {
+		SSDFS_ERR("fail to check mapping table: err %d\n", err);
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto destroy_check;
+	}
+
+	ssdfs_fsck_maptbl_cross_check(&check, result);
+
+	SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+			"mapping table: portions %u, copies %d, "
+			"mapped LEBs %llu, migrating LEBs %llu, "
+			"lost %u, invalid %u, corrupted %u, compressed %u, "
+			"invalid counters %u, invalid indexes %llu, "
+			"duplicate PEBs %llu, invalid states %llu, "
+			"invalid migrations %llu, bitmap mismatches %llu, "
+			"checked PEBs %llu, PEB mismatches %llu, "
+			"type mismatches %llu, cache mismatches %llu\n",
+			check.portions_count, check.copies_count,
+			result->mapped_lebs, result->migrating_lebs,
+			result->lost_fragments, result->invalid_fragments,
+			result->corrupted_fragments,
+			result->compressed_fragments,
+			result->invalid_counters, result->invalid_indexes,
+			result->duplicate_pebs, result->invalid_states,
+			result->invalid_migrations, result->bitmap_mismatches,
+			result->checked_pebs, result->peb_mismatches,
+			result->type_mismatches, result->cache_mismatches);
+
+	if (result->lost_fragments || result->invalid_fragments ||
+	    result->corrupted_fragments || result->invalid_counters ||
+	    result->invalid_indexes || result->duplicate_pebs ||
+	    result->invalid_states || result->invalid_migrations ||
+	    result->bitmap_mismatches || result->peb_mismatches ||
+	    result->type_mismatches || result->cache_mismatches)
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	else
+		result->state = SSDFS_FSCK_CHECK_RESULT_SUCCESS;
+
+destroy_check:
+	ssdfs_fsck_maptbl_destroy_check(&check);
+
+finish_check:
+	SSDFS_DBG(env->base.show_debug,
+		  "finished: state %#x\n", result->state);
+
+	if (result->state == SSDFS_FSCK_CHECK_RESULT_CORRUPTION) {
+		env->check_result.corruption.mask |=
+				SSDFS_FSCK_MAPPING_TABLE_CORRUPTED;
+	}
+
+	return result->state;
+}
+
+/*
+ * struct ssdfs_fsck_btree_node_request - request of b-tree node's check
+ * @seg_id: segment ID of the node
+ * @node_id: node ID
+ * @node_type: expected type of the node (unknown for root's children)
+ * @height: expected height of the node
+ * @parent_height: height of parent node
+ * @start_hash: lower bound of node's hashes
+ * @end_hash: upper bound of node's hashes
+ */
+struct ssdfs_fsck_btree_node_request {
+	u64 seg_id;
+	u32 node_id;
+	u8 node_type;
+	u8 height;
+	u8 parent_height;
+	u64 start_hash;
+	u64 end_hash;
+};
+
+/*
+ * struct ssdfs_fsck_btree_requests - array of nodes' requests
+ * @items: array of requests
+ * @count: number of requests in array
+ * @capacity: capacity of array
+ */
+struct ssdfs_fsck_btree_requests {
+	struct ssdfs_fsck_btree_node_request *items;
+	u32 count;
+	u32 capacity;
+};
+
+/*
+ * struct ssdfs_fsck_btree_segment - nodes' requests of one segment
+ * @seg_id: segment ID
+ * @start: index of the first request in level's array
+ * @count: number of requests of the segment
+ */
+struct ssdfs_fsck_btree_segment {
+	u64 seg_id;
+	u32 start;
+	u32 count;
+};
+
+/*
+ * struct ssdfs_fsck_btree_leb2peb - LEB/PEB pair of b-tree node's segment
+ * @leb_id: LEB ID
+ * @peb_id: PEB ID
+ */
+struct ssdfs_fsck_btree_leb2peb {
+	u64 leb_id;
+	u64 peb_id;
+};
+
+struct ssdfs_fsck_btree_job;
+
+typedef void (*btree_check_items_fn)(struct ssdfs_fsck_btree_job *job,
+				     u8 *node, u16 items_capacity);
+
+/*
+ * struct ssdfs_fsck_btree_type - b-tree type descriptor
+ * @name: name of the tree
+ * @type: type of the tree
+ * @tree_magic: magic of b-tree descriptor
+ * @node_magic: magic of node's header
+ * @node_hdr_size: size of tree specific node's header
+ * @compat_flag: feature flag of the tree
+ * @corruption_flag: corruption flag of the tree
+ * @check_items: check of tree specific node's header
+ */
+struct ssdfs_fsck_btree_type {
+	const char *name;
+	int type;
+	u32 tree_magic;
+	u16 node_magic;
+	u32 node_hdr_size;
+	u64 compat_flag;
+	u64 corruption_flag;
+	btree_check_items_fn check_items;
+};
+
+/*
+ * struct ssdfs_fsck_btree_check - b-tree check environment
+ * @env: fsck environment
+ * @creation_point: volume creation point
+ * @type: b-tree type descriptor
+ * @footer: footer of superblock segment's log
+ * @desc: b-tree descriptor
+ * @root: root node of b-tree
+ * @node_size: size of node in bytes
+ * @index_size: size of index key in bytes
+ * @item_size: size of item in bytes
+ * @lebs_per_seg: number of LEBs in segment
+ * @volume_segs: number of segments in volume
+ * @upper_node_id: last allocated node ID
+ * @map: LEB/PEB pairs of metadata PEBs map (sorted by LEB ID)
+ * @map_count: number of pairs in @map
+ * @level: requests of current level's nodes
+ * @next: requests of next level's nodes
+ * @segs: segments of current level's nodes
+ * @segs_count: number of items in @segs
+ *
+ * The tree is checked level by level. Requests of current level are
+ * sorted by segment ID and node ID. Every thread reads the PEBs of its
+ * own range of segments and checks the found nodes. The index keys of
+ * checked nodes are the requests of the next level.
+ */
+struct ssdfs_fsck_btree_check {
+	struct ssdfs_fsck_environment *env;
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	const struct ssdfs_fsck_btree_type *type;
+	union ssdfs_metadata_footer footer;
+	struct ssdfs_btree_descriptor *desc;
+	struct ssdfs_btree_inline_root_node *root;
+	u32 node_size;
+	u16 index_size;
+	u16 item_size;
+	u32 lebs_per_seg;
+	u64 volume_segs;
+	u32 upper_node_id;
+	struct ssdfs_fsck_btree_leb2peb *map;
+	u32 map_count;
+	struct ssdfs_fsck_btree_requests level;
+	struct ssdfs_fsck_btree_requests next;
+	struct ssdfs_fsck_btree_segment *segs;
+	u32 segs_count;
+};
+
+/*
+ * struct ssdfs_fsck_btree_job - b-tree check's thread
+ * @check: b-tree check environment
+ * @thread: thread descriptor
+ * @id: thread ID
+ * @err: code of error
+ * @start: first segment of thread
+ * @count: number of segments of thread
+ * @nodes: nodes of processed segment
+ * @found: is node found in processed segment?
+ * @capacity: capacity of @nodes and @found in nodes
+ * @children: requests of next level's nodes
+ * @result: found corruptions
+ */
+struct ssdfs_fsck_btree_job {
+	struct ssdfs_fsck_btree_check *check;
+	pthread_t thread;
+	int id;
+	int err;
+	u32 start;
+	u32 count;
+	u8 *nodes;
+	u8 *found;
+	u32 capacity;
+	struct ssdfs_fsck_btree_requests children;
+	struct ssdfs_fsck_btree_corruption result;
+};
+
+static int btree_node_id_cmp(const void *item1, const void *item2)
+{
+	const struct ssdfs_fsck_btree_node_request *req1 = item1;
+	const struct ssdfs_fsck_btree_node_request *req2 = item2;
+
+	if (req1->node_id != req2->node_id)
+		return req1->node_id < req2->node_id ? -1 : 1;
+
+	return 0;
+}
+
+static int btree_node_location_cmp(const void *item1, const void *item2)
+{
+	const struct ssdfs_fsck_btree_node_request *req1 = item1;
+	const struct ssdfs_fsck_btree_node_request *req2 = item2;
+
+	if (req1->seg_id != req2->seg_id)
+		return req1->seg_id < req2->seg_id ? -1 : 1;
+
+	return btree_node_id_cmp(item1, item2);
+}
+
+static int btree_leb_id_cmp(const void *item1, const void *item2)
+{
+	const struct ssdfs_fsck_btree_leb2peb *pair1 = item1;
+	const struct ssdfs_fsck_btree_leb2peb *pair2 = item2;
+
+	if (pair1->leb_id != pair2->leb_id)
+		return pair1->leb_id < pair2->leb_id ? -1 : 1;
+
+	return 0;
+}
+
+static
+int ssdfs_fsck_btree_add_request(struct ssdfs_fsck_btree_requests *requests,
+				 struct ssdfs_fsck_btree_node_request *req)
+{
+	size_t req_size = sizeof(struct ssdfs_fsck_btree_node_request);
+	struct ssdfs_fsck_btree_node_request *items;
+	u32 capacity;
+
+	if (requests->count >= requests->capacity) {
+		capacity = max_t(u32, requests->capacity * 2, 64);
+
+		items = realloc(requests->items, (size_t)capacity * req_size);
+		if (!items) {
+			SSDFS_ERR("fail to allocate memory: capacity %u\n",
+				  capacity);
+			return -ENOMEM;
+		}
+
+		requests->items = items;
+		requests->capacity = capacity;
+	}
+
+	memcpy(&requests->items[requests->count], req, req_size);
+	requests->count++;
+
+	return 0;
+}
+
+static inline
+void ssdfs_fsck_btree_free_requests(struct ssdfs_fsck_btree_requests *requests)
+{
+	free(requests->items);
+	requests->items = NULL;
+	requests->count = 0;
+	requests->capacity = 0;
+}
+
+static
+u64 ssdfs_fsck_btree_leb2peb(struct ssdfs_fsck_btree_check *check, u64 leb_id)
+{
+	struct ssdfs_fsck_btree_leb2peb key = {.leb_id = leb_id};
+	struct ssdfs_fsck_btree_leb2peb *pair;
+
+	if (check->map_count > 0) {
+		pair = bsearch(&key, check->map, check->map_count,
+				sizeof(struct ssdfs_fsck_btree_leb2peb),
+				btree_leb_id_cmp);
+		return pair ? pair->peb_id : U64_MAX;
+	}
+
+	if (!(check->creation_point->found_metadata &
+					SSDFS_FSCK_MAPTBL_CACHE_FOUND))
+		return U64_MAX;
+
+	return __ssdfs_maptbl_cache_convert_leb2peb(check->env,
+						    check->creation_point,
+						    leb_id);
+}
+
+/*
+ * ssdfs_fsck_btree_store_nodes() - store nodes of log
+ * @arg: thread of b-tree check
+ * @seg_index: index of segment in level's segments array
+ * @copy_index: copy index (not used)
+ * @area: content of log's payload area
+ * @area_size: size of payload area in bytes
+ *
+ * Payload is scanned page by page for node headers of the tree.
+ * Only the requested nodes of the segment are stored. The node
+ * of later log replaces the node of previous one.
+ */
+static
+void ssdfs_fsck_btree_store_nodes(void *arg,
+				  u32 seg_index, int copy_index,
+				  u8 *area, u32 area_size)
+{
+	struct ssdfs_fsck_btree_job *job = (struct ssdfs_fsck_btree_job *)arg;
+	struct ssdfs_fsck_btree_check *check = job->check;
+	struct ssdfs_fsck_btree_segment *seg = &check->segs[seg_index];
+	struct ssdfs_fsck_btree_node_request *reqs;
+	struct ssdfs_fsck_btree_node_request key;
+	struct ssdfs_fsck_btree_node_request *req;
+	struct ssdfs_btree_node_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_btree_node_header);
+	u32 page_size = check->env->base.page_size;
+	u32 node_size = check->node_size;
+	u32 offset;
+	u32 index;
+
+	reqs = &check->level.items[seg->start];
+
+	for (offset = 0; (offset + hdr_size) <= area_size; offset += page_size) {
+		hdr = (struct ssdfs_btree_node_header *)(area + offset);
+
+		if (le32_to_cpu(hdr->magic.common) != SSDFS_SUPER_MAGIC ||
+		    le16_to_cpu(hdr->magic.key) != check->type->node_magic)
+			continue;
+
+		if ((offset + node_size) > area_size) {
+			SSDFS_DBG(check->env->base.show_debug,
+				  "truncated node: seg_id %llu, offset %u\n",
+				  seg->seg_id, offset);
+			continue;
+		}
+
+		key.node_id = le32_to_cpu(hdr->node_id);
+		req = bsearch(&key, reqs, seg->count,
+				sizeof(struct ssdfs_fsck_btree_node_request),
+				btree_node_id_cmp);
+		if (!req) {
+			/* stale or not requested node */
+			continue;
+		}
+
+		index = req - reqs;
+		memcpy(job->nodes + ((size_t)index * node_size),
+			area + offset, node_size);
+		job->found[index] = SSDFS_TRUE;
+
+		offset += node_size - page_size;
+	}
+}
+
+static
+int ssdfs_fsck_btree_load_segment(struct ssdfs_fsck_btree_job *job,
+				  u32 seg_index)
+{
+	struct ssdfs_fsck_btree_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_fsck_btree_segment *seg = &check->segs[seg_index];
+	u64 leb_id, peb_id;
+	u32 i;
+	int err;
+
+	if (seg->count > job->capacity) {
+		free(job->nodes);
+		free(job->found);
+
+		job->nodes = malloc((size_t)seg->count * check->node_size);
+		job->found = malloc(seg->count);
+
+		if (!job->nodes || !job->found) {
+			SSDFS_ERR("fail to allocate memory: "
+				  "nodes %u, node_size %u\n",
+				  seg->count, check->node_size);
+			job->capacity = 0;
+			return -ENOMEM;
+		}
+
+		job->capacity = seg->count;
+	}
+
+	memset(job->found, SSDFS_FALSE, seg->count);
+
+	for (i = 0; i < check->lebs_per_seg; i++) {
+		leb_id = (seg->seg_id * check->lebs_per_seg) + i;
+
+		peb_id = ssdfs_fsck_btree_leb2peb(check, leb_id);
+		if (peb_id >= U64_MAX) {
+			SSDFS_DBG(env->base.show_debug,
+				  "unknown PEB: leb_id %llu\n",
+				  leb_id);
+			continue;
+		}
+
+		err = ssdfs_fsck_load_peb_payload(env, job, seg_index, 0,
+					peb_id, ssdfs_fsck_btree_store_nodes);
+		if (err) {
+			SSDFS_ERR("fail to load PEB: "
+				  "peb_id %llu, err %d\n",
+				  peb_id, err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static
+int is_ssdfs_fsck_btree_node_csum_valid(struct ssdfs_fsck_btree_check *check,
+					u8 *node)
+{
+	struct ssdfs_btree_node_header *hdr;
+
+	hdr = (struct ssdfs_btree_node_header *)node;
+
+	if (le16_to_cpu(hdr->check.bytes) <
+				sizeof(struct ssdfs_btree_node_header))
+		return SSDFS_FALSE;
+
+	return is_ssdfs_fsck_csum_valid(&hdr->check, node, check->node_size);
+}
+
+static
+void ssdfs_fsck_check_inodes_node(struct ssdfs_fsck_btree_job *job,
+				  u8 *node, u16 items_capacity)
+{
+	struct ssdfs_inodes_btree_node_header *hdr;
+	u16 inodes_count, valid_inodes;
+
+	hdr = (struct ssdfs_inodes_btree_node_header *)node;
+	inodes_count = le16_to_cpu(hdr->inodes_count);
+	valid_inodes = le16_to_cpu(hdr->valid_inodes);
+
+	if (valid_inodes > inodes_count || inodes_count > items_capacity) {
+		SSDFS_DBG(job->check->env->base.show_debug,
+			  "invalid counters: node_id %u, inodes_count %u, "
+			  "valid_inodes %u, items_capacity %u\n",
+			  le32_to_cpu(hdr->node.node_id), inodes_count,
+			  valid_inodes, items_capacity);
+		job->result.invalid_counters++;
+	}
+}
+
+static
+void ssdfs_fsck_check_snapshots_node(struct ssdfs_fsck_btree_job *job,
+				     u8 *node, u16 items_capacity)
+{
+	struct ssdfs_snapshots_btree_node_header *hdr;
+	u32 snapshots_count;
+
+	hdr = (struct ssdfs_snapshots_btree_node_header *)node;
+	snapshots_count = le32_to_cpu(hdr->snapshots_count);
+
+	if (snapshots_count > items_capacity) {
+		SSDFS_DBG(job->check->env->base.show_debug,
+			  "invalid counters: node_id %u, snapshots_count %u, "
+			  "items_capacity %u\n",
+			  le32_to_cpu(hdr->node.node_id), snapshots_count,
+			  items_capacity);
+		job->result.invalid_counters++;
+	}
+}
+
+static
+void ssdfs_fsck_check_invextree_node(struct ssdfs_fsck_btree_job *job,
+				     u8 *node, u16 items_capacity)
+{
+	struct ssdfs_invextree_node_header *hdr;
+	u32 extents_count;
+
+	hdr = (struct ssdfs_invextree_node_header *)node;
+	extents_count = le32_to_cpu(hdr->extents_count);
+
+	if (extents_count > items_capacity) {
+		SSDFS_DBG(job->check->env->base.show_debug,
+			  "invalid counters: node_id %u, extents_count %u, "
+			  "items_capacity %u\n",
+			  le32_to_cpu(hdr->node.node_id), extents_count,
+			  items_capacity);
+		job->result.invalid_counters++;
+	}
+}
+
+static inline
+int is_ssdfs_fsck_shdict_area_valid(struct ssdfs_shared_dict_area *area,
+				    u32 node_size)
+{
+	u32 offset = le16_to_cpu(area->offset);
+	u32 size = le16_to_cpu(area->size);
+
+	return (offset + size) <= node_size &&
+		le16_to_cpu(area->free_space) <= size;
+}
+
+static
+void ssdfs_fsck_check_shared_dict_node(struct ssdfs_fsck_btree_job *job,
+					u8 *node, u16 items_capacity)
+{
+	struct ssdfs_shared_dictionary_node_header *hdr;
+	u32 node_size = job->check->node_size;
+
+	hdr = (struct ssdfs_shared_dictionary_node_header *)node;
+
+	if (!is_ssdfs_fsck_shdict_area_valid(&hdr->str_area, node_size) ||
+	    !is_ssdfs_fsck_shdict_area_valid(&hdr->hash_table, node_size) ||
+	    !is_ssdfs_fsck_shdict_area_valid(&hdr->lookup_table2, node_size)) {
+		SSDFS_DBG(job->check->env->base.show_debug,
+			  "invalid dictionary's area: node_id %u\n",
+			  le32_to_cpu(hdr->node.node_id));
+		job->result.space_errors++;
+	}
+
+	if (le16_to_cpu(hdr->lookup_table1_items) > SSDFS_SHDIC_LTBL1_SIZE ||
+	    le16_to_cpu(hdr->hash_table.items_count) > items_capacity) {
+		SSDFS_DBG(job->check->env->base.show_debug,
+			  "invalid counters: node_id %u, "
+			  "lookup_table1_items %u, hash_table items %u, "
+			  "items_capacity %u\n",
+			  le32_to_cpu(hdr->node.node_id),
+			  le16_to_cpu(hdr->lookup_table1_items),
+			  le16_to_cpu(hdr->hash_table.items_count),
+			  items_capacity);
+		job->result.invalid_counters++;
+	}
+}
+
+/*
+ * ssdfs_fsck_btree_check_index_area() - check node's index keys
+ * @job: thread of b-tree check
+ * @req: request of node's check
+ * @node: node's content
+ * @index_offset: offset of index area in node
+ *
+ * Index keys have to be sorted by hash. Every key with valid extent
+ * defines the request of child node's check. The child's hashes
+ * are bounded by the hash of its key and the hash of the next key.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_fsck_btree_check_index_area(struct ssdfs_fsck_btree_job *job,
+				      struct ssdfs_fsck_btree_node_request *req,
+				      u8 *node, u32 index_offset)
+{
+	struct ssdfs_fsck_btree_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_btree_node_header *hdr;
+	struct ssdfs_btree_index_key *keys;
+	struct ssdfs_fsck_btree_node_request child;
+	u16 index_count;
+	u64 start_hash, end_hash;
+	u64 hash, prev_hash = 0;
+	u16 i;
+	int err;
+
+	hdr = (struct ssdfs_btree_node_header *)node;
+	keys = (struct ssdfs_btree_index_key *)(node + index_offset);
+	index_count = le16_to_cpu(hdr->index_count);
+	start_hash = le64_to_cpu(hdr->start_hash);
+	end_hash = le64_to_cpu(hdr->end_hash);
+
+	for (i = 0; i < index_count; i++) {
+		hash = le64_to_cpu(keys[i].index.hash);
+
+		if ((i > 0 && hash <= prev_hash) ||
+		    (hdr->type == SSDFS_BTREE_INDEX_NODE &&
+		     (hash < start_hash || hash > end_hash))) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid index key: node_id %u, index %u, "
+				  "hash %llx, prev_hash %llx, "
+				  "start_hash %llx, end_hash %llx\n",
+				  req->node_id, i, hash, prev_hash,
+				  start_hash, end_hash);
+			job->result.invalid_keys++;
+		}
+
+		prev_hash = hash;
+
+		if (!(le16_to_cpu(keys[i].flags) &
+					SSDFS_BTREE_INDEX_HAS_VALID_EXTENT))
+			continue;
+
+		child.seg_id = le64_to_cpu(keys[i].index.extent.seg_id);
+		child.node_id = le32_to_cpu(keys[i].node_id);
+		child.node_type = keys[i].node_type;
+		child.height = keys[i].height;
+		child.parent_height = hdr->height;
+		child.start_hash = hash;
+
+		if ((i + 1) < index_count)
+			child.end_hash = le64_to_cpu(keys[i + 1].index.hash);
+		else
+			child.end_hash = req->end_hash;
+
+		if (child.seg_id >= check->volume_segs ||
+		    child.node_id == SSDFS_BTREE_ROOT_NODE_ID ||
+		    child.node_id > check->upper_node_id ||
+		    child.node_type <= SSDFS_BTREE_ROOT_NODE ||
+		    child.node_type >= SSDFS_BTREE_NODE_TYPE_MAX ||
+		    child.height >= hdr->height) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid child: node_id %u, index %u, "
+				  "child seg_id %llu, node_id %u, "
+				  "type %#x, height %u\n",
+				  req->node_id, i, child.seg_id,
+				  child.node_id, child.node_type,
+				  child.height);
+			job->result.invalid_children++;
+			continue;
+		}
+
+		err = ssdfs_fsck_btree_add_request(&job->children, &child);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_fsck_btree_check_node() - check b-tree node
+ * @job: thread of b-tree check
+ * @req: request of node's check
+ * @node: node's content
+ *
+ * The node's header has to be consistent with the b-tree descriptor
+ * and the parent's index key. The index and items areas have to
+ * be inside of the node without overlapping. Index keys of the node
+ * are added into the requests of the next level.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_fsck_btree_check_node(struct ssdfs_fsck_btree_job *job,
+				struct ssdfs_fsck_btree_node_request *req,
+				u8 *node)
+{
+	struct ssdfs_fsck_btree_check *check = job->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_btree_node_header *hdr;
+	u32 node_size = check->node_size;
+	u32 items_offset = check->type->node_hdr_size;
+	u32 index_offset = U32_MAX;
+	u32 index_area_size;
+	u32 item_area_offset;
+	u16 items_capacity;
+	u64 start_hash, end_hash;
+	u16 flags;
+
+	hdr = (struct ssdfs_btree_node_header *)node;
+	flags = le16_to_cpu(hdr->flags);
+	start_hash = le64_to_cpu(hdr->start_hash);
+	end_hash = le64_to_cpu(hdr->end_hash);
+
+	job->result.checked_nodes++;
+
+	if (!is_ssdfs_fsck_btree_node_csum_valid(check, node)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid checksum: seg_id %llu, node_id %u\n",
+			  req->seg_id, req->node_id);
+		job->result.corrupted_nodes++;
+		return 0;
+	}
+
+	if (hdr->log_node_size != check->desc->log_node_size ||
+	    hdr->type <= SSDFS_BTREE_ROOT_NODE ||
+	    hdr->type >= SSDFS_BTREE_NODE_TYPE_MAX ||
+	    (flags & ~SSDFS_BTREE_NODE_FLAGS_MASK) ||
+	    (hdr->type == SSDFS_BTREE_LEAF_NODE &&
+	     (flags & SSDFS_BTREE_NODE_HAS_INDEX_AREA)) ||
+	    (hdr->type == SSDFS_BTREE_INDEX_NODE &&
+	     !(flags & SSDFS_BTREE_NODE_HAS_INDEX_AREA)) ||
+	    (hdr->type != SSDFS_BTREE_INDEX_NODE &&
+	     !(flags & SSDFS_BTREE_NODE_HAS_ITEMS_AREA))) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid node's header: seg_id %llu, node_id %u, "
+			  "log_node_size %u, type %#x, flags %#x\n",
+			  req->seg_id, req->node_id, hdr->log_node_size,
+			  hdr->type, flags);
+		job->result.invalid_nodes++;
+		return 0;
+	}
+
+	if ((req->node_type != SSDFS_BTREE_NODE_UNKNOWN_TYPE &&
+	     hdr->type != req->node_type) ||
+	    (req->node_type != SSDFS_BTREE_NODE_UNKNOWN_TYPE &&
+	     hdr->height != req->height) ||
+	    hdr->height >= req->parent_height) {
+		SSDFS_DBG(env->base.show_debug,
+			  "node is inconsistent with parent: "
+			  "seg_id %llu, node_id %u, type %#x, height %u, "
+			  "expected type %#x, height %u, parent height %u\n",
+			  req->seg_id, req->node_id, hdr->type, hdr->height,
+			  req->node_type, req->height, req->parent_height);
+		job->result.invalid_children++;
+	}
+
+	/* empty node has no hashes */
+	if (start_hash != U64_MAX || end_hash != U64_MAX) {
+		if (start_hash > end_hash ||
+		    start_hash < req->start_hash ||
+		    end_hash > req->end_hash) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid node's range: "
+				  "node_id %u, start_hash %llx, "
+				  "end_hash %llx, parent's range %llx-%llx\n",
+				  req->node_id, start_hash, end_hash,
+				  req->start_hash, req->end_hash);
+			job->result.invalid_keys++;
+		}
+	}
+
+	if (flags & SSDFS_BTREE_NODE_HAS_INDEX_AREA) {
+		index_area_size = 0;
+
+		if (hdr->log_index_area_size < 32)
+			index_area_size = 1U << hdr->log_index_area_size;
+
+		if (hdr->index_size != check->index_size ||
+		    le16_to_cpu(hdr->index_area_offset) < items_offset ||
+		    index_area_size == 0 ||
+		    ((u64)le16_to_cpu(hdr->index_area_offset) +
+					index_area_size) > node_size ||
+		    ((u32)le16_to_cpu(hdr->index_count) *
+					check->index_size) > index_area_size) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid index area: node_id %u, "
+				  "offset %u, size %u, index_size %u, "
+				  "index_count %u\n",
+				  req->node_id,
+				  le16_to_cpu(hdr->index_area_offset),
+				  index_area_size, hdr->index_size,
+				  le16_to_cpu(hdr->index_count));
+			job->result.space_errors++;
+		} else {
+			index_offset = le16_to_cpu(hdr->index_area_offset);
+			items_offset = index_offset + index_area_size;
+		}
+	} else if (le16_to_cpu(hdr->index_count) != 0) {
+		SSDFS_DBG(env->base.show_debug,
+			  "index keys without index area: node_id %u\n",
+			  req->node_id);
+		job->result.invalid_counters++;
+	}
+
+	if (flags & SSDFS_BTREE_NODE_HAS_ITEMS_AREA) {
+		item_area_offset = le32_to_cpu(hdr->item_area_offset);
+		items_capacity = le16_to_cpu(hdr->items_capacity);
+
+		if (item_area_offset < items_offset ||
+		    item_area_offset > node_size ||
+		    hdr->min_item_size > le16_to_cpu(hdr->max_item_size) ||
+		    ((u64)items_capacity * check->item_size) >
+					(node_size - item_area_offset)) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid items area: node_id %u, "
+				  "offset %u, items_capacity %u, "
+				  "min_item_size %u, max_item_size %u\n",
+				  req->node_id, item_area_offset,
+				  items_capacity, hdr->min_item_size,
+				  le16_to_cpu(hdr->max_item_size));
+			job->result.space_errors++;
+		} else
+			check->type->check_items(job, node, items_capacity);
+	}
+
+	if (index_offset >= U32_MAX)
+		return 0;
+
+	return ssdfs_fsck_btree_check_index_area(job, req, node, index_offset);
+}
+
+static
+void *ssdfs_fsck_btree_check_segments(void *arg)
+{
+	struct ssdfs_fsck_btree_job *job = (struct ssdfs_fsck_btree_job *)arg;
+	struct ssdfs_fsck_btree_check *check = job->check;
+	struct ssdfs_fsck_btree_segment *seg;
+	struct ssdfs_fsck_btree_node_request *req;
+	u32 i, j;
+
+	for (i = job->start; i < (job->start + job->count); i++) {
+		seg = &check->segs[i];
+
+		job->err = ssdfs_fsck_btree_load_segment(job, i);
+		if (job->err)
+			goto finish_check;
+
+		for (j = 0; j < seg->count; j++) {
+			req = &check->level.items[seg->start + j];
+
+			if (!job->found[j]) {
+				SSDFS_DBG(check->env->base.show_debug,
+					  "node is not found: "
+					  "seg_id %llu, node_id %u\n",
+					  req->seg_id, req->node_id);
+				job->result.lost_nodes++;
+				continue;
+			}
+
+			job->err = ssdfs_fsck_btree_check_node(job, req,
+					job->nodes + ((size_t)j * check->node_size));
+			if (job->err)
+				goto finish_check;
+		}
+	}
+
+finish_check:
+	free(job->nodes);
+	job->nodes = NULL;
+	free(job->found);
+	job->found = NULL;
+
+	pthread_exit((void *)(long)(job->err != 0));
+}
+
+static
+void ssdfs_fsck_btree_add_result(struct ssdfs_fsck_btree_corruption *result,
+				 struct ssdfs_fsck_btree_corruption *found)
+{
+	result->checked_nodes += found->checked_nodes;
+	result->lost_nodes += found->lost_nodes;
+	result->invalid_nodes += found->invalid_nodes;
+	result->corrupted_nodes += found->corrupted_nodes;
+	result->invalid_keys += found->invalid_keys;
+	result->invalid_children += found->invalid_children;
+	result->duplicate_nodes += found->duplicate_nodes;
+	result->space_errors += found->space_errors;
+	result->invalid_counters += found->invalid_counters;
+}
+
+/*
+ * ssdfs_fsck_btree_prepare_level() - prepare requests of current level
+ * @check: b-tree check environment
+ * @result: found corruptions [out]
+ *
+ * Node ID is unique in the tree. So, the node referenced several
+ * times is checked only once. The rest of requests are grouped by
+ * segments to read every PEB of the level only once.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_fsck_btree_prepare_level(struct ssdfs_fsck_btree_check *check,
+				   struct ssdfs_fsck_btree_corruption *result)
+{
+	struct ssdfs_fsck_btree_requests *level = &check->level;
+	size_t req_size = sizeof(struct ssdfs_fsck_btree_node_request);
+	u32 count = 0;
+	u32 i;
+
+	qsort(level->items, level->count, req_size, btree_node_id_cmp);
+
+	for (i = 0; i < level->count; i++) {
+		if (count > 0 &&
+		    level->items[count - 1].node_id == level->items[i].node_id) {
+			SSDFS_DBG(check->env->base.show_debug,
+				  "duplicate node: node_id %u\n",
+				  level->items[i].node_id);
+			result->duplicate_nodes++;
+			continue;
+		}
+
+		if (count != i)
+			memcpy(&level->items[count], &level->items[i], req_size);
+
+		count++;
+	}
+
+	level->count = count;
+
+	qsort(level->items, level->count, req_size, btree_node_location_cmp);
+
+	free(check->segs);
+	check->segs_count = 0;
+
+	check->segs = calloc(max_t(u32, level->count, 1),
+			     sizeof(struct ssdfs_fsck_btree_segment));
+	if (!check->segs) {
+		SSDFS_ERR("fail to allocate memory: requests %u\n",
+			  level->count);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < level->count; i++) {
+		struct ssdfs_fsck_btree_segment *seg;
+
+		if (check->segs_count > 0) {
+			seg = &check->segs[check->segs_count - 1];
+
+			if (seg->seg_id == level->items[i].seg_id) {
+				seg->count++;
+				continue;
+			}
+		}
+
+		seg = &check->segs[check->segs_count];
+		seg->seg_id = level->items[i].seg_id;
+		seg->start = i;
+		seg->count = 1;
+		check->segs_count++;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_fsck_btree_run_jobs() - check nodes of current level
+ * @check: b-tree check environment
+ * @result: found corruptions [out]
+ *
+ * Segments of the level are distributed between threads by ranges
+ * of equal size. So, all PEBs of the level are read in parallel.
+ * Requests of children found by every thread are gathered into
+ * the requests of next level.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EAGAIN     - fail to create thread.
+ * %-EIO        - thread has failed.
+ */
+static
+int ssdfs_fsck_btree_run_jobs(struct ssdfs_fsck_btree_check *check,
+			      struct ssdfs_fsck_btree_corruption *result)
+{
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_fsck_btree_job *jobs;
+	u32 items_count = check->segs_count;
+	u32 threads = max_t(u32, env->threads.capacity, 1);
+	u32 items_per_thread;
+	int created = 0;
+	u32 j;
+	int i;
+	int err = 0;
+
+	threads = min_t(u32, threads, items_count);
+	if (threads == 0)
+		return 0;
+
+	items_per_thread = (items_count + threads - 1) / threads;
+
+	jobs = calloc(threads, sizeof(struct ssdfs_fsck_btree_job));
+	if (!jobs) {
+		SSDFS_ERR("fail to allocate threads pool: %s\n",
+			  strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < threads; i++) {
+		jobs[i].check = check;
+		jobs[i].id = i;
+		jobs[i].start = i * items_per_thread;
+
+		if (jobs[i].start >= items_count)
+			break;
+
+		jobs[i].count = min_t(u32, items_per_thread,
+				      items_count - jobs[i].start);
+
+		err = pthread_create(&jobs[i].thread, NULL,
+				     ssdfs_fsck_btree_check_segments,
+				     (void *)&jobs[i]);
+		if (err) {
+			SSDFS_ERR("fail to create thread %d: %s\n",
+				  i, strerror(err));
+			err = -EAGAIN;
+			break;
+		}
+
+		created++;
+	}
+
+	for (i = 0; i < created; i++) {
+		pthread_join(jobs[i].thread, NULL);
+
+		if (jobs[i].err != 0) {
+			SSDFS_ERR("thread %d has failed: err %d\n",
+				  i, jobs[i].err);
+			err = -EIO;
+		}
+
+		ssdfs_fsck_btree_add_result(result, &jobs[i].result);
+
+		for (j = 0; !err && j < jobs[i].children.count; j++) {
+			err = ssdfs_fsck_btree_add_request(&check->next,
+						&jobs[i].children.items[j]);
+		}
+
+		ssdfs_fsck_btree_free_requests(&jobs[i].children);
+	}
+
+	free(jobs);
+	return err;
+}
+
+/*
+ * ssdfs_fsck_btree_check_root() - check root node of b-tree
+ * @check: b-tree check environment
+ * @result: found corruptions [out]
+ *
+ * The root node lives in the superblock. Its index keys define
+ * the requests of the first level of nodes.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid root node.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+static
+int ssdfs_fsck_btree_check_root(struct ssdfs_fsck_btree_check *check,
+				struct ssdfs_fsck_btree_corruption *result)
+{
+	struct ssdfs_fsck_environment *env = check->env;
+	struct ssdfs_btree_root_node_header *hdr = &check->root->header;
+	struct ssdfs_btree_index *index;
+	struct ssdfs_fsck_btree_node_request req;
+	u64 hash, prev_hash = 0;
+	int i;
+	int err;
+
+	result->height = hdr->height;
+
+	if (hdr->type != SSDFS_BTREE_ROOT_NODE ||
+	    hdr->items_count > SSDFS_BTREE_ROOT_NODE_INDEX_COUNT ||
+	    (hdr->items_count > 0 &&
+	     hdr->height == SSDFS_BTREE_LEAF_NODE_HEIGHT)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid root node: type %#x, "
+			  "items_count %u, height %u\n",
+			  hdr->type, hdr->items_count, hdr->height);
+		result->invalid_nodes++;
+		return -EINVAL;
+	}
+
+	for (i = 0; i < hdr->items_count; i++) {
+		index = &check->root->indexes[i];
+		hash = le64_to_cpu(index->hash);
+
+		if (i > 0 && hash <= prev_hash) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid root's key: index %d, "
+				  "hash %llx, prev_hash %llx\n",
+				  i, hash, prev_hash);
+			result->invalid_keys++;
+		}
+
+		prev_hash = hash;
+
+		req.seg_id = le64_to_cpu(index->extent.seg_id);
+		req.node_id = le32_to_cpu(hdr->node_ids[i]);
+		req.node_type = SSDFS_BTREE_NODE_UNKNOWN_TYPE;
+		req.height = hdr->height - 1;
+		req.parent_height = hdr->height;
+		req.start_hash = hash;
+
+		if ((i + 1) < hdr->items_count)
+			req.end_hash = le64_to_cpu(check->root->indexes[i + 1].hash);
+		else
+			req.end_hash = U64_MAX;
+
+		if (req.seg_id >= check->volume_segs ||
+		    req.node_id == SSDFS_BTREE_ROOT_NODE_ID ||
+		    req.node_id > check->upper_node_id) {
+			SSDFS_DBG(env->base.show_debug,
+				  "invalid root's child: index %d, "
+				  "seg_id %llu, node_id %u\n",
+				  i, req.seg_id, req.node_id);
+			result->invalid_children++;
+			continue;
+		}
+
+		err = ssdfs_fsck_btree_add_request(&check->level, &req);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static
+int ssdfs_fsck_btree_prepare_map(struct ssdfs_fsck_btree_check *check)
+{
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_metadata_map *map;
+	static const int seg_types[] = {
+		SSDFS_LEAF_NODE_SEG_TYPE,
+		SSDFS_HYBRID_NODE_SEG_TYPE,
+		SSDFS_INDEX_NODE_SEG_TYPE,
+	};
+	u32 count = 0;
+	int i, j;
+
+	creation_point = check->creation_point;
+
+	if (!(creation_point->found_metadata &
+				SSDFS_FSCK_METADATA_PEB_MAP_PREPARED))
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(seg_types); i++)
+		count += creation_point->metadata_map[seg_types[i]].count;
+
+	if (count == 0)
+		return 0;
+
+	check->map = calloc(count, sizeof(struct ssdfs_fsck_btree_leb2peb));
+	if (!check->map) {
+		SSDFS_ERR("fail to allocate memory: pairs %u\n", count);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(seg_types); i++) {
+		map = &creation_point->metadata_map[seg_types[i]];
+
+		for (j = 0; j < map->count; j++) {
+			check->map[check->map_count].leb_id =
+						map->array[j].leb_id;
+			check->map[check->map_count].peb_id =
+						map->array[j].peb_id;
+			check->map_count++;
+		}
+	}
+
+	qsort(check->map, check->map_count,
+		sizeof(struct ssdfs_fsck_btree_leb2peb), btree_leb_id_cmp);
+
+	return 0;
+}
+
+static inline
+int is_ssdfs_fsck_log_footer(union ssdfs_metadata_footer *footer)
+{
+	u16 key = le16_to_cpu(footer->magic.key);
+
+	if (le32_to_cpu(footer->magic.common) != SSDFS_SUPER_MAGIC)
+		return SSDFS_FALSE;
+
+	return key == SSDFS_LOG_FOOTER_MAGIC ||
+		key == SSDFS_PARTIAL_LOG_HDR_MAGIC;
+}
+
+/*
+ * ssdfs_fsck_btree_read_footer() - read footer of superblock's log
+ * @env: fsck environment
+ * @log: found log of superblock segment
+ * @footer: log footer [out]
+ *
+ * Volume search keeps only the header of superblock segment's log.
+ * So, the footer is read by means of header's descriptor.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - log has no footer.
+ * %-EIO        - I/O error.
+ */
 static
-int is_base_snapshot_segment_corrupted(struct ssdfs_fsck_environment *env)
+int ssdfs_fsck_btree_read_footer(struct ssdfs_fsck_environment *env,
+				 struct ssdfs_fsck_found_log *log,
+				 union ssdfs_metadata_footer *footer)
 {
-	SSDFS_DBG(env->base.show_debug,
-		  "Try to find base snapshot segment corruption(s)\n");
+	struct ssdfs_metadata_descriptor *desc;
+	u32 peb_size = env->base.erase_size;
+	u32 flags;
+	int err;
 
-/* TODO: implement */
+	memset(footer, 0, sizeof(union ssdfs_metadata_footer));
 
-	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+	if (log->peb_id >= U64_MAX || !is_ssdfs_fsck_log_header(&log->header))
+		return -ENODATA;
+
+	if (is_ssdfs_fsck_log_footer(&log->footer)) {
+		memcpy(footer, &log->footer, sizeof(union ssdfs_metadata_footer));
+		return 0;
+	}
+
+	if (le16_to_cpu(log->header.magic.key) == SSDFS_SEGMENT_HDR_MAGIC) {
+		desc = &log->header.seg_hdr.desc_array[SSDFS_LOG_FOOTER_INDEX];
+		flags = le32_to_cpu(log->header.seg_hdr.seg_flags);
+	} else {
+		desc = &log->header.pl_hdr.desc_array[SSDFS_LOG_FOOTER_INDEX];
+		flags = le32_to_cpu(log->header.pl_hdr.pl_flags);
+	}
+
+	if (flags & SSDFS_PARTIAL_HEADER_INSTEAD_FOOTER) {
+		err = ssdfs_read_partial_log_footer(&env->base,
+					log->peb_id, peb_size,
+					le32_to_cpu(desc->offset),
+					sizeof(struct ssdfs_partial_log_header),
+					&footer->pl_hdr);
+	} else if (flags & SSDFS_LOG_HAS_FOOTER) {
+		err = ssdfs_read_log_footer(&env->base,
+					log->peb_id, peb_size,
+					le32_to_cpu(desc->offset),
+					sizeof(struct ssdfs_log_footer),
+					&footer->footer);
+	} else
+		return -ENODATA;
+
+	if (err) {
+		SSDFS_ERR("fail to read log footer: "
+			  "peb_id %llu, err %d\n",
+			  log->peb_id, err);
+		return err;
+	}
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_BASE_SNAPSHOT_SEGMENT_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	if (!is_ssdfs_fsck_log_footer(footer))
+		return -ENODATA;
+
+	return 0;
 }
 
+/*
+ * ssdfs_fsck_btree_find_root() - find b-tree's root in superblock
+ * @log: found log of superblock segment
+ * @footer: footer of superblock segment's log
+ * @tree_type: type of the tree
+ * @desc: b-tree descriptor [out]
+ * @root: root node of b-tree [out]
+ * @feature_compat: compatible feature set [out]
+ *
+ * Invalidated extents b-tree is stored in volume header. Other trees
+ * are stored in volume state of log footer (or partial log header).
+ * The @feature_compat is U64_MAX if volume state is unavailable.
+ */
 static
-int is_superblock_segment_corrupted(struct ssdfs_fsck_environment *env)
+int ssdfs_fsck_btree_find_root(struct ssdfs_fsck_found_log *log,
+				union ssdfs_metadata_footer *footer,
+				int tree_type,
+				struct ssdfs_btree_descriptor **desc,
+				struct ssdfs_btree_inline_root_node **root,
+				u64 *feature_compat)
 {
-	SSDFS_DBG(env->base.show_debug,
-		  "Try to find superblock segment corruption(s)\n");
+	struct ssdfs_volume_state *vs = NULL;
+	struct ssdfs_partial_log_header *pl_hdr = NULL;
+	u16 key;
 
-/* TODO: implement */
+	*feature_compat = U64_MAX;
 
-	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+	if (log->peb_id >= U64_MAX)
+		return -ENODATA;
+
+	key = le16_to_cpu(footer->magic.key);
+
+	if (le32_to_cpu(footer->magic.common) == SSDFS_SUPER_MAGIC) {
+		if (key == SSDFS_LOG_FOOTER_MAGIC) {
+			vs = &footer->footer.volume_state;
+			*feature_compat = le64_to_cpu(vs->feature_compat);
+		} else if (key == SSDFS_PARTIAL_LOG_HDR_MAGIC)
+			pl_hdr = &footer->pl_hdr;
+	}
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_SUPERBLOCK_SEGMENT_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	switch (tree_type) {
+	case SSDFS_INODES_BTREE:
+		if (vs) {
+			*desc = &vs->inodes_btree.desc;
+			*root = &vs->inodes_btree.root_node;
+		} else if (pl_hdr) {
+			*desc = &pl_hdr->inodes_btree.desc;
+			*root = &pl_hdr->inodes_btree.root_node;
+		} else
+			return -ENODATA;
+		break;
+
+	case SSDFS_SHARED_DICTIONARY_BTREE:
+		if (vs) {
+			*desc = &vs->shared_dict_btree.desc;
+			*root = &vs->shared_dict_btree.root_node;
+		} else if (pl_hdr) {
+			*desc = &pl_hdr->shared_dict_btree.desc;
+			*root = &pl_hdr->shared_dict_btree.root_node;
+		} else
+			return -ENODATA;
+		break;
+
+	case SSDFS_SNAPSHOTS_BTREE:
+		if (vs) {
+			*desc = &vs->snapshots_btree.desc;
+			*root = &vs->snapshots_btree.root_node;
+		} else if (pl_hdr) {
+			*desc = &pl_hdr->snapshots_btree.desc;
+			*root = &pl_hdr->snapshots_btree.root_node;
+		} else
+			return -ENODATA;
+		break;
+
+	case SSDFS_INVALIDATED_EXTENTS_BTREE:
+		if (!is_ssdfs_fsck_log_header(&log->header))
+			return -ENODATA;
+
+		if (le16_to_cpu(log->header.magic.key) ==
+						SSDFS_SEGMENT_HDR_MAGIC) {
+			*desc = &log->header.seg_hdr.volume_hdr.invextree.desc;
+			*root = &log->header.seg_hdr.volume_hdr.invextree.root_node;
+		} else {
+			*desc = &log->header.pl_hdr.invextree.desc;
+			*root = &log->header.pl_hdr.invextree.root_node;
+		}
+		break;
+
+	default:
+		BUG();
+	}
+
+	return 0;
 }
 
+/*
+ * ssdfs_fsck_btree_init_check() - prepare b-tree check
+ * @env: fsck environment
+ * @creation_point: volume creation point
+ * @type: b-tree type descriptor
+ * @check: b-tree check environment [out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOENT     - tree is absent on volume.
+ * %-EINVAL     - invalid b-tree descriptor.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EIO        - I/O error.
+ */
 static
-int is_segment_bitmap_corrupted(struct ssdfs_fsck_environment *env)
+int ssdfs_fsck_btree_init_check(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_volume_creation_point *creation_point,
+			const struct ssdfs_fsck_btree_type *type,
+			struct ssdfs_fsck_btree_check *check)
 {
-	SSDFS_DBG(env->base.show_debug,
-		  "Try to find segment bitmap corruption(s)\n");
+	struct ssdfs_fsck_found_log *log;
+	struct ssdfs_btree_descriptor *desc;
+	struct ssdfs_btree_inline_root_node *root;
+	u64 feature_compat = U64_MAX;
+	u32 page_size = env->base.page_size;
+	int i;
+	int err = -ENODATA;
 
-/* TODO: implement */
+	memset(check, 0, sizeof(struct ssdfs_fsck_btree_check));
 
-	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+	check->env = env;
+	check->creation_point = creation_point;
+	check->type = type;
+
+	for (i = 0; i < SSDFS_SB_SEG_COPY_MAX; i++) {
+		log = &creation_point->superblock_seg.logs[i];
+
+		err = ssdfs_fsck_btree_read_footer(env, log, &check->footer);
+		if (err == -EIO)
+			return err;
+
+		err = ssdfs_fsck_btree_find_root(log, &check->footer,
+						 type->type, &desc, &root,
+						 &feature_compat);
+		if (!err)
+			break;
+	}
+
+	if (err) {
+		SSDFS_DBG(env->base.show_debug,
+			  "%s root has not been found\n",
+			  type->name);
+		return -EINVAL;
+	}
+
+	if (le32_to_cpu(desc->magic) != type->tree_magic) {
+		if (feature_compat != U64_MAX &&
+		    !(feature_compat & type->compat_flag))
+			return -ENOENT;
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_SEGMENT_BITMAP_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid %s descriptor: magic %#x\n",
+			  type->name, le32_to_cpu(desc->magic));
+		return -EINVAL;
+	}
+
+	check->desc = desc;
+	check->root = root;
+	check->index_size = le16_to_cpu(desc->index_size);
+	check->item_size = le16_to_cpu(desc->item_size);
+	check->upper_node_id = le32_to_cpu(root->header.upper_node_id);
+
+	if (env->seg_size == 0 || env->base.erase_size == 0 ||
+	    env->seg_size < env->base.erase_size || page_size == 0) {
+		SSDFS_ERR("invalid geometry: seg_size %u, erase_size %u, "
+			  "page_size %u\n",
+			  env->seg_size, env->base.erase_size, page_size);
+		return -EINVAL;
+	}
+
+	check->lebs_per_seg = env->seg_size / env->base.erase_size;
+	check->volume_segs = env->base.fs_size / env->seg_size;
+
+	if (desc->type != type->type ||
+	    desc->log_node_size >= 32 ||
+	    (1U << desc->log_node_size) < page_size ||
+	    (1U << desc->log_node_size) > env->base.erase_size ||
+	    (1U << desc->log_node_size) < type->node_hdr_size ||
+	    check->index_size != sizeof(struct ssdfs_btree_index_key)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid %s descriptor: type %#x, "
+			  "log_node_size %u, index_size %u\n",
+			  type->name, desc->type,
+			  desc->log_node_size, check->index_size);
+		return -EINVAL;
+	}
+
+	check->node_size = 1U << desc->log_node_size;
+
+	return ssdfs_fsck_btree_prepare_map(check);
 }
 
 static
-int is_mapping_table_corrupted(struct ssdfs_fsck_environment *env)
+void ssdfs_fsck_btree_destroy_check(struct ssdfs_fsck_btree_check *check)
+{
+	ssdfs_fsck_btree_free_requests(&check->level);
+	ssdfs_fsck_btree_free_requests(&check->next);
+
+	free(check->segs);
+	check->segs = NULL;
+	free(check->map);
+	check->map = NULL;
+}
+
+/*
+ * is_ssdfs_btree_corrupted() - check b-tree
+ * @env: fsck environment
+ * @type: b-tree type descriptor
+ * @result: found corruptions [out]
+ *
+ * The tree is traversed in breadth-first order starting from the root
+ * node. The nodes of the same level are read and checked by a pool
+ * of threads. So, the check is limited by the device's bandwidth
+ * rather than by the latency of a node's read.
+ */
+static
+int is_ssdfs_btree_corrupted(struct ssdfs_fsck_environment *env,
+			     const struct ssdfs_fsck_btree_type *type,
+			     struct ssdfs_fsck_btree_corruption *result)
 {
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_btree_check check;
+	struct ssdfs_fsck_btree_requests requests;
+	u32 levels = 0;
+	int err;
+
 	SSDFS_DBG(env->base.show_debug,
-		  "Try to find mapping table corruption(s)\n");
+		  "Try to find %s corruption(s)\n", type->name);
 
-/* TODO: implement */
+	creation_point = ssdfs_fsck_get_checked_creation_point(env);
+
+	if (!creation_point ||
+	    !(creation_point->found_metadata & SSDFS_FSCK_SB_SEGS_FOUND)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "superblock segment has not been found\n");
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto finish_check;
+	}
+
+	err = ssdfs_fsck_btree_init_check(env, creation_point, type, &check);
+	if (err == -ENOENT) {
+		SSDFS_DBG(env->base.show_debug,
+			  "%s is absent\n", type->name);
+		result->state = SSDFS_FSCK_CHECK_RESULT_SUCCESS;
+		goto destroy_check;
+	} else if (err == -EINVAL) {
+		result->invalid_nodes++;
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto destroy_check;
+	} else if (err) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto destroy_check;
+	}
+
+	err = ssdfs_fsck_btree_check_root(&check, result);
+	if (err == -EINVAL) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto destroy_check;
+	} else if (err) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto destroy_check;
+	}
 
+	while (check.level.count > 0) {
+		err = ssdfs_fsck_btree_prepare_level(&check, result);
+		if (!err)
+			err = ssdfs_fsck_btree_run_jobs(&check, result);
+		if (err) {
+			SSDFS_ERR("fail to check %s: level %u, err %d\n",
+				  type->name, levels, err);
+			result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+			goto destroy_check;
+		}
+
+		requests = check.level;
+		check.level = check.next;
+		check.next = requests;
+		check.next.count = 0;
+		levels++;
+	}
+
+	SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+			"%s: height %u, levels %u, checked nodes %llu, "
+			"lost %llu, invalid %llu, corrupted %llu, "
+			"invalid keys %llu, invalid children %llu, "
+			"duplicate nodes %llu, space errors %llu, "
+			"invalid counters %llu\n",
+			type->name, result->height, levels,
+			result->checked_nodes, result->lost_nodes,
+			result->invalid_nodes, result->corrupted_nodes,
+			result->invalid_keys, result->invalid_children,
+			result->duplicate_nodes, result->space_errors,
+			result->invalid_counters);
+
+	if (result->lost_nodes || result->invalid_nodes ||
+	    result->corrupted_nodes || result->invalid_keys ||
+	    result->invalid_children || result->duplicate_nodes ||
+	    result->space_errors || result->invalid_counters)
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	else
+		result->state = SSDFS_FSCK_CHECK_RESULT_SUCCESS;
+
+destroy_check:
+	ssdfs_fsck_btree_destroy_check(&check);
+
+finish_check:
 	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+		  "finished: state %#x\n", result->state);
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_MAPPING_TABLE_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	if (result->state == SSDFS_FSCK_CHECK_RESULT_CORRUPTION)
+		env->check_result.corruption.mask |= type->corruption_flag;
+
+	return result->state;
 }
 
+static const struct ssdfs_fsck_btree_type inodes_btree_type = {
+	.name = "inodes btree",
+	.type = SSDFS_INODES_BTREE,
+	.tree_magic = SSDFS_INODES_BTREE_MAGIC,
+	.node_magic = SSDFS_INODES_BNODE_MAGIC,
+	.node_hdr_size = sizeof(struct ssdfs_inodes_btree_node_header),
+	.compat_flag = SSDFS_HAS_INODES_TREE_COMPAT_FLAG,
+	.corruption_flag = SSDFS_FSCK_INODES_BTREE_CORRUPTED,
+	.check_items = ssdfs_fsck_check_inodes_node,
+};
+
+static const struct ssdfs_fsck_btree_type snapshots_btree_type = {
+	.name = "snapshots btree",
+	.type = SSDFS_SNAPSHOTS_BTREE,
+	.tree_magic = SSDFS_SNAPSHOTS_BTREE_MAGIC,
+	.node_magic = SSDFS_SNAPSHOTS_BNODE_MAGIC,
+	.node_hdr_size = sizeof(struct ssdfs_snapshots_btree_node_header),
+	.compat_flag = SSDFS_HAS_SNAPSHOTS_TREE_COMPAT_FLAG,
+	.corruption_flag = SSDFS_FSCK_SNAPSHOTS_BTREE_CORRUPTED,
+	.check_items = ssdfs_fsck_check_snapshots_node,
+};
+
+static const struct ssdfs_fsck_btree_type invextree_type = {
+	.name = "invalid extents btree",
+	.type = SSDFS_INVALIDATED_EXTENTS_BTREE,
+	.tree_magic = SSDFS_INVEXT_BTREE_MAGIC,
+	.node_magic = SSDFS_INVEXT_BNODE_MAGIC,
+	.node_hdr_size = sizeof(struct ssdfs_invextree_node_header),
+	.compat_flag = SSDFS_HAS_INVALID_EXTENTS_TREE_COMPAT_FLAG,
+	.corruption_flag = SSDFS_FSCK_INVALID_EXTENTS_BTREE_CORRUPTED,
+	.check_items = ssdfs_fsck_check_invextree_node,
+};
+
+static const struct ssdfs_fsck_btree_type shared_dict_btree_type = {
+	.name = "shared dictionary btree",
+	.type = SSDFS_SHARED_DICTIONARY_BTREE,
+	.tree_magic = SSDFS_SHARED_DICT_BTREE_MAGIC,
+	.node_magic = SSDFS_DICTIONARY_BNODE_MAGIC,
+	.node_hdr_size = sizeof(struct ssdfs_shared_dictionary_node_header),
+	.compat_flag = SSDFS_HAS_SHARED_DICT_COMPAT_FLAG,
+	.corruption_flag = SSDFS_FSCK_SHARED_DICT_BTREE_CORRUPTED,
+	.check_items = ssdfs_fsck_check_shared_dict_node,
+};
+
 static
 int is_inodes_btree_corrupted(struct ssdfs_fsck_environment *env)
 {
-	SSDFS_DBG(env->base.show_debug,
-		  "Try to find inodes btree corruption(s)\n");
+	return is_ssdfs_btree_corrupted(env, &inodes_btree_type,
+				&env->check_result.corruption.inodes_btree);
+}
 
-/* TODO: implement */
+static
+int is_snapshots_btree_corrupted(struct ssdfs_fsck_environment *env)
+{
+	return is_ssdfs_btree_corrupted(env, &snapshots_btree_type,
+				&env->check_result.corruption.snapshots_btree);
+}
 
-	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+static
+int is_invalid_extents_btree_corrupted(struct ssdfs_fsck_environment *env)
+{
+	return is_ssdfs_btree_corrupted(env, &invextree_type,
+				&env->check_result.corruption.invalid_extents);
+}
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_INODES_BTREE_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+static
+int is_shared_dictionary_btree_corrupted(struct ssdfs_fsck_environment *env)
+{
+	return is_ssdfs_btree_corrupted(env, &shared_dict_btree_type,
+				&env->check_result.corruption.shared_dictionary);
 }
 
+/*
+ * struct ssdfs_fsck_sb_log_chain - newest logs of superblock segment's copy
+ * @is_valid: is the chain consistent?
+ * @has_volume_state: does the chain end with log footer?
+ * @cno: checkpoint of the newest log in the chain
+ * @timestamp: timestamp of the newest log in the chain
+ * @header: segment header of the newest full log
+ * @next: partial log header that follows the previous log
+ * @footer: footer of the newest log in the chain
+ */
+struct ssdfs_fsck_sb_log_chain {
+	int is_valid;
+	int has_volume_state;
+	u64 cno;
+	u64 timestamp;
+	union ssdfs_metadata_header header;
+	union ssdfs_metadata_header next;
+	union ssdfs_metadata_footer footer;
+};
+
+/*
+ * ssdfs_fsck_sb_check_log_footer() - check footer of superblock's log
+ * @env: fsck environment
+ * @peb_id: PEB ID of superblock segment's copy
+ * @desc: footer's descriptor of log's header
+ * @flags: flags of log's header
+ * @chain: log chain [in|out]
+ * @result: superblock segment's check result [out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - footer is absent or corrupted.
+ * %-EIO        - I/O error.
+ */
 static
-int is_snapshots_btree_corrupted(struct ssdfs_fsck_environment *env)
+int ssdfs_fsck_sb_check_log_footer(struct ssdfs_fsck_environment *env,
+			u64 peb_id, struct ssdfs_metadata_descriptor *desc,
+			u32 flags, struct ssdfs_fsck_sb_log_chain *chain,
+			struct ssdfs_fsck_superblock_segment_corruption *result)
 {
-	SSDFS_DBG(env->base.show_debug,
-		  "Try to find snapshots btree corruption(s)\n");
+	union ssdfs_metadata_footer *footer = &chain->footer;
+	struct ssdfs_metadata_check *check;
+	u32 peb_size = env->base.erase_size;
+	u32 offset = le32_to_cpu(desc->offset);
+	u16 magic;
+	u64 cno, timestamp;
+	int err;
 
-/* TODO: implement */
+	if (flags & SSDFS_LOG_HAS_FOOTER) {
+		magic = SSDFS_LOG_FOOTER_MAGIC;
+		err = ssdfs_read_log_footer(&env->base, peb_id, peb_size,
+					    offset,
+					    sizeof(struct ssdfs_log_footer),
+					    &footer->footer);
+	} else if (flags & SSDFS_PARTIAL_HEADER_INSTEAD_FOOTER) {
+		magic = SSDFS_PARTIAL_LOG_HDR_MAGIC;
+		err = ssdfs_read_partial_log_footer(&env->base,
+					peb_id, peb_size, offset,
+					sizeof(struct ssdfs_partial_log_header),
+					&footer->pl_hdr);
+	} else {
+		SSDFS_DBG(env->base.show_debug,
+			  "log has no footer: peb_id %llu, flags %#x\n",
+			  peb_id, flags);
+		result->invalid_footers++;
+		return -ENODATA;
+	}
 
-	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+	if (err) {
+		SSDFS_ERR("fail to read log footer: "
+			  "peb_id %llu, offset %u, err %d\n",
+			  peb_id, offset, err);
+		return err;
+	}
+
+	if (le32_to_cpu(footer->magic.common) != SSDFS_SUPER_MAGIC ||
+	    le16_to_cpu(footer->magic.key) != magic) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid log footer: peb_id %llu, offset %u\n",
+			  peb_id, offset);
+		result->invalid_footers++;
+		return -ENODATA;
+	}
+
+	if (magic == SSDFS_LOG_FOOTER_MAGIC) {
+		check = &footer->footer.volume_state.check;
+		cno = le64_to_cpu(footer->footer.cno);
+		timestamp = le64_to_cpu(footer->footer.timestamp);
+	} else {
+		check = &footer->pl_hdr.check;
+		cno = le64_to_cpu(footer->pl_hdr.cno);
+		timestamp = le64_to_cpu(footer->pl_hdr.timestamp);
+	}
+
+	if (!is_ssdfs_fsck_csum_valid(check, footer,
+				      sizeof(union ssdfs_metadata_footer))) {
+		SSDFS_DBG(env->base.show_debug,
+			  "corrupted log footer: peb_id %llu, offset %u\n",
+			  peb_id, offset);
+		result->corrupted_footers++;
+		return -ENODATA;
+	}
+
+	if (cno < chain->cno || timestamp < chain->timestamp) {
+		SSDFS_DBG(env->base.show_debug,
+			  "footer is older than header: peb_id %llu, "
+			  "cno %llu, header's cno %llu\n",
+			  peb_id, cno, chain->cno);
+		result->broken_chains++;
+		return -ENODATA;
+	}
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_SNAPSHOTS_BTREE_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	chain->cno = cno;
+	chain->timestamp = timestamp;
+	chain->has_volume_state = magic == SSDFS_LOG_FOOTER_MAGIC;
+
+	return 0;
 }
 
+/*
+ * ssdfs_fsck_sb_check_log_chain() - check newest logs of superblock's copy
+ * @env: fsck environment
+ * @log: found log of superblock segment
+ * @chain: log chain [out]
+ * @result: superblock segment's check result [out]
+ *
+ * Volume search finds the newest full log of superblock segment.
+ * This full log could be followed by partial logs. Every log of
+ * the chain has to be valid, it has to belong to the same PEB and
+ * it cannot be older than the previous one. The volume state is
+ * available only if the chain ends with log footer. The check
+ * needs only a few I/O requests because only headers and footers
+ * of the newest logs are read.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - log chain is corrupted.
+ * %-EIO        - I/O error.
+ */
 static
-int is_invalid_extents_btree_corrupted(struct ssdfs_fsck_environment *env)
+int ssdfs_fsck_sb_check_log_chain(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_found_log *log,
+			struct ssdfs_fsck_sb_log_chain *chain,
+			struct ssdfs_fsck_superblock_segment_corruption *result)
 {
-	SSDFS_DBG(env->base.show_debug,
-		  "Try to find invalid extents btree corruption(s)\n");
+	struct ssdfs_segment_header *seg_hdr = &chain->header.seg_hdr;
+	struct ssdfs_partial_log_header *pl_hdr = &chain->next.pl_hdr;
+	struct ssdfs_metadata_descriptor *desc;
+	u32 peb_size = env->base.erase_size;
+	u32 page_size = env->base.page_size;
+	u64 seg_id, leb_id;
+	u64 log_offset, upper_offset;
+	u32 log_bytes;
+	u32 flags;
+	u16 log_pages;
+	int err;
 
-/* TODO: implement */
+	memset(chain, 0, sizeof(struct ssdfs_fsck_sb_log_chain));
 
-	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+	if (log->peb_id >= U64_MAX || page_size == 0) {
+		result->lost_copies++;
+		return -ENODATA;
+	}
+
+	log_offset = (u64)log->start_page * page_size;
+
+	err = ssdfs_read_segment_header(&env->base, log->peb_id, peb_size,
+					log_offset,
+					sizeof(struct ssdfs_segment_header),
+					seg_hdr);
+	if (err) {
+		SSDFS_ERR("fail to read segment header: "
+			  "peb_id %llu, offset %llu, err %d\n",
+			  log->peb_id, log_offset, err);
+		return err;
+	}
+
+	result->checked_logs++;
+
+	log_pages = le16_to_cpu(seg_hdr->log_pages);
+	upper_offset = log_offset + (u64)log_pages * page_size;
+
+	if (le32_to_cpu(seg_hdr->volume_hdr.magic.common) !=
+						SSDFS_SUPER_MAGIC ||
+	    le16_to_cpu(seg_hdr->volume_hdr.magic.key) !=
+						SSDFS_SEGMENT_HDR_MAGIC ||
+	    le16_to_cpu(seg_hdr->seg_type) != SSDFS_SB_SEG_TYPE ||
+	    le64_to_cpu(seg_hdr->peb_id) != log->peb_id ||
+	    log_pages == 0 || upper_offset > peb_size) {
+		SSDFS_DBG(env->base.show_debug,
+			  "invalid segment header: peb_id %llu, "
+			  "start_page %u, seg_type %#x, log_pages %u\n",
+			  log->peb_id, log->start_page,
+			  le16_to_cpu(seg_hdr->seg_type), log_pages);
+		result->invalid_headers++;
+		return -ENODATA;
+	}
+
+	if (!is_ssdfs_fsck_csum_valid(&seg_hdr->volume_hdr.check, seg_hdr,
+				      sizeof(struct ssdfs_segment_header))) {
+		SSDFS_DBG(env->base.show_debug,
+			  "corrupted segment header: peb_id %llu, "
+			  "start_page %u\n",
+			  log->peb_id, log->start_page);
+		result->corrupted_headers++;
+		return -ENODATA;
+	}
+
+	seg_id = le64_to_cpu(seg_hdr->seg_id);
+	leb_id = le64_to_cpu(seg_hdr->leb_id);
+	chain->cno = le64_to_cpu(seg_hdr->cno);
+	chain->timestamp = le64_to_cpu(seg_hdr->timestamp);
+
+	desc = &seg_hdr->desc_array[SSDFS_LOG_FOOTER_INDEX];
+	flags = le32_to_cpu(seg_hdr->seg_flags);
+
+	do {
+		err = ssdfs_fsck_sb_check_log_footer(env, log->peb_id,
+						     desc, flags,
+						     chain, result);
+		if (err)
+			return err;
+
+		if (chain->has_volume_state)
+			break;
+
+		log_bytes = le32_to_cpu(chain->footer.pl_hdr.log_bytes);
+		log_offset += (log_bytes / page_size) * page_size;
+
+		if (log_bytes < page_size || log_offset >= upper_offset)
+			break;
+
+		err = ssdfs_read_partial_log_header(&env->base,
+					log->peb_id, peb_size, log_offset,
+					sizeof(struct ssdfs_partial_log_header),
+					pl_hdr);
+		if (err) {
+			SSDFS_ERR("fail to read partial log header: "
+				  "peb_id %llu, offset %llu, err %d\n",
+				  log->peb_id, log_offset, err);
+			return err;
+		}
+
+		if (le32_to_cpu(pl_hdr->magic.common) != SSDFS_SUPER_MAGIC ||
+		    le16_to_cpu(pl_hdr->magic.key) !=
+					SSDFS_PARTIAL_LOG_HDR_MAGIC) {
+			/* the previous log is the newest one */
+			break;
+		}
+
+		result->checked_logs++;
+
+		if (!is_ssdfs_fsck_csum_valid(&pl_hdr->check, pl_hdr,
+				sizeof(struct ssdfs_partial_log_header))) {
+			SSDFS_DBG(env->base.show_debug,
+				  "corrupted partial log header: "
+				  "peb_id %llu, offset %llu\n",
+				  log->peb_id, log_offset);
+			result->corrupted_headers++;
+			return -ENODATA;
+		}
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_INVALID_EXTENTS_BTREE_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		if (le16_to_cpu(pl_hdr->seg_type) != SSDFS_SB_SEG_TYPE ||
+		    le64_to_cpu(pl_hdr->seg_id) != seg_id ||
+		    le64_to_cpu(pl_hdr->leb_id) != leb_id ||
+		    le64_to_cpu(pl_hdr->peb_id) != log->peb_id ||
+		    le64_to_cpu(pl_hdr->cno) < chain->cno ||
+		    le64_to_cpu(pl_hdr->timestamp) < chain->timestamp) {
+			SSDFS_DBG(env->base.show_debug,
+				  "inconsistent partial log: "
+				  "peb_id %llu, offset %llu, "
+				  "seg_id %llu, cno %llu, prev cno %llu\n",
+				  log->peb_id, log_offset,
+				  le64_to_cpu(pl_hdr->seg_id),
+				  le64_to_cpu(pl_hdr->cno), chain->cno);
+			result->broken_chains++;
+			return -ENODATA;
+		}
+
+		chain->cno = le64_to_cpu(pl_hdr->cno);
+		chain->timestamp = le64_to_cpu(pl_hdr->timestamp);
+
+		desc = &pl_hdr->desc_array[SSDFS_LOG_FOOTER_INDEX];
+		flags = le32_to_cpu(pl_hdr->pl_flags);
+	} while (log_offset < upper_offset);
+
+	chain->is_valid = SSDFS_TRUE;
+	return 0;
 }
 
 static
-int is_shared_dictionary_btree_corrupted(struct ssdfs_fsck_environment *env)
+u32 ssdfs_fsck_sb_compare_volume_states(struct ssdfs_volume_state *vs1,
+					struct ssdfs_volume_state *vs2)
+{
+	u32 mismatches = 0;
+
+	if (vs1->nsegs != vs2->nsegs)
+		mismatches++;
+	if (vs1->free_pages != vs2->free_pages)
+		mismatches++;
+	if (vs1->cno != vs2->cno)
+		mismatches++;
+	if (vs1->flags != vs2->flags)
+		mismatches++;
+	if (vs1->state != vs2->state)
+		mismatches++;
+	if (vs1->feature_compat != vs2->feature_compat)
+		mismatches++;
+	if (vs1->feature_compat_ro != vs2->feature_compat_ro)
+		mismatches++;
+	if (vs1->feature_incompat != vs2->feature_incompat)
+		mismatches++;
+	if (memcmp(vs1->uuid, vs2->uuid, SSDFS_UUID_SIZE) != 0)
+		mismatches++;
+
+	return mismatches;
+}
+
+/*
+ * is_superblock_segment_corrupted() - check superblock segment
+ * @env: fsck environment
+ *
+ * The newest full/partial log chain of main and copy superblock
+ * segments is checked and the volume states of both copies are
+ * compared. The volume is clean if both copies are consistent and
+ * the file system has been unmounted cleanly. Unclean umount is not
+ * a corruption but it requires the deep check of the volume.
+ */
+static
+int is_superblock_segment_corrupted(struct ssdfs_fsck_environment *env)
 {
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_superblock_segment_corruption *result;
+	struct ssdfs_fsck_sb_log_chain *chains = NULL;
+	struct ssdfs_fsck_sb_log_chain *newest = NULL;
+	struct ssdfs_volume_state *vs;
+	int i;
+	int err;
+
 	SSDFS_DBG(env->base.show_debug,
-		  "Try to find shared dictionary btree corruption(s)\n");
+		  "Try to find superblock segment corruption(s)\n");
 
-/* TODO: implement */
+	result = &env->check_result.corruption.superblock_seg;
+	result->fs_state = SSDFS_MOUNTED_FS;
+	result->is_clean = SSDFS_FALSE;
+
+	creation_point = ssdfs_fsck_get_checked_creation_point(env);
+
+	if (!creation_point ||
+	    !(creation_point->found_metadata & SSDFS_FSCK_SB_SEGS_FOUND)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "superblock segment has not been found\n");
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto finish_check;
+	}
+
+	chains = calloc(SSDFS_SB_SEG_COPY_MAX,
+			sizeof(struct ssdfs_fsck_sb_log_chain));
+	if (!chains) {
+		SSDFS_ERR("fail to allocate memory\n");
+		result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+		goto finish_check;
+	}
+
+	for (i = 0; i < SSDFS_SB_SEG_COPY_MAX; i++) {
+		err = ssdfs_fsck_sb_check_log_chain(env,
+					&creation_point->superblock_seg.logs[i],
+					&chains[i], result);
+		if (err == -ENODATA)
+			continue;
+		else if (err) {
+			SSDFS_ERR("fail to check superblock segment: "
+				  "copy %d, err %d\n", i, err);
+			result->state = SSDFS_FSCK_CHECK_RESULT_FAILURE;
+			goto free_chains;
+		}
+
+		if (!newest) {
+			newest = &chains[i];
+			continue;
+		}
+
+		if (newest->has_volume_state != chains[i].has_volume_state) {
+			result->state_mismatches++;
+			continue;
+		}
+
+		if (chains[i].has_volume_state) {
+			result->state_mismatches +=
+			    ssdfs_fsck_sb_compare_volume_states(
+				&newest->footer.footer.volume_state,
+				&chains[i].footer.footer.volume_state);
+		}
+	}
+
+	if (newest && newest->has_volume_state) {
+		vs = &newest->footer.footer.volume_state;
+		result->fs_state = le16_to_cpu(vs->state);
+	}
+
+	SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+			"superblock segment: checked logs %u, "
+			"lost copies %u, invalid headers %u, "
+			"corrupted headers %u, invalid footers %u, "
+			"corrupted footers %u, broken chains %u, "
+			"state mismatches %u, file system state %#x\n",
+			result->checked_logs, result->lost_copies,
+			result->invalid_headers, result->corrupted_headers,
+			result->invalid_footers, result->corrupted_footers,
+			result->broken_chains, result->state_mismatches,
+			result->fs_state);
+
+	if (!newest || result->lost_copies || result->invalid_headers ||
+	    result->corrupted_headers || result->invalid_footers ||
+	    result->corrupted_footers || result->broken_chains ||
+	    result->state_mismatches ||
+	    (result->fs_state & SSDFS_ERROR_FS)) {
+		result->state = SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+		goto free_chains;
+	}
+
+	result->state = SSDFS_FSCK_CHECK_RESULT_SUCCESS;
+
+	if (result->fs_state == SSDFS_VALID_FS)
+		result->is_clean = SSDFS_TRUE;
+	else if (result->fs_state == SSDFS_MOUNTED_FS)
+		env->check_result.state = SSDFS_FSCK_VOLUME_UNCLEAN_UMOUNT;
+
+free_chains:
+	free(chains);
 
+finish_check:
 	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+		  "finished: state %#x, is_clean %#x\n",
+		  result->state, result->is_clean);
+
+	if (result->state == SSDFS_FSCK_CHECK_RESULT_CORRUPTION) {
+		env->check_result.corruption.mask |=
+				SSDFS_FSCK_SUPERBLOCK_SEGMENT_CORRUPTED;
+	}
 
-	env->check_result.corruption.mask |=
-			SSDFS_FSCK_SHARED_DICT_BTREE_CORRUPTED;
-	return SSDFS_FSCK_CHECK_RESULT_CORRUPTION;
+	return result->state;
 }
 
 enum {
@@ -229,7 +4729,34 @@ int is_ssdfs_volume_corrupted(struct ssdfs_fsck_environment *env)
 		goto check_failure;
 	}
 
+	if (!env->force_checking) {
+		switch (is_superblock_segment_corrupted(env)) {
+		case SSDFS_FSCK_CHECK_RESULT_SUCCESS:
+		case SSDFS_FSCK_CHECK_RESULT_CORRUPTION:
+			/* continue logic */
+			break;
+
+		default:
+			SSDFS_ERR("fail to check superblock segment\n");
+			goto check_failure;
+		}
+
+		if (env->check_result.corruption.superblock_seg.is_clean) {
+			SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+					"volume is clean: deep check skipped "
+					"(use --force to check it)\n");
+			env->check_result.state = SSDFS_FSCK_VOLUME_HEALTHY;
+			goto finish_check;
+		}
+	}
+
 	for (i = 0; i < SSDFS_FSCK_CHECK_FUNCTION_MAX; i++) {
+		if (i == SSDFS_FSCK_SUPERBLOCK_SEG_CHECK_FUNCTION &&
+		    !env->force_checking) {
+			/* already checked */
+			continue;
+		}
+
 		switch (check_actions[i](env)) {
 		case SSDFS_FSCK_CHECK_RESULT_SUCCESS:
 		case SSDFS_FSCK_CHECK_RESULT_CORRUPTION:
@@ -243,6 +4770,15 @@ int is_ssdfs_volume_corrupted(struct ssdfs_fsck_environment *env)
 		}
 	}
 
+	if (env->check_result.state == SSDFS_FSCK_VOLUME_UNKNOWN_CHECK_RESULT) {
+		if (env->check_result.corruption.mask == 0)
+			env->check_result.state = SSDFS_FSCK_VOLUME_HEALTHY;
+		else {
+			env->check_result.state =
+					SSDFS_FSCK_VOLUME_SLIGHTLY_CORRUPTED;
+		}
+	}
+
 finish_check:
 	switch (env->check_result.state) {
 	case SSDFS_FSCK_VOLUME_COMPLETELY_DESTROYED:
@@ -1059,11 +1059,10 @@ int ssdfs_fsck_allocate_segbmap_logs_array(struct ssdfs_fsck_environment *env)
 	return SSDFS_FSCK_SEARCH_RESULT_SUCCESS;
 }
 
-static
-u64 ssdfs_maptbl_cache_convert_leb2peb(struct ssdfs_fsck_environment *env,
-					u64 leb_id)
+u64 __ssdfs_maptbl_cache_convert_leb2peb(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_volume_creation_point *creation_point,
+			u64 leb_id)
 {
-	struct ssdfs_fsck_volume_creation_point *creation_point;
 	struct ssdfs_fsck_mapping_table_cache *maptbl_cache;
 	struct ssdfs_maptbl_cache_header *cache_hdr;
 	u16 items_count;
@@ -1079,16 +1078,9 @@ u64 ssdfs_maptbl_cache_convert_leb2peb(struct ssdfs_fsck_environment *env,
 		  "leb_id %llu\n",
 		  leb_id);
 
-	creation_point = ssdfs_fsck_get_creation_point(env, 0);
-
-	if (!creation_point) {
-		SSDFS_ERR("fail to get creation point\n");
-		return SSDFS_FSCK_SEARCH_RESULT_FAILURE;
-	}
-
 	if (!(creation_point->found_metadata & SSDFS_FSCK_MAPTBL_CACHE_FOUND)) {
 		SSDFS_ERR("Mapping table cache is not found\n");
-		return SSDFS_FSCK_SEARCH_RESULT_FAILURE;
+		return U64_MAX;
 	}
 
 	maptbl_cache = &creation_point->maptbl_cache;
@@ -1150,6 +1142,23 @@ u64 ssdfs_maptbl_cache_convert_leb2peb(struct ssdfs_fsck_environment *env,
 	return U64_MAX;
 }
 
+static
+u64 ssdfs_maptbl_cache_convert_leb2peb(struct ssdfs_fsck_environment *env,
+					u64 leb_id)
+{
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+
+	creation_point = ssdfs_fsck_get_creation_point(env, 0);
+
+	if (!creation_point) {
+		SSDFS_ERR("fail to get creation point\n");
+		return U64_MAX;
+	}
+
+	return __ssdfs_maptbl_cache_convert_leb2peb(env, creation_point,
+						    leb_id);
+}
+
 static
 int ssdfs_fsck_find_segbmap_peb(struct ssdfs_fsck_environment *env,
 				struct ssdfs_fsck_found_log *log,
@@ -2284,6 +2293,7 @@ int ssdfs_fsck_metadata_map_add_peb_descriptor(struct ssdfs_thread_state *state,
 	item->seg_id = le64_to_cpu(hdr->seg_id);
 	item->leb_id = le64_to_cpu(hdr->leb_id);
 	item->peb_id = state->peb.id;
+	item->relation_peb_id = le64_to_cpu(hdr->relation_peb_id);
 
 	switch (le16_to_cpu(hdr->seg_type)) {
 	case SSDFS_INITIAL_SNAPSHOT_SEG_TYPE:
@@ -2314,6 +2324,10 @@ int ssdfs_fsck_metadata_map_add_peb_descriptor(struct ssdfs_thread_state *state,
 		item->type = SSDFS_MAPTBL_IDXNODE_PEB_TYPE;
 		break;
 
+	case SSDFS_USER_DATA_SEG_TYPE:
+		item->type = SSDFS_MAPTBL_DATA_PEB_TYPE;
+		break;
+
 	default:
 		SSDFS_ERR("unexpected segment type %#x\n",
 			  le16_to_cpu(hdr->seg_type));
@@ -2371,6 +2385,7 @@ int ssdfs_fsck_process_peb(struct ssdfs_thread_state *state)
 	case SSDFS_LEAF_NODE_SEG_TYPE:
 	case SSDFS_HYBRID_NODE_SEG_TYPE:
 	case SSDFS_INDEX_NODE_SEG_TYPE:
+	case SSDFS_USER_DATA_SEG_TYPE:
 		err = ssdfs_fsck_metadata_map_add_peb_descriptor(state, &hdr);
 		if (err) {
 			SSDFS_ERR("fail to process erase block: "
@@ -2381,7 +2396,7 @@ int ssdfs_fsck_process_peb(struct ssdfs_thread_state *state)
 		break;
 
 	default:
-		/* ignore not metadata erase block */
+		/* ignore erase block of unknown type */
 		return 0;
 	}
 
@@ -2648,6 +2663,10 @@ int ssdfs_fsck_process_metadata_map_item(struct ssdfs_fsck_environment *env,
 		index = SSDFS_INDEX_NODE_SEG_TYPE;
 		break;
 
+	case SSDFS_MAPTBL_DATA_PEB_TYPE:
+		index = SSDFS_USER_DATA_SEG_TYPE;
+		break;
+
 	default:
 		SSDFS_ERR("unexpected PEB type %#x\n",
 			  item->type);
@@ -2863,7 +2882,8 @@ complete_volume_search:
 		env->detection_result.state = SSDFS_FSCK_NO_FILE_SYSTEM_DETECTED;
 		SSDFS_DBG(env->base.show_debug,
 			  "file system hasn't been detected\n");
-	} else if (creation_point->found_metadata ==
+	} else if ((creation_point->found_metadata &
+				SSDFS_FSCK_ALL_CRITICAL_METADATA_FOUND_MASK) ==
 				SSDFS_FSCK_ALL_CRITICAL_METADATA_FOUND_MASK) {
 		env->detection_result.state = SSDFS_FSCK_DEVICE_HAS_FILE_SYSTEM;
 		SSDFS_DBG(env->base.show_debug,
@@ -122,6 +122,9 @@ struct ssdfs_fsck_mapping_table_cache {
 	u32 bytes_count;
 };
 
+/* Metadata map has items for every segment type, user data including */
+#define SSDFS_FSCK_METADATA_MAP_MAX	(SSDFS_LAST_KNOWN_SEG_TYPE + 1)
+
 /*
  * struct ssdfs_fsck_volume_creation_point - volume creation point
  * @found_metadata: found metadata bitmap
@@ -141,7 +144,7 @@ struct ssdfs_fsck_volume_creation_point {
 	struct ssdfs_fsck_segment_bitmap_detection segbmap;
 	struct ssdfs_fsck_mapping_table_detection maptbl;
 	struct ssdfs_fsck_mapping_table_cache maptbl_cache;
-	struct ssdfs_metadata_map metadata_map[SSDFS_LAST_KNOWN_SEG_TYPE];
+	struct ssdfs_metadata_map metadata_map[SSDFS_FSCK_METADATA_MAP_MAX];
 };
 
 enum {
@@ -276,7 +279,7 @@ void ssdfs_fsck_init_metadata_map(struct ssdfs_fsck_volume_creation_point *ptr)
 	struct ssdfs_metadata_map *map;
 	int i;
 
-	for (i = 0; i < SSDFS_LAST_KNOWN_SEG_TYPE; i++) {
+	for (i = 0; i < SSDFS_FSCK_METADATA_MAP_MAX; i++) {
 		map = &ptr->metadata_map[i];
 		map->array = NULL;
 		map->capacity = 0;
@@ -302,7 +305,7 @@ void ssdfs_fsck_destroy_metadata_map(struct ssdfs_fsck_volume_creation_point *pt
 	struct ssdfs_metadata_map *map;
 	int i;
 
-	for (i = 0; i < SSDFS_LAST_KNOWN_SEG_TYPE; i++) {
+	for (i = 0; i < SSDFS_FSCK_METADATA_MAP_MAX; i++) {
 		map = &ptr->metadata_map[i];
 		__ssdfs_fsck_destroy_metadata_map(map);
 	}
@@ -27,6 +27,7 @@
 #include <dirent.h>
 
 #include "ssdfs_tools.h"
+#include "maptbl.h"
 #include "detect_file_system.h"
 
 #define SSDFS_FSCK_INFO(show, fmt, ...) \
@@ -98,36 +99,140 @@ enum {
 #define SSDFS_FSCK_XATTR_BTREE_CORRUPTED			(1 << 11)
 #define SSDFS_FSCK_SHARED_XATTR_BTREE_CORRUPTED			(1 << 12)
 
+/*
+ * struct ssdfs_fsck_base_snapshot_segment_corruption - base snapshot corruption
+ * @state: check result
+ * @invalid_header: is segment header's magic, type or geometry invalid?
+ * @corrupted_header: is segment header's checksum invalid?
+ */
 struct ssdfs_fsck_base_snapshot_segment_corruption {
 	int state;
+	int invalid_header;
+	int corrupted_header;
 };
 
+/*
+ * struct ssdfs_fsck_superblock_segment_corruption - superblock segment corruption
+ * @state: check result
+ * @checked_logs: number of checked full and partial logs
+ * @lost_copies: number of superblock segment's copies without valid log
+ * @invalid_headers: number of log headers with invalid magic or geometry
+ * @corrupted_headers: number of log headers with invalid checksum
+ * @invalid_footers: number of logs with absent or invalid footer
+ * @corrupted_footers: number of log footers with invalid checksum
+ * @broken_chains: number of partial log chains with inconsistent log
+ * @state_mismatches: number of volume state's fields different in copies
+ * @fs_state: file system state of the newest volume state
+ * @is_clean: is volume cleanly unmounted and consistent?
+ */
 struct ssdfs_fsck_superblock_segment_corruption {
 	int state;
+	u32 checked_logs;
+	u32 lost_copies;
+	u32 invalid_headers;
+	u32 corrupted_headers;
+	u32 invalid_footers;
+	u32 corrupted_footers;
+	u32 broken_chains;
+	u32 state_mismatches;
+	u16 fs_state;
+	int is_clean;
 };
 
+/*
+ * struct ssdfs_fsck_mapping_table_corruption - mapping table corruption
+ * @state: check result
+ * @lost_fragments: number of LEB/PEB table fragments without valid copy
+ * @invalid_fragments: number of LEB/PEB table fragments with invalid header
+ * @corrupted_fragments: number of LEB/PEB table fragments with invalid checksum
+ * @compressed_fragments: number of compressed (not checked) fragments
+ * @invalid_counters: number of LEB table fragments with wrong LEBs' counters
+ * @mapped_lebs: number of mapped LEBs
+ * @migrating_lebs: number of LEBs under migration
+ * @invalid_indexes: number of LEB descriptors with invalid PEB index
+ * @duplicate_pebs: number of PEBs mapped or described several times
+ * @invalid_states: number of PEBs with state or type unexpected for mapping
+ * @invalid_migrations: number of inconsistent migration pairs
+ * @bitmap_mismatches: number of PEBs with wrong bit in used PEBs bitmap
+ * @checked_pebs: number of checked metadata PEBs
+ * @peb_mismatches: number of metadata PEBs with different LEB in mapping table
+ * @type_mismatches: number of metadata PEBs with different PEB type
+ * @cache_mismatches: number of mapping table cache's items with different PEB
+ */
 struct ssdfs_fsck_mapping_table_corruption {
 	int state;
+	u32 lost_fragments;
+	u32 invalid_fragments;
+	u32 corrupted_fragments;
+	u32 compressed_fragments;
+	u32 invalid_counters;
+	u64 mapped_lebs;
+	u64 migrating_lebs;
+	u64 invalid_indexes;
+	u64 duplicate_pebs;
+	u64 invalid_states;
+	u64 invalid_migrations;
+	u64 bitmap_mismatches;
+	u64 checked_pebs;
+	u64 peb_mismatches;
+	u64 type_mismatches;
+	u64 cache_mismatches;
 };
 
+/*
+ * struct ssdfs_fsck_segment_bitmap_corruption - segment bitmap corruption
+ * @state: check result
+ * @lost_fragments: number of fragments without any valid copy
+ * @invalid_fragments: number of fragments with invalid header
+ * @corrupted_fragments: number of fragments with invalid checksum
+ * @compressed_fragments: number of compressed (not checked) fragments
+ * @inconsistent_fragments: number of fragments that differ in both copies
+ * @inconsistent_segs: number of segments that differ in both copies
+ * @invalid_counters: number of fragments with wrong states' counters
+ * @invalid_states: number of segments with unknown state
+ * @checked_pebs: number of checked metadata PEBs
+ * @state_mismatches: number of metadata PEBs with unexpected segment state
+ */
 struct ssdfs_fsck_segment_bitmap_corruption {
 	int state;
+	u32 lost_fragments;
+	u32 invalid_fragments;
+	u32 corrupted_fragments;
+	u32 compressed_fragments;
+	u32 inconsistent_fragments;
+	u64 inconsistent_segs;
+	u32 invalid_counters;
+	u64 invalid_states;
+	u64 checked_pebs;
+	u64 state_mismatches;
 };
 
-struct ssdfs_fsck_inodes_btree_corruption {
-	int state;
-};
-
-struct ssdfs_fsck_snapshots_btree_corruption {
-	int state;
-};
-
-struct ssdfs_fsck_invalid_extents_btree_corruption {
-	int state;
-};
-
-struct ssdfs_fsck_shared_dictionary_btree_corruption {
+/*
+ * struct ssdfs_fsck_btree_corruption - b-tree corruption
+ * @state: check result
+ * @height: height of the tree
+ * @checked_nodes: number of checked nodes
+ * @lost_nodes: number of nodes that have not been found on volume
+ * @invalid_nodes: number of nodes (or root node) with invalid header
+ * @corrupted_nodes: number of nodes with invalid checksum
+ * @invalid_keys: number of keys out of order or out of node's range
+ * @invalid_children: number of nodes inconsistent with parent's index
+ * @duplicate_nodes: number of nodes referenced several times
+ * @space_errors: number of nodes with inconsistent areas or free space
+ * @invalid_counters: number of nodes with wrong items' counters
+ */
+struct ssdfs_fsck_btree_corruption {
 	int state;
+	u32 height;
+	u64 checked_nodes;
+	u64 lost_nodes;
+	u64 invalid_nodes;
+	u64 corrupted_nodes;
+	u64 invalid_keys;
+	u64 invalid_children;
+	u64 duplicate_nodes;
+	u64 space_errors;
+	u64 invalid_counters;
 };
 
 struct ssdfs_fsck_corruption_details {
@@ -136,10 +241,10 @@ struct ssdfs_fsck_corruption_details {
 	struct ssdfs_fsck_superblock_segment_corruption superblock_seg;
 	struct ssdfs_fsck_mapping_table_corruption mapping_table;
 	struct ssdfs_fsck_segment_bitmap_corruption segment_bitmap;
-	struct ssdfs_fsck_inodes_btree_corruption inodes_btree;
-	struct ssdfs_fsck_snapshots_btree_corruption snapshots_btree;
-	struct ssdfs_fsck_invalid_extents_btree_corruption invalid_extents;
-	struct ssdfs_fsck_shared_dictionary_btree_corruption shared_dictionary;
+	struct ssdfs_fsck_btree_corruption inodes_btree;
+	struct ssdfs_fsck_btree_corruption snapshots_btree;
+	struct ssdfs_fsck_btree_corruption invalid_extents;
+	struct ssdfs_fsck_btree_corruption shared_dictionary;
 };
 
 struct ssdfs_fsck_check_result {
@@ -147,6 +252,68 @@ struct ssdfs_fsck_check_result {
 	struct ssdfs_fsck_corruption_details corruption;
 };
 
+#define SSDFS_FSCK_LEBTBL_FRAG_COMPR_MASK \
+	(SSDFS_LEBTBL_FRAG_ZLIB_COMPR | SSDFS_LEBTBL_FRAG_LZO_COMPR | \
+	 SSDFS_LEBTBL_FRAG_LZ4_COMPR | SSDFS_LEBTBL_FRAG_ZSTD_COMPR)
+#define SSDFS_FSCK_PEBTBL_FRAG_COMPR_MASK \
+	(SSDFS_PEBTBL_FRAG_ZLIB_COMPR | SSDFS_PEBTBL_FRAG_LZO_COMPR | \
+	 SSDFS_PEBTBL_FRAG_LZ4_COMPR | SSDFS_PEBTBL_FRAG_ZSTD_COMPR)
+
+/*
+ * struct ssdfs_fsck_maptbl_check - mapping table check environment
+ * @env: fsck environment
+ * @creation_point: volume creation point
+ * @copies_count: number of mapping table's copies
+ * @chain: LEB IDs of mapping table's PEBs for every copy
+ * @chain_len: number of LEBs in chain of every copy
+ * @maptbl_pebs: number of PEBs that contain all portions
+ * @portions_count: number of portions in mapping table
+ * @portions_per_peb: number of portions in PEB
+ * @portion_size: size of portion in bytes
+ * @fragments_per_portion: number of LEB/PEB table fragments in portion
+ * @lebtbl_fragments: number of LEB table fragments in portion
+ * @stripes_per_portion: number of PEB table fragments in portion
+ * @lebs_per_portion: number of LEBs described by portion
+ * @pebs_per_portion: number of PEBs described by portion
+ * @lebs_count: number of LEBs in volume
+ * @pebs_count: number of PEBs in volume
+ * @leb2peb: PEB ID of every LEB
+ * @peb2leb: LEB ID of every PEB
+ * @peb_state: state of every PEB
+ * @peb_type: type of every PEB
+ * @peb_flags: role of every PEB in mapping table
+ * @reserved_pebs_pct: percentage of reserved PEBs in PEB table's stripe
+ *
+ * Every portion describes its own range of LEBs and its own
+ * range of PEBs. The LEB descriptor refers to PEB descriptor
+ * of the same portion. As a result, threads that process
+ * different portions never touch the same items of arrays.
+ */
+struct ssdfs_fsck_maptbl_check {
+	struct ssdfs_fsck_environment *env;
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	int copies_count;
+	u64 *chain[SSDFS_MAPTBL_SEG_COPY_MAX];
+	u32 chain_len;
+	u32 maptbl_pebs;
+	u32 portions_count;
+	u16 portions_per_peb;
+	u32 portion_size;
+	u16 fragments_per_portion;
+	u16 lebtbl_fragments;
+	u16 stripes_per_portion;
+	u16 lebs_per_portion;
+	u16 pebs_per_portion;
+	u64 lebs_count;
+	u64 pebs_count;
+	u64 *leb2peb;
+	u64 *peb2leb;
+	u8 *peb_state;
+	u8 *peb_type;
+	u8 *peb_flags;
+	u16 reserved_pebs_pct;
+};
+
 enum {
 	SSDFS_FSCK_NO_RECOVERY_NECCESSARY,
 	SSDFS_FSCK_UNABLE_RECOVER,
@@ -161,8 +328,40 @@ enum {
 	SSDFS_FSCK_UNKNOWN_RECOVERY_RESULT,
 };
 
+/*
+ * struct ssdfs_fsck_mapping_table_recovery - mapping table recovery
+ * @state: recovery result
+ * @check: geometry and rebuilt LEB/PEB arrays of mapping table
+ * @relation: migration destination PEB ID of every LEB
+ * @peb_relation: relation PEB ID of every found PEB
+ * @peb_time: creation timestamp of every found PEB
+ * @found_pebs: number of found PEBs that can be described by mapping table
+ * @mapped_lebs: number of mapped LEBs
+ * @migrating_lebs: number of LEBs under migration
+ * @reserved_pebs: number of mapped PEBs of reserved superblock segments
+ * @conflicts: number of PEBs that refer to already mapped LEB
+ * @stale_pebs: number of PEBs that lost the conflict
+ * @invalid_items: number of found PEBs out of mapping table's portion
+ * @pre_erased_pebs: number of PEBs marked as pre-erased
+ * @written_pebs: number of rewritten mapping table's PEBs
+ * @skipped_pebs: number of mapping table's PEBs that cannot be rewritten
+ */
 struct ssdfs_fsck_mapping_table_recovery {
 	int state;
+	struct ssdfs_fsck_maptbl_check check;
+	u64 *relation;
+	u64 *peb_relation;
+	u64 *peb_time;
+	u64 found_pebs;
+	u64 mapped_lebs;
+	u64 migrating_lebs;
+	u64 reserved_pebs;
+	u64 conflicts;
+	u64 stale_pebs;
+	u64 invalid_items;
+	u64 pre_erased_pebs;
+	u32 written_pebs;
+	u32 skipped_pebs;
 };
 
 struct ssdfs_fsck_segment_bitmap_recovery {
@@ -331,11 +530,20 @@ void ssdfs_wait_threads_activity_ending(struct ssdfs_fsck_environment *env)
 int is_device_contains_ssdfs_volume(struct ssdfs_fsck_environment *env);
 void ssdfs_fsck_init_detection_result(struct ssdfs_fsck_environment *env);
 void ssdfs_fsck_destroy_detection_result(struct ssdfs_fsck_environment *env);
+u64 __ssdfs_maptbl_cache_convert_leb2peb(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_volume_creation_point *creation_point,
+			u64 leb_id);
 
 /* check_file_system.c */
 int is_ssdfs_volume_corrupted(struct ssdfs_fsck_environment *env);
 void ssdfs_fsck_init_check_result(struct ssdfs_fsck_environment *env);
 void ssdfs_fsck_destroy_check_result(struct ssdfs_fsck_environment *env);
+struct ssdfs_fsck_volume_creation_point *
+ssdfs_fsck_get_checked_creation_point(struct ssdfs_fsck_environment *env);
+int ssdfs_fsck_maptbl_init_check(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_volume_creation_point *creation_point,
+			struct ssdfs_fsck_maptbl_check *check);
+void ssdfs_fsck_maptbl_destroy_check(struct ssdfs_fsck_maptbl_check *check);
 
 /* recover_file_system.c */
 int recover_corrupted_ssdfs_volume(struct ssdfs_fsck_environment *env);
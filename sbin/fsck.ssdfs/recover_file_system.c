@@ -12,6 +12,8 @@
  * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
  */
 
+#include <zlib.h>
+
 #include "fsck.h"
 
 enum {
@@ -25,16 +27,33 @@ enum {
 
 void ssdfs_fsck_init_recovery_result(struct ssdfs_fsck_environment *env)
 {
-/* TODO: implement */
 	SSDFS_DBG(env->base.show_debug,
 		  "init recovery result\n");
+
+	memset(&env->recovery_result, 0,
+		sizeof(struct ssdfs_fsck_recovery_result));
+	env->recovery_result.state = SSDFS_FSCK_UNKNOWN_RECOVERY_RESULT;
+}
+
+static
+void ssdfs_fsck_maptbl_destroy_recovery(struct ssdfs_fsck_mapping_table_recovery *recovery)
+{
+	ssdfs_fsck_maptbl_destroy_check(&recovery->check);
+
+	free(recovery->relation);
+	recovery->relation = NULL;
+	free(recovery->peb_relation);
+	recovery->peb_relation = NULL;
+	free(recovery->peb_time);
+	recovery->peb_time = NULL;
 }
 
 void ssdfs_fsck_destroy_recovery_result(struct ssdfs_fsck_environment *env)
 {
-/* TODO: implement */
 	SSDFS_DBG(env->base.show_debug,
 		  "destroy recovery result\n");
+
+	ssdfs_fsck_maptbl_destroy_recovery(&env->recovery_result.details.mapping_table);
 }
 
 typedef int (*recover_fn)(struct ssdfs_fsck_environment *env);
@@ -48,25 +67,642 @@ int is_mapping_table_corrupted(struct ssdfs_fsck_environment *env)
 				SSDFS_FSCK_MAPPING_TABLE_CORRUPTED;
 }
 
+/*
+ * ssdfs_fsck_maptbl_peb_index() - define PEB's descriptor in portion
+ * @check: mapping table's geometry
+ * @peb_id: PEB ID
+ * @portion_index: index of portion that describes PEB [out]
+ * @peb_index: index of PEB's descriptor in portion [out]
+ *
+ * The stripes' headers are prepared by the same method as mkfs
+ * uses. So, the found index is the index of PEB's descriptor in
+ * the rebuilt portion. The percentage of reserved PEBs doesn't
+ * change the range of stripe's PEBs.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - PEB is out of mapping table.
+ */
+static
+int ssdfs_fsck_maptbl_peb_index(struct ssdfs_fsck_maptbl_check *check,
+				u64 peb_id, u16 *portion_index, u16 *peb_index)
+{
+	struct ssdfs_peb_table_fragment_header hdr;
+	u64 portion;
+	u64 start_peb;
+	u16 pebs_count;
+	u16 i;
+
+	if (peb_id >= check->pebs_count)
+		return -ERANGE;
+
+	portion = peb_id / check->pebs_per_portion;
+	if (portion >= check->portions_count)
+		return -ERANGE;
+
+	for (i = 0; i < check->stripes_per_portion; i++) {
+		ssdfs_maptbl_prepare_pebtbl_fragment((u8 *)&hdr,
+					check->pebs_count,
+					check->pebs_per_portion,
+					check->stripes_per_portion,
+					check->reserved_pebs_pct,
+					(u16)portion, i);
+
+		start_peb = le64_to_cpu(hdr.start_peb);
+		pebs_count = le16_to_cpu(hdr.pebs_count);
+
+		if (peb_id >= start_peb && peb_id < (start_peb + pebs_count)) {
+			*portion_index = (u16)portion;
+			*peb_index = DEFINE_PEB_INDEX_IN_PORTION(i,
+						(u16)(peb_id - start_peb));
+			return 0;
+		}
+	}
+
+	return -ERANGE;
+}
+
+/*
+ * is_ssdfs_fsck_maptbl_pair_valid() - check that LEB/PEB pair can be mapped
+ * @check: mapping table's geometry
+ * @leb_id: LEB ID
+ * @peb_id: PEB ID
+ *
+ * LEB descriptor refers to PEB descriptor of the same portion.
+ */
+static
+int is_ssdfs_fsck_maptbl_pair_valid(struct ssdfs_fsck_maptbl_check *check,
+				    u64 leb_id, u64 peb_id)
+{
+	u16 portion_index;
+	u16 peb_index;
+
+	if (leb_id >= check->lebs_count)
+		return SSDFS_FALSE;
+
+	if (ssdfs_fsck_maptbl_peb_index(check, peb_id,
+					&portion_index, &peb_index))
+		return SSDFS_FALSE;
+
+	return (leb_id / check->lebs_per_portion) == portion_index;
+}
+
+static inline
+int is_ssdfs_fsck_peb_newer(struct ssdfs_fsck_mapping_table_recovery *recovery,
+			    u64 peb_id, u64 cur_peb_id)
+{
+	u64 time = recovery->peb_time[peb_id];
+	u64 cur_time = recovery->peb_time[cur_peb_id];
+
+	if (time != cur_time)
+		return time > cur_time;
+
+	return peb_id > cur_peb_id;
+}
+
+/*
+ * ssdfs_fsck_maptbl_add_item() - add found PEB into LEB/PEB arrays
+ * @recovery: mapping table recovery
+ * @item: PEB descriptor found by whole volume search
+ *
+ * If several PEBs refer to the same LEB, then the LEB is mapped
+ * on the PEB with the newest creation timestamp.
+ */
+static
+void ssdfs_fsck_maptbl_add_item(struct ssdfs_fsck_mapping_table_recovery *recovery,
+				struct ssdfs_metadata_peb_item *item)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	u64 leb_id = item->leb_id;
+	u64 peb_id = item->peb_id;
+	u64 cur_peb_id;
+
+	if (item->type <= SSDFS_MAPTBL_UNKNOWN_PEB_TYPE ||
+	    item->type >= SSDFS_MAPTBL_PEB_TYPE_MAX ||
+	    !is_ssdfs_fsck_maptbl_pair_valid(check, leb_id, peb_id)) {
+		SSDFS_DBG(check->env->base.show_debug,
+			  "PEB cannot be mapped: "
+			  "leb_id %llu, peb_id %llu, type %#x\n",
+			  leb_id, peb_id, item->type);
+		recovery->invalid_items++;
+		return;
+	}
+
+	if (check->peb2leb[peb_id] != U64_MAX) {
+		/* PEB has been added already */
+		return;
+	}
+
+	recovery->found_pebs++;
+
+	check->peb2leb[peb_id] = leb_id;
+	check->peb_type[peb_id] = (u8)item->type;
+	recovery->peb_relation[peb_id] = item->relation_peb_id;
+	recovery->peb_time[peb_id] = item->peb_creation_timestamp;
+
+	cur_peb_id = check->leb2peb[leb_id];
+	if (cur_peb_id >= U64_MAX) {
+		check->leb2peb[leb_id] = peb_id;
+		return;
+	}
+
+	SSDFS_DBG(check->env->base.show_debug,
+		  "several PEBs refer to LEB: "
+		  "leb_id %llu, peb_id %llu, peb_id %llu\n",
+		  leb_id, cur_peb_id, peb_id);
+
+	recovery->conflicts++;
+
+	if (is_ssdfs_fsck_peb_newer(recovery, peb_id, cur_peb_id))
+		check->leb2peb[leb_id] = peb_id;
+}
+
+/*
+ * ssdfs_fsck_maptbl_resolve_lebs() - define state of every PEB
+ * @recovery: mapping table recovery
+ *
+ * If the newest PEB of LEB refers to another PEB of the same LEB,
+ * then the LEB is under migration. The referred PEB is the source
+ * and the newest PEB is the destination. Every other found PEB
+ * of LEB is stale.
+ */
+static
+void ssdfs_fsck_maptbl_resolve_lebs(struct ssdfs_fsck_mapping_table_recovery *recovery)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	u64 leb_id, peb_id, src_peb_id;
+
+	for (leb_id = 0; leb_id < check->lebs_count; leb_id++) {
+		peb_id = check->leb2peb[leb_id];
+		if (peb_id >= U64_MAX)
+			continue;
+
+		src_peb_id = recovery->peb_relation[peb_id];
+
+		if (src_peb_id < check->pebs_count && src_peb_id != peb_id &&
+		    check->peb2leb[src_peb_id] == leb_id) {
+			check->leb2peb[leb_id] = src_peb_id;
+			recovery->relation[leb_id] = peb_id;
+			check->peb_state[src_peb_id] =
+				SSDFS_MAPTBL_MIGRATION_SRC_USING_STATE;
+			check->peb_state[peb_id] =
+				SSDFS_MAPTBL_MIGRATION_DST_USING_STATE;
+			recovery->migrating_lebs++;
+		} else {
+			check->peb_state[peb_id] = SSDFS_MAPTBL_USING_PEB_STATE;
+			recovery->mapped_lebs++;
+		}
+	}
+
+	for (peb_id = 0; peb_id < check->pebs_count; peb_id++) {
+		if (check->peb_state[peb_id] != SSDFS_MAPTBL_UNKNOWN_PEB_STATE)
+			continue;
+
+		if (check->peb2leb[peb_id] != U64_MAX) {
+			SSDFS_DBG(check->env->base.show_debug,
+				  "stale PEB: leb_id %llu, peb_id %llu\n",
+				  check->peb2leb[peb_id], peb_id);
+			check->peb2leb[peb_id] = U64_MAX;
+			recovery->stale_pebs++;
+		}
+
+		check->peb_type[peb_id] = SSDFS_MAPTBL_UNKNOWN_PEB_TYPE;
+	}
+}
+
+/*
+ * ssdfs_fsck_maptbl_add_reserved_sb_pebs() - map superblock segments' PEBs
+ * @recovery: mapping table recovery
+ * @vh: volume header
+ *
+ * The PEBs of reserved superblock segments are mapped but
+ * they contain no logs. So, whole volume search cannot find them.
+ */
+static
+void ssdfs_fsck_maptbl_add_reserved_sb_pebs(struct ssdfs_fsck_mapping_table_recovery *recovery,
+					    struct ssdfs_volume_header *vh)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	u64 leb_id, peb_id;
+	int i, j;
+
+	for (i = 0; i < SSDFS_SB_CHAIN_MAX; i++) {
+		for (j = 0; j < SSDFS_SB_SEG_COPY_MAX; j++) {
+			leb_id = le64_to_cpu(vh->sb_pebs[i][j].leb_id);
+			peb_id = le64_to_cpu(vh->sb_pebs[i][j].peb_id);
+
+			if (!is_ssdfs_fsck_maptbl_pair_valid(check,
+							     leb_id, peb_id))
+				continue;
+
+			if (check->leb2peb[leb_id] != U64_MAX ||
+			    check->peb_state[peb_id] !=
+					SSDFS_MAPTBL_UNKNOWN_PEB_STATE)
+				continue;
+
+			check->leb2peb[leb_id] = peb_id;
+			check->peb2leb[peb_id] = leb_id;
+			check->peb_type[peb_id] = SSDFS_MAPTBL_SBSEG_PEB_TYPE;
+			check->peb_state[peb_id] = SSDFS_MAPTBL_USING_PEB_STATE;
+			recovery->reserved_pebs++;
+			recovery->mapped_lebs++;
+		}
+	}
+}
+
+static
+struct ssdfs_volume_header *
+ssdfs_fsck_get_recovery_volume_header(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_volume_creation_point *creation_point)
+{
+	struct ssdfs_fsck_found_log *log;
+
+	log = &creation_point->superblock_seg.logs[SSDFS_MAIN_SB_SEG];
+
+	if (log->peb_id < U64_MAX &&
+	    le16_to_cpu(log->header.magic.key) == SSDFS_SEGMENT_HDR_MAGIC)
+		return &log->header.seg_hdr.volume_hdr;
+
+	return &env->detection_result.found_valid_peb.seg_hdr.volume_hdr;
+}
+
+/*
+ * ssdfs_fsck_maptbl_chain_peb_id() - define PEB of mapping table's chain
+ * @recovery: mapping table recovery
+ * @copy_index: copy index (main or backup)
+ * @peb_index: index of PEB in mapping table's chain
+ *
+ * The PEB is taken from the rebuilt LEB/PEB arrays (the migration
+ * destination has priority) or from the mapping table cache.
+ * U64_MAX means that PEB is unknown.
+ */
+static
+u64 ssdfs_fsck_maptbl_chain_peb_id(struct ssdfs_fsck_mapping_table_recovery *recovery,
+				   int copy_index, u32 peb_index)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	u64 leb_id;
+	u64 peb_id = U64_MAX;
+
+	if (peb_index >= check->chain_len)
+		return U64_MAX;
+
+	leb_id = check->chain[copy_index][peb_index];
+
+	if (leb_id < check->lebs_count) {
+		peb_id = recovery->relation[leb_id];
+		if (peb_id >= U64_MAX)
+			peb_id = check->leb2peb[leb_id];
+	}
+
+	if (peb_id >= U64_MAX) {
+		peb_id = __ssdfs_maptbl_cache_convert_leb2peb(check->env,
+							check->creation_point,
+							leb_id);
+	}
+
+	return peb_id;
+}
+
+/*
+ * ssdfs_fsck_maptbl_read_log_header() - read header of mapping table's log
+ * @env: fsck environment
+ * @leb_id: LEB ID of mapping table's PEB
+ * @peb_id: PEB ID
+ * @hdr: buffer for the header [out]
+ * @log_end: page aligned end of the log [out]
+ *
+ * The first log of PEB is expected to be the log of mapping table
+ * with payload. The end of the log is defined by the farthest
+ * area of the header's descriptors.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - PEB doesn't contain log of mapping table.
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_fsck_maptbl_read_log_header(struct ssdfs_fsck_environment *env,
+				      u64 leb_id, u64 peb_id,
+				      union ssdfs_metadata_header *hdr,
+				      u32 *log_end)
+{
+	struct ssdfs_metadata_descriptor *desc;
+	u32 peb_size = env->base.erase_size;
+	u32 page_size = env->base.page_size;
+	u32 end = 0;
+	int i;
+	int err;
+
+	err = ssdfs_read_segment_header(&env->base, peb_id, peb_size,
+					0, sizeof(*hdr), hdr);
+	if (err) {
+		SSDFS_ERR("fail to read log header: "
+			  "peb_id %llu, err %d\n",
+			  peb_id, err);
+		return err;
+	}
+
+	if (le32_to_cpu(hdr->magic.common) != SSDFS_SUPER_MAGIC ||
+	    le16_to_cpu(hdr->magic.key) != SSDFS_SEGMENT_HDR_MAGIC ||
+	    le16_to_cpu(hdr->seg_hdr.seg_type) != SSDFS_MAPTBL_SEG_TYPE ||
+	    le64_to_cpu(hdr->seg_hdr.leb_id) != leb_id) {
+		SSDFS_DBG(env->base.show_debug,
+			  "PEB doesn't contain mapping table's log: "
+			  "leb_id %llu, peb_id %llu\n",
+			  leb_id, peb_id);
+		return -ENODATA;
+	}
+
+	for (i = 0; i < SSDFS_SEG_HDR_DESC_MAX; i++) {
+		desc = &hdr->seg_hdr.desc_array[i];
+
+		if (!is_ssdfs_fsck_area_valid(desc))
+			continue;
+
+		end = max_t(u32, end,
+			    le32_to_cpu(desc->offset) +
+			    le32_to_cpu(desc->size));
+	}
+
+	end = ((end + page_size - 1) / page_size) * page_size;
+
+	desc = &hdr->seg_hdr.desc_array[SSDFS_COLD_PAYLOAD_AREA_INDEX];
+
+	if (!is_ssdfs_fsck_area_valid(desc) || end > peb_size) {
+		SSDFS_DBG(env->base.show_debug,
+			  "unexpected log: peb_id %llu, log_end %u\n",
+			  peb_id, end);
+		return -ENODATA;
+	}
+
+	*log_end = end;
+	return 0;
+}
+
+/*
+ * ssdfs_fsck_maptbl_define_reserved_pebs() - define reserved PEBs percentage
+ * @recovery: mapping table recovery
+ *
+ * mkfs defines the number of reserved PEBs of every stripe
+ * as percentage of stripe's PEBs, but the percentage is not stored
+ * in the volume header. So, it is taken from the first PEB table's
+ * fragment of every mapping table's PEB that has valid checksum.
+ * The percentage has to be consistent with every found fragment.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - percentage cannot be defined.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_fsck_maptbl_define_reserved_pebs(struct ssdfs_fsck_mapping_table_recovery *recovery)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	union ssdfs_metadata_header hdr;
+	struct ssdfs_metadata_descriptor *desc;
+	struct ssdfs_peb_table_fragment_header *pebtbl_hdr;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
+	u32 page_size = env->base.page_size;
+	u32 stripe_offset = (u32)check->lebtbl_fragments * page_size;
+	u32 pct_min = 0;
+	u32 pct_max = 100;
+	u32 found = 0;
+	u8 *buf;
+	u32 i;
+	int j;
+	int err = 0;
+
+	buf = malloc(page_size);
+	if (!buf) {
+		SSDFS_ERR("fail to allocate memory: "
+			  "page_size %u\n", page_size);
+		return -ENOMEM;
+	}
+
+	pebtbl_hdr = (struct ssdfs_peb_table_fragment_header *)buf;
+
+	for (j = 0; j < check->copies_count; j++) {
+		for (i = 0; i < check->chain_len; i++) {
+			u64 leb_id = check->chain[j][i];
+			u64 peb_id;
+			u32 log_end;
+			u32 bytes_count;
+			u32 reserved_pebs;
+			u16 pebs_count;
+			__le32 csum;
+
+			peb_id = ssdfs_fsck_maptbl_chain_peb_id(recovery,
+								 j, i);
+			if (peb_id >= check->pebs_count)
+				continue;
+
+			err = ssdfs_fsck_maptbl_read_log_header(env, leb_id,
+								peb_id, &hdr,
+								&log_end);
+			if (err == -ENODATA) {
+				err = 0;
+				continue;
+			} else if (err)
+				goto free_buffer;
+
+			desc = &hdr.seg_hdr.desc_array[SSDFS_COLD_PAYLOAD_AREA_INDEX];
+
+			if (le32_to_cpu(desc->size) < (stripe_offset + hdr_size))
+				continue;
+
+			err = env->base.dev_ops->read(env->base.fd,
+					(peb_id * env->base.erase_size) +
+					le32_to_cpu(desc->offset) +
+					stripe_offset,
+					page_size, buf,
+					env->base.show_debug);
+			if (err) {
+				SSDFS_ERR("fail to read PEB table's fragment: "
+					  "peb_id %llu, err %d\n",
+					  peb_id, err);
+				goto free_buffer;
+			}
+
+			pebs_count = le16_to_cpu(pebtbl_hdr->pebs_count);
+			reserved_pebs = le16_to_cpu(pebtbl_hdr->reserved_pebs);
+			bytes_count = le32_to_cpu(pebtbl_hdr->bytes_count);
+
+			if (le16_to_cpu(pebtbl_hdr->magic) !=
+						SSDFS_PEB_TABLE_MAGIC ||
+			    pebtbl_hdr->flags &
+					SSDFS_FSCK_PEBTBL_FRAG_COMPR_MASK ||
+			    bytes_count != (hdr_size + (pebs_count * desc_size)) ||
+			    bytes_count > page_size ||
+			    pebs_count == 0 || reserved_pebs > pebs_count)
+				continue;
+
+			csum = pebtbl_hdr->checksum;
+			pebtbl_hdr->checksum = 0;
+			if (csum != ssdfs_crc32_le(buf, bytes_count))
+				continue;
+
+			/* reserved_pebs = (pebs_count * pct) / 100 */
+			pct_min = max_t(u32, pct_min,
+					((reserved_pebs * 100) +
+						pebs_count - 1) / pebs_count);
+			pct_max = min_t(u32, pct_max,
+					(((reserved_pebs + 1) * 100) - 1) /
+								pebs_count);
+			found++;
+		}
+	}
+
+	SSDFS_DBG(env->base.show_debug,
+		  "found fragments %u, pct_min %u, pct_max %u\n",
+		  found, pct_min, pct_max);
+
+	if (found == 0 || pct_min > pct_max) {
+		err = -ENODATA;
+		goto free_buffer;
+	}
+
+	check->reserved_pebs_pct = (u16)pct_min;
+
+free_buffer:
+	free(buf);
+	return err;
+}
+
+/*
+ * ssdfs_fsck_recover_mapping_table() - rebuild mapping table
+ * @env: fsck environment
+ *
+ * The LEB/PEB arrays are rebuilt by means of the metadata PEBs map
+ * of whole volume search. Segment header of every found PEB defines
+ * the LEB and the type of PEB. Conflicting PEBs are resolved by
+ * the newest creation timestamp. Every PEB that is not mapped
+ * is treated as pre-erased one.
+ */
 static
 int ssdfs_fsck_recover_mapping_table(struct ssdfs_fsck_environment *env)
 {
+	struct ssdfs_fsck_mapping_table_recovery *recovery;
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_maptbl_check *check;
+	struct ssdfs_metadata_map *map;
+	u64 peb_id;
+	int i, j;
+	int err;
+
+	recovery = &env->recovery_result.details.mapping_table;
+	check = &recovery->check;
+
 	if (!is_mapping_table_corrupted(env)) {
 		SSDFS_DBG(env->base.show_debug,
 			  "Mapping table is not corrupted. "
 			  "No recovery necessary.\n");
-		return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
+		recovery->state = SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
+		return recovery->state;
 	}
 
 	SSDFS_DBG(env->base.show_debug,
 		  "Try to recover mapping table\n");
 
-/* TODO: implement */
+	creation_point = ssdfs_fsck_get_checked_creation_point(env);
+
+	if (!creation_point ||
+	    !(creation_point->found_metadata &
+				SSDFS_FSCK_MAPPING_TBL_FOUND)) {
+		SSDFS_DBG(env->base.show_debug,
+			  "mapping table has not been found\n");
+		recovery->state = SSDFS_FSCK_UNABLE_RECOVER_RESULT;
+		goto finish_recovery;
+	}
+
+	if (!(creation_point->found_metadata &
+				SSDFS_FSCK_METADATA_PEB_MAP_PREPARED)) {
+		SSDFS_FSCK_INFO(env->base.show_info,
+				"Mapping table can be rebuilt "
+				"by whole volume search only. "
+				"Please, use --force option.\n");
+		recovery->state = SSDFS_FSCK_UNABLE_RECOVER_RESULT;
+		goto finish_recovery;
+	}
+
+	err = ssdfs_fsck_maptbl_init_check(env, creation_point, check);
+	if (err == -EINVAL) {
+		recovery->state = SSDFS_FSCK_UNABLE_RECOVER_RESULT;
+		goto destroy_recovery;
+	} else if (err) {
+		recovery->state = SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+		goto destroy_recovery;
+	}
 
+	recovery->relation = malloc(check->lebs_count * sizeof(u64));
+	recovery->peb_relation = malloc(check->pebs_count * sizeof(u64));
+	recovery->peb_time = calloc(check->pebs_count, sizeof(u64));
+
+	if (!recovery->relation || !recovery->peb_relation ||
+	    !recovery->peb_time) {
+		SSDFS_ERR("fail to allocate memory: "
+			  "lebs_count %llu, pebs_count %llu\n",
+			  check->lebs_count, check->pebs_count);
+		recovery->state = SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+		goto destroy_recovery;
+	}
+
+	memset(recovery->relation, 0xFF, check->lebs_count * sizeof(u64));
+	memset(recovery->peb_relation, 0xFF, check->pebs_count * sizeof(u64));
+
+	for (i = 0; i < SSDFS_FSCK_METADATA_MAP_MAX; i++) {
+		map = &creation_point->metadata_map[i];
+
+		for (j = 0; j < map->count; j++)
+			ssdfs_fsck_maptbl_add_item(recovery, &map->array[j]);
+	}
+
+	ssdfs_fsck_maptbl_resolve_lebs(recovery);
+	ssdfs_fsck_maptbl_add_reserved_sb_pebs(recovery,
+		ssdfs_fsck_get_recovery_volume_header(env, creation_point));
+
+	err = ssdfs_fsck_maptbl_define_reserved_pebs(recovery);
+	if (err == -ENODATA) {
+		SSDFS_FSCK_INFO(env->base.show_info,
+				"Mapping table cannot be rebuilt: "
+				"percentage of reserved PEBs is unknown.\n");
+		recovery->state = SSDFS_FSCK_UNABLE_RECOVER_RESULT;
+		goto destroy_recovery;
+	} else if (err) {
+		recovery->state = SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+		goto destroy_recovery;
+	}
+
+	for (peb_id = 0; peb_id < check->pebs_count; peb_id++) {
+		if (check->peb_state[peb_id] == SSDFS_MAPTBL_UNKNOWN_PEB_STATE)
+			recovery->pre_erased_pebs++;
+	}
+
+	if (recovery->invalid_items > 0)
+		recovery->state = SSDFS_FSCK_PARTIAL_RECOVER_RESULT;
+	else
+		recovery->state = SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
+
+	goto finish_recovery;
+
+destroy_recovery:
+	ssdfs_fsck_maptbl_destroy_recovery(recovery);
+
+finish_recovery:
 	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+		  "finished: state %#x\n",
+		  recovery->state);
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return recovery->state;
 }
 
 static inline
@@ -94,7 +730,7 @@ int ssdfs_fsck_recover_segment_bitmap(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_UNABLE_RECOVER_RESULT;
 }
 
 static inline
@@ -122,7 +758,7 @@ int ssdfs_fsck_recover_inodes_btree(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_UNABLE_RECOVER_RESULT;
 }
 
 static inline
@@ -150,7 +786,7 @@ int ssdfs_fsck_recover_shared_dictionary(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_UNABLE_RECOVER_RESULT;
 }
 
 static inline
@@ -178,7 +814,7 @@ int ssdfs_fsck_recover_snapshots_btree(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_UNABLE_RECOVER_RESULT;
 }
 
 static inline
@@ -206,7 +842,7 @@ int ssdfs_fsck_recover_invalid_extents_btree(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_UNABLE_RECOVER_RESULT;
 }
 
 static inline
@@ -234,7 +870,7 @@ int ssdfs_fsck_recover_superblock_segment(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_UNABLE_RECOVER_RESULT;
 }
 
 static inline
@@ -262,7 +898,7 @@ int ssdfs_fsck_recover_base_snapshot_segment(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_UNABLE_RECOVER_RESULT;
 }
 
 enum {
@@ -291,15 +927,44 @@ static recover_fn recover_actions[SSDFS_FSCK_RECOVER_FUNCTION_MAX] = {
 static
 int ssdfs_fsck_explain_mapping_table_recovery(struct ssdfs_fsck_environment *env)
 {
+	struct ssdfs_fsck_mapping_table_recovery *recovery;
+
 	SSDFS_DBG(env->base.show_debug,
 		  "Explain mapping table recovery result\n");
 
-/* TODO: implement */
+	recovery = &env->recovery_result.details.mapping_table;
+
+	if (!is_mapping_table_corrupted(env))
+		goto finish_explain;
+
+	switch (recovery->state) {
+	case SSDFS_FSCK_RECOVER_RESULT_SUCCESS:
+	case SSDFS_FSCK_PARTIAL_RECOVER_RESULT:
+		SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+				"mapping table has been rebuilt: "
+				"found PEBs %llu, mapped LEBs %llu, "
+				"migrating LEBs %llu, reserved PEBs %llu, "
+				"conflicts %llu, stale PEBs %llu, "
+				"invalid PEBs %llu, pre-erased PEBs %llu\n",
+				recovery->found_pebs, recovery->mapped_lebs,
+				recovery->migrating_lebs,
+				recovery->reserved_pebs,
+				recovery->conflicts, recovery->stale_pebs,
+				recovery->invalid_items,
+				recovery->pre_erased_pebs);
+		break;
 
+	default:
+		SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+				"mapping table cannot be rebuilt\n");
+		break;
+	}
+
+finish_explain:
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -313,7 +978,7 @@ int ssdfs_fsck_explain_segment_bitmap_recovery(struct ssdfs_fsck_environment *en
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -327,7 +992,7 @@ int ssdfs_fsck_explain_inodes_btree_recovery(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -341,7 +1006,7 @@ int ssdfs_fsck_explain_shared_dictionary_recovery(struct ssdfs_fsck_environment
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -355,7 +1020,7 @@ int ssdfs_fsck_explain_snapshots_btree_recovery(struct ssdfs_fsck_environment *e
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -369,7 +1034,7 @@ int ssdfs_fsck_explain_invalid_extents_btree_recovery(struct ssdfs_fsck_environm
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -383,7 +1048,7 @@ int ssdfs_fsck_explain_superblock_segment_recovery(struct ssdfs_fsck_environment
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -397,7 +1062,7 @@ int ssdfs_fsck_explain_base_snapshot_segment_recovery(struct ssdfs_fsck_environm
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static explain_recovery_fn explain_actions[SSDFS_FSCK_RECOVER_FUNCTION_MAX] = {
@@ -411,33 +1076,972 @@ static explain_recovery_fn explain_actions[SSDFS_FSCK_RECOVER_FUNCTION_MAX] = {
 /* 07 */	ssdfs_fsck_explain_base_snapshot_segment_recovery,
 };
 
+/*
+ * ssdfs_fsck_summarize_recovery_result() - summarize recovery result
+ * @env: fsck environment
+ *
+ * The volume is recovered if every corrupted metadata structure
+ * has been rebuilt completely. Metadata are partially lost if
+ * some corrupted metadata structures cannot be rebuilt.
+ */
 static
 int ssdfs_fsck_summarize_recovery_result(struct ssdfs_fsck_environment *env)
 {
+	struct ssdfs_fsck_recovery_details *details;
+	u64 unrecovered = env->check_result.corruption.mask;
+	int recovered = 0;
+
 	SSDFS_DBG(env->base.show_debug,
 		  "Summarize recovery result\n");
 
-/* TODO: implement */
+	details = &env->recovery_result.details;
+
+	if (is_mapping_table_corrupted(env)) {
+		switch (details->mapping_table.state) {
+		case SSDFS_FSCK_RECOVER_RESULT_SUCCESS:
+			unrecovered &= ~SSDFS_FSCK_MAPPING_TABLE_CORRUPTED;
+			recovered++;
+			break;
+
+		case SSDFS_FSCK_PARTIAL_RECOVER_RESULT:
+			recovered++;
+			break;
+
+		default:
+			/* mapping table has not been rebuilt */
+			break;
+		}
+	}
 
 	SSDFS_DBG(env->base.show_debug,
-		  "finished\n");
+		  "finished: recovered %d, unrecovered %#llx\n",
+		  recovered, unrecovered);
+
+	if (recovered == 0)
+		return SSDFS_FSCK_UNABLE_RECOVER;
+	else if (unrecovered == 0)
+		return SSDFS_FSCK_RECOVERY_SUCCESS;
+
+	return SSDFS_FSCK_METADATA_PARTIALLY_LOST;
+}
+
+/*
+ * struct ssdfs_fsck_maptbl_write_job - mapping table write's thread
+ * @recovery: mapping table recovery
+ * @thread: thread descriptor
+ * @id: thread ID
+ * @err: code of error
+ * @start: first mapping table's PEB of thread
+ * @count: number of mapping table's PEBs of thread
+ * @open_zones: number of open zones
+ * @payload: rebuilt portions of processed PEB
+ * @log: buffer of processed PEB's log
+ * @verify: buffer for read back of written log
+ * @erase_buf: buffer for erase operation
+ * @written_pebs: number of rewritten PEBs
+ * @skipped_pebs: number of PEBs that cannot be rewritten
+ */
+struct ssdfs_fsck_maptbl_write_job {
+	struct ssdfs_fsck_mapping_table_recovery *recovery;
+	pthread_t thread;
+	int id;
+	int err;
+	u32 start;
+	u32 count;
+	u32 open_zones;
+	u8 *payload;
+	u8 *log;
+	u8 *verify;
+	void *erase_buf;
+	u32 written_pebs;
+	u32 skipped_pebs;
+};
+
+static
+void ssdfs_fsck_maptbl_build_stripe(struct ssdfs_fsck_maptbl_check *check,
+				    u8 *pebtbl)
+{
+	struct ssdfs_peb_table_fragment_header *hdr;
+	u64 start_peb;
+	u16 pebs_count;
+	u16 i, count;
+
+	hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
+	start_peb = le64_to_cpu(hdr->start_peb);
+	pebs_count = le16_to_cpu(hdr->pebs_count);
+
+	for (i = 0; i < pebs_count; i += count) {
+		u64 peb_id = start_peb + i;
+		u8 state = check->peb_state[peb_id];
+		u8 type = check->peb_type[peb_id];
+
+		for (count = 1; (i + count) < pebs_count; count++) {
+			if (check->peb_state[peb_id + count] != state ||
+			    check->peb_type[peb_id + count] != type)
+				break;
+		}
+
+		if (state == SSDFS_MAPTBL_UNKNOWN_PEB_STATE) {
+			ssdfs_maptbl_define_pebs_as_pre_erased(pebtbl,
+								i, count);
+		} else {
+			ssdfs_maptbl_define_pebs_as_used(pebtbl, i, count,
+							 type, state);
+		}
+	}
+}
+
+static
+void ssdfs_fsck_maptbl_build_lebtbl(struct ssdfs_fsck_mapping_table_recovery *recovery,
+				    u8 *lebtbl)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	struct ssdfs_leb_table_fragment_header *hdr;
+	u64 start_leb;
+	u16 lebs_count;
+	u16 portion_index;
+	u16 physical_index, relation_index, index;
+	u16 i, count;
+	int err;
+
+	hdr = (struct ssdfs_leb_table_fragment_header *)lebtbl;
+	start_leb = le64_to_cpu(hdr->start_leb);
+	lebs_count = le16_to_cpu(hdr->lebs_count);
+
+	for (i = 0; i < lebs_count; i += count) {
+		u64 leb_id = start_leb + i;
+		u64 peb_id = check->leb2peb[leb_id];
+
+		count = 1;
+
+		if (peb_id >= U64_MAX)
+			continue;
+
+		err = ssdfs_fsck_maptbl_peb_index(check, peb_id,
+						  &portion_index,
+						  &physical_index);
+		BUG_ON(err);
+
+		if (recovery->relation[leb_id] < U64_MAX) {
+			err = ssdfs_fsck_maptbl_peb_index(check,
+						recovery->relation[leb_id],
+						&portion_index,
+						&relation_index);
+			BUG_ON(err);
+
+			ssdfs_maptbl_define_leb_as_migrating(lebtbl, i,
+							     physical_index,
+							     relation_index);
+			continue;
+		}
+
+		for (; (i + count) < lebs_count; count++) {
+			u64 next_peb_id = check->leb2peb[leb_id + count];
+
+			if (next_peb_id != (peb_id + count) ||
+			    recovery->relation[leb_id + count] < U64_MAX)
+				break;
+
+			err = ssdfs_fsck_maptbl_peb_index(check, next_peb_id,
+							  &portion_index,
+							  &index);
+			if (err || index != (physical_index + count))
+				break;
+		}
+
+		ssdfs_maptbl_define_lebs_as_mapped(lebtbl, i,
+						   physical_index, count);
+	}
+}
+
+/*
+ * ssdfs_fsck_maptbl_build_portion() - rebuild portion of mapping table
+ * @recovery: mapping table recovery
+ * @ptr: buffer of portion
+ * @portion_index: index of portion
+ *
+ * The headers of fragments are prepared by the same methods as
+ * mkfs uses. The percentage of reserved PEBs is the one found
+ * in surviving PEB table's fragments. The sequences of PEBs with the same state and type
+ * and the sequences of LEBs that are mapped on the sequence of PEBs
+ * are defined by one call.
+ */
+static
+void ssdfs_fsck_maptbl_build_portion(struct ssdfs_fsck_mapping_table_recovery *recovery,
+				     u8 *ptr, u16 portion_index)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	u32 page_size = check->env->base.page_size;
+	u8 *pebtbl = ptr + ((size_t)check->lebtbl_fragments * page_size);
+	u16 i;
+
+	for (i = 0; i < check->lebtbl_fragments; i++) {
+		ssdfs_maptbl_prepare_lebtbl_fragment(ptr + ((size_t)i * page_size),
+						     check->lebs_count,
+						     check->lebs_per_portion,
+						     portion_index, i);
+	}
+
+	for (i = 0; i < check->stripes_per_portion; i++) {
+		u8 *stripe = pebtbl + ((size_t)i * page_size);
+
+		ssdfs_maptbl_prepare_pebtbl_fragment(stripe,
+					check->pebs_count,
+					check->pebs_per_portion,
+					check->stripes_per_portion,
+					check->reserved_pebs_pct,
+					portion_index, i);
+		ssdfs_fsck_maptbl_build_stripe(check, stripe);
+		ssdfs_maptbl_calculate_pebtbl_checksum(stripe);
+	}
+
+	for (i = 0; i < check->lebtbl_fragments; i++) {
+		u8 *lebtbl = ptr + ((size_t)i * page_size);
+
+		ssdfs_fsck_maptbl_build_lebtbl(recovery, lebtbl);
+		ssdfs_maptbl_calculate_lebtbl_checksum(lebtbl);
+	}
+}
+
+/*
+ * ssdfs_fsck_maptbl_rewrite_log() - replace payload of mapping table's log
+ * @job: thread of mapping table write
+ * @leb_id: LEB ID of mapping table's PEB
+ * @peb_id: PEB ID
+ * @payload_size: size of rebuilt payload in bytes
+ *
+ * The PEB is expected to contain only one log (mkfs creates
+ * the mapping table in this way). If any log follows the first
+ * one, the PEB is not rewritten because the erase would lose the
+ * later logs. The payload of the first log is replaced by rebuilt
+ * portions. The log footer doesn't describe the payload, so only
+ * checksums of payload's descriptor and segment header are
+ * recalculated. The PEB is erased, the log is written from the PEB's
+ * beginning and, finally, the written log is read back and compared.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - PEB doesn't contain single log of mapping table.
+ * %-EIO        - I/O error or written log is not confirmed.
+ */
+static
+int ssdfs_fsck_maptbl_rewrite_log(struct ssdfs_fsck_maptbl_write_job *job,
+				  u64 leb_id, u64 peb_id, u32 payload_size)
+{
+	struct ssdfs_fsck_environment *env = job->recovery->check.env;
+	union ssdfs_metadata_header *hdr;
+	struct ssdfs_metadata_descriptor *desc;
+	struct ssdfs_nand_geometry info = {
+		.erasesize = env->base.erase_size,
+		.writesize = env->base.page_size,
+	};
+	u32 peb_size = env->base.erase_size;
+	u32 page_size = env->base.page_size;
+	u64 offset = peb_id * peb_size;
+	u32 area_offset;
+	u32 log_end = 0;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "leb_id %llu, peb_id %llu, payload_size %u\n",
+		  leb_id, peb_id, payload_size);
+
+	hdr = (union ssdfs_metadata_header *)job->log;
+
+	err = ssdfs_fsck_maptbl_read_log_header(env, leb_id, peb_id,
+						hdr, &log_end);
+	if (err)
+		return err;
+
+	desc = &hdr->seg_hdr.desc_array[SSDFS_COLD_PAYLOAD_AREA_INDEX];
+
+	if (le32_to_cpu(desc->size) != payload_size) {
+		SSDFS_DBG(env->base.show_debug,
+			  "unexpected payload: peb_id %llu, "
+			  "size %u, payload_size %u\n",
+			  peb_id, le32_to_cpu(desc->size),
+			  payload_size);
+		return -ENODATA;
+	}
+
+	if ((log_end + page_size) <= peb_size) {
+		struct ssdfs_signature *magic;
+
+		err = env->base.dev_ops->read(env->base.fd, offset + log_end,
+					      page_size, job->verify,
+					      env->base.show_debug);
+		if (err) {
+			SSDFS_ERR("fail to read page after log: "
+				  "peb_id %llu, log_end %u, err %d\n",
+				  peb_id, log_end, err);
+			return err;
+		}
+
+		magic = (struct ssdfs_signature *)job->verify;
+
+		if (le32_to_cpu(magic->common) == SSDFS_SUPER_MAGIC) {
+			SSDFS_DBG(env->base.show_debug,
+				  "PEB contains several logs: "
+				  "peb_id %llu, log_end %u\n",
+				  peb_id, log_end);
+			return -ENODATA;
+		}
+	}
+
+	area_offset = le32_to_cpu(desc->offset);
+
+	err = env->base.dev_ops->read(env->base.fd, offset, log_end,
+				      job->log, env->base.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to read log: "
+			  "peb_id %llu, size %u, err %d\n",
+			  peb_id, log_end, err);
+		return err;
+	}
+
+	memcpy(job->log + area_offset, job->payload, payload_size);
+
+	desc->check.bytes = cpu_to_le16(min_t(u32, payload_size,
+					      PAGE_CACHE_SIZE));
+	desc->check.flags = cpu_to_le16(SSDFS_CRC32);
+
+	err = ssdfs_calculate_csum(&desc->check, job->payload, payload_size);
+	if (err)
+		return -ENODATA;
+
+	err = ssdfs_calculate_csum(&hdr->seg_hdr.volume_hdr.check,
+				   hdr, log_end);
+	if (err)
+		return -ENODATA;
+
+	err = env->base.dev_ops->erase(env->base.fd, offset, peb_size,
+					job->erase_buf, SSDFS_128KB,
+					env->base.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to erase PEB: "
+			  "peb_id %llu, err %d\n",
+			  peb_id, err);
+		return err;
+	}
+
+	err = env->base.dev_ops->write(env->base.fd, &info, offset, log_end,
+					job->log, &job->open_zones,
+					env->base.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to write log: "
+			  "peb_id %llu, size %u, err %d\n",
+			  peb_id, log_end, err);
+		return err;
+	}
+
+	err = env->base.dev_ops->read(env->base.fd, offset, log_end,
+				      job->verify, env->base.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to read written log: "
+			  "peb_id %llu, size %u, err %d\n",
+			  peb_id, log_end, err);
+		return err;
+	}
+
+	if (memcmp(job->verify, job->log, log_end) != 0) {
+		SSDFS_ERR("written log is not confirmed: "
+			  "peb_id %llu, size %u\n",
+			  peb_id, log_end);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_fsck_maptbl_write_peb() - write rebuilt portions of PEB
+ * @job: thread of mapping table write
+ * @peb_index: index of PEB in mapping table's chain
+ *
+ * Every copy is rewritten in place. So, the backup copy is written
+ * at first and the main copy is touched only after the backup copy
+ * has been written and confirmed by read back. If an error happens
+ * in the middle of the main copy's rewrite, then the backup copy
+ * keeps the rebuilt portions. If there is no confirmed backup copy
+ * (mapping table has no copy or the backup PEB cannot be rewritten),
+ * then the main copy is the only copy of the portions and it is
+ * rewritten only if user has confirmed it by the -y option.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_fsck_maptbl_write_peb(struct ssdfs_fsck_maptbl_write_job *job,
+				u32 peb_index)
+{
+	struct ssdfs_fsck_mapping_table_recovery *recovery = job->recovery;
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	struct ssdfs_fsck_environment *env = check->env;
+	u32 start_portion = peb_index * check->portions_per_peb;
+	u32 portions;
+	int has_backup = SSDFS_FALSE;
+	u32 i;
+	int j;
+	int err;
+
+	if (peb_index >= check->chain_len)
+		return 0;
+
+	portions = min_t(u32, check->portions_per_peb,
+			 check->portions_count - start_portion);
+
+	memset(job->payload, 0,
+		(size_t)check->portions_per_peb * check->portion_size);
+
+	for (i = 0; i < portions; i++) {
+		ssdfs_fsck_maptbl_build_portion(recovery,
+				job->payload + ((size_t)i * check->portion_size),
+				(u16)(start_portion + i));
+	}
+
+	for (j = check->copies_count - 1; j >= 0; j--) {
+		u64 leb_id = check->chain[j][peb_index];
+		u64 peb_id;
+
+		peb_id = ssdfs_fsck_maptbl_chain_peb_id(recovery, j,
+							 peb_index);
+		if (peb_id >= U64_MAX) {
+			SSDFS_DBG(env->base.show_debug,
+				  "unknown PEB: leb_id %llu\n",
+				  leb_id);
+			job->skipped_pebs++;
+			continue;
+		}
+
+		if (j == SSDFS_MAIN_MAPTBL_SEG && !has_backup &&
+		    !env->yes_all_questions) {
+			SSDFS_DBG(env->base.show_debug,
+				  "main copy has no backup: "
+				  "leb_id %llu, peb_id %llu\n",
+				  leb_id, peb_id);
+			job->skipped_pebs++;
+			continue;
+		}
+
+		err = ssdfs_fsck_maptbl_rewrite_log(job, leb_id, peb_id,
+					portions * check->portion_size);
+		if (err == -ENODATA) {
+			job->skipped_pebs++;
+			continue;
+		} else if (err)
+			return err;
+
+		if (j != SSDFS_MAIN_MAPTBL_SEG)
+			has_backup = SSDFS_TRUE;
+
+		job->written_pebs++;
+	}
+
+	return 0;
+}
+
+static
+void *ssdfs_fsck_maptbl_write_portions(void *arg)
+{
+	struct ssdfs_fsck_maptbl_write_job *job;
+	struct ssdfs_fsck_maptbl_check *check;
+	u32 erase_size;
+	u32 i;
+
+	job = (struct ssdfs_fsck_maptbl_write_job *)arg;
+	check = &job->recovery->check;
+	erase_size = check->env->base.erase_size;
+
+	job->payload = malloc((size_t)check->portions_per_peb *
+					check->portion_size);
+	job->log = malloc(erase_size);
+	job->verify = malloc(erase_size);
+	job->erase_buf = malloc(SSDFS_128KB);
+
+	if (!job->payload || !job->log || !job->verify || !job->erase_buf) {
+		SSDFS_ERR("fail to allocate memory: "
+			  "erase_size %u\n", erase_size);
+		job->err = -ENOMEM;
+		goto finish_write;
+	}
+
+	memset(job->erase_buf, 0xFF, SSDFS_128KB);
+
+	for (i = job->start; i < (job->start + job->count); i++) {
+		job->err = ssdfs_fsck_maptbl_write_peb(job, i);
+		if (job->err)
+			goto finish_write;
+	}
+
+finish_write:
+	free(job->payload);
+	job->payload = NULL;
+	free(job->log);
+	job->log = NULL;
+	free(job->verify);
+	job->verify = NULL;
+	free(job->erase_buf);
+	job->erase_buf = NULL;
+
+	pthread_exit((void *)(long)(job->err != 0));
+}
+
+/*
+ * ssdfs_fsck_maptbl_run_write_jobs() - execute mapping table write's threads
+ * @recovery: mapping table recovery
+ *
+ * Mapping table's PEBs are distributed between threads
+ * by ranges of equal size. Every PEB contains its own portions.
+ * So, threads never write the same portion.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EAGAIN     - fail to create thread.
+ * %-EIO        - thread has failed.
+ */
+static
+int ssdfs_fsck_maptbl_run_write_jobs(struct ssdfs_fsck_mapping_table_recovery *recovery)
+{
+	struct ssdfs_fsck_environment *env = recovery->check.env;
+	struct ssdfs_fsck_maptbl_write_job *jobs;
+	u32 items_count = recovery->check.maptbl_pebs;
+	u32 threads = max_t(u32, env->threads.capacity, 1);
+	u32 items_per_thread;
+	int created = 0;
+	int i;
+	int err = 0;
+
+	threads = min_t(u32, threads, items_count);
+	if (threads == 0)
+		return 0;
+
+	items_per_thread = (items_count + threads - 1) / threads;
+
+	jobs = calloc(threads, sizeof(struct ssdfs_fsck_maptbl_write_job));
+	if (!jobs) {
+		SSDFS_ERR("fail to allocate threads pool: %s\n",
+			  strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < threads; i++) {
+		jobs[i].recovery = recovery;
+		jobs[i].id = i;
+		jobs[i].start = i * items_per_thread;
+
+		if (jobs[i].start >= items_count)
+			break;
 
-	return SSDFS_FSCK_RECOVERY_FAILED;
+		jobs[i].count = min_t(u32, items_per_thread,
+				      items_count - jobs[i].start);
 
+		err = pthread_create(&jobs[i].thread, NULL,
+				     ssdfs_fsck_maptbl_write_portions,
+				     (void *)&jobs[i]);
+		if (err) {
+			SSDFS_ERR("fail to create thread %d: %s\n",
+				  i, strerror(err));
+			err = -EAGAIN;
+			break;
+		}
+
+		created++;
+	}
+
+	for (i = 0; i < created; i++) {
+		pthread_join(jobs[i].thread, NULL);
+
+		if (jobs[i].err != 0) {
+			SSDFS_ERR("thread %d has failed: err %d\n",
+				  i, jobs[i].err);
+			err = -EIO;
+		}
+
+		recovery->written_pebs += jobs[i].written_pebs;
+		recovery->skipped_pebs += jobs[i].skipped_pebs;
+	}
+
+	free(jobs);
+	return err;
+}
+
+/*
+ * ssdfs_fsck_maptbl_update_cache_fragment() - update fragment of maptbl cache
+ * @recovery: mapping table recovery
+ * @ptr: fragment of mapping table cache
+ * @size: size of fragment in bytes
+ *
+ * LEB/PEB pair is kept if PEB is still mapped on the LEB (as
+ * the physical or the relation PEB). Otherwise, PEB ID is replaced
+ * by the rebuilt one. The PEB state is taken from the rebuilt
+ * mapping table and it is marked as consistent.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - fragment is corrupted or compressed.
+ */
+static
+int ssdfs_fsck_maptbl_update_cache_fragment(struct ssdfs_fsck_mapping_table_recovery *recovery,
+					    u8 *ptr, u32 size)
+{
+	struct ssdfs_fsck_maptbl_check *check = &recovery->check;
+	struct ssdfs_maptbl_cache_header *hdr;
+	struct ssdfs_leb2peb_pair *pairs;
+	struct ssdfs_maptbl_cache_peb_state *states;
+	size_t hdr_size = SSDFS_MAPTBL_CACHE_HDR_SIZE;
+	u16 items_count;
+	__le32 *magic;
+	u16 i;
+
+	hdr = (struct ssdfs_maptbl_cache_header *)ptr;
+	items_count = le16_to_cpu(hdr->items_count);
+
+	if (le16_to_cpu(hdr->flags) != 0 ||
+	    le16_to_cpu(hdr->bytes_count) > size ||
+	    le16_to_cpu(hdr->bytes_count) != (hdr_size + SSDFS_PEB_STATE_SIZE +
+			(items_count * (SSDFS_LEB2PEB_PAIR_SIZE +
+					SSDFS_PEB_STATE_SIZE))))
+		return -ENODATA;
+
+	pairs = (struct ssdfs_leb2peb_pair *)(ptr + hdr_size);
+	magic = (__le32 *)(ptr + hdr_size +
+				(items_count * SSDFS_LEB2PEB_PAIR_SIZE));
+	states = (struct ssdfs_maptbl_cache_peb_state *)(magic + 1);
+
+	if (le32_to_cpu(*magic) != SSDFS_MAPTBL_CACHE_PEB_STATE_MAGIC)
+		return -ENODATA;
+
+	for (i = 0; i < items_count; i++) {
+		u64 leb_id = le64_to_cpu(pairs[i].leb_id);
+		u64 peb_id = le64_to_cpu(pairs[i].peb_id);
+
+		if (leb_id >= check->lebs_count)
+			continue;
+
+		if (peb_id != check->leb2peb[leb_id] &&
+		    peb_id != recovery->relation[leb_id]) {
+			if (check->leb2peb[leb_id] >= U64_MAX)
+				continue;
+
+			peb_id = check->leb2peb[leb_id];
+			pairs[i].peb_id = cpu_to_le64(peb_id);
+		}
+
+		if (peb_id >= check->pebs_count ||
+		    check->peb_state[peb_id] == SSDFS_MAPTBL_UNKNOWN_PEB_STATE)
+			continue;
+
+		states[i].state = check->peb_state[peb_id];
+		states[i].consistency = SSDFS_PEB_STATE_CONSISTENT;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_fsck_maptbl_update_cache() - update mapping table cache of superblock
+ * @recovery: mapping table recovery
+ * @log: found log of superblock segment
+ * @buf: buffer for PEB's content
+ * @erase_buf: buffer for erase operation
+ *
+ * Mapping table cache of the last full log of superblock segment
+ * is updated by the rebuilt mapping table. Checksums of cache's
+ * descriptor and segment header are recalculated. The PEB is
+ * erased and all its logs are written back.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - log doesn't contain valid mapping table cache.
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_fsck_maptbl_update_cache(struct ssdfs_fsck_mapping_table_recovery *recovery,
+				   struct ssdfs_fsck_found_log *log,
+				   u8 *buf, void *erase_buf)
+{
+	struct ssdfs_fsck_environment *env = recovery->check.env;
+	struct ssdfs_segment_header *seg_hdr;
+	struct ssdfs_metadata_descriptor *desc;
+	union ssdfs_metadata_header *hdr;
+	struct ssdfs_nand_geometry info = {
+		.erasesize = env->base.erase_size,
+		.writesize = env->base.page_size,
+	};
+	u32 peb_size = env->base.erase_size;
+	u32 page_size = env->base.page_size;
+	u64 offset = log->peb_id * peb_size;
+	u32 log_offset = log->start_page * page_size;
+	u32 area_offset, area_size;
+	u32 used_bytes = 0;
+	u32 open_zones = 0;
+	uLong csum = 0;
+	u32 i;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "peb_id %llu, start_page %u\n",
+		  log->peb_id, log->start_page);
+
+	err = env->base.dev_ops->read(env->base.fd, offset, peb_size,
+				      buf, env->base.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to read PEB: "
+			  "peb_id %llu, err %d\n",
+			  log->peb_id, err);
+		return err;
+	}
+
+	while (used_bytes < peb_size) {
+		u32 log_end = used_bytes;
+
+		hdr = (union ssdfs_metadata_header *)(buf + used_bytes);
+
+		if ((used_bytes + sizeof(*hdr)) > peb_size ||
+		    le32_to_cpu(hdr->magic.common) != SSDFS_SUPER_MAGIC)
+			break;
+
+		if (le16_to_cpu(hdr->magic.key) == SSDFS_SEGMENT_HDR_MAGIC)
+			desc = hdr->seg_hdr.desc_array;
+		else if (le16_to_cpu(hdr->magic.key) ==
+					SSDFS_PARTIAL_LOG_HDR_MAGIC)
+			desc = hdr->pl_hdr.desc_array;
+		else
+			break;
+
+		for (i = 0; i < SSDFS_SEG_HDR_DESC_MAX; i++) {
+			if (!is_ssdfs_fsck_area_valid(&desc[i]))
+				continue;
+
+			log_end = max_t(u32, log_end,
+					le32_to_cpu(desc[i].offset) +
+					le32_to_cpu(desc[i].size));
+		}
+
+		log_end = ((log_end + page_size - 1) / page_size) * page_size;
+
+		if (log_end <= used_bytes || log_end > peb_size)
+			break;
+
+		used_bytes = log_end;
+	}
+
+	if (log_offset >= used_bytes)
+		return -ENODATA;
+
+	seg_hdr = (struct ssdfs_segment_header *)(buf + log_offset);
+	desc = &seg_hdr->desc_array[SSDFS_MAPTBL_CACHE_INDEX];
+	area_offset = le32_to_cpu(desc->offset);
+	area_size = le32_to_cpu(desc->size);
+
+	if (le16_to_cpu(seg_hdr->volume_hdr.magic.key) !=
+						SSDFS_SEGMENT_HDR_MAGIC ||
+	    !is_ssdfs_fsck_area_valid(desc) ||
+	    (area_offset + area_size) > used_bytes)
+		return -ENODATA;
+
+	for (i = 0; i < area_size; i += page_size) {
+		u8 *ptr = buf + area_offset + i;
+		u32 size = min_t(u32, page_size, area_size - i);
+		struct ssdfs_maptbl_cache_header *cache_hdr;
+
+		cache_hdr = (struct ssdfs_maptbl_cache_header *)ptr;
+
+		if (size < SSDFS_MAPTBL_CACHE_HDR_SIZE ||
+		    le32_to_cpu(cache_hdr->magic.common) != SSDFS_SUPER_MAGIC ||
+		    le16_to_cpu(cache_hdr->magic.key) !=
+						SSDFS_MAPTBL_CACHE_MAGIC)
+			break;
+
+		err = ssdfs_fsck_maptbl_update_cache_fragment(recovery,
+							      ptr, size);
+		if (err)
+			return err;
+
+		csum = crc32(csum, ptr, le16_to_cpu(cache_hdr->bytes_count));
+	}
+
+	if (i == 0)
+		return -ENODATA;
+
+	desc->check.csum = cpu_to_le32(~csum);
+
+	err = ssdfs_calculate_csum(&seg_hdr->volume_hdr.check, seg_hdr,
+				   used_bytes - log_offset);
+	if (err)
+		return -ENODATA;
+
+	err = env->base.dev_ops->erase(env->base.fd, offset, peb_size,
+					erase_buf, SSDFS_128KB,
+					env->base.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to erase PEB: "
+			  "peb_id %llu, err %d\n",
+			  log->peb_id, err);
+		return err;
+	}
+
+	err = env->base.dev_ops->write(env->base.fd, &info, offset,
+					used_bytes, buf, &open_zones,
+					env->base.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to write logs: "
+			  "peb_id %llu, size %u, err %d\n",
+			  log->peb_id, used_bytes, err);
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_fsck_maptbl_update_sb_caches() - update maptbl cache of superblock
+ * @env: fsck environment
+ * @recovery: mapping table recovery
+ *
+ * Rebuilt mapping table can map LEBs on other PEBs. So, mapping
+ * table cache of both superblock segment's copies is updated too.
+ *
+ * RETURN:
+ * [success] - number of copies that cannot be updated.
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EIO        - I/O error.
+ */
+static
+int ssdfs_fsck_maptbl_update_sb_caches(struct ssdfs_fsck_environment *env,
+			struct ssdfs_fsck_mapping_table_recovery *recovery)
+{
+	struct ssdfs_fsck_volume_creation_point *creation_point;
+	struct ssdfs_fsck_found_log *log;
+	u8 *buf = NULL;
+	void *erase_buf = NULL;
+	int skipped = 0;
+	int i;
+	int err = 0;
+
+	creation_point = recovery->check.creation_point;
+
+	buf = malloc(env->base.erase_size);
+	erase_buf = malloc(SSDFS_128KB);
+	if (!buf || !erase_buf) {
+		SSDFS_ERR("fail to allocate memory: "
+			  "erase_size %u\n", env->base.erase_size);
+		err = -ENOMEM;
+		goto free_buffers;
+	}
+
+	memset(erase_buf, 0xFF, SSDFS_128KB);
+
+	for (i = 0; i < SSDFS_SB_SEG_COPY_MAX; i++) {
+		log = &creation_point->superblock_seg.logs[i];
+
+		if (log->peb_id >= recovery->check.pebs_count) {
+			skipped++;
+			continue;
+		}
+
+		err = ssdfs_fsck_maptbl_update_cache(recovery, log,
+						     buf, erase_buf);
+		if (err == -ENODATA) {
+			SSDFS_DBG(env->base.show_debug,
+				  "unable to update mapping table cache: "
+				  "peb_id %llu\n", log->peb_id);
+			skipped++;
+			err = 0;
+			continue;
+		} else if (err)
+			goto free_buffers;
+	}
+
+	err = skipped;
+
+free_buffers:
+	free(buf);
+	free(erase_buf);
+	return err;
 }
 
 static
 int ssdfs_fsck_write_mapping_table_metadata(struct ssdfs_fsck_environment *env)
 {
+	struct ssdfs_fsck_mapping_table_recovery *recovery;
+	int skipped_caches;
+	int err;
+
 	SSDFS_DBG(env->base.show_debug,
 		  "Write mapping table metadata\n");
 
-/* TODO: implement */
+	recovery = &env->recovery_result.details.mapping_table;
+
+	if (!is_mapping_table_corrupted(env) || !recovery->check.leb2peb) {
+		SSDFS_DBG(env->base.show_debug,
+			  "mapping table has not been rebuilt\n");
+		return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
+	}
+
+	if (recovery->check.copies_count < SSDFS_MAPTBL_SEG_COPY_MAX &&
+	    !env->yes_all_questions) {
+		SSDFS_FSCK_INFO(env->base.show_info,
+				"Mapping table has no backup copy and "
+				"it cannot be rewritten safely. "
+				"Please, use -y option to rewrite "
+				"the mapping table in place.\n");
+	}
+
+	err = ssdfs_fsck_maptbl_run_write_jobs(recovery);
+	if (err) {
+		SSDFS_ERR("fail to write mapping table: err %d\n", err);
+		return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	}
+
+	skipped_caches = ssdfs_fsck_maptbl_update_sb_caches(env, recovery);
+	if (skipped_caches < 0) {
+		SSDFS_ERR("fail to update mapping table cache: err %d\n",
+			  skipped_caches);
+		return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	}
+
+	if (fsync(env->base.fd) < 0) {
+		SSDFS_ERR("fail to sync device %s: %s\n",
+			  env->base.dev_name, strerror(errno));
+		return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	}
+
+	SSDFS_FSCK_INFO(env->base.show_info && env->be_verbose,
+			"mapping table: written PEBs %u, skipped PEBs %u, "
+			"skipped caches %d\n",
+			recovery->written_pebs, recovery->skipped_pebs,
+			skipped_caches);
+
+	if (recovery->skipped_pebs > 0 || skipped_caches > 0) {
+		/*
+		 * The rebuilt mapping table hasn't been stored completely.
+		 * Other metadata can still be written, but recovery
+		 * result has to be reported as partial one.
+		 */
+		recovery->state = SSDFS_FSCK_PARTIAL_RECOVER_RESULT;
+		env->recovery_result.state =
+				ssdfs_fsck_summarize_recovery_result(env);
+	}
 
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -451,7 +2055,7 @@ int ssdfs_fsck_write_segment_bitmap_metadata(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -465,7 +2069,7 @@ int ssdfs_fsck_write_inodes_btree_metadata(struct ssdfs_fsck_environment *env)
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -479,7 +2083,7 @@ int ssdfs_fsck_write_shared_dictionary_metadata(struct ssdfs_fsck_environment *e
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -493,7 +2097,7 @@ int ssdfs_fsck_write_snapshots_btree_metadata(struct ssdfs_fsck_environment *env
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -507,7 +2111,7 @@ int ssdfs_fsck_write_invalid_extents_btree_metadata(struct ssdfs_fsck_environmen
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -521,7 +2125,7 @@ int ssdfs_fsck_write_superblock_segment_metadata(struct ssdfs_fsck_environment *
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 static
@@ -535,7 +2139,7 @@ int ssdfs_fsck_write_base_snapshot_segment_metadata(struct ssdfs_fsck_environmen
 	SSDFS_DBG(env->base.show_debug,
 		  "finished\n");
 
-	return SSDFS_FSCK_RECOVER_RESULT_FAILURE;
+	return SSDFS_FSCK_RECOVER_RESULT_SUCCESS;
 }
 
 
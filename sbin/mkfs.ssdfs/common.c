@@ -196,6 +196,70 @@ set_extent_offset:
 	return 0;
 }
 
+/*
+ * share_extent_buffer() - share extent's buffer with another extent
+ * @src: extent that contains prepared buffer
+ * @dst: extent that needs to contain the same data
+ *
+ * The @dst extent references the buffer of @src extent without
+ * any copying. The buffer is freed by the last released extent.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int share_extent_buffer(struct ssdfs_extent_desc *src,
+			struct ssdfs_extent_desc *dst)
+{
+	BUG_ON(!src->buf || dst->buf);
+
+	if (!src->buf_refs) {
+		src->buf_refs = malloc(sizeof(u32));
+		if (!src->buf_refs) {
+			SSDFS_ERR("fail to allocate references counter\n");
+			return -ENOMEM;
+		}
+
+		*src->buf_refs = 1;
+	}
+
+	__atomic_add_fetch(src->buf_refs, 1, __ATOMIC_RELAXED);
+
+	dst->state = src->state;
+	dst->buf = src->buf;
+	dst->buf_refs = src->buf_refs;
+	dst->bytes_count = src->bytes_count;
+	dst->compr_bytes = src->compr_bytes;
+	dst->uncompr_bytes = src->uncompr_bytes;
+
+	return 0;
+}
+
+/*
+ * release_extent_buffer() - release extent's buffer
+ * @desc: extent descriptor
+ *
+ * Shared buffer is freed only when nobody references it.
+ * PEBs are released by concurrent writers, so the counter
+ * is decremented atomically.
+ */
+void release_extent_buffer(struct ssdfs_extent_desc *desc)
+{
+	if (!desc->buf)
+		return;
+
+	if (!desc->buf_refs ||
+	    __atomic_sub_fetch(desc->buf_refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		free(desc->buf_refs);
+		free(desc->buf);
+	}
+
+	desc->buf = NULL;
+	desc->buf_refs = NULL;
+}
+
 u32 calculate_log_pages(struct ssdfs_volume_layout *layout,
 			int seg_type,
 			struct ssdfs_peb_content *desc)
@@ -1090,6 +1154,8 @@ make_uncompressed_blob:
 
 	bmp_hdr->bytes_count = cpu_to_le32(written_bmap_bytes);
 	extent->bytes_count = written_bmap_bytes;
+	extent->compr_bytes = written_compr_bytes;
+	extent->uncompr_bytes = bmap_bytes;
 
 	switch (layout->blkbmap.compression) {
 	case SSDFS_UNCOMPRESSED_BLOB:
@@ -1136,6 +1202,20 @@ fail_pre_commit_blk_bmap:
 	return err;
 }
 
+static inline
+void init_block_bitmap_args(struct ssdfs_blkbmap_args *args,
+			    int seg_index, int peb_index,
+			    size_t bytes_count,
+			    u32 start_logical_blk, u16 blks_count)
+{
+	memset(args, 0, sizeof(struct ssdfs_blkbmap_args));
+	args->seg_index = seg_index;
+	args->peb_index = peb_index;
+	args->bytes_count = bytes_count;
+	args->start_logical_blk = start_logical_blk;
+	args->blks_count = blks_count;
+}
+
 int pre_commit_block_bitmap(struct ssdfs_volume_layout *layout,
 			    int seg_index, int peb_index,
 			    size_t bytes_count,
@@ -1144,6 +1224,7 @@ int pre_commit_block_bitmap(struct ssdfs_volume_layout *layout,
 	struct ssdfs_segment_desc *seg_desc;
 	struct ssdfs_peb_content *peb_desc;
 	struct ssdfs_extent_desc *extent;
+	int err;
 
 	SSDFS_DBG(layout->env.show_debug,
 		  "seg_index %d, peb_index %d, "
@@ -1169,9 +1250,17 @@ int pre_commit_block_bitmap(struct ssdfs_volume_layout *layout,
 	peb_desc = &seg_desc->pebs[peb_index];
 	extent = &peb_desc->extents[SSDFS_BLOCK_BITMAP];
 
-	return __pre_commit_block_bitmap(layout, extent, peb_index,
-					 bytes_count,
-					 start_logical_blk, blks_count);
+	err = __pre_commit_block_bitmap(layout, extent, peb_index,
+					bytes_count,
+					start_logical_blk, blks_count);
+	if (err)
+		return err;
+
+	init_block_bitmap_args(&layout->blkbmap.last,
+				seg_index, peb_index, bytes_count,
+				start_logical_blk, blks_count);
+
+	return 0;
 }
 
 int pre_commit_block_bitmap_backup(struct ssdfs_volume_layout *layout,
@@ -1182,6 +1271,8 @@ int pre_commit_block_bitmap_backup(struct ssdfs_volume_layout *layout,
 	struct ssdfs_segment_desc *seg_desc;
 	struct ssdfs_peb_content *peb_desc;
 	struct ssdfs_extent_desc *extent;
+	struct ssdfs_extent_desc *primary;
+	struct ssdfs_blkbmap_args args;
 
 	SSDFS_DBG(layout->env.show_debug,
 		  "seg_index %d, peb_index %d, "
@@ -1206,6 +1297,16 @@ int pre_commit_block_bitmap_backup(struct ssdfs_volume_layout *layout,
 
 	peb_desc = &seg_desc->pebs[peb_index];
 	extent = &peb_desc->extents[SSDFS_BLOCK_BITMAP_BACKUP];
+	primary = &peb_desc->extents[SSDFS_BLOCK_BITMAP];
+
+	init_block_bitmap_args(&args, seg_index, peb_index, bytes_count,
+				start_logical_blk, blks_count);
+
+	if (primary->buf && primary->bytes_count > 0 &&
+	    memcmp(&args, &layout->blkbmap.last, sizeof(args)) == 0) {
+		/* backup copy is identical to the primary bitmap */
+		return share_extent_buffer(primary, extent);
+	}
 
 	return __pre_commit_block_bitmap(layout, extent, peb_index,
 					 bytes_count,
@@ -1273,6 +1374,10 @@ void commit_block_bitmap_backup(struct ssdfs_volume_layout *layout,
 	peb_desc = &seg_desc->pebs[peb_index];
 	extent = &peb_desc->extents[SSDFS_BLOCK_BITMAP_BACKUP];
 
+	/* shared buffer has been committed as primary bitmap */
+	if (extent->buf == peb_desc->extents[SSDFS_BLOCK_BITMAP].buf)
+		return;
+
 	__commit_block_bitmap(layout, extent, metadata_blks);
 }
 
@@ -1334,25 +1439,64 @@ static u64 calculate_offset_table_size(u16 fragments, u16 valid_blks)
 	return allocation_size;
 }
 
-static inline u32 define_block_descriptor_offset(u16 blk_id,
-						 u16 fragments)
+/*
+ * fill_offset_descriptors() - fill fragment of physical offsets
+ * @offsets: array of physical offset descriptors
+ * @count: number of descriptors in the array
+ * @area_type: type of log's area that contains the blocks
+ * @logical_offset: logical offset (in pages) of the first block
+ * @logical_blk: logical block ID of the first block
+ * @peb_page: index of the first block's descriptor in the PEB
+ *
+ * All fields of descriptors are arithmetic progressions. The constant
+ * part of descriptor is converted once and byte offset of block
+ * descriptor is advanced by descriptor size with extra area block
+ * table header on every area's boundary.
+ */
+static
+void fill_offset_descriptors(struct ssdfs_phys_offset_descriptor *offsets,
+			     u16 count, u8 area_type,
+			     u32 logical_offset,
+			     u16 logical_blk,
+			     u32 peb_page)
 {
-	u32 blk_desc_per_fragment;
-	u32 blk_desc_per_area;
+	struct ssdfs_phys_offset_descriptor pattern;
 	size_t hdr_size = sizeof(struct ssdfs_area_block_table);
 	size_t blk_desc_size = sizeof(struct ssdfs_block_descriptor);
-	u32 area_index;
-	u32 offset;
+	u32 blk_desc_per_area;
+	u32 area_rest;
+	u32 byte_offset;
+	u16 i;
 
-	blk_desc_per_fragment = BLK_DESC_PER_FRAGMENT();
-	blk_desc_per_area = blk_desc_per_fragment * SSDFS_FRAGMENTS_CHAIN_MAX;
+	blk_desc_per_area = BLK_DESC_PER_FRAGMENT() * SSDFS_FRAGMENTS_CHAIN_MAX;
 
-	area_index = blk_id / blk_desc_per_area;
+	byte_offset = (peb_page / blk_desc_per_area + 1) * hdr_size;
+	byte_offset += peb_page * blk_desc_size;
+	area_rest = blk_desc_per_area - (peb_page % blk_desc_per_area);
 
-	offset = (area_index + 1) * hdr_size;
-	offset += (u32)blk_id * blk_desc_size;
+	memset(&pattern, 0, sizeof(pattern));
+	pattern.blk_state.log_start_page = 0;
+	pattern.blk_state.log_area = cpu_to_le8(area_type);
+	pattern.blk_state.peb_migration_id = SSDFS_PEB_MIGRATION_ID_START;
 
-	return offset;
+	for (i = 0; i < count; i++) {
+		u16 blk = logical_blk + i;
+
+		if (area_rest == 0) {
+			byte_offset += hdr_size;
+			area_rest = blk_desc_per_area;
+		}
+
+		offsets[i] = pattern;
+		offsets[i].page_desc.logical_offset =
+					cpu_to_le32(logical_offset + i);
+		offsets[i].page_desc.logical_blk = cpu_to_le16(blk);
+		offsets[i].page_desc.peb_page = cpu_to_le16(blk);
+		offsets[i].blk_state.byte_offset = cpu_to_le32(byte_offset);
+
+		byte_offset += blk_desc_size;
+		area_rest--;
+	}
 }
 
 static void prepare_offsets_table_fragment(struct ssdfs_volume_layout *layout,
@@ -1373,10 +1517,8 @@ static void prepare_offsets_table_fragment(struct ssdfs_volume_layout *layout,
 	struct ssdfs_phys_offset_descriptor *offsets;
 	size_t item_size = sizeof(struct ssdfs_phys_offset_descriptor);
 	u16 id_count, free_items;
-	u16 blk_desc_fragments;
 	u32 byte_size;
 	u16 flags = 0;
-	int i;
 
 	BUG_ON(!fragment || !processed_blks);
 	BUG_ON(valid_blks == 0);
@@ -1388,32 +1530,18 @@ static void prepare_offsets_table_fragment(struct ssdfs_volume_layout *layout,
 
 	hdr = (struct ssdfs_phys_offset_table_header *)fragment;
 	offsets = (struct ssdfs_phys_offset_descriptor *)(fragment + hdr_size);
-	*processed_blks = 0;
 	id_count = min_t(u16, rest_blks, OFF_DESC_PER_FRAGMENT());
-	blk_desc_fragments = BLK_DESC_TABLE_FRAGMENTS(valid_blks);
-
-	for (i = 0; i < id_count; ++i, ++*processed_blks) {
-		u32 logical_offset = logical_start_page + i;
-		u32 peb_page = start_peb_page + i;
-		u32 byte_offset = define_block_descriptor_offset(peb_page,
-							blk_desc_fragments);
-		u16 blk = logical_blk + i;
 
-		SSDFS_DBG(layout->env.show_debug,
-			  "ID %d, logical_offset %u, "
-			  "logical_blk %u, peb_page %u\n",
-			  i, logical_offset, blk, blk);
-
-		offsets[i].page_desc.logical_offset = cpu_to_le32(logical_offset);
-		offsets[i].page_desc.logical_blk = cpu_to_le16(blk);
-		offsets[i].page_desc.peb_page = cpu_to_le16(blk);
+	SSDFS_DBG(layout->env.show_debug,
+		  "id_count %u, logical_start_page %u, "
+		  "logical_blk %u, start_peb_page %u\n",
+		  id_count, logical_start_page,
+		  logical_blk, start_peb_page);
 
-		offsets[i].blk_state.log_start_page = 0;
-		offsets[i].blk_state.log_area = cpu_to_le8(area_type);
-		offsets[i].blk_state.peb_migration_id =
-					SSDFS_PEB_MIGRATION_ID_START;
-		offsets[i].blk_state.byte_offset = cpu_to_le32(byte_offset);
-	}
+	fill_offset_descriptors(offsets, id_count, area_type,
+				logical_start_page, logical_blk,
+				start_peb_page);
+	*processed_blks = id_count;
 
 	hdr->magic = cpu_to_le32(SSDFS_PHYS_OFF_TABLE_MAGIC);
 	hdr->start_id = cpu_to_le16(start_id);
@@ -1681,7 +1809,8 @@ static int __pre_commit_offset_table(struct ssdfs_volume_layout *layout,
 	return 0;
 }
 
-int pre_commit_offset_table(struct ssdfs_volume_layout *layout,
+static inline
+void init_offset_table_args(struct ssdfs_blk2off_table_args *args,
 			    int seg_index, int peb_index,
 			    u64 logical_byte_offset,
 			    u32 start_logical_blk,
@@ -1689,21 +1818,27 @@ int pre_commit_offset_table(struct ssdfs_volume_layout *layout,
 			    u32 used_logical_blks,
 			    u32 last_allocated_blk)
 {
-	struct ssdfs_segment_desc *seg_desc;
-	struct ssdfs_peb_content *peb_desc;
-	struct ssdfs_extent_desc *extent;
+	memset(args, 0, sizeof(struct ssdfs_blk2off_table_args));
+	args->seg_index = seg_index;
+	args->peb_index = peb_index;
+	args->logical_byte_offset = logical_byte_offset;
+	args->start_logical_blk = start_logical_blk;
+	args->valid_blks = valid_blks;
+	args->used_logical_blks = used_logical_blks;
+	args->last_allocated_blk = last_allocated_blk;
+}
 
-	SSDFS_DBG(layout->env.show_debug,
-		  "seg_index %d, peb_index %d, "
-		  "valid_blks %u, used_logical_blks %u, "
-		  "last_allocated_blk %u\n",
-		  seg_index, peb_index, valid_blks,
-		  used_logical_blks, last_allocated_blk);
+static struct ssdfs_extent_desc *
+get_offset_table_extent(struct ssdfs_volume_layout *layout,
+			int seg_index, int peb_index,
+			int extent_type)
+{
+	struct ssdfs_segment_desc *seg_desc;
 
 	if (seg_index >= layout->segs_capacity) {
 		SSDFS_ERR("seg_index %d >= segs_capacity %d\n",
 			  seg_index, layout->segs_capacity);
-		return -EINVAL;
+		return NULL;
 	}
 
 	seg_desc = &layout->segs[seg_index];
@@ -1711,18 +1846,53 @@ int pre_commit_offset_table(struct ssdfs_volume_layout *layout,
 	if (peb_index >= seg_desc->pebs_capacity) {
 		SSDFS_ERR("peb_index %d >= pebs_capacity %d\n",
 			  peb_index, seg_desc->pebs_capacity);
-		return -EINVAL;
+		return NULL;
 	}
 
-	peb_desc = &seg_desc->pebs[peb_index];
-	extent = &peb_desc->extents[SSDFS_OFFSET_TABLE];
+	return &seg_desc->pebs[peb_index].extents[extent_type];
+}
 
-	return __pre_commit_offset_table(layout, peb_index, extent,
-					 logical_byte_offset,
-					 start_logical_blk,
-					 valid_blks,
-					 used_logical_blks,
-					 last_allocated_blk);
+int pre_commit_offset_table(struct ssdfs_volume_layout *layout,
+			    int seg_index, int peb_index,
+			    u64 logical_byte_offset,
+			    u32 start_logical_blk,
+			    u16 valid_blks,
+			    u32 used_logical_blks,
+			    u32 last_allocated_blk)
+{
+	struct ssdfs_extent_desc *extent;
+	int err;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "seg_index %d, peb_index %d, "
+		  "valid_blks %u, used_logical_blks %u, "
+		  "last_allocated_blk %u\n",
+		  seg_index, peb_index, valid_blks,
+		  used_logical_blks, last_allocated_blk);
+
+	extent = get_offset_table_extent(layout, seg_index, peb_index,
+					 SSDFS_OFFSET_TABLE);
+	if (!extent)
+		return -EINVAL;
+
+	err = __pre_commit_offset_table(layout, peb_index, extent,
+					logical_byte_offset,
+					start_logical_blk,
+					valid_blks,
+					used_logical_blks,
+					last_allocated_blk);
+	if (err)
+		return err;
+
+	init_offset_table_args(&layout->blk2off_tbl.last,
+				seg_index, peb_index,
+				logical_byte_offset,
+				start_logical_blk,
+				valid_blks,
+				used_logical_blks,
+				last_allocated_blk);
+
+	return 0;
 }
 
 int pre_commit_offset_table_backup(struct ssdfs_volume_layout *layout,
@@ -1733,9 +1903,9 @@ int pre_commit_offset_table_backup(struct ssdfs_volume_layout *layout,
 				   u32 used_logical_blks,
 				   u32 last_allocated_blk)
 {
-	struct ssdfs_segment_desc *seg_desc;
-	struct ssdfs_peb_content *peb_desc;
 	struct ssdfs_extent_desc *extent;
+	struct ssdfs_extent_desc *primary;
+	struct ssdfs_blk2off_table_args args;
 
 	SSDFS_DBG(layout->env.show_debug,
 		  "seg_index %d, peb_index %d, "
@@ -1744,22 +1914,27 @@ int pre_commit_offset_table_backup(struct ssdfs_volume_layout *layout,
 		  seg_index, peb_index, valid_blks,
 		  used_logical_blks, last_allocated_blk);
 
-	if (seg_index >= layout->segs_capacity) {
-		SSDFS_ERR("seg_index %d >= segs_capacity %d\n",
-			  seg_index, layout->segs_capacity);
+	extent = get_offset_table_extent(layout, seg_index, peb_index,
+					 SSDFS_OFFSET_TABLE_BACKUP);
+	if (!extent)
 		return -EINVAL;
-	}
 
-	seg_desc = &layout->segs[seg_index];
+	primary = get_offset_table_extent(layout, seg_index, peb_index,
+					  SSDFS_OFFSET_TABLE);
+	BUG_ON(!primary);
 
-	if (peb_index >= seg_desc->pebs_capacity) {
-		SSDFS_ERR("peb_index %d >= pebs_capacity %d\n",
-			  peb_index, seg_desc->pebs_capacity);
-		return -EINVAL;
-	}
+	init_offset_table_args(&args, seg_index, peb_index,
+				logical_byte_offset,
+				start_logical_blk,
+				valid_blks,
+				used_logical_blks,
+				last_allocated_blk);
 
-	peb_desc = &seg_desc->pebs[peb_index];
-	extent = &peb_desc->extents[SSDFS_OFFSET_TABLE_BACKUP];
+	if (primary->buf && primary->bytes_count > 0 &&
+	    memcmp(&args, &layout->blk2off_tbl.last, sizeof(args)) == 0) {
+		/* backup copy is identical to the primary table */
+		return share_extent_buffer(primary, extent);
+	}
 
 	return __pre_commit_offset_table(layout, peb_index, extent,
 					 logical_byte_offset,
@@ -1826,6 +2001,10 @@ void commit_offset_table_backup(struct ssdfs_volume_layout *layout,
 	peb_desc = &seg_desc->pebs[peb_index];
 	extent = &peb_desc->extents[SSDFS_OFFSET_TABLE_BACKUP];
 
+	/* shared buffer has been committed as primary table */
+	if (extent->buf == peb_desc->extents[SSDFS_OFFSET_TABLE].buf)
+		return;
+
 	__commit_offset_table(layout, extent);
 }
 
@@ -1921,7 +2100,9 @@ int prepare_block_descriptor_fragment(struct ssdfs_volume_layout *layout,
 				      u32 payload_offset_in_bytes,
 				      u32 *cur_byte_offset)
 {
+	struct ssdfs_block_descriptor pattern;
 	u8 area_type = SSDFS_LOG_MAIN_AREA;
+	u32 logical_byte;
 	u32 bytes_count;
 	int i;
 
@@ -1936,38 +2117,32 @@ int prepare_block_descriptor_fragment(struct ssdfs_volume_layout *layout,
 	else
 		area_type = SSDFS_LOG_JOURNAL_AREA;
 
-	for (i = 0; i < valid_blks; i++) {
-		struct ssdfs_block_descriptor *blk_desc = &array[i];
-		u32 logical_page;
-		u32 peb_page;
-
-		memset(blk_desc, 0xFF, sizeof(struct ssdfs_block_descriptor));
-
-		blk_desc->ino = cpu_to_le64(inode_id);
-		BUG_ON(peb_index >= U16_MAX);
-		blk_desc->peb_index = cpu_to_le16(peb_index);
+	BUG_ON(peb_index >= U16_MAX);
+	BUG_ON((start_logical_blk + valid_blks) > U16_MAX);
 
-		logical_page = payload_offset_in_bytes;
-		logical_page += *cur_byte_offset;
-		logical_page /= page_size;
-		blk_desc->logical_offset = cpu_to_le32(logical_page);
+	SSDFS_DBG(layout->env.show_debug,
+		  "valid_blks %u, ino %llu, start_logical_blk %u, "
+		  "cur_byte_offset %u\n",
+		  valid_blks, inode_id, start_logical_blk,
+		  *cur_byte_offset);
 
-		peb_page = start_logical_blk + i;
-		BUG_ON(peb_page >= U16_MAX);
-		blk_desc->peb_page = cpu_to_le16((u16)peb_page);
+	/* the constant part of descriptor is converted only once */
+	memset(&pattern, 0xFF, sizeof(struct ssdfs_block_descriptor));
+	pattern.ino = cpu_to_le64(inode_id);
+	pattern.peb_index = cpu_to_le16(peb_index);
+	pattern.state[0].log_start_page = 0;
+	pattern.state[0].log_area = cpu_to_le8(area_type);
+	pattern.state[0].peb_migration_id = SSDFS_PEB_MIGRATION_ID_START;
 
-		SSDFS_DBG(layout->env.show_debug,
-			  "ID %d, logical_offset %u, "
-			  "ino %llu, peb_page %u\n",
-			  i, logical_page, inode_id, peb_page);
+	logical_byte = payload_offset_in_bytes + *cur_byte_offset;
 
-		blk_desc->state[0].log_start_page = 0;
-		blk_desc->state[0].log_area = cpu_to_le8(area_type);
-		blk_desc->state[0].peb_migration_id =
-				SSDFS_PEB_MIGRATION_ID_START;
-		blk_desc->state[0].byte_offset =
-				cpu_to_le32(*cur_byte_offset);
+	for (i = 0; i < valid_blks; i++) {
+		array[i] = pattern;
+		array[i].logical_offset = cpu_to_le32(logical_byte / page_size);
+		array[i].peb_page = cpu_to_le16((u16)(start_logical_blk + i));
+		array[i].state[0].byte_offset = cpu_to_le32(*cur_byte_offset);
 
+		logical_byte += item_size;
 		*cur_byte_offset += item_size;
 	}
 
@@ -2634,3 +2809,151 @@ void commit_log_footer(struct ssdfs_volume_layout *layout,
 			   seg_index);
 	}
 }
+
+/*
+ * clone_log_template() - build log as a clone of committed log
+ * @layout: pointer on volume layout
+ * @tmpl_seg_index: segment index of the template log
+ * @tmpl_peb_index: PEB index of the template log
+ * @seg_index: segment index of the cloned log
+ * @peb_index: PEB index of the cloned log
+ *
+ * The caller guarantees that the content of the cloned log
+ * is identical to the already committed template log
+ * (for example, backup copy of a segment) and that the cloned
+ * log has no prepared extents. The areas of the template log
+ * are shared without copying. Only segment header and partial
+ * log header are copied because of per-log IDs and, as a result,
+ * only checksums of these structures are recalculated.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid input.
+ * %-ENOMEM     - fail to allocate memory.
+ */
+int clone_log_template(struct ssdfs_volume_layout *layout,
+			int tmpl_seg_index, int tmpl_peb_index,
+			int seg_index, int peb_index)
+{
+	struct ssdfs_segment_desc *seg_desc;
+	struct ssdfs_peb_content *tmpl, *peb_desc;
+	struct ssdfs_extent_desc *src, *dst;
+	struct ssdfs_segment_header *hdr;
+	struct ssdfs_partial_log_header *pl_hdr;
+	size_t hdr_len = sizeof(struct ssdfs_segment_header);
+	size_t pl_hdr_len = sizeof(struct ssdfs_partial_log_header);
+	int i;
+	int err;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "template: seg_index %d, peb_index %d; "
+		  "clone: seg_index %d, peb_index %d\n",
+		  tmpl_seg_index, tmpl_peb_index,
+		  seg_index, peb_index);
+
+	if (tmpl_seg_index >= layout->segs_capacity ||
+	    seg_index >= layout->segs_capacity) {
+		SSDFS_ERR("seg_index %d/%d >= segs_capacity %d\n",
+			  tmpl_seg_index, seg_index,
+			  layout->segs_capacity);
+		return -EINVAL;
+	}
+
+	if (tmpl_peb_index >= layout->segs[tmpl_seg_index].pebs_capacity ||
+	    peb_index >= layout->segs[seg_index].pebs_capacity) {
+		SSDFS_ERR("invalid peb_index %d/%d\n",
+			  tmpl_peb_index, peb_index);
+		return -EINVAL;
+	}
+
+	tmpl = &layout->segs[tmpl_seg_index].pebs[tmpl_peb_index];
+	seg_desc = &layout->segs[seg_index];
+	peb_desc = &seg_desc->pebs[peb_index];
+
+	src = &tmpl->extents[SSDFS_SEG_HEADER];
+	if (!src->buf || src->bytes_count != hdr_len) {
+		SSDFS_ERR("template log has no segment header\n");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < SSDFS_SEG_LOG_ITEMS_COUNT; i++) {
+		src = &tmpl->extents[i];
+		dst = &peb_desc->extents[i];
+
+		BUG_ON(dst->buf);
+
+		dst->offset = src->offset;
+
+		if (!src->buf) {
+			dst->bytes_count = src->bytes_count;
+			continue;
+		}
+
+		switch (i) {
+		case SSDFS_SEG_HEADER:
+			dst->buf = malloc(hdr_len);
+			if (!dst->buf) {
+				SSDFS_ERR("unable to allocate memory of size %zu\n",
+					  hdr_len);
+				return -ENOMEM;
+			}
+
+			memcpy(dst->buf, src->buf, hdr_len);
+			dst->state = src->state;
+			dst->bytes_count = src->bytes_count;
+
+			hdr = (struct ssdfs_segment_header *)dst->buf;
+			hdr->seg_id = cpu_to_le64(seg_desc->seg_id);
+			hdr->leb_id = cpu_to_le64(peb_desc->leb_id);
+			hdr->peb_id = cpu_to_le64(peb_desc->peb_id);
+
+			hdr->volume_hdr.check.csum = 0;
+			hdr->volume_hdr.check.csum =
+					ssdfs_crc32_le(hdr, hdr_len);
+			continue;
+
+		case SSDFS_LOG_FOOTER:
+			pl_hdr = (struct ssdfs_partial_log_header *)src->buf;
+			if (le16_to_cpu(pl_hdr->magic.key) !=
+						SSDFS_PARTIAL_LOG_HDR_MAGIC) {
+				/* log footer has no per-log IDs */
+				break;
+			}
+
+			dst->buf = malloc(src->bytes_count);
+			if (!dst->buf) {
+				SSDFS_ERR("unable to allocate memory of size %u\n",
+					  src->bytes_count);
+				return -ENOMEM;
+			}
+
+			memcpy(dst->buf, src->buf, src->bytes_count);
+			dst->state = src->state;
+			dst->bytes_count = src->bytes_count;
+
+			pl_hdr = (struct ssdfs_partial_log_header *)dst->buf;
+			pl_hdr->seg_id = cpu_to_le64(seg_desc->seg_id);
+			pl_hdr->leb_id = cpu_to_le64(peb_desc->leb_id);
+			pl_hdr->peb_id = cpu_to_le64(peb_desc->peb_id);
+
+			pl_hdr->check.csum = 0;
+			pl_hdr->check.csum = ssdfs_crc32_le(pl_hdr, pl_hdr_len);
+			continue;
+
+		default:
+			/* area is the same for every clone */
+			break;
+		}
+
+		err = share_extent_buffer(src, dst);
+		if (err) {
+			SSDFS_ERR("fail to share extent %d: err %d\n",
+				  i, err);
+			return err;
+		}
+	}
+
+	return 0;
+}
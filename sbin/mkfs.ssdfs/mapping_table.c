@@ -276,14 +276,16 @@ define_stripes_per_portion:
 	return seg_state;
 }
 
+/*
+ * Buffers of fragments are allocated on demand by maptbl_get_fragment().
+ * Only fragments with mapped LEBs live in memory from validation till
+ * writing. Other fragments are generated right before writing of
+ * the mapping table's PEB and they are freed right after it.
+ */
 static
 int maptbl_create_fragments_array(struct ssdfs_volume_layout *layout)
 {
 	u32 maptbl_pebs = layout->maptbl.maptbl_pebs;
-	size_t portion_size = layout->maptbl.portion_size;
-	u16 portions_per_fragment = layout->maptbl.portions_per_fragment;
-	size_t peb_buffer_size = portion_size * portions_per_fragment;
-	u32 i;
 
 	SSDFS_DBG(layout->env.show_debug, "layout %p\n", layout);
 
@@ -295,25 +297,7 @@ int maptbl_create_fragments_array(struct ssdfs_volume_layout *layout)
 		return -ENOMEM;
 	}
 
-	for (i = 0; i < maptbl_pebs; i++) {
-		layout->maptbl.fragments_array[i] = calloc(1, peb_buffer_size);
-		if (layout->maptbl.fragments_array[i] == NULL) {
-			SSDFS_ERR("fail to allocate PEB's buffer: "
-				  "index %d\n", i);
-			goto free_buffers;
-		}
-	}
-
 	return 0;
-
-free_buffers:
-	for (i--; i >= 0; i--) {
-		free(layout->maptbl.fragments_array[i]);
-		layout->maptbl.fragments_array[i] = NULL;
-	}
-	free(layout->maptbl.fragments_array);
-	layout->maptbl.fragments_array = NULL;
-	return -ENOMEM;
 }
 
 void maptbl_destroy_fragments_array(struct ssdfs_volume_layout *layout)
@@ -338,74 +322,24 @@ void maptbl_prepare_leb_table(struct ssdfs_volume_layout *layout,
 				u8 *ptr, u16 portion_index,
 				u16 mempage_index)
 {
-	struct ssdfs_leb_table_fragment_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
 	u32 lebtbl_portion_bytes = layout->maptbl.lebtbl_portion_bytes;
-	u16 lebs_per_portion = layout->maptbl.lebs_per_portion;
-	u32 leb_desc_per_mempage;
 	u16 lebtbl_mempages;
-	u64 start_portion_leb;
-	u64 start_fragment_leb;
 	u64 pebs_per_volume;
-	u64 lebs_count;
-	u32 bytes_count;
 
 	SSDFS_DBG(layout->env.show_debug,
 		  "layout %p, ptr %p, portion_index %u, "
 		  "mempage_index %u\n",
 		  layout, ptr, portion_index, mempage_index);
 
-	leb_desc_per_mempage = SSDFS_LEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
 	lebtbl_mempages = (u16)(lebtbl_portion_bytes / layout->page_size);
 	BUG_ON(lebtbl_mempages == 0);
 	BUG_ON(mempage_index >= lebtbl_mempages);
 
-	start_portion_leb = (u64)lebs_per_portion * portion_index;
-	start_fragment_leb = start_portion_leb +
-				((u64)leb_desc_per_mempage * mempage_index);
-
 	pebs_per_volume = layout->env.fs_size / layout->env.erase_size;
 
-	if (pebs_per_volume <= start_fragment_leb)
-		lebs_count = 0;
-	else {
-		lebs_count = pebs_per_volume - start_fragment_leb;
-		lebs_count = min_t(u64, lebs_count, lebs_per_portion);
-		lebs_count = min_t(u64, lebs_count, leb_desc_per_mempage);
-	}
-
-	SSDFS_DBG(layout->env.show_debug,
-		  "start_portion_leb %llu, start_fragment_leb %llu, "
-		  "pebs_per_volume %llu, "
-		  "lebs_per_portion %u, lebs_count %llu\n",
-		  start_portion_leb, start_fragment_leb,
-		  pebs_per_volume, lebs_per_portion, lebs_count);
-
-	bytes_count = hdr_size;
-	bytes_count += lebs_count * sizeof(struct ssdfs_leb_descriptor);
-
-	hdr = (struct ssdfs_leb_table_fragment_header *)ptr;
-
-	hdr->magic = cpu_to_le16(SSDFS_LEB_TABLE_MAGIC);
-	hdr->flags = 0;
-
-	if (mempage_index == 0)
-		hdr->start_leb = cpu_to_le64(start_portion_leb);
-	else
-		hdr->start_leb = cpu_to_le64(start_fragment_leb);
-
-	BUG_ON(lebs_count >= U16_MAX);
-	hdr->lebs_count = cpu_to_le16(lebs_count);
-
-	hdr->mapped_lebs = 0;
-	hdr->migrating_lebs = 0;
-
-	hdr->portion_id = cpu_to_le16(portion_index);
-	hdr->fragment_id = cpu_to_le16(mempage_index);
-
-	hdr->bytes_count = cpu_to_le32(bytes_count);
-
-	memset(ptr + hdr_size, 0xFF, PAGE_CACHE_SIZE - hdr_size);
+	ssdfs_maptbl_prepare_lebtbl_fragment(ptr, pebs_per_volume,
+					     layout->maptbl.lebs_per_portion,
+					     portion_index, mempage_index);
 }
 
 static
@@ -413,18 +347,7 @@ void maptbl_prepare_peb_table(struct ssdfs_volume_layout *layout,
 				u8 *ptr,  u16 portion_index,
 				u16 stripe_index)
 {
-	struct ssdfs_peb_table_fragment_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
-	u64 pebs_per_portion = layout->maptbl.pebs_per_portion;
-	u16 reserved_pebs_pct = layout->maptbl.reserved_pebs_per_fragment;
-	u64 reserved_pebs;
-	u16 stripes_per_portion;
-	u32 peb_desc_per_stripe;
 	u64 pebs_per_volume;
-	u64 start_peb;
-	u64 pebs_count;
-	u32 bytes_count;
-	u64 rest_pebs;
 
 	SSDFS_DBG(layout->env.show_debug,
 		  "layout %p, ptr %p, portion_index %u, "
@@ -432,66 +355,12 @@ void maptbl_prepare_peb_table(struct ssdfs_volume_layout *layout,
 		  layout, ptr, portion_index, stripe_index);
 
 	pebs_per_volume = layout->env.fs_size / layout->env.erase_size;
-	stripes_per_portion = layout->maptbl.stripes_per_portion;
-
-	BUG_ON(stripe_index >= stripes_per_portion);
-
-	rest_pebs = pebs_per_volume - (pebs_per_portion * portion_index);
-	rest_pebs = min_t(u64, rest_pebs, pebs_per_portion);
 
-	peb_desc_per_stripe = rest_pebs / stripes_per_portion;
-	if (rest_pebs % stripes_per_portion)
-		peb_desc_per_stripe++;
-
-	start_peb = ((u64)pebs_per_portion * portion_index) +
-			((u64)peb_desc_per_stripe * stripe_index);
-
-	if (pebs_per_volume <= start_peb)
-		pebs_count = 0;
-	else {
-		pebs_count = pebs_per_volume -
-			(pebs_per_portion * portion_index);
-		pebs_count = min_t(u64, pebs_count, pebs_per_portion);
-		pebs_count += pebs_count % stripes_per_portion;
-		pebs_count /= stripes_per_portion;
-
-		if ((start_peb + pebs_count) > pebs_per_volume)
-			pebs_count = pebs_per_volume - start_peb;
-	}
-
-	SSDFS_DBG(layout->env.show_debug,
-		  "stripes_per_portion %u, peb_desc_per_stripe %u, "
-		  "pebs_per_portion %llu, start_peb %llu, "
-		  "pebs_per_volume %llu, pebs_count %llu\n",
-		  stripes_per_portion, peb_desc_per_stripe,
-		  pebs_per_portion, start_peb, pebs_per_volume,
-		  pebs_count);
-
-	bytes_count = hdr_size;
-	bytes_count += pebs_count * sizeof(struct ssdfs_peb_descriptor);
-
-	hdr = (struct ssdfs_peb_table_fragment_header *)ptr;
-
-	hdr->magic = cpu_to_le16(SSDFS_PEB_TABLE_MAGIC);
-	hdr->flags = 0;
-
-	hdr->recover_months = SSDFS_PEB_RECOVER_MONTHS_DEFAULT;
-	hdr->recover_threshold = SSDFS_PEBTBL_FIRST_RECOVER_TRY;
-
-	hdr->start_peb = cpu_to_le64(start_peb);
-	BUG_ON(pebs_count >= U16_MAX);
-	hdr->pebs_count = cpu_to_le16(pebs_count);
-
-	reserved_pebs = (pebs_count * reserved_pebs_pct) / 100;
-	BUG_ON(reserved_pebs >= U16_MAX);
-	hdr->last_selected_peb = cpu_to_le16(0);
-	hdr->reserved_pebs = cpu_to_le16((u16)reserved_pebs);
-
-	hdr->stripe_id = cpu_to_le16(stripe_index);
-	hdr->portion_id = cpu_to_le16(portion_index);
-	hdr->fragment_id = cpu_to_le16(stripe_index);
-
-	hdr->bytes_count = cpu_to_le32(bytes_count);
+	ssdfs_maptbl_prepare_pebtbl_fragment(ptr, pebs_per_volume,
+				layout->maptbl.pebs_per_portion,
+				layout->maptbl.stripes_per_portion,
+				layout->maptbl.reserved_pebs_per_fragment,
+				portion_index, stripe_index);
 }
 
 static
@@ -543,7 +412,6 @@ int maptbl_prepare_portion(struct ssdfs_volume_layout *layout,
 int maptbl_mkfs_prepare(struct ssdfs_volume_layout *layout)
 {
 	u32 portions;
-	u32 i;
 	int err;
 
 	SSDFS_DBG(layout->env.show_debug, "layout %p\n", layout);
@@ -564,33 +432,86 @@ int maptbl_mkfs_prepare(struct ssdfs_volume_layout *layout)
 	portions = layout->maptbl.portions_count;
 	BUG_ON(portions >= U16_MAX);
 
-	for (i = 0; i < portions; i++) {
+	return 0;
+}
+
+static
+void maptbl_mark_fragment_pre_erased(struct ssdfs_volume_layout *layout,
+				     u32 fragment_index);
+
+/*
+ * maptbl_get_fragment() - get buffer of mapping table's fragment
+ * @layout: pointer on volume layout
+ * @index: index of fragment (PEB of mapping table)
+ *
+ * This method returns the buffer of fragment. If the fragment
+ * has not been created yet, then the buffer is allocated and
+ * every portion of the fragment is prepared. The unallocated PEBs
+ * of fragment are marked as pre-erased if the range of unallocated
+ * PEBs has been defined already.
+ *
+ * RETURN:
+ * [success] - pointer on fragment's buffer.
+ * [failure] - NULL.
+ */
+static
+u8 *maptbl_get_fragment(struct ssdfs_volume_layout *layout, u32 index)
+{
+	u32 portions = layout->maptbl.portions_count;
+	u16 portions_per_fragment = layout->maptbl.portions_per_fragment;
+	size_t portion_size = layout->maptbl.portion_size;
+	size_t peb_buffer_size = portion_size * portions_per_fragment;
+	u32 start_portion = index * portions_per_fragment;
+	u32 end_portion;
+	u32 i;
+	int err;
+
+	BUG_ON(index >= layout->maptbl.maptbl_pebs);
+
+	if (layout->maptbl.fragments_array[index])
+		return layout->maptbl.fragments_array[index];
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "layout %p, index %u\n", layout, index);
+
+	layout->maptbl.fragments_array[index] = calloc(1, peb_buffer_size);
+	if (layout->maptbl.fragments_array[index] == NULL) {
+		SSDFS_ERR("fail to allocate PEB's buffer: "
+			  "index %u\n", index);
+		return NULL;
+	}
+
+	end_portion = min_t(u32, start_portion + portions_per_fragment,
+			    portions);
+
+	for (i = start_portion; i < end_portion; i++) {
 		err = maptbl_prepare_portion(layout, (u16)i);
 		if (err) {
 			SSDFS_ERR("fail to prepare portion: "
 				  "index %u, err %d\n",
 				  i, err);
-			return err;
+			free(layout->maptbl.fragments_array[index]);
+			layout->maptbl.fragments_array[index] = NULL;
+			return NULL;
 		}
 	}
 
-	return 0;
+	if (layout->maptbl.pre_erased_start_peb != U64_MAX)
+		maptbl_mark_fragment_pre_erased(layout, index);
+
+	return layout->maptbl.fragments_array[index];
 }
 
 static
-int check_portion_pebs_validity(struct ssdfs_volume_layout *layout,
-				u8 *portion)
+int check_stripe_pebs_validity(struct ssdfs_volume_layout *layout,
+			       u8 *pebtbl)
 {
 	int fd = layout->env.fd;
 	struct ssdfs_peb_table_fragment_header *hdr;
 	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
 	struct ssdfs_peb_descriptor *desc;
 	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
-	u16 stripes = layout->maptbl.stripes_per_portion;
-	u32 lebtbl_portion_bytes = layout->maptbl.lebtbl_portion_bytes;
-	u8 *pebtbl = portion + lebtbl_portion_bytes;
 	u8 *desc_array;
-	u16 stripe_id;
 	u64 peb_id;
 	u16 pebs_count;
 	u32 peb_size = layout->env.erase_size;
@@ -600,77 +521,199 @@ int check_portion_pebs_validity(struct ssdfs_volume_layout *layout,
 	u8 *bmap;
 	int res;
 
-	SSDFS_DBG(layout->env.show_debug, "layout %p\n", layout);
+	hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
+	pebs_count = le16_to_cpu(hdr->pebs_count);
+	peb_id = le64_to_cpu(hdr->start_peb);
+	desc_array = pebtbl + hdr_size;
 
-	for (stripe_id = 0; stripe_id < stripes; stripe_id++) {
-		pebtbl += stripe_id * layout->page_size;
-		hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
-		pebs_count = le16_to_cpu(hdr->pebs_count);
-		peb_id = le64_to_cpu(hdr->start_peb);
-		desc_array = pebtbl + hdr_size;
-
-		for (i = 0; i < pebs_count; i++, peb_id++) {
-			u8 *cur_ptr;
-
-			offset = peb_id * peb_size;
-			cur_ptr = desc_array + (peb_id * desc_size);
-			desc = (struct ssdfs_peb_descriptor *)cur_ptr;
-
-			res = layout->env.dev_ops->check_peb(fd, offset,
-							peb_size,
-							SSDFS_FALSE,
-							layout->env.show_debug);
-			if (res < 0) {
-				SSDFS_ERR("fail to check PEB: "
-					  "offset %llu, err %d\n",
-					  offset, res);
-				return res;
-			}
+	SSDFS_DBG(layout->env.show_debug,
+		  "start_peb %llu, pebs_count %u\n",
+		  peb_id, pebs_count);
+
+	for (i = 0; i < pebs_count; i++, peb_id++) {
+		offset = peb_id * peb_size;
+		desc = (struct ssdfs_peb_descriptor *)(desc_array +
+							(i * desc_size));
+
+		res = layout->env.dev_ops->check_peb(fd, offset,
+						peb_size,
+						SSDFS_FALSE,
+						layout->env.show_debug);
+		if (res < 0) {
+			SSDFS_ERR("fail to check PEB: "
+				  "offset %llu, err %d\n",
+				  offset, res);
+			return res;
+		}
 
-			switch (res) {
-			case SSDFS_PEB_ERASURE_OK:
-				desc->erase_cycles = cpu_to_le32(1);
-				break;
+		switch (res) {
+		case SSDFS_PEB_ERASURE_OK:
+			desc->erase_cycles = cpu_to_le32(1);
+			break;
 
-			case SSDFS_PEB_IS_BAD:
-				desc->erase_cycles = cpu_to_le32(U32_MAX);
-				desc->state =
-				    cpu_to_le8(SSDFS_MAPTBL_BAD_PEB_STATE);
+		case SSDFS_PEB_IS_BAD:
+			desc->erase_cycles = cpu_to_le32(U32_MAX);
+			desc->state =
+			    cpu_to_le8(SSDFS_MAPTBL_BAD_PEB_STATE);
 
-				flags = le8_to_cpu(hdr->flags);
-				flags |= SSDFS_PEBTBL_BADBLK_EXIST;
-				hdr->flags = cpu_to_le8(flags);
+			flags = le8_to_cpu(hdr->flags);
+			flags |= SSDFS_PEBTBL_BADBLK_EXIST;
+			hdr->flags = cpu_to_le8(flags);
 
-				bmap = &hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
-				__set_bit(i, (unsigned long *)bmap);
-				bmap = &hdr->bmaps[SSDFS_PEBTBL_BADBLK_BMAP][0];
-				__set_bit(i, (unsigned long *)bmap);
-				break;
+			bmap = &hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
+			__set_bit(i, (unsigned long *)bmap);
+			bmap = &hdr->bmaps[SSDFS_PEBTBL_BADBLK_BMAP][0];
+			__set_bit(i, (unsigned long *)bmap);
+			break;
 
-			case SSDFS_RECOVERING_PEB:
-				desc->erase_cycles = cpu_to_le32(1);
-				desc->state =
-				    cpu_to_le8(SSDFS_MAPTBL_RECOVERING_STATE);
+		case SSDFS_RECOVERING_PEB:
+			desc->erase_cycles = cpu_to_le32(1);
+			desc->state =
+			    cpu_to_le8(SSDFS_MAPTBL_RECOVERING_STATE);
 
-				flags = le8_to_cpu(hdr->flags);
-				flags |= SSDFS_PEBTBL_UNDER_RECOVERING;
-				hdr->flags = cpu_to_le8(flags);
+			flags = le8_to_cpu(hdr->flags);
+			flags |= SSDFS_PEBTBL_UNDER_RECOVERING;
+			hdr->flags = cpu_to_le8(flags);
 
-				bmap = &hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
-				__set_bit(i, (unsigned long *)bmap);
-				bmap = &hdr->bmaps[SSDFS_PEBTBL_RECOVER_BMAP][0];
-				__set_bit(i, (unsigned long *)bmap);
-				break;
+			bmap = &hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
+			__set_bit(i, (unsigned long *)bmap);
+			bmap = &hdr->bmaps[SSDFS_PEBTBL_RECOVER_BMAP][0];
+			__set_bit(i, (unsigned long *)bmap);
+			break;
 
-			default:
-				BUG();
-			};
-		}
+		default:
+			BUG();
+		};
 	}
 
 	return 0;
 }
 
+static inline
+u8 *get_pebtbl_stripe(struct ssdfs_volume_layout *layout,
+		      u64 stripe_index)
+{
+	u16 stripes = layout->maptbl.stripes_per_portion;
+	u16 portions_per_peb = layout->maptbl.portions_per_fragment;
+	size_t portion_size = layout->maptbl.portion_size;
+	u32 lebtbl_portion_bytes = layout->maptbl.lebtbl_portion_bytes;
+	u64 portion_index = stripe_index / stripes;
+	u8 *ptr;
+
+	ptr = layout->maptbl.fragments_array[portion_index / portions_per_peb];
+	ptr += (portion_index % portions_per_peb) * portion_size;
+	ptr += lebtbl_portion_bytes;
+	ptr += (stripe_index % stripes) * layout->page_size;
+
+	return ptr;
+}
+
+static inline
+u64 get_pebtbl_stripes_count(struct ssdfs_volume_layout *layout)
+{
+	return (u64)layout->maptbl.maptbl_pebs *
+			layout->maptbl.portions_per_fragment *
+			layout->maptbl.stripes_per_portion;
+}
+
+/*
+ * check_nand_die_pebs_validity() - check PEBs of NAND die
+ * @arg: pointer on thread's job
+ *
+ * Stripes of PEB table are distributed between NAND dies
+ * in round-robin manner. The thread checks the PEBs of every
+ * stripe of the NAND die. Every stripe is updated by one
+ * thread only, so the result doesn't depend on threads' timing.
+ */
+static
+void *check_nand_die_pebs_validity(void *arg)
+{
+	struct ssdfs_maptbl_check_job *job =
+			(struct ssdfs_maptbl_check_job *)arg;
+	struct ssdfs_volume_layout *layout;
+	u64 stripes_count;
+	u64 index;
+	int err;
+
+	if (!job)
+		pthread_exit((void *)1);
+
+	layout = job->layout;
+	stripes_count = get_pebtbl_stripes_count(layout);
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "die_index %u, dies_count %u\n",
+		  job->die_index, job->dies_count);
+
+	job->err = 0;
+
+	for (index = job->die_index; index < stripes_count;
+					index += job->dies_count) {
+		err = check_stripe_pebs_validity(layout,
+					get_pebtbl_stripe(layout, index));
+		if (err) {
+			SSDFS_ERR("fail to check stripe: "
+				  "die_index %u, stripe_index %llu, "
+				  "err %d\n",
+				  job->die_index, index, err);
+			job->err = err;
+			pthread_exit((void *)1);
+		}
+	}
+
+	pthread_exit((void *)0);
+}
+
+static
+int check_pebs_validity_concurrently(struct ssdfs_volume_layout *layout,
+				     u32 dies_count)
+{
+	struct ssdfs_maptbl_check_job *jobs;
+	u32 started = 0;
+	u32 i;
+	int err = 0;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "layout %p, dies_count %u\n",
+		  layout, dies_count);
+
+	jobs = calloc(dies_count, sizeof(struct ssdfs_maptbl_check_job));
+	if (!jobs) {
+		SSDFS_ERR("fail to allocate jobs: %s\n",
+			  strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < dies_count; i++) {
+		jobs[i].die_index = i;
+		jobs[i].dies_count = dies_count;
+		jobs[i].layout = layout;
+
+		err = pthread_create(&jobs[i].thread, NULL,
+				     check_nand_die_pebs_validity,
+				     (void *)&jobs[i]);
+		if (err) {
+			SSDFS_ERR("fail to create thread %u: %s\n",
+				  i, strerror(err));
+			err = -err;
+			break;
+		}
+
+		started++;
+	}
+
+	for (i = 0; i < started; i++)
+		pthread_join(jobs[i].thread, NULL);
+
+	/* the error of the first NAND die is reported */
+	for (i = 0; !err && i < started; i++)
+		err = jobs[i].err;
+
+	free(jobs);
+
+	return err;
+}
+
 static
 int check_pebs_validity(struct ssdfs_volume_layout *layout)
 {
@@ -679,10 +722,10 @@ int check_pebs_validity(struct ssdfs_volume_layout *layout)
 		.writesize = layout->page_size,
 	};
 	int fd = layout->env.fd;
-	u32 maptbl_pebs;
-	u16 portions_per_peb;
-	size_t portion_size;
-	u32 findex, pindex;
+	u64 stripes_count;
+	u64 index;
+	u32 dies_count;
+	u32 i;
 	int res;
 
 	SSDFS_DBG(layout->env.show_debug, "layout %p\n", layout);
@@ -705,23 +748,43 @@ int check_pebs_validity(struct ssdfs_volume_layout *layout)
 	if (res)
 		return res;
 
-	maptbl_pebs = layout->maptbl.maptbl_pebs;
-	portions_per_peb = layout->maptbl.portions_per_fragment;
-	portion_size = layout->maptbl.portion_size;
+	stripes_count = get_pebtbl_stripes_count(layout);
+	dies_count = (u32)min_t(u64, layout->nand_dies_count, stripes_count);
 
-	for (findex = 0; findex < maptbl_pebs; findex++) {
-		u8 *peb_buf = layout->maptbl.fragments_array[findex];
+	if (layout->plan.is_enabled) {
+		/* the check erases every PEB of the volume */
+		plan_account_erase(layout,
+				   layout->env.fs_size / layout->env.erase_size,
+				   layout->env.erase_size,
+				   max_t(u32, dies_count, 1));
+		layout->is_volume_erased = SSDFS_TRUE;
+		return 0;
+	}
 
-		for (pindex = 0; pindex < portions_per_peb; pindex++) {
-			u8 *portion = peb_buf + (pindex * portion_size);
+	/* every PEB is checked, so every fragment has to be created */
+	for (i = 0; i < layout->maptbl.maptbl_pebs; i++) {
+		if (!maptbl_get_fragment(layout, i)) {
+			SSDFS_ERR("fail to create fragment: index %u\n", i);
+			return -ENOMEM;
+		}
+	}
 
-			res = check_portion_pebs_validity(layout, portion);
+	if (dies_count > 1) {
+		res = check_pebs_validity_concurrently(layout, dies_count);
+		if (res) {
+			SSDFS_ERR("fail to check PEBs: "
+				  "dies_count %u, err %d\n",
+				  dies_count, res);
+			return res;
+		}
+	} else {
+		for (index = 0; index < stripes_count; index++) {
+			res = check_stripe_pebs_validity(layout,
+					get_pebtbl_stripe(layout, index));
 			if (res) {
-				SSDFS_ERR("fail to check portion: "
-					  "fragment_index %u, "
-					  "portion_index %u, "
-					  "err %d\n",
-					  findex, pindex, res);
+				SSDFS_ERR("fail to check stripe: "
+					  "stripe_index %llu, err %d\n",
+					  index, res);
 				return res;
 			}
 		}
@@ -775,7 +838,10 @@ u8 *get_lebtbl_fragment(struct ssdfs_volume_layout *layout,
 
 	*leb_desc_index = diff_leb_id % leb_desc_per_mempage;
 
-	fragment = (u8 *)layout->maptbl.fragments_array[*fragment_index];
+	fragment = maptbl_get_fragment(layout, *fragment_index);
+	if (!fragment)
+		return NULL;
+
 	portion = fragment + (*portion_index * layout->maptbl.portion_size);
 	lebtbl = portion + (mempage_index * layout->page_size);
 
@@ -798,7 +864,10 @@ u8 *get_pebtbl_fragment(struct ssdfs_volume_layout *layout,
 		  layout, fragment_index,
 		  portion_index, stripe_index);
 
-	fragment = (u8 *)layout->maptbl.fragments_array[fragment_index];
+	fragment = maptbl_get_fragment(layout, fragment_index);
+	if (!fragment)
+		return NULL;
+
 	portion = fragment + (portion_index * layout->maptbl.portion_size);
 
 	pebtbl = portion + layout->maptbl.lebtbl_portion_bytes;
@@ -814,160 +883,84 @@ u16 find_unused_peb(struct ssdfs_peb_table_fragment_header *hdr)
 	u16 bmap_ulongs = (pebs_count + BITS_PER_LONG - 1) / BITS_PER_LONG;
 	unsigned long *bmap;
 	u16 index;
-	u16 peb_index;
+	u32 peb_index;
 
 	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
 
-	index = 0;
-	for (; index < bmap_ulongs; index++) {
+	for (index = 0; index < bmap_ulongs; index++) {
 		if (bmap[index] != ULONG_MAX)
 			break;
 	}
 
-	peb_index = index * BITS_PER_LONG;
-	for (; peb_index < pebs_count; peb_index++) {
-		if (!test_bit(peb_index, bmap))
-			break;
-	}
+	if (index >= bmap_ulongs)
+		goto fail_find_unused_peb;
 
-	if (peb_index >= pebs_count) {
-		SSDFS_ERR("fail to find unused peb\n");
-		return U16_MAX;
-	}
-
-	return peb_index;
-}
+	peb_index = (u32)index * BITS_PER_LONG;
+	peb_index += ffz(bmap[index]);
 
-static
-void define_peb_as_used(u8 *pebtbl, u16 peb_index, int meta_index)
-{
-	struct ssdfs_peb_table_fragment_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
-	struct ssdfs_peb_descriptor *desc_array, *desc;
-	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
-	u16 pebs_count;
-	u16 last_selected_peb;
-	int peb_type = SEG2PEB_TYPE(META2SEG_TYPE(meta_index));
-	unsigned long *bmap;
-	u32 bytes_count;
+	if (peb_index >= pebs_count)
+		goto fail_find_unused_peb;
 
-	BUG_ON(meta_index > SSDFS_METADATA_ITEMS_MAX);
-	BUG_ON(peb_type <= SSDFS_MAPTBL_UNKNOWN_PEB_TYPE ||
-		peb_type >= SSDFS_MAPTBL_PEB_TYPE_MAX);
-
-	hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
-	BUG_ON(hdr->magic != cpu_to_le16(SSDFS_PEB_TABLE_MAGIC));
-	pebs_count = le16_to_cpu(hdr->pebs_count);
-	last_selected_peb = le16_to_cpu(hdr->last_selected_peb);
-	BUG_ON(last_selected_peb >= pebs_count);
-	BUG_ON(peb_index >= pebs_count);
-	bytes_count = le32_to_cpu(hdr->bytes_count);
-
-	BUG_ON(bytes_count != (hdr_size + (pebs_count * desc_size)));
-
-	desc_array = (struct ssdfs_peb_descriptor *)(pebtbl + hdr_size);
-	desc = &desc_array[peb_index];
-
-	BUG_ON(le8_to_cpu(desc->state) != SSDFS_MAPTBL_UNKNOWN_PEB_STATE);
-	BUG_ON(le8_to_cpu(desc->type) != SSDFS_MAPTBL_UNKNOWN_PEB_TYPE);
-
-	desc->type = cpu_to_le8((u8)peb_type);
-	desc->state = cpu_to_le8(SSDFS_MAPTBL_USING_PEB_STATE);
-
-	hdr->last_selected_peb = cpu_to_le16(last_selected_peb);
+	return (u16)peb_index;
 
-	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
-	__set_bit(peb_index, bmap);
+fail_find_unused_peb:
+	SSDFS_ERR("fail to find unused peb\n");
+	return U16_MAX;
 }
 
+/*
+ * count_unused_pebs() - count unused PEBs in sequence
+ * @hdr: PEB table fragment's header
+ * @peb_index: index of the first unused PEB
+ * @max_count: upper bound of the sequence
+ *
+ * This method counts unused PEBs that follow @peb_index
+ * (including @peb_index) by words of the bitmap.
+ */
 static
-void define_peb_as_pre_erased(u8 *pebtbl, u16 peb_index)
+u16 count_unused_pebs(struct ssdfs_peb_table_fragment_header *hdr,
+		      u16 peb_index, u16 max_count)
 {
-	struct ssdfs_peb_table_fragment_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
-	struct ssdfs_peb_descriptor *desc_array, *desc;
-	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
+	u16 pebs_count = le16_to_cpu(hdr->pebs_count);
+	u32 end = min_t(u32, pebs_count, (u32)peb_index + max_count);
 	unsigned long *bmap;
-	u16 pebs_count;
-	u16 last_selected_peb;
-	u32 bytes_count;
-
-	hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
-	BUG_ON(hdr->magic != cpu_to_le16(SSDFS_PEB_TABLE_MAGIC));
-	pebs_count = le16_to_cpu(hdr->pebs_count);
-	last_selected_peb = le16_to_cpu(hdr->last_selected_peb);
-	BUG_ON(last_selected_peb >= pebs_count);
-	BUG_ON(peb_index >= pebs_count);
-	bytes_count = le32_to_cpu(hdr->bytes_count);
-
-	BUG_ON(bytes_count != (hdr_size + (pebs_count * desc_size)));
-
-	desc_array = (struct ssdfs_peb_descriptor *)(pebtbl + hdr_size);
-	desc = &desc_array[peb_index];
+	unsigned long word;
+	u32 index;
 
-	BUG_ON(le8_to_cpu(desc->state) != SSDFS_MAPTBL_UNKNOWN_PEB_STATE);
-	BUG_ON(le8_to_cpu(desc->type) != SSDFS_MAPTBL_UNKNOWN_PEB_TYPE);
-
-	desc->type = cpu_to_le8(SSDFS_MAPTBL_UNKNOWN_PEB_TYPE);
-	desc->state = cpu_to_le8(SSDFS_MAPTBL_PRE_ERASE_STATE);
-
-	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_DIRTY_BMAP][0];
-	__set_bit(peb_index, bmap);
-}
-
-static inline
-u16 DEFINE_PEB_INDEX_IN_PORTION(u16 stripe_index,
-				u16 item_index)
-{
-	u32 peb_index;
+	bmap = (unsigned long *)&hdr->bmaps[SSDFS_PEBTBL_USED_BMAP][0];
 
-	peb_index = SSDFS_PEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
-	peb_index *= stripe_index;
-	peb_index += item_index;
+	if (peb_index >= end)
+		return 0;
 
-	BUG_ON(peb_index >= U16_MAX);
+	index = BITOP_WORD(peb_index);
+	word = bmap[index] & BITMAP_FIRST_WORD_MASK(peb_index);
 
-	return (u16)peb_index;
-}
+	while (word == 0) {
+		index++;
+		if (((u32)index * BITS_PER_LONG) >= end)
+			return (u16)(end - peb_index);
+		word = bmap[index];
+	}
 
-static
-void define_leb_as_mapped(u8 *lebtbl, u16 leb_desc_index, u16 physical_index)
-{
-	struct ssdfs_leb_table_fragment_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
-	struct ssdfs_leb_descriptor *desc_array, *desc;
-	size_t desc_size = sizeof(struct ssdfs_leb_descriptor);
-	u16 lebs_count;
-	u16 mapped_lebs, migrating_lebs;
-	u32 bytes_count;
-
-	hdr = (struct ssdfs_leb_table_fragment_header *)lebtbl;
-	BUG_ON(hdr->magic != cpu_to_le16(SSDFS_LEB_TABLE_MAGIC));
-
-	lebs_count = le16_to_cpu(hdr->lebs_count);
-	BUG_ON(lebs_count == 0);
-	mapped_lebs = le16_to_cpu(hdr->mapped_lebs);
-	BUG_ON(mapped_lebs > lebs_count);
-	migrating_lebs = le16_to_cpu(hdr->migrating_lebs);
-	BUG_ON(migrating_lebs > lebs_count);
-	BUG_ON((mapped_lebs + migrating_lebs) > lebs_count);
-	bytes_count = le32_to_cpu(hdr->bytes_count);
-	BUG_ON(bytes_count != (hdr_size + (lebs_count * desc_size)));
-
-	desc_array = (struct ssdfs_leb_descriptor *)(lebtbl + hdr_size);
-	desc = &desc_array[leb_desc_index];
-
-	desc->physical_index = cpu_to_le16(physical_index);
-	desc->relation_index = cpu_to_le16(U16_MAX);
-
-	mapped_lebs++;
-	hdr->mapped_lebs = cpu_to_le16(mapped_lebs);
+	end = min_t(u32, end, (index * BITS_PER_LONG) + __builtin_ctzl(word));
+	return (u16)(end - peb_index);
 }
 
+/*
+ * get_stripe_index() - define stripe of LEB
+ * @layout: pointer on volume layout
+ * @lebtbl_hdr: LEB table fragment's header
+ * @leb_id: LEB ID
+ * @lebs_in_stripe: number of following LEBs in the same stripe [out]
+ *
+ * This method calculates the index of stripe for @leb_id and
+ * the number of LEBs (starting from @leb_id) that belong
+ * to the same stripe.
+ */
 static inline
 u16 get_stripe_index(struct ssdfs_volume_layout *layout,
 		     struct ssdfs_leb_table_fragment_header *lebtbl_hdr,
-		     u64 leb_id)
+		     u64 leb_id, u32 *lebs_in_stripe)
 {
 	u16 stripes_per_portion = layout->maptbl.stripes_per_portion;
 	u32 pebs_per_seg = (u32)(layout->seg_size / layout->env.erase_size);
@@ -983,9 +976,11 @@ u16 get_stripe_index(struct ssdfs_volume_layout *layout,
 	start_leb = le64_to_cpu(lebtbl_hdr->start_leb);
 	peb_desc_per_stripe = SSDFS_PEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
 
-	if (stripes_per_portion == 1)
+	if (stripes_per_portion == 1) {
 		stripe_index = (leb_id - start_leb) / peb_desc_per_stripe;
-	else if (pebs_per_seg > stripes_per_portion) {
+		*lebs_in_stripe = peb_desc_per_stripe -
+				((leb_id - start_leb) % peb_desc_per_stripe);
+	} else if (pebs_per_seg > stripes_per_portion) {
 		u32 leb_index_per_stripe;
 
 		leb_index_per_stripe = pebs_per_seg + stripes_per_portion - 1;
@@ -993,17 +988,39 @@ u16 get_stripe_index(struct ssdfs_volume_layout *layout,
 
 		BUG_ON((leb_index / leb_index_per_stripe) >= U16_MAX);
 		stripe_index = (u16)(leb_index / leb_index_per_stripe);
+		*lebs_in_stripe = leb_index_per_stripe -
+				(leb_index % leb_index_per_stripe);
+		*lebs_in_stripe = min_t(u32, *lebs_in_stripe,
+					pebs_per_seg - leb_index);
 	} else {
 		BUG_ON(pebs_per_seg >= U16_MAX);
 		stripe_index = (u16)(leb_index / pebs_per_seg);
+		*lebs_in_stripe = U32_MAX;
 	}
 
 	return stripe_index;
 }
 
+/*
+ * map_lebs2pebs() - map sequence of LEBs on PEBs
+ * @layout: pointer on volume layout
+ * @leb_id: first LEB ID of the sequence
+ * @count: number of LEBs in the sequence
+ * @meta_index: metadata type of the LEBs
+ * @mapped: number of mapped LEBs [out]
+ *
+ * This method maps the longest prefix of the sequence that
+ * belongs to one LEB table fragment and to one stripe. All LEBs
+ * of the prefix receive the sequence of unused PEBs of the stripe.
+ *
+ * RETURN:
+ * [success] - PEB ID of the first mapped LEB.
+ * [failure] - U64_MAX.
+ */
 static
-u64 map_leb2peb(struct ssdfs_volume_layout *layout,
-		u64 leb_id, int meta_index)
+u64 map_lebs2pebs(struct ssdfs_volume_layout *layout,
+		  u64 leb_id, u32 count, int meta_index,
+		  u16 *mapped)
 {
 	struct ssdfs_leb_table_fragment_header *lebtbl_hdr;
 	u8 *lebtbl;
@@ -1014,18 +1031,31 @@ u64 map_leb2peb(struct ssdfs_volume_layout *layout,
 	u64 start_leb, start_peb;
 	u16 lebs_count;
 	u16 stripe_index;
+	u32 lebs_in_stripe;
 	u16 peb_index;
 	u16 leb_desc_index;
 	u16 physical_index;
+	u32 leb_desc_per_mempage;
+	int peb_type;
 
 	SSDFS_DBG(layout->env.show_debug,
-		  "layout %p, leb_id %llu, meta_index %#x\n",
-		  layout, leb_id, meta_index);
+		  "layout %p, leb_id %llu, count %u, meta_index %#x\n",
+		  layout, leb_id, count, meta_index);
+
+	*mapped = 0;
+
+	BUG_ON(count == 0);
 
 	lebtbl = get_lebtbl_fragment(layout, leb_id,
 				     &fragment_index,
 				     &portion_index,
 				     &leb_desc_index);
+	if (!lebtbl) {
+		SSDFS_ERR("fail to get LEB table: leb_id %llu\n",
+			  leb_id);
+		return U64_MAX;
+	}
+
 	lebtbl_hdr = (struct ssdfs_leb_table_fragment_header *)lebtbl;
 
 	BUG_ON(lebtbl_hdr->magic != cpu_to_le16(SSDFS_LEB_TABLE_MAGIC));
@@ -1036,10 +1066,24 @@ u64 map_leb2peb(struct ssdfs_volume_layout *layout,
 	BUG_ON(leb_id < start_leb);
 	BUG_ON(leb_id >= (start_leb + lebs_count));
 
-	stripe_index = get_stripe_index(layout, lebtbl_hdr, leb_id);
+	stripe_index = get_stripe_index(layout, lebtbl_hdr, leb_id,
+					&lebs_in_stripe);
+
+	leb_desc_per_mempage = SSDFS_LEB_DESC_PER_FRAGMENT(PAGE_CACHE_SIZE);
+	count = min_t(u32, count, lebs_in_stripe);
+	count = min_t(u32, count, leb_desc_per_mempage - leb_desc_index);
+	count = min_t(u32, count, (start_leb + lebs_count) - leb_id);
 
 	pebtbl = get_pebtbl_fragment(layout, fragment_index,
 				     portion_index, stripe_index);
+	if (!pebtbl) {
+		SSDFS_ERR("fail to get PEB table: "
+			  "fragment_index %u, portion_index %u, "
+			  "stripe_index %u\n",
+			  fragment_index, portion_index, stripe_index);
+		return U64_MAX;
+	}
+
 	pebtbl_hdr = (struct ssdfs_peb_table_fragment_header *)pebtbl;
 
 	BUG_ON(pebtbl_hdr->magic != cpu_to_le16(SSDFS_PEB_TABLE_MAGIC));
@@ -1054,16 +1098,26 @@ u64 map_leb2peb(struct ssdfs_volume_layout *layout,
 		return U64_MAX;
 	}
 
-	define_peb_as_used(pebtbl, peb_index, meta_index);
+	*mapped = count_unused_pebs(pebtbl_hdr, peb_index,
+				    (u16)min_t(u32, count, U16_MAX));
+	BUG_ON(*mapped == 0);
+
+	BUG_ON(meta_index > SSDFS_METADATA_ITEMS_MAX);
+	peb_type = SEG2PEB_TYPE(META2SEG_TYPE(meta_index));
+
+	ssdfs_maptbl_define_pebs_as_used(pebtbl, peb_index, *mapped,
+					 peb_type, SSDFS_MAPTBL_USING_PEB_STATE);
 
 	physical_index = DEFINE_PEB_INDEX_IN_PORTION(stripe_index, peb_index);
-	define_leb_as_mapped(lebtbl, leb_desc_index, physical_index);
+	ssdfs_maptbl_define_lebs_as_mapped(lebtbl, leb_desc_index,
+					   physical_index, *mapped);
 
 	start_peb = le64_to_cpu(pebtbl_hdr->start_peb);
 
 	SSDFS_DBG(layout->env.show_debug,
-		  "peb_index %u, physical_index %u, start_peb %llu\n",
-		  peb_index, physical_index, start_peb);
+		  "peb_index %u, physical_index %u, start_peb %llu, "
+		  "mapped %u\n",
+		  peb_index, physical_index, start_peb, *mapped);
 
 	return start_peb + peb_index;
 }
@@ -1074,6 +1128,9 @@ int map_segment_lebs2pebs(struct ssdfs_volume_layout *layout,
 {
 	struct ssdfs_peb_content *peb;
 	u64 leb_id, peb_id;
+	u32 count;
+	u16 mapped;
+	u16 k;
 	int i;
 	int err;
 
@@ -1081,9 +1138,10 @@ int map_segment_lebs2pebs(struct ssdfs_volume_layout *layout,
 		  "layout %p, pebs_count %u, pebs_capacity %u\n",
 		  layout, segment->pebs_count, segment->pebs_capacity);
 
-	for (i = 0; i < segment->pebs_capacity; i++) {
+	for (i = 0; i < segment->pebs_capacity; i += mapped) {
 		peb = &segment->pebs[i];
 		leb_id = peb->leb_id;
+		mapped = 1;
 
 		if (leb_id == U64_MAX) {
 			SSDFS_DBG(layout->env.show_debug,
@@ -1091,7 +1149,14 @@ int map_segment_lebs2pebs(struct ssdfs_volume_layout *layout,
 			continue;
 		}
 
-		peb_id = map_leb2peb(layout, leb_id, segment->seg_type);
+		/* sequence of contiguous LEBs */
+		for (count = 1; (i + count) < segment->pebs_capacity; count++) {
+			if (segment->pebs[i + count].leb_id != (leb_id + count))
+				break;
+		}
+
+		peb_id = map_lebs2pebs(layout, leb_id, count,
+					segment->seg_type, &mapped);
 		if (peb_id == U64_MAX) {
 			SSDFS_ERR("fail to map LEB to PEB: "
 				  "leb_id %llu\n",
@@ -1099,19 +1164,22 @@ int map_segment_lebs2pebs(struct ssdfs_volume_layout *layout,
 			return -ERANGE;
 		}
 
-		err = cache_leb2peb_pair(layout, leb_id, peb_id);
-		if (err) {
-			SSDFS_ERR("fail to cache leb2peb pair: "
-				  "leb_id %llu, peb_id %llu, err %d\n",
-				  leb_id, peb_id, err);
-			return err;
-		}
+		for (k = 0; k < mapped; k++) {
+			err = cache_leb2peb_pair(layout, leb_id + k,
+						 peb_id + k);
+			if (err) {
+				SSDFS_ERR("fail to cache leb2peb pair: "
+					  "leb_id %llu, peb_id %llu, err %d\n",
+					  leb_id + k, peb_id + k, err);
+				return err;
+			}
 
-		SSDFS_DBG(layout->env.show_debug,
-			  "peb_index %d, leb_id %llu, peb_id %llu\n",
-			  i, leb_id, peb_id);
+			SSDFS_DBG(layout->env.show_debug,
+				  "peb_index %d, leb_id %llu, peb_id %llu\n",
+				  i + k, leb_id + k, peb_id + k);
 
-		peb->peb_id = peb_id;
+			segment->pebs[i + k].peb_id = peb_id + k;
+		}
 	}
 
 	return 0;
@@ -1158,28 +1226,103 @@ int map_allocated_lebs2pebs(struct ssdfs_volume_layout *layout)
 	return 0;
 }
 
+/*
+ * maptbl_mark_fragment_pre_erased() - mark unallocated PEBs of fragment
+ * @layout: pointer on volume layout
+ * @fragment_index: index of fragment (PEB of mapping table)
+ *
+ * Every PEB starting from @pre_erased_start_peb is unallocated.
+ * The rest of every stripe of fragment is filled as a whole range
+ * of PEB descriptors.
+ */
 static
-int mark_unallocated_pebs_as_pre_erased(struct ssdfs_volume_layout *layout)
+void maptbl_mark_fragment_pre_erased(struct ssdfs_volume_layout *layout,
+				     u32 fragment_index)
 {
-	struct ssdfs_segment_desc *segment;
-	struct ssdfs_leb_table_fragment_header *lebtbl_hdr;
-	u8 *lebtbl;
 	struct ssdfs_peb_table_fragment_header *pebtbl_hdr;
+	u8 *fragment;
 	u8 *pebtbl;
 	u16 stripes_per_portion = layout->maptbl.stripes_per_portion;
-	u32 fragment_index;
-	u32 portion_index;
-	u16 leb_desc_index;
+	u16 portions_per_fragment = layout->maptbl.portions_per_fragment;
+	u32 pebs_per_portion = layout->maptbl.pebs_per_portion;
+	u32 portions_count = layout->maptbl.portions_count;
+	size_t portion_size = layout->maptbl.portion_size;
+	u32 lebtbl_portion_bytes = layout->maptbl.lebtbl_portion_bytes;
+	u64 peb_id = layout->maptbl.pre_erased_start_peb;
+	u64 start_peb;
+	u16 pebs_count;
+	u16 peb_index;
+	u32 start_portion, end_portion;
+	u32 i;
+	u16 j;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "fragment_index %u, peb_id %llu\n",
+		  fragment_index, peb_id);
+
+	fragment = layout->maptbl.fragments_array[fragment_index];
+	BUG_ON(!fragment);
+
+	start_portion = fragment_index * portions_per_fragment;
+	end_portion = min_t(u32, start_portion + portions_per_fragment,
+			    portions_count);
+
+	for (i = start_portion; i < end_portion; i++) {
+		if (((u64)(i + 1) * pebs_per_portion) <= peb_id)
+			continue;
+
+		for (j = 0; j < stripes_per_portion; j++) {
+			pebtbl = fragment;
+			pebtbl += (i - start_portion) * portion_size;
+			pebtbl += lebtbl_portion_bytes;
+			pebtbl += j * layout->page_size;
+
+			pebtbl_hdr =
+			    (struct ssdfs_peb_table_fragment_header *)pebtbl;
+
+			BUG_ON(pebtbl_hdr->magic !=
+					cpu_to_le16(SSDFS_PEB_TABLE_MAGIC));
+
+			start_peb = le64_to_cpu(pebtbl_hdr->start_peb);
+			pebs_count = le16_to_cpu(pebtbl_hdr->pebs_count);
+
+			SSDFS_DBG(layout->env.show_debug,
+				  "start_peb %llu, pebs_count %u, peb_id %llu\n",
+				  start_peb, pebs_count, peb_id);
+
+			if (pebs_count == 0)
+				continue;
+
+			if ((start_peb + pebs_count) <= peb_id)
+				continue;
+
+			if (peb_id > start_peb)
+				peb_index = (u16)(peb_id - start_peb);
+			else
+				peb_index = 0;
+
+			ssdfs_maptbl_define_pebs_as_pre_erased(pebtbl,
+							peb_index,
+							pebs_count - peb_index);
+		}
+	}
+}
+
+static
+int mark_unallocated_pebs_as_pre_erased(struct ssdfs_volume_layout *layout)
+{
+	struct ssdfs_segment_desc *segment;
 	u64 leb_id;
 	u64 peb_id;
 	u64 total_pebs_count;
-	u64 start_leb, start_peb;
-	u16 lebs_count, pebs_count;
 	u64 unallocated_pebs;
-	u16 stripe_index;
-	int i, j;
+	u32 i;
 
-	if (layout->need_erase_device) {
+	/*
+	 * Quick format erases only PEBs used by existing volume.
+	 * Stale PEBs that were missed have to be erased by driver.
+	 */
+	if (layout->need_erase_device && !layout->quick_format) {
 		SSDFS_DBG(layout->env.show_debug,
 			  "do nothing: volume will be erased by mkfs\n");
 		return 0;
@@ -1203,64 +1346,12 @@ int mark_unallocated_pebs_as_pre_erased(struct ssdfs_volume_layout *layout)
 
 	unallocated_pebs = total_pebs_count - leb_id;
 
-	while (leb_id < total_pebs_count) {
-		lebtbl = get_lebtbl_fragment(layout, leb_id,
-					     &fragment_index,
-					     &portion_index,
-					     &leb_desc_index);
-		lebtbl_hdr = (struct ssdfs_leb_table_fragment_header *)lebtbl;
-
-		BUG_ON(lebtbl_hdr->magic != cpu_to_le16(SSDFS_LEB_TABLE_MAGIC));
-
-		start_leb = le64_to_cpu(lebtbl_hdr->start_leb);
-		lebs_count = le16_to_cpu(lebtbl_hdr->lebs_count);
-
-		SSDFS_DBG(layout->env.show_debug,
-			  "start_leb %llu, lebs_count %u\n",
-			  start_leb, lebs_count);
-
-		BUG_ON(leb_id < start_leb);
-		BUG_ON(leb_id >= (start_leb + lebs_count));
-
-		stripe_index = get_stripe_index(layout, lebtbl_hdr, leb_id);
-
-		for (i = stripe_index; i < stripes_per_portion; i++) {
-			u64 peb_index;
-
-			pebtbl = get_pebtbl_fragment(layout, fragment_index,
-						     portion_index, i);
-			pebtbl_hdr =
-			    (struct ssdfs_peb_table_fragment_header *)pebtbl;
-
-			BUG_ON(pebtbl_hdr->magic !=
-					cpu_to_le16(SSDFS_PEB_TABLE_MAGIC));
-
-			start_peb = le64_to_cpu(pebtbl_hdr->start_peb);
-			pebs_count = le64_to_cpu(pebtbl_hdr->pebs_count);
-
-			SSDFS_DBG(layout->env.show_debug,
-				  "start_peb %llu, pebs_count %u, peb_id %llu\n",
-				  start_peb, pebs_count, peb_id);
+	layout->maptbl.pre_erased_start_peb = peb_id;
 
-			BUG_ON(peb_id < start_peb);
-
-			if (pebs_count == 0)
-				goto define_next_peb_id;
-
-			BUG_ON(peb_id >= (start_peb + pebs_count));
-
-			peb_index = peb_id - start_peb;
-			BUG_ON(peb_index >= U16_MAX || peb_index >= pebs_count);
-
-			for (j = peb_index; j < pebs_count; j++) {
-				define_peb_as_pre_erased(pebtbl, j);
-			}
-
-define_next_peb_id:
-			peb_id = start_peb + pebs_count;
-		}
-
-		leb_id = start_leb + lebs_count;
+	/* fragments that are not created yet will be marked on creation */
+	for (i = 0; i < layout->maptbl.maptbl_pebs; i++) {
+		if (layout->maptbl.fragments_array[i])
+			maptbl_mark_fragment_pre_erased(layout, i);
 	}
 
 	layout->maptbl.pre_erased_pebs = unallocated_pebs;
@@ -1545,6 +1636,13 @@ int maptbl_mkfs_validate(struct ssdfs_volume_layout *layout)
 		return err;
 	}
 
+	err = maptbl_cache_mkfs_pack(layout);
+	if (err) {
+		SSDFS_ERR("fail to pack maptbl cache: err %d\n",
+			  err);
+		return err;
+	}
+
 	err = mark_unallocated_pebs_as_pre_erased(layout);
 	if (err) {
 		SSDFS_ERR("fail to mark unallocated PEBs as pre-erased: err %d\n",
@@ -1859,10 +1957,8 @@ int maptbl_mkfs_define_layout(struct ssdfs_volume_layout *layout)
 			extent->buf =
 				layout->maptbl.fragments_array[fragment_index];
 			if (!extent->buf) {
-				SSDFS_ERR("invalid fragment pointer: "
-					  "buffer_index %d\n",
-					  i + j);
-				return -ERANGE;
+				/* fragment will be generated before write */
+				peb_desc->is_deferred = SSDFS_TRUE;
 			}
 			layout->maptbl.fragments_array[fragment_index] = NULL;
 
@@ -1945,44 +2041,6 @@ int maptbl_mkfs_define_layout(struct ssdfs_volume_layout *layout)
 	return 0;
 }
 
-static inline
-void calculate_lebtbl_fragment_checksum(u8 *ptr)
-{
-	struct ssdfs_leb_table_fragment_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_leb_table_fragment_header);
-	u32 bytes_count;
-
-	hdr = (struct ssdfs_leb_table_fragment_header *)ptr;
-
-	BUG_ON(le16_to_cpu(hdr->magic) != SSDFS_LEB_TABLE_MAGIC);
-
-	bytes_count = le32_to_cpu(hdr->bytes_count);
-
-	BUG_ON(bytes_count < hdr_size);
-
-	hdr->checksum = 0;
-	hdr->checksum = ssdfs_crc32_le(ptr, bytes_count);
-}
-
-static inline
-void calculate_pebtbl_fragment_checksum(u8 *ptr)
-{
-	struct ssdfs_peb_table_fragment_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
-	u32 bytes_count;
-
-	hdr = (struct ssdfs_peb_table_fragment_header *)ptr;
-
-	BUG_ON(le16_to_cpu(hdr->magic) != SSDFS_PEB_TABLE_MAGIC);
-
-	bytes_count = le32_to_cpu(hdr->bytes_count);
-
-	BUG_ON(bytes_count < hdr_size);
-
-	hdr->checksum = 0;
-	hdr->checksum = ssdfs_crc32_le(ptr, bytes_count);
-}
-
 static
 void calculate_peb_fragments_checksum(struct ssdfs_volume_layout *layout,
 					void *fragments)
@@ -2007,7 +2065,7 @@ void calculate_peb_fragments_checksum(struct ssdfs_volume_layout *layout,
 			u8 *lebtbl_ptr;
 
 			lebtbl_ptr = ptr + (j * layout->page_size);
-			calculate_lebtbl_fragment_checksum(lebtbl_ptr);
+			ssdfs_maptbl_calculate_lebtbl_checksum(lebtbl_ptr);
 		}
 
 		ptr += lebtbl_portion_bytes;
@@ -2016,7 +2074,7 @@ void calculate_peb_fragments_checksum(struct ssdfs_volume_layout *layout,
 			u8 *pebtbl_ptr;
 
 			pebtbl_ptr = ptr + (j * layout->page_size);
-			calculate_pebtbl_fragment_checksum(pebtbl_ptr);
+			ssdfs_maptbl_calculate_pebtbl_checksum(pebtbl_ptr);
 		}
 	}
 }
@@ -2047,6 +2105,60 @@ void maptbl_define_migration_threshold(struct ssdfs_volume_layout *layout,
 			cpu_to_le16(layout->maptbl.migration_threshold);
 }
 
+static
+int maptbl_commit_peb(struct ssdfs_volume_layout *layout,
+		      int seg_index, int peb_index)
+{
+	struct ssdfs_peb_content *peb_desc;
+	struct ssdfs_extent_desc *extent;
+	u32 metadata_blks;
+	u32 blks;
+	int err;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "layout %p, seg_index %d, peb_index %d\n",
+		  layout, seg_index, peb_index);
+
+	peb_desc = &layout->segs[seg_index].pebs[peb_index];
+	extent = &peb_desc->extents[SSDFS_LOG_PAYLOAD];
+	BUG_ON(!extent->buf);
+
+	err = pre_commit_segment_header(layout, seg_index, peb_index,
+					SSDFS_MAPTBL_SEG_TYPE);
+	if (err)
+		return err;
+
+	calculate_peb_fragments_checksum(layout, extent->buf);
+
+	err = pre_commit_log_footer(layout, seg_index, peb_index);
+	if (err)
+		return err;
+
+	maptbl_define_migration_threshold(layout, seg_index, peb_index);
+
+	metadata_blks = calculate_metadata_blks(layout,
+						SSDFS_MAPTBL_SEG_TYPE,
+						peb_desc);
+
+	commit_block_bitmap(layout, seg_index, peb_index, metadata_blks);
+	commit_offset_table(layout, seg_index, peb_index);
+	commit_block_descriptors(layout, seg_index, peb_index);
+
+	if (layout->blkbmap.has_backup_copy) {
+		commit_block_bitmap_backup(layout, seg_index,
+					   peb_index, metadata_blks);
+	}
+
+	if (layout->blk2off_tbl.has_backup_copy)
+		commit_offset_table_backup(layout, seg_index, peb_index);
+
+	blks = calculate_log_pages(layout, SSDFS_MAPTBL_SEG_TYPE, peb_desc);
+	commit_log_footer(layout, seg_index, peb_index, blks);
+	commit_segment_header(layout, seg_index, peb_index, blks);
+
+	return 0;
+}
+
 int maptbl_mkfs_commit(struct ssdfs_volume_layout *layout)
 {
 	struct ssdfs_metadata_desc *meta_desc;
@@ -2055,7 +2167,6 @@ int maptbl_mkfs_commit(struct ssdfs_volume_layout *layout)
 	u32 maptbl_pebs;
 	u32 pebs_per_seg;
 	u32 portions_count = layout->maptbl.portions_count;
-	u32 metadata_blks;
 	int i, j;
 	int fragment_index = 0;
 	int err;
@@ -2090,7 +2201,6 @@ int maptbl_mkfs_commit(struct ssdfs_volume_layout *layout)
 			struct ssdfs_leb_table_fragment_header *hdr;
 			struct ssdfs_peb_content *peb_desc;
 			struct ssdfs_extent_desc *extent;
-			u32 blks;
 
 			if (fragment_index >= portions_count)
 				break;
@@ -2098,6 +2208,13 @@ int maptbl_mkfs_commit(struct ssdfs_volume_layout *layout)
 			BUG_ON(j >= layout->segs[seg_index].pebs_capacity);
 
 			peb_desc = &layout->segs[seg_index].pebs[j];
+
+			if (peb_desc->is_deferred) {
+				/* it will be committed before write */
+				fragment_index++;
+				continue;
+			}
+
 			extent = &peb_desc->extents[SSDFS_LOG_PAYLOAD];
 			BUG_ON(!extent->buf);
 
@@ -2107,53 +2224,81 @@ int maptbl_mkfs_commit(struct ssdfs_volume_layout *layout)
 			if (le16_to_cpu(hdr->magic) != SSDFS_LEB_TABLE_MAGIC)
 				break;
 
-			err = pre_commit_segment_header(layout, seg_index, j,
-							SSDFS_MAPTBL_SEG_TYPE);
+			err = maptbl_commit_peb(layout, seg_index, j);
 			if (err)
 				return err;
 
-			calculate_peb_fragments_checksum(layout, extent->buf);
+			fragment_index++;
+		}
 
-			err = pre_commit_log_footer(layout, seg_index,
-						    j);
-			if (err)
-				return err;
+		seg_index++;
+	}
 
-			maptbl_define_migration_threshold(layout,
-							  seg_index, j);
+	layout->segs_count += segs_count;
+	return 0;
+}
 
-			metadata_blks = calculate_metadata_blks(layout,
-							SSDFS_MAPTBL_SEG_TYPE,
-							peb_desc);
+/*
+ * maptbl_mkfs_generate_peb() - generate deferred PEB of mapping table
+ * @layout: pointer on volume layout
+ * @seg_index: index of segment in layout
+ * @peb_index: index of PEB in segment
+ *
+ * This method creates the fragment of mapping table for deferred PEB
+ * and commits the PEB's log. It is called right before the PEB
+ * is written, so only one such fragment is kept in memory.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate fragment.
+ * %-ERANGE     - invalid fragment.
+ */
+int maptbl_mkfs_generate_peb(struct ssdfs_volume_layout *layout,
+			     int seg_index, int peb_index)
+{
+	struct ssdfs_metadata_desc *meta_desc;
+	struct ssdfs_peb_content *peb_desc;
+	struct ssdfs_extent_desc *extent;
+	struct ssdfs_leb_table_fragment_header *hdr;
+	u32 pebs_per_seg;
+	u32 fragment_index;
 
-			commit_block_bitmap(layout, seg_index, j,
-					    metadata_blks);
-			commit_offset_table(layout, seg_index, j);
-			commit_block_descriptors(layout, seg_index, j);
+	peb_desc = &layout->segs[seg_index].pebs[peb_index];
 
-			if (layout->blkbmap.has_backup_copy) {
-				commit_block_bitmap_backup(layout, seg_index,
-							   j, metadata_blks);
-			}
+	if (!peb_desc->is_deferred)
+		return 0;
 
-			if (layout->blk2off_tbl.has_backup_copy) {
-				commit_offset_table_backup(layout, seg_index,
-							   j);
-			}
+	SSDFS_DBG(layout->env.show_debug,
+		  "layout %p, seg_index %d, peb_index %d\n",
+		  layout, seg_index, peb_index);
 
-			blks = calculate_log_pages(layout,
-						   SSDFS_MAPTBL_SEG_TYPE,
-						   peb_desc);
-			commit_log_footer(layout, seg_index, j, blks);
-			commit_segment_header(layout, seg_index, j,
-					      blks);
+	meta_desc = &layout->meta_array[SSDFS_PEB_MAPPING_TABLE];
+	pebs_per_seg = (u32)(layout->seg_size / layout->env.erase_size);
 
-			fragment_index++;
-		}
+	BUG_ON(seg_index < meta_desc->start_seg_index);
+	fragment_index = (seg_index - meta_desc->start_seg_index) *
+				pebs_per_seg + peb_index;
 
-		seg_index++;
+	extent = &peb_desc->extents[SSDFS_LOG_PAYLOAD];
+	BUG_ON(extent->buf);
+
+	extent->buf = (char *)maptbl_get_fragment(layout, fragment_index);
+	if (!extent->buf) {
+		SSDFS_ERR("fail to create fragment: index %u\n",
+			  fragment_index);
+		return -ENOMEM;
 	}
+	layout->maptbl.fragments_array[fragment_index] = NULL;
+	peb_desc->is_deferred = SSDFS_FALSE;
 
-	layout->segs_count += segs_count;
-	return 0;
+	hdr = (struct ssdfs_leb_table_fragment_header *)extent->buf;
+	if (le16_to_cpu(hdr->magic) != SSDFS_LEB_TABLE_MAGIC) {
+		SSDFS_ERR("invalid fragment: index %u\n",
+			  fragment_index);
+		return -ERANGE;
+	}
+
+	return maptbl_commit_peb(layout, seg_index, peb_index);
 }
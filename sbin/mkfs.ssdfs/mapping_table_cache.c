@@ -32,6 +32,7 @@ int maptbl_cache_create_fragments_array(struct ssdfs_volume_layout *layout)
 	u32 lebs_count = 0;
 	u32 fragments_count;
 	size_t fragment_size = layout->page_size;
+	size_t pair_size = sizeof(struct ssdfs_leb2peb_pair);
 	u32 leb2peb_pair_per_fragment;
 	u32 i, j;
 
@@ -54,13 +55,24 @@ int maptbl_cache_create_fragments_array(struct ssdfs_volume_layout *layout)
 	fragments_count = lebs_count + leb2peb_pair_per_fragment - 1;
 	fragments_count /= leb2peb_pair_per_fragment;
 
+	layout->maptbl_cache.pairs = calloc(lebs_count + 1, pair_size);
+	if (layout->maptbl_cache.pairs == NULL) {
+		SSDFS_ERR("fail to allocate LEB2PEB pairs array: "
+			  "lebs_count %u\n",
+			  lebs_count);
+		return -ENOMEM;
+	}
+
+	layout->maptbl_cache.pairs_count = 0;
+	layout->maptbl_cache.pairs_capacity = lebs_count;
+
 	layout->maptbl_cache.fragments_array =
 				calloc(fragments_count, sizeof(void *));
 	if (layout->maptbl_cache.fragments_array == NULL) {
 		SSDFS_ERR("fail to allocate maptbl cache's fragments array: "
 			  "buffers_count %u\n",
 			  fragments_count);
-		return -ENOMEM;
+		goto free_pairs;
 	}
 
 	for (i = 0; i < fragments_count; i++) {
@@ -80,12 +92,17 @@ int maptbl_cache_create_fragments_array(struct ssdfs_volume_layout *layout)
 	return 0;
 
 free_buffers:
-	for (i--; i >= 0; i--) {
-		free(layout->maptbl_cache.fragments_array[i]);
-		layout->maptbl_cache.fragments_array[i] = NULL;
+	for (; i > 0; i--) {
+		free(layout->maptbl_cache.fragments_array[i - 1]);
+		layout->maptbl_cache.fragments_array[i - 1] = NULL;
 	}
 	free(layout->maptbl_cache.fragments_array);
 	layout->maptbl_cache.fragments_array = NULL;
+
+free_pairs:
+	free(layout->maptbl_cache.pairs);
+	layout->maptbl_cache.pairs = NULL;
+	layout->maptbl_cache.pairs_capacity = 0;
 	return -ENOMEM;
 }
 
@@ -104,6 +121,11 @@ void maptbl_cache_destroy_fragments_array(struct ssdfs_volume_layout *layout)
 	}
 	free(layout->maptbl_cache.fragments_array);
 	layout->maptbl_cache.fragments_array = NULL;
+
+	free(layout->maptbl_cache.pairs);
+	layout->maptbl_cache.pairs = NULL;
+	layout->maptbl_cache.pairs_count = 0;
+	layout->maptbl_cache.pairs_capacity = 0;
 }
 
 static
@@ -181,363 +203,182 @@ int maptbl_cache_mkfs_prepare(struct ssdfs_volume_layout *layout)
 	return 0;
 }
 
-static
-u32 find_fragment_index(struct ssdfs_volume_layout *layout,
-			u64 leb_id)
+/*
+ * cache_leb2peb_pair() - store LEB to PEB pair for the maptbl cache
+ * @layout: pointer on volume layout
+ * @leb_id: LEB ID
+ * @peb_id: PEB ID
+ *
+ * This method only collects the pair. The collected pairs are
+ * sorted and packed into the maptbl cache's fragments by
+ * maptbl_cache_mkfs_pack() in one pass.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - pairs array is full.
+ */
+int cache_leb2peb_pair(struct ssdfs_volume_layout *layout,
+			u64 leb_id, u64 peb_id)
 {
-	u8 *ptr;
-	struct ssdfs_maptbl_cache_header *hdr;
-	u16 items_per_fragment;
-	u64 start_leb, end_leb;
-	u16 items_count;
-	u32 i = 0;
+	struct ssdfs_maptbl_cache_layout *cache = &layout->maptbl_cache;
+	struct ssdfs_leb2peb_pair *pair;
 
 	SSDFS_DBG(layout->env.show_debug,
-		  "layout %p, leb_id %llu\n", layout, leb_id);
+		  "layout %p, leb_id %llu, peb_id %llu\n",
+		  layout, leb_id, peb_id);
 
 	BUG_ON(leb_id == U64_MAX);
+	BUG_ON(peb_id == U64_MAX);
 
-	items_per_fragment = SSDFS_LEB2PEB_PAIR_PER_FRAGMENT(layout->page_size);
-
-	for (; i < layout->maptbl_cache.fragments_count; i++) {
-		ptr = (u8 *)layout->maptbl_cache.fragments_array[i];
-		hdr = (struct ssdfs_maptbl_cache_header *)ptr;
-
-		BUG_ON(le16_to_cpu(hdr->magic.key) != SSDFS_MAPTBL_CACHE_MAGIC);
-
-		start_leb = le64_to_cpu(hdr->start_leb);
-		end_leb = le64_to_cpu(hdr->end_leb);
-		items_count = le16_to_cpu(hdr->items_count);
-
-		if (start_leb == U64_MAX)
-			break;
-		else if (leb_id >= start_leb && leb_id <= end_leb)
-			break;
-		else if (leb_id > end_leb && items_count < items_per_fragment)
-			break;
-	}
-
-	return i;
-}
-
-static inline
-int __ssdfs_maptbl_cache_area_size(struct ssdfs_maptbl_cache_header *hdr,
-				   size_t *leb2peb_area_size,
-				   size_t *peb_state_area_size)
-{
-	size_t hdr_size = sizeof(struct ssdfs_maptbl_cache_header);
-	size_t pair_size = sizeof(struct ssdfs_leb2peb_pair);
-	size_t peb_state_size = sizeof(struct ssdfs_maptbl_cache_peb_state);
-	size_t magic_size = peb_state_size;
-	u16 bytes_count;
-	u16 items_count;
-	size_t threshold_size;
-	size_t capacity;
-
-	*leb2peb_area_size = 0;
-	*peb_state_area_size = magic_size;
-
-	bytes_count = le16_to_cpu(hdr->bytes_count);
-	items_count = le16_to_cpu(hdr->items_count);
-
-	threshold_size = hdr_size + magic_size;
-
-	if (bytes_count < threshold_size) {
-		SSDFS_ERR("fragment is corrupted: "
-			  "hdr_size %zu, bytes_count %u\n",
-			  hdr_size, bytes_count);
-		return -ERANGE;
-	} else if (bytes_count == threshold_size) {
-		return -ENODATA;
-	}
-
-	capacity =
-		(bytes_count - threshold_size) / (pair_size + peb_state_size);
-
-	if (items_count > capacity) {
-		SSDFS_ERR("items_count %u > capacity %zu\n",
-			  items_count, capacity);
+	if (cache->pairs_count >= cache->pairs_capacity) {
+		SSDFS_ERR("pairs array is full: "
+			  "pairs_count %u, pairs_capacity %u\n",
+			  cache->pairs_count, cache->pairs_capacity);
 		return -ERANGE;
 	}
 
-	*leb2peb_area_size = capacity * pair_size;
-	*peb_state_area_size = magic_size + (capacity * peb_state_size);
+	pair = &cache->pairs[cache->pairs_count];
+	pair->leb_id = cpu_to_le64(leb_id);
+	pair->peb_id = cpu_to_le64(peb_id);
+	cache->pairs_count++;
 
 	return 0;
 }
 
-static inline
-int ssdfs_peb_state_area_size(struct ssdfs_maptbl_cache_header *hdr)
-{
-	size_t leb2peb_area_size;
-	size_t peb_state_area_size;
-	int err;
-
-	err = __ssdfs_maptbl_cache_area_size(hdr,
-					     &leb2peb_area_size,
-					     &peb_state_area_size);
-	if (err == -ENODATA) {
-		/* empty area */
-		err = 0;
-	} else if (err) {
-		SSDFS_ERR("fail to define peb state area size: "
-			  "err %d\n",
-			  err);
-		return err;
-	}
-
-	return (int)peb_state_area_size;
-}
-
-static inline
-struct ssdfs_leb2peb_pair *LEB2PEB_PAIR_AREA(u8 *fragment)
-{
-	size_t hdr_size = sizeof(struct ssdfs_maptbl_cache_header);
-
-	return (struct ssdfs_leb2peb_pair *)(fragment + hdr_size);
-}
-
-static inline
-void *PEB_STATE_AREA(u8 *fragment)
-{
-	struct ssdfs_maptbl_cache_header *hdr;
-	size_t hdr_size = sizeof(struct ssdfs_maptbl_cache_header);
-	size_t leb2peb_area_size;
-	size_t peb_state_area_size;
-	void *start = NULL;
-	__le32 *magic = NULL;
-	int err;
-
-	hdr = (struct ssdfs_maptbl_cache_header *)fragment;
-
-	err = __ssdfs_maptbl_cache_area_size(hdr,
-					     &leb2peb_area_size,
-					     &peb_state_area_size);
-	if (err == -ENODATA) {
-		/* empty area */
-		err = 0;
-	} else if (err) {
-		SSDFS_ERR("fail to get area size: err %d\n", err);
-		return ERR_PTR(err);
-	}
-
-	start = fragment + hdr_size + leb2peb_area_size;
-	magic = (__le32 *)start;
-
-	if (le32_to_cpu(*magic) != SSDFS_MAPTBL_CACHE_PEB_STATE_MAGIC) {
-		SSDFS_ERR("invalid magic %#x\n",
-			  le32_to_cpu(*magic));
-		return ERR_PTR(-ERANGE);
-	}
-
-	return start;
-}
-
-static inline
-struct ssdfs_maptbl_cache_peb_state *FIRST_PEB_STATE(u8 *fragment)
+static
+int leb2peb_pair_cmp(const void *item1, const void *item2)
 {
-	size_t peb_state_size = sizeof(struct ssdfs_maptbl_cache_peb_state);
-	size_t magic_size = peb_state_size;
-	void *start = PEB_STATE_AREA(fragment);
+	const struct ssdfs_leb2peb_pair *pair1 = item1;
+	const struct ssdfs_leb2peb_pair *pair2 = item2;
+	u64 leb_id1 = le64_to_cpu(pair1->leb_id);
+	u64 leb_id2 = le64_to_cpu(pair2->leb_id);
 
-	if (IS_ERR(start))
-		return (struct ssdfs_maptbl_cache_peb_state *)start;
+	if (leb_id1 != leb_id2)
+		return leb_id1 < leb_id2 ? -1 : 1;
 
-	if (!start)
-		return ERR_PTR(-ERANGE);
-
-	return (struct ssdfs_maptbl_cache_peb_state *)((u8 *)start +
-							magic_size);
+	return 0;
 }
 
 static
-int add_leb2peb_pair(struct ssdfs_volume_layout *layout,
-		     u8 *fragment,
-		     struct ssdfs_leb2peb_pair *new_pair,
-		     struct ssdfs_leb2peb_pair *moving_pair,
-		     struct ssdfs_maptbl_cache_peb_state *new_state,
-		     struct ssdfs_maptbl_cache_peb_state *moving_state)
+void maptbl_cache_pack_fragment(struct ssdfs_volume_layout *layout,
+				u8 *fragment,
+				struct ssdfs_leb2peb_pair *pairs,
+				u16 items_count)
 {
 	struct ssdfs_maptbl_cache_header *hdr;
-	u16 items_per_fragment;
-	u16 items_count;
-	struct ssdfs_leb2peb_pair *leb2peb_pairs = NULL;
+	struct ssdfs_maptbl_cache_peb_state *peb_states;
 	size_t pair_size = sizeof(struct ssdfs_leb2peb_pair);
-	struct ssdfs_maptbl_cache_peb_state *peb_states = NULL;
 	size_t peb_state_size = sizeof(struct ssdfs_maptbl_cache_peb_state);
 	size_t magic_size = peb_state_size;
-	u16 item_index = 0;
+	u8 *area;
+	__le32 *magic;
 	u16 bytes_count;
-	int need_moving = SSDFS_FALSE;
-	int i;
-	int err;
+	u16 i;
 
 	SSDFS_DBG(layout->env.show_debug,
-		  "layout %p\n", layout);
+		  "layout %p, fragment %p, items_count %u\n",
+		  layout, fragment, items_count);
 
-	hdr = (struct ssdfs_maptbl_cache_header *)fragment;
+	BUG_ON(items_count == 0);
 
-	items_per_fragment = SSDFS_LEB2PEB_PAIR_PER_FRAGMENT(layout->page_size);
-	items_count = le16_to_cpu(hdr->items_count);
-	BUG_ON(items_count > items_per_fragment);
+	hdr = (struct ssdfs_maptbl_cache_header *)fragment;
+	BUG_ON(le16_to_cpu(hdr->magic.key) != SSDFS_MAPTBL_CACHE_MAGIC);
 
-	leb2peb_pairs = LEB2PEB_PAIR_AREA(fragment);
+	area = fragment + SSDFS_MAPTBL_CACHE_HDR_SIZE;
+	memcpy(area, pairs, items_count * pair_size);
 
-	peb_states = FIRST_PEB_STATE(fragment);
-	if (IS_ERR(peb_states)) {
-		SSDFS_ERR("fail to get first PEB state: "
-			  "err %d\n",
-			  (int)PTR_ERR(peb_states));
-		return (int)PTR_ERR(peb_states);
-	}
-
-	if (items_count == items_per_fragment) {
-		memcpy(moving_pair,
-			&leb2peb_pairs[items_count - 1], pair_size);
-		memcpy(moving_state,
-			&peb_states[items_count - 1], peb_state_size);
-		need_moving = SSDFS_TRUE;
-	} else {
-		u8 *area = NULL;
-		int area_size;
-
-		area = PEB_STATE_AREA(fragment);
-		if (IS_ERR(area)) {
-			SSDFS_ERR("fail to get PEB states  area: "
-				  "err %d\n",
-				  (int)PTR_ERR(area));
-			return (int)PTR_ERR(area);
-		}
+	area += items_count * pair_size;
+	magic = (__le32 *)area;
+	*magic = cpu_to_le32(SSDFS_MAPTBL_CACHE_PEB_STATE_MAGIC);
 
-		area_size = ssdfs_peb_state_area_size(hdr);
-		if (area_size < 0) {
-			err = area_size < 0 ? area_size : -ERANGE;
-			SSDFS_ERR("fail to define the area size: "
-				  "err %d\n", err);
-			return err;
-		} else if (area_size > 0) {
-			memmove(area + pair_size, area, area_size);
-			peb_states =
-			    (struct ssdfs_maptbl_cache_peb_state *)(area +
-								    magic_size +
-								    pair_size);
-		}
+	peb_states = (struct ssdfs_maptbl_cache_peb_state *)(area + magic_size);
+	for (i = 0; i < items_count; i++) {
+		peb_states[i].consistency = (u8)SSDFS_PEB_STATE_CONSISTENT;
+		peb_states[i].state = (u8)SSDFS_MAPTBL_USING_PEB_STATE;
+		peb_states[i].flags = 0;
+		peb_states[i].shared_peb_index = U8_MAX;
 	}
 
-	if (items_count > 0) {
-		for (i = items_count - 1; i >= 0; i--) {
-			u64 cur_leb_id = le64_to_cpu(leb2peb_pairs[i].leb_id);
-
-			BUG_ON(cur_leb_id == U64_MAX);
-
-			if (cur_leb_id <= le64_to_cpu(new_pair->leb_id))
-				break;
-		}
+	hdr->items_count = cpu_to_le16(items_count);
 
-		item_index = i + 1;
+	bytes_count = SSDFS_MAPTBL_CACHE_HDR_SIZE + magic_size;
+	bytes_count += items_count * (pair_size + peb_state_size);
+	hdr->bytes_count = cpu_to_le16(bytes_count);
 
-		if (item_index < items_count) {
-			u16 moving_items;
+	hdr->start_leb = pairs[0].leb_id;
+	hdr->end_leb = pairs[items_count - 1].leb_id;
 
-			if (items_count == items_per_fragment)
-				moving_items = items_count - 1 - item_index;
-			else
-				moving_items = items_count - item_index;
+	layout->maptbl_cache.bytes_count += bytes_count;
+}
 
-			memmove(&leb2peb_pairs[item_index + 1],
-				&leb2peb_pairs[item_index],
-				pair_size * moving_items);
-			memmove(&peb_states[item_index + 1],
-				&peb_states[item_index],
-				peb_state_size * moving_items);
-		}
-	}
+/*
+ * maptbl_cache_mkfs_pack() - pack collected pairs into maptbl cache
+ * @layout: pointer on volume layout
+ *
+ * This method sorts the collected LEB to PEB pairs by LEB ID and
+ * fills the maptbl cache's fragments by the sorted pairs in one
+ * linear pass. Every fragment (except the last one) is fully packed.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ERANGE     - fragments cannot contain all pairs.
+ */
+int maptbl_cache_mkfs_pack(struct ssdfs_volume_layout *layout)
+{
+	struct ssdfs_maptbl_cache_layout *cache = &layout->maptbl_cache;
+	size_t pair_size = sizeof(struct ssdfs_leb2peb_pair);
+	u32 items_per_fragment;
+	u32 pair_index = 0;
+	u32 i;
 
-	memcpy(&leb2peb_pairs[item_index], new_pair, pair_size);
-	memcpy(&peb_states[item_index], new_state, peb_state_size);
+	SSDFS_DBG(layout->env.show_debug,
+		  "layout %p, pairs_count %u\n",
+		  layout, cache->pairs_count);
 
-	memcpy(&hdr->start_leb, &leb2peb_pairs[0].leb_id,
-		sizeof(hdr->start_leb));
-	memcpy(&hdr->end_leb, &leb2peb_pairs[items_count].leb_id,
-		sizeof(hdr->end_leb));
+	items_per_fragment = SSDFS_LEB2PEB_PAIR_PER_FRAGMENT(layout->page_size);
 
-	if (items_count == 0) {
-		layout->maptbl_cache.bytes_count +=
-			SSDFS_MAPTBL_CACHE_HDR_SIZE + magic_size;
+	if (cache->pairs_count >
+			(u64)cache->fragments_count * items_per_fragment) {
+		SSDFS_ERR("fragments cannot contain all pairs: "
+			  "pairs_count %u, fragments_count %u, "
+			  "items_per_fragment %u\n",
+			  cache->pairs_count, cache->fragments_count,
+			  items_per_fragment);
+		return -ERANGE;
 	}
 
-	items_count++;
-	hdr->items_count = cpu_to_le16(items_count);
-
-	bytes_count = SSDFS_MAPTBL_CACHE_HDR_SIZE + magic_size;
-	bytes_count += items_count * (pair_size + peb_state_size);
-	hdr->bytes_count = cpu_to_le16(bytes_count);
+	qsort(cache->pairs, cache->pairs_count, pair_size,
+		leb2peb_pair_cmp);
 
-	layout->maptbl_cache.bytes_count += pair_size + peb_state_size;
+	cache->bytes_count = 0;
 
-	SSDFS_DBG(layout->env.show_debug,
-		  "finished\n");
+	for (i = 0; i < cache->fragments_count; i++) {
+		u32 items_count;
 
-	return need_moving ? -EAGAIN : 0;
-}
+		if (pair_index >= cache->pairs_count)
+			break;
 
-int cache_leb2peb_pair(struct ssdfs_volume_layout *layout,
-			u64 leb_id, u64 peb_id)
-{
-	u8 *ptr;
-	struct ssdfs_leb2peb_pair new_pair, moving_pair;
-	size_t pair_size = sizeof(struct ssdfs_leb2peb_pair);
-	struct ssdfs_maptbl_cache_peb_state new_state, moving_state;
-	size_t peb_state_size = sizeof(struct ssdfs_maptbl_cache_peb_state);
-	u32 index = 0;
-	int res = 0;
+		items_count = min_t(u32, items_per_fragment,
+				    cache->pairs_count - pair_index);
 
-	SSDFS_DBG(layout->env.show_debug,
-		  "layout %p, leb_id %llu, peb_id %llu\n",
-		  layout, leb_id, peb_id);
+		maptbl_cache_pack_fragment(layout,
+					   cache->fragments_array[i],
+					   &cache->pairs[pair_index],
+					   (u16)items_count);
 
-	BUG_ON(leb_id == U64_MAX);
-	BUG_ON(peb_id == U64_MAX);
+		pair_index += items_count;
+	}
 
-	moving_pair.leb_id = cpu_to_le64(leb_id);
-	moving_pair.peb_id = cpu_to_le64(peb_id);
-
-	moving_state.consistency = (u8)SSDFS_PEB_STATE_CONSISTENT;
-	moving_state.state = (u8)SSDFS_MAPTBL_USING_PEB_STATE;
-	moving_state.flags = 0;
-	moving_state.shared_peb_index = U8_MAX;
-
-	index = find_fragment_index(layout, leb_id);
-
-	do {
-		BUG_ON(index >= layout->maptbl_cache.fragments_count);
-		ptr = (u8 *)layout->maptbl_cache.fragments_array[index];
-
-		memcpy(&new_pair, &moving_pair, pair_size);
-		memcpy(&new_state, &moving_state, peb_state_size);
-
-		res = add_leb2peb_pair(layout, ptr, &new_pair, &moving_pair,
-					&new_state, &moving_state);
-
-		if (res == -EAGAIN) {
-			/*
-			 * continue to move
-			 */
-			index++;
-		} else if (res) {
-			SSDFS_ERR("fail to add new pair: "
-				  "fragment_index %u, err %d\n",
-				  index, res);
-			return res;
-		} else {
-			SSDFS_DBG(layout->env.show_debug,
-				  "finished\n");
-			return 0;
-		}
-	} while (res == -EAGAIN);
+	free(cache->pairs);
+	cache->pairs = NULL;
+	cache->pairs_count = 0;
+	cache->pairs_capacity = 0;
 
-	SSDFS_DBG(layout->env.show_debug,
-		  "finished\n");
+	SSDFS_DBG(layout->env.show_debug, "finished\n");
 
 	return 0;
 }
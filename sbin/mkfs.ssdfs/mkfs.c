@@ -37,6 +37,7 @@
 #include <uuid/uuid.h>
 #include <limits.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "mkfs.h"
 #include <mtd/mtd-abi.h>
@@ -223,6 +224,7 @@ static struct ssdfs_mkfs_operations maptbl_mkfs_ops = {
 	.validate = maptbl_mkfs_validate,
 	.define_layout = maptbl_mkfs_define_layout,
 	.commit = maptbl_mkfs_commit,
+	.generate_peb = maptbl_mkfs_generate_peb,
 };
 
 static struct ssdfs_mkfs_operations user_data_mkfs_ops = {
@@ -740,10 +742,7 @@ static void free_segs_array(struct ssdfs_volume_layout *layout)
 				struct ssdfs_extent_desc *desc;
 
 				desc = &layout->segs[i].pebs[j].extents[k];
-				if (desc->buf) {
-					free(desc->buf);
-					desc->buf = NULL;
-				}
+				release_extent_buffer(desc);
 				if (desc->compr_buf) {
 					free(desc->compr_buf);
 					desc->compr_buf = NULL;
@@ -979,22 +978,20 @@ static int check_extent_before_write(struct ssdfs_volume_layout *layout,
 
 static int check_peb_before_write(struct ssdfs_volume_layout *layout,
 				  struct ssdfs_peb_content *peb,
-				  char *bmap, u32 *blks)
+				  u64 *start_blk, u32 *blks)
 {
 	struct ssdfs_extent_desc *desc;
 	u32 start_offset = U32_MAX;
 	u32 payload_size = U32_MAX;
 	u32 aligned_offset;
 	u32 aligned_size;
-	u32 erasesize = layout->env.erase_size;
 	u32 pagesize = layout->page_size;
-	u64 start_blk;
 	int i;
 	int err;
 
 	SSDFS_DBG(layout->env.show_debug,
-		  "layout %p, leb_id %llu, peb_id %llu, bmap %p\n",
-		  layout, peb->leb_id, peb->peb_id, bmap);
+		  "layout %p, leb_id %llu, peb_id %llu\n",
+		  layout, peb->leb_id, peb->peb_id);
 
 	for (i = 0; i < SSDFS_SEG_LOG_ITEMS_COUNT; i++) {
 		desc = &peb->extents[i];
@@ -1047,67 +1044,96 @@ static int check_peb_before_write(struct ssdfs_volume_layout *layout,
 	BUG_ON(aligned_offset > start_offset);
 	aligned_size = payload_size + (start_offset - aligned_offset);
 
-	start_blk = (peb->peb_id * erasesize) + aligned_offset;
-	start_blk /= pagesize;
+	*start_blk = (peb->peb_id * layout->env.erase_size) + aligned_offset;
+	*start_blk /= pagesize;
 
 	*blks = (aligned_size + pagesize - 1) / pagesize;
 
-	for (i = 0; i < *blks; i++) {
-		u64 cur_blk;
-		size_t bits;
-		unsigned long *addr;
-		int nr;
+	return 0;
+}
 
-		cur_blk = start_blk + i;
-		bits = 8 * sizeof(unsigned long);
-		addr = (unsigned long *)bmap + (cur_blk / bits);
-		nr = cur_blk % bits;
+/*
+ * struct ssdfs_blk_range - range of blocks occupied by PEB's content
+ * @start_blk: first block of the range
+ * @blks: number of blocks in the range
+ */
+struct ssdfs_blk_range {
+	u64 start_blk;
+	u64 blks;
+};
 
-		if (test_bit(nr, addr)) {
-			SSDFS_ERR("block %llu has used yet\n", cur_blk);
-			return -EINVAL;
-		} else
-			__set_bit(nr, addr);
-	}
+static int blk_range_cmp(const void *item1, const void *item2)
+{
+	const struct ssdfs_blk_range *range1 = item1;
+	const struct ssdfs_blk_range *range2 = item2;
+
+	if (range1->start_blk != range2->start_blk)
+		return range1->start_blk < range2->start_blk ? -1 : 1;
 
 	return 0;
 }
 
+/*
+ * Every PEB's content occupies one range of blocks. The ranges
+ * are sorted and neighbours are checked for overlapping. So, the check
+ * needs in memory for metadata PEBs only but not for every block
+ * of the volume. The content of deferred PEBs is generated right
+ * before write, so such PEB is accounted as fully occupied range.
+ * The extents of deferred PEBs are checked right after generation.
+ */
 static int check_layout_before_write(struct ssdfs_volume_layout *layout)
 {
-	char *bmap;
-	u64 fs_size = layout->env.fs_size;
+	struct ssdfs_blk_range *ranges;
 	u64 segsize = layout->seg_size;
+	u32 erasesize = layout->env.erase_size;
 	u32 pagesize = layout->page_size;
-	u64 fs_blks = fs_size / pagesize;
 	u64 seg_blks_capacity = segsize / pagesize;
+	u32 pebs_per_seg = (u32)(segsize / erasesize);
+	u32 ranges_count = 0;
+	u32 k;
 	int i, j;
 	int err = 0;
 
-	bmap = calloc((fs_blks + 8 - 1)/8, 1);
-	if (!bmap) {
-		SSDFS_ERR("unable to allocate %llu bytes\n",
-			  (unsigned long long)((fs_blks + 8 - 1)/8));
+	ranges = calloc((size_t)layout->segs_count * pebs_per_seg,
+			sizeof(struct ssdfs_blk_range));
+	if (!ranges) {
+		SSDFS_ERR("unable to allocate blocks ranges array: "
+			  "segs_count %d, pebs_per_seg %u\n",
+			  layout->segs_count, pebs_per_seg);
 		return -ENOMEM;
 	}
 
 	for (i = 0; i < layout->segs_count; i++) {
 		u64 seg_blks = 0;
 
+		BUG_ON(layout->segs[i].pebs_count > pebs_per_seg);
+
 		for (j = 0; j < layout->segs[i].pebs_count; j++) {
 			struct ssdfs_peb_content *peb;
+			struct ssdfs_blk_range *range;
 			u32 blks = 0;
 
 			peb = &layout->segs[i].pebs[j];
-			err = check_peb_before_write(layout, peb, bmap, &blks);
+			range = &ranges[ranges_count++];
+
+			if (peb->is_deferred) {
+				range->start_blk = peb->peb_id * erasesize;
+				range->start_blk /= pagesize;
+				range->blks = erasesize / pagesize;
+				continue;
+			}
+
+			err = check_peb_before_write(layout, peb,
+						     &range->start_blk, &blks);
 			if (err) {
 				SSDFS_ERR("invalid PEB: "
 					  "seg_index %d, peb_index %d, "
 					  "err %d\n",
 					  i, j, err);
-				return err;
+				goto free_ranges;
 			}
 
+			range->blks = blks;
 			seg_blks += blks;
 		}
 
@@ -1115,12 +1141,26 @@ static int check_layout_before_write(struct ssdfs_volume_layout *layout)
 			SSDFS_ERR("blocks count %llu is greater than %llu\n",
 				  seg_blks, seg_blks_capacity);
 			err = -E2BIG;
-			goto free_bmap;
+			goto free_ranges;
 		}
 	}
 
-free_bmap:
-	free(bmap);
+	qsort(ranges, ranges_count, sizeof(struct ssdfs_blk_range),
+	      blk_range_cmp);
+
+	for (k = 1; k < ranges_count; k++) {
+		u64 prev_end = ranges[k - 1].start_blk + ranges[k - 1].blks;
+
+		if (prev_end > ranges[k].start_blk) {
+			SSDFS_ERR("block %llu has used yet\n",
+				  ranges[k].start_blk);
+			err = -EINVAL;
+			goto free_ranges;
+		}
+	}
+
+free_ranges:
+	free(ranges);
 	return err;
 }
 
@@ -1326,7 +1366,21 @@ static int erase_device(struct ssdfs_volume_layout *layout)
 	if (layout->is_volume_erased)
 		return 0;
 
+	if (layout->quick_format) {
+		err = quick_erase_device(layout);
+		if (err != -ENODATA && err != -ERANGE)
+			return err;
+
+		err = 0;
+	}
+
 	if (!layout->need_erase_device) {
+		if (layout->plan.is_enabled) {
+			plan_account_erase(layout, layout->segs_count,
+					   layout->seg_size, 1);
+			return 0;
+		}
+
 		return erase_allocated_segments_only(layout);
 	}
 
@@ -1338,6 +1392,13 @@ static int erase_device(struct ssdfs_volume_layout *layout)
 		layout->threads.capacity = cpu_cores;
 
 	if (layout->threads.capacity == SSDFS_MKFS_DEFAULT_THREADS) {
+		if (layout->plan.is_enabled) {
+			plan_account_erase(layout,
+					   layout->env.fs_size / layout->seg_size,
+					   layout->seg_size, 1);
+			return 0;
+		}
+
 		return erase_all_segments(layout);
 	}
 
@@ -1345,6 +1406,12 @@ static int erase_device(struct ssdfs_volume_layout *layout)
 	pebs_per_thread = (pebs_count + layout->threads.capacity - 1);
 	pebs_per_thread /= layout->threads.capacity;
 
+	if (layout->plan.is_enabled) {
+		plan_account_erase(layout, pebs_count, layout->env.erase_size,
+				   layout->threads.capacity);
+		return 0;
+	}
+
 	layout->threads.jobs = calloc(layout->threads.capacity,
 				      sizeof(struct ssdfs_thread_state));
 	if (!layout->threads.jobs) {
@@ -1394,35 +1461,37 @@ free_threads_pool:
 }
 
 static int flush_write_buffer(struct ssdfs_volume_layout *layout,
+			      struct ssdfs_peb_writer *writer,
 			      u64 offset, u32 size)
 {
 	struct ssdfs_nand_geometry info = {
 		.erasesize = layout->env.erase_size,
 		.writesize = layout->page_size,
 	};
+	struct ssdfs_write_buffer *wbuf = &writer->write_buffer;
 	int fd = layout->env.fd;
 	u32 pagesize = layout->page_size;
 	int err;
 
 	SSDFS_DBG(layout->env.show_debug,
-		  "offset %llu, size %u\n",
-		  offset, size);
+		  "writer %u, offset %llu, size %u\n",
+		  writer->index, offset, size);
 
-	if (layout->write_buffer.ptr == NULL) {
+	if (wbuf->ptr == NULL) {
 		SSDFS_ERR("write buffer is not allocated\n");
 		return -ERANGE;
 	}
 
-	if (layout->write_buffer.capacity == 0) {
+	if (wbuf->capacity == 0) {
 		SSDFS_ERR("invalid write buffer capacity %u\n",
-			  layout->write_buffer.capacity);
+			  wbuf->capacity);
 		return -ERANGE;
 	}
 
-	if (size == 0 || size > layout->write_buffer.capacity) {
+	if (size == 0 || size > wbuf->capacity) {
 		SSDFS_ERR("invalid requested size: "
-			  "size %u, layout->write_buffer.capacity %u\n",
-			  size, layout->write_buffer.capacity);
+			  "size %u, write_buffer.capacity %u\n",
+			  size, wbuf->capacity);
 		return -ERANGE;
 	}
 
@@ -1432,9 +1501,15 @@ static int flush_write_buffer(struct ssdfs_volume_layout *layout,
 		return -ERANGE;
 	}
 
+	if (layout->plan.is_enabled) {
+		layout->plan.write_ios++;
+		layout->plan.written_bytes += size;
+		goto finish_flush;
+	}
+
 	err = layout->env.dev_ops->write(fd, &info, offset, size,
-					 layout->write_buffer.ptr,
-					 &layout->env.open_zones,
+					 wbuf->ptr,
+					 &writer->open_zones,
 					 layout->env.show_debug);
 	if (err) {
 		SSDFS_ERR("unable to write: "
@@ -1443,13 +1518,15 @@ static int flush_write_buffer(struct ssdfs_volume_layout *layout,
 		return err;
 	}
 
-	memset(layout->write_buffer.ptr, 0xFF, layout->write_buffer.capacity);
-	layout->write_buffer.offset = 0;
+finish_flush:
+	memset(wbuf->ptr, 0xFF, wbuf->capacity);
+	wbuf->offset = 0;
 
 	return 0;
 }
 
 static int prepare_write_buffer(struct ssdfs_volume_layout *layout,
+				struct ssdfs_write_buffer *wbuf,
 				u32 offset, char *buf, u32 size,
 				u32 *copied_size)
 {
@@ -1461,14 +1538,14 @@ static int prepare_write_buffer(struct ssdfs_volume_layout *layout,
 
 	*copied_size = 0;
 
-	if (layout->write_buffer.ptr == NULL) {
+	if (wbuf->ptr == NULL) {
 		SSDFS_ERR("write buffer is not allocated\n");
 		return -ERANGE;
 	}
 
-	if (layout->write_buffer.capacity == 0) {
+	if (wbuf->capacity == 0) {
 		SSDFS_ERR("invalid write buffer capacity %u\n",
-			  layout->write_buffer.capacity);
+			  wbuf->capacity);
 		return -ERANGE;
 	}
 
@@ -1477,19 +1554,18 @@ static int prepare_write_buffer(struct ssdfs_volume_layout *layout,
 		return -ERANGE;
 	}
 
-	if (offset < layout->write_buffer.offset ||
-	    offset >= layout->write_buffer.capacity) {
+	if (offset < wbuf->offset || offset >= wbuf->capacity) {
 		SSDFS_DBG(layout->env.show_debug,
 			  "no more space: write_buffer.offset %u, "
 			  "offset %u, size %u\n",
-			  layout->write_buffer.offset, offset, size);
+			  wbuf->offset, offset, size);
 		return -ENOSPC;
 	}
 
-	bytes_count = min_t(u32, size, layout->write_buffer.capacity - offset);
-	memcpy(layout->write_buffer.ptr + offset, buf, bytes_count);
+	bytes_count = min_t(u32, size, wbuf->capacity - offset);
+	memcpy(wbuf->ptr + offset, buf, bytes_count);
 	*copied_size = bytes_count;
-	layout->write_buffer.offset = offset + bytes_count;
+	wbuf->offset = offset + bytes_count;
 
 	if (*copied_size != size) {
 		SSDFS_DBG(layout->env.show_debug,
@@ -1498,7 +1574,7 @@ static int prepare_write_buffer(struct ssdfs_volume_layout *layout,
 		return -ENOSPC;
 	}
 
-	if ((offset + bytes_count) == layout->write_buffer.capacity) {
+	if ((offset + bytes_count) == wbuf->capacity) {
 		SSDFS_DBG(layout->env.show_debug,
 			  "no more space: offset %u, size %u\n",
 			  offset, size);
@@ -1508,9 +1584,66 @@ static int prepare_write_buffer(struct ssdfs_volume_layout *layout,
 	return 0;
 }
 
+static int generate_deferred_peb(struct ssdfs_volume_layout *layout,
+				 int seg_index, int peb_index)
+{
+	struct ssdfs_segment_desc *seg_desc = &layout->segs[seg_index];
+	struct ssdfs_peb_content *peb_desc = &seg_desc->pebs[peb_index];
+	int seg_type = seg_desc->seg_type;
+	u64 start_blk = 0;
+	u32 blks = 0;
+	int err;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "seg_index %d, peb_index %d, seg_type %#x\n",
+		  seg_index, peb_index, seg_type);
+
+	BUG_ON(seg_type < 0 || seg_type >= SSDFS_METADATA_ITEMS_MAX);
+
+	if (!mkfs_ops[seg_type]->generate_peb) {
+		SSDFS_ERR("unable to generate PEB: seg_type %#x\n",
+			  seg_type);
+		return -EOPNOTSUPP;
+	}
+
+	err = mkfs_ops[seg_type]->generate_peb(layout, seg_index, peb_index);
+	if (err) {
+		SSDFS_ERR("fail to generate PEB: "
+			  "seg_index %d, peb_index %d, err %d\n",
+			  seg_index, peb_index, err);
+		return err;
+	}
+
+	err = check_peb_before_write(layout, peb_desc, &start_blk, &blks);
+	if (err) {
+		SSDFS_ERR("invalid PEB: "
+			  "seg_index %d, peb_index %d, err %d\n",
+			  seg_index, peb_index, err);
+		return err;
+	}
+
+	return 0;
+}
+
+static void release_peb_content(struct ssdfs_peb_content *peb_desc)
+{
+	struct ssdfs_extent_desc *desc;
+	int i;
+
+	for (i = 0; i < SSDFS_SEG_LOG_ITEMS_COUNT; i++) {
+		desc = &peb_desc->extents[i];
+
+		release_extent_buffer(desc);
+		free(desc->compr_buf);
+		desc->compr_buf = NULL;
+	}
+}
+
 static int write_peb(struct ssdfs_volume_layout *layout,
+		     struct ssdfs_peb_writer *writer,
 		     int seg_index, int peb_index)
 {
+	struct ssdfs_write_buffer *wbuf = &writer->write_buffer;
 	struct ssdfs_segment_desc *seg_desc;
 	struct ssdfs_peb_content *peb_desc;
 	u32 erase_size = layout->env.erase_size;
@@ -1519,15 +1652,17 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 	u32 peb_offset = 0;
 	u64 volume_offset;
 	u32 flushed_bytes = 0;
+	u64 planned_ios = layout->plan.write_ios;
+	u64 planned_bytes = layout->plan.written_bytes;
 	int need_close_zone = SSDFS_FALSE;
 	u32 i;
 	int err = 0;
 
 	SSDFS_DBG(layout->env.show_debug,
 		  "device %s, segs_count %u, segs_capacity %u, "
-		  "seg_index %d, peb_index %d\n",
+		  "writer %u, seg_index %d, peb_index %d\n",
 		  layout->env.dev_name, layout->segs_count,
-		  layout->segs_capacity,
+		  layout->segs_capacity, writer->index,
 		  seg_index, peb_index);
 
 	if (seg_index >= layout->segs_capacity) {
@@ -1546,9 +1681,18 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 		return -EINVAL;
 	}
 
-	memset(layout->write_buffer.ptr, 0xFF, layout->write_buffer.capacity);
-
 	peb_desc = &seg_desc->pebs[peb_index];
+
+	if (peb_desc->is_deferred) {
+		SSDFS_ERR("PEB content is not generated: "
+			  "seg_index %d, peb_index %d\n",
+			  seg_index, peb_index);
+		return -ERANGE;
+	}
+
+	memset(wbuf->ptr, 0xFF, wbuf->capacity);
+	wbuf->offset = 0;
+
 	peb_id = peb_desc->peb_id;
 	volume_offset = peb_id * erase_size;
 
@@ -1581,14 +1725,15 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 		while (size > 0) {
 			u32 copied_bytes = 0;
 
-			write_buf_offset =
-				peb_offset % layout->write_buffer.capacity;
+			write_buf_offset = peb_offset % wbuf->capacity;
 
-			err = prepare_write_buffer(layout, write_buf_offset,
+			err = prepare_write_buffer(layout, wbuf,
+						   write_buf_offset,
 						   buf, size, &copied_bytes);
 			if (err == -ENOSPC) {
-				err = flush_write_buffer(layout, volume_offset,
-						layout->write_buffer.capacity);
+				err = flush_write_buffer(layout, writer,
+							 volume_offset,
+							 wbuf->capacity);
 				if (err) {
 					SSDFS_ERR("fail to flush write buffer: "
 						  "volume_offset %llu, err %d\n",
@@ -1596,8 +1741,8 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 					return err;
 				}
 
-				volume_offset += layout->write_buffer.capacity;
-				flushed_bytes += layout->write_buffer.capacity;
+				volume_offset += wbuf->capacity;
+				flushed_bytes += wbuf->capacity;
 			} else if (err) {
 				SSDFS_ERR("fail to prepare write buffer: "
 					  "peb_offset %u, write_buf_offset %u, "
@@ -1636,7 +1781,7 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 		aligned_size += pagesize - 1;
 		aligned_size = (aligned_size / pagesize) * pagesize;
 
-		err = flush_write_buffer(layout, volume_offset,
+		err = flush_write_buffer(layout, writer, volume_offset,
 					 aligned_size);
 		if (err) {
 			SSDFS_ERR("fail to flush write buffer: "
@@ -1646,6 +1791,13 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 		}
 	}
 
+	if (layout->plan.is_enabled) {
+		plan_account_peb(layout, seg_desc->seg_type, peb_desc,
+				 layout->plan.write_ios - planned_ios,
+				 layout->plan.written_bytes - planned_bytes);
+		return 0;
+	}
+
 	switch (layout->env.device_type) {
 	case SSDFS_ZNS_DEVICE:
 		/* continue logic */
@@ -1662,7 +1814,7 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 	switch (seg_desc->seg_type) {
 	case SSDFS_INITIAL_SNAPSHOT:
 		need_close_zone = SSDFS_TRUE;
-		layout->env.open_zones--;
+		writer->open_zones--;
 		break;
 
 	default:
@@ -1686,10 +1838,31 @@ static int write_peb(struct ssdfs_volume_layout *layout,
 	return 0;
 }
 
-static int write_segments(struct ssdfs_volume_layout *layout)
+static int prepare_peb_content(struct ssdfs_volume_layout *layout,
+			       int seg_index, int peb_index)
+{
+	struct ssdfs_peb_content *peb_desc;
+
+	peb_desc = &layout->segs[seg_index].pebs[peb_index];
+
+	if (!peb_desc->is_deferred)
+		return 0;
+
+	return generate_deferred_peb(layout, seg_index, peb_index);
+}
+
+static int write_segments_sequentially(struct ssdfs_volume_layout *layout)
 {
+	struct ssdfs_peb_writer writer = {
+		.index = 0,
+		.err = 0,
+		.write_buffer = layout->write_buffer,
+		.open_zones = 0,
+		.layout = layout,
+		.queue = NULL,
+	};
 	u32 i, j;
-	int err;
+	int err = 0;
 
 	SSDFS_DBG(layout->env.show_debug,
 		  "device %s, segs_count %u, segs_capacity %u\n",
@@ -1698,18 +1871,327 @@ static int write_segments(struct ssdfs_volume_layout *layout)
 
 	for (i = 0; i < layout->segs_count; i++) {
 		for (j = 0; j < layout->segs[i].pebs_count; j++) {
-			err = write_peb(layout, i, j);
+			err = prepare_peb_content(layout, i, j);
+			if (err)
+				goto finish_write;
+
+			err = write_peb(layout, &writer, i, j);
 			if (err) {
 				SSDFS_ERR("fail to write PEB: "
 					  "seg_index %d, peb_index %d, "
 					  "err %d\n",
 					  i, j, err);
-				return err;
+				goto finish_write;
 			}
+
+			/* content of written PEB is not needed anymore */
+			release_peb_content(&layout->segs[i].pebs[j]);
 		}
 	}
 
-	return 0;
+finish_write:
+	layout->env.open_zones += writer.open_zones;
+	return err;
+}
+
+static int peb_write_queue_pop(struct ssdfs_peb_write_queue *queue,
+				struct ssdfs_peb_write_request *req)
+{
+	pthread_mutex_lock(&queue->lock);
+
+	while (queue->count == 0 && !queue->is_closed)
+		pthread_cond_wait(&queue->request_added, &queue->lock);
+
+	if (queue->count == 0) {
+		pthread_mutex_unlock(&queue->lock);
+		return SSDFS_FALSE;
+	}
+
+	*req = queue->requests[queue->head];
+	queue->head = (queue->head + 1) % queue->capacity;
+	queue->count--;
+
+	pthread_mutex_unlock(&queue->lock);
+
+	return SSDFS_TRUE;
+}
+
+static void peb_write_queue_complete(struct ssdfs_peb_write_queue *queue,
+				     int err)
+{
+	pthread_mutex_lock(&queue->lock);
+
+	BUG_ON(queue->active_zones == 0);
+	queue->active_zones--;
+
+	if (err && !queue->err)
+		queue->err = err;
+
+	pthread_cond_signal(&queue->request_done);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+static int peb_write_queue_push(struct ssdfs_peb_write_queue *queue,
+				int seg_index, int peb_index)
+{
+	struct ssdfs_peb_write_request *req;
+	int err;
+
+	pthread_mutex_lock(&queue->lock);
+
+	while (queue->active_zones >= queue->capacity && !queue->err)
+		pthread_cond_wait(&queue->request_done, &queue->lock);
+
+	err = queue->err;
+	if (!err) {
+		req = &queue->requests[(queue->head + queue->count) %
+							queue->capacity];
+		req->seg_index = seg_index;
+		req->peb_index = peb_index;
+
+		queue->count++;
+		queue->active_zones++;
+
+		pthread_cond_signal(&queue->request_added);
+	}
+
+	pthread_mutex_unlock(&queue->lock);
+
+	return err;
+}
+
+static void peb_write_queue_close(struct ssdfs_peb_write_queue *queue)
+{
+	pthread_mutex_lock(&queue->lock);
+	queue->is_closed = SSDFS_TRUE;
+	pthread_cond_broadcast(&queue->request_added);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+static void *peb_writer_thread(void *arg)
+{
+	struct ssdfs_peb_writer *writer = (struct ssdfs_peb_writer *)arg;
+	struct ssdfs_volume_layout *layout = writer->layout;
+	struct ssdfs_peb_write_request req;
+	int seg_index, peb_index;
+	int err;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "writer %u has started\n", writer->index);
+
+	while (peb_write_queue_pop(writer->queue, &req)) {
+		seg_index = req.seg_index;
+		peb_index = req.peb_index;
+
+		err = write_peb(layout, writer, seg_index, peb_index);
+		if (err) {
+			SSDFS_ERR("fail to write PEB: "
+				  "seg_index %d, peb_index %d, err %d\n",
+				  seg_index, peb_index, err);
+			writer->err = err;
+		}
+
+		/* content of written PEB is not needed anymore */
+		release_peb_content(&layout->segs[seg_index].pebs[peb_index]);
+
+		peb_write_queue_complete(writer->queue, err);
+	}
+
+	pthread_exit(writer->err ? (void *)1 : (void *)0);
+}
+
+/*
+ * write_segments_concurrently() - write PEBs into several zones
+ * @layout: volume layout
+ * @writers_count: number of zones under write at the same time
+ *
+ * Every PEB of ZNS device is a zone. PEBs' content is prepared
+ * in the order of segments by the caller's thread and every prepared
+ * PEB is written by one of writer threads. A writer writes the whole
+ * PEB sequentially from the zone's start and tracks the zone's write
+ * pointer. The number of PEBs that are prepared and not written yet
+ * is limited by @writers_count, so the number of zones under write
+ * together with the zones left open never exceeds the active zones
+ * limit of device.
+ *
+ * Deferred PEBs are generated by the caller's thread only. The
+ * mapping table's generate_peb hook takes the fragment from
+ * layout->maptbl.fragments_array without any locking. And generation
+ * in the order of writing keeps no more than @writers_count generated
+ * PEBs in memory at once.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOMEM     - fail to allocate memory.
+ * %-ERANGE     - internal error.
+ * %-EIO        - I/O error.
+ */
+static int write_segments_concurrently(struct ssdfs_volume_layout *layout,
+				       u32 writers_count)
+{
+	struct ssdfs_peb_write_queue queue;
+	struct ssdfs_peb_writer *writers;
+	u32 pagesize = layout->page_size;
+	u32 started = 0;
+	u32 i, j;
+	int err = 0;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "device %s, segs_count %u, writers_count %u\n",
+		  layout->env.dev_name, layout->segs_count,
+		  writers_count);
+
+	memset(&queue, 0, sizeof(queue));
+	pthread_mutex_init(&queue.lock, NULL);
+	pthread_cond_init(&queue.request_added, NULL);
+	pthread_cond_init(&queue.request_done, NULL);
+	queue.capacity = writers_count;
+
+	queue.requests = calloc(writers_count,
+				sizeof(struct ssdfs_peb_write_request));
+	writers = calloc(writers_count, sizeof(struct ssdfs_peb_writer));
+	if (!queue.requests || !writers) {
+		SSDFS_ERR("fail to allocate writers: count %u\n",
+			  writers_count);
+		err = -ENOMEM;
+		goto free_writers;
+	}
+
+	for (i = 0; i < writers_count; i++) {
+		struct ssdfs_peb_writer *writer = &writers[i];
+
+		writer->index = i;
+		writer->layout = layout;
+		writer->queue = &queue;
+		writer->write_buffer.capacity = pagesize;
+
+		err = posix_memalign((void **)&writer->write_buffer.ptr,
+				     pagesize, pagesize);
+		if (err || !writer->write_buffer.ptr) {
+			SSDFS_ERR("fail to allocate write buffer\n");
+			writer->write_buffer.ptr = NULL;
+			err = -ENOMEM;
+			goto stop_writers;
+		}
+
+		err = pthread_create(&writer->thread, NULL,
+				     peb_writer_thread, (void *)writer);
+		if (err) {
+			SSDFS_ERR("fail to create writer %u: %s\n",
+				  i, strerror(err));
+			err = -ERANGE;
+			goto stop_writers;
+		}
+
+		started++;
+	}
+
+	for (i = 0; i < layout->segs_count; i++) {
+		for (j = 0; j < layout->segs[i].pebs_count; j++) {
+			err = prepare_peb_content(layout, i, j);
+			if (err)
+				goto stop_writers;
+
+			err = peb_write_queue_push(&queue, i, j);
+			if (err)
+				goto stop_writers;
+		}
+	}
+
+stop_writers:
+	peb_write_queue_close(&queue);
+
+	for (i = 0; i < started; i++) {
+		pthread_join(writers[i].thread, NULL);
+		layout->env.open_zones += writers[i].open_zones;
+	}
+
+	if (!err)
+		err = queue.err;
+
+free_writers:
+	if (writers) {
+		for (i = 0; i < writers_count; i++)
+			free(writers[i].write_buffer.ptr);
+		free(writers);
+	}
+
+	free(queue.requests);
+	pthread_cond_destroy(&queue.request_done);
+	pthread_cond_destroy(&queue.request_added);
+	pthread_mutex_destroy(&queue.lock);
+
+	return err;
+}
+
+/*
+ * get_peb_writers_count() - define number of concurrent PEB writers
+ * @layout: volume layout
+ *
+ * Zones of metadata segments (except the initial snapshot one) are
+ * not finished after write and stay open for the file system driver.
+ * Such zones keep occupying the active zones limit of the device.
+ * So, only the rest of the limit can be used by concurrent writers.
+ */
+static u32 get_peb_writers_count(struct ssdfs_volume_layout *layout)
+{
+	u32 max_active_zones = 0;
+	u32 open_zones = layout->calculated_open_zones;
+	u32 threads;
+	int err;
+
+	if (layout->env.device_type != SSDFS_ZNS_DEVICE)
+		return 1;
+
+	err = zns_get_max_active_zones(layout->env.fd, &max_active_zones,
+					layout->env.show_debug);
+	if (err) {
+		SSDFS_DBG(layout->env.show_debug,
+			  "unknown active zones limit: err %d\n", err);
+		return 1;
+	}
+
+	threads = layout->threads.capacity;
+	if (threads == SSDFS_MKFS_UNKNOWN_THREADS) {
+		int cpu_cores = get_cpu_cores_number();
+
+		threads = cpu_cores > 0 ? cpu_cores :
+					SSDFS_MKFS_DEFAULT_THREADS;
+	}
+
+	if (max_active_zones == 0)
+		return threads;
+
+	if (max_active_zones <= open_zones) {
+		SSDFS_DBG(layout->env.show_debug,
+			  "no free active zones: "
+			  "max_active_zones %u, open_zones %u\n",
+			  max_active_zones, open_zones);
+		return 1;
+	}
+
+	return min_t(u32, threads, max_active_zones - open_zones);
+}
+
+static int write_segments(struct ssdfs_volume_layout *layout)
+{
+	u32 writers_count = get_peb_writers_count(layout);
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "writers_count %u\n", writers_count);
+
+	if (layout->plan.is_enabled) {
+		/* dry run only accounts writes of every PEB */
+		layout->plan.writers = writers_count;
+		return write_segments_sequentially(layout);
+	}
+
+	if (writers_count <= SSDFS_MKFS_DEFAULT_THREADS)
+		return write_segments_sequentially(layout);
+
+	return write_segments_concurrently(layout, writers_count);
 }
 
 static int write_device(struct ssdfs_volume_layout *layout)
@@ -1746,6 +2228,9 @@ static int write_device(struct ssdfs_volume_layout *layout)
 	if (err)
 		return err;
 
+	if (layout->plan.is_enabled)
+		return 0;
+
 	if (fsync(layout->env.fd) < 0) {
 		SSDFS_ERR("fail to sync device %s: %s\n",
 			  layout->env.dev_name, strerror(errno));
@@ -1775,6 +2260,7 @@ int main(int argc, char *argv[])
 	static struct ssdfs_volume_layout volume_layout = {
 		.force_overwrite = SSDFS_FALSE,
 		.need_erase_device = SSDFS_FALSE,
+		.quick_format = SSDFS_FALSE,
 		.env.show_debug = SSDFS_FALSE,
 		.env.show_info = SSDFS_TRUE,
 		.seg_size = SSDFS_8MB,
@@ -1809,6 +2295,7 @@ int main(int argc, char *argv[])
 		.maptbl.reserved_pebs_per_fragment = U16_MAX,
 		.maptbl.compression = SSDFS_UNKNOWN_COMPRESSION,
 		.maptbl.pre_erased_pebs = 0,
+		.maptbl.pre_erased_start_peb = U64_MAX,
 		.btree.node_size = SSDFS_8KB,
 		.btree.min_index_area_size = 0,
 		.btree.lnode_log_pages = U16_MAX,
@@ -1824,8 +2311,11 @@ int main(int argc, char *argv[])
 		.write_buffer.capacity = 0,
 		.threads.capacity = SSDFS_MKFS_UNKNOWN_THREADS,
 		.is_volume_erased = SSDFS_FALSE,
+		.plan.is_enabled = SSDFS_FALSE,
 	};
 	struct ssdfs_volume_layout *layout_ptr;
+	struct timespec start_time, end_time;
+	u64 generation_ns;
 	int err = 0;
 
 	layout_ptr = &volume_layout;
@@ -1855,14 +2345,19 @@ int main(int argc, char *argv[])
 	if (is_device_mounted(layout_ptr))
 		goto mkfs_failed;
 
-	if (!is_safe_overwrite_device(layout_ptr))
-		goto mkfs_failed;
+	/* dry run doesn't overwrite the device */
+	if (!layout_ptr->plan.is_enabled) {
+		if (!is_safe_overwrite_device(layout_ptr))
+			goto mkfs_failed;
+	}
 
 	SSDFS_MKFS_INFO(layout_ptr->env.show_info,
 			"[002]\t[SUCCESS]\n");
 	SSDFS_MKFS_INFO(layout_ptr->env.show_info,
 			"[003]\tPREPARE SEGMENTS ARRAY...\n");
 
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
 	err = alloc_segs_array(layout_ptr);
 	if (err)
 		goto mkfs_failed;
@@ -1878,8 +2373,13 @@ int main(int argc, char *argv[])
 
 	SSDFS_MKFS_INFO(layout_ptr->env.show_info,
 			"[004]\t[SUCCESS]\n");
-	SSDFS_MKFS_INFO(layout_ptr->env.show_info,
-			"[005]\tWRITE METADATA...\n");
+	if (layout_ptr->plan.is_enabled) {
+		SSDFS_MKFS_INFO(layout_ptr->env.show_info,
+				"[005]\tPLAN METADATA WRITE...\n");
+	} else {
+		SSDFS_MKFS_INFO(layout_ptr->env.show_info,
+				"[005]\tWRITE METADATA...\n");
+	}
 
 	err = write_device(layout_ptr);
 	if (err)
@@ -1889,6 +2389,17 @@ int main(int argc, char *argv[])
 				"[005]\t[SUCCESS]\n");
 	}
 
+	if (layout_ptr->plan.is_enabled) {
+		clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+		generation_ns = (u64)(end_time.tv_sec - start_time.tv_sec) *
+								1000000000;
+		generation_ns += end_time.tv_nsec;
+		generation_ns -= start_time.tv_nsec;
+
+		plan_show_report(layout_ptr, generation_ns);
+	}
+
 free_segs_memory:
 	free_segs_array(layout_ptr);
 
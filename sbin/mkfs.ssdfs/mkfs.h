@@ -34,6 +34,7 @@
 
 #include "ssdfs_tools.h"
 #include "segbmap.h"
+#include "maptbl.h"
 
 #define SSDFS_MKFS_INFO(show, fmt, ...) \
 	do { \
@@ -86,6 +87,8 @@ enum {
  * @offset: offset from PEB's beginning in bytes
  * @bytes_count: bytes count in the extent
  * @compr_bytes: compressed size in bytes
+ * @uncompr_bytes: uncompressed size of compressed data in bytes
+ * @buf_refs: references counter of buffer shared by several extents
  */
 struct ssdfs_extent_desc {
 	int state;
@@ -94,17 +97,21 @@ struct ssdfs_extent_desc {
 	u32 offset;
 	u32 bytes_count;
 	u32 compr_bytes;
+	u32 uncompr_bytes;
+	u32 *buf_refs;
 };
 
 /*
  * struct ssdfs_peb_content - content of the PEB's log
  * @leb_id: LEB's identification number
  * @peb_id: PEB's identification number
+ * @is_deferred: content is generated right before write
  * @extents: array of extent descriptors
  */
 struct ssdfs_peb_content {
 	u64 leb_id;
 	u64 peb_id;
+	int is_deferred;
 	struct ssdfs_extent_desc extents[SSDFS_SEG_LOG_ITEMS_COUNT];
 };
 
@@ -141,15 +148,55 @@ struct ssdfs_superblock_layout {
 	struct ssdfs_volume_state vs;
 };
 
+/*
+ * struct ssdfs_blkbmap_args - block bitmap's preparation arguments
+ * @seg_index: segment index
+ * @peb_index: PEB index
+ * @bytes_count: size of PEB's buffer in bytes
+ * @start_logical_blk: first logical block ID
+ * @blks_count: number of valid blocks in PEB
+ */
+struct ssdfs_blkbmap_args {
+	int seg_index;
+	int peb_index;
+	u64 bytes_count;
+	u32 start_logical_blk;
+	u32 blks_count;
+};
+
 /*
  * struct ssdfs_blkbmap_layout - block bitmap creation structure
  * @has_backup_copy: backup copy is present?
  * @compression: compression type
+ * @last: arguments of the last prepared block bitmap
  */
 struct ssdfs_blkbmap_layout {
 	/* creation options */
 	int has_backup_copy;
 	int compression;
+
+	/* backup copy shares the last prepared block bitmap */
+	struct ssdfs_blkbmap_args last;
+};
+
+/*
+ * struct ssdfs_blk2off_table_args - offsets table's preparation arguments
+ * @seg_index: segment index
+ * @peb_index: PEB index
+ * @logical_byte_offset: logical offset in bytes of the first block
+ * @start_logical_blk: first logical block ID
+ * @valid_blks: number of valid blocks in PEB
+ * @used_logical_blks: number of used logical blocks in segment
+ * @last_allocated_blk: last allocated logical block ID in segment
+ */
+struct ssdfs_blk2off_table_args {
+	int seg_index;
+	int peb_index;
+	u64 logical_byte_offset;
+	u32 start_logical_blk;
+	u32 valid_blks;
+	u32 used_logical_blks;
+	u32 last_allocated_blk;
 };
 
 /*
@@ -157,12 +204,16 @@ struct ssdfs_blkbmap_layout {
  * @has_backup_copy: backup copy is present?
  * @compression: compression type
  * @pages_per_seg: number of pages per segment
+ * @last: arguments of the last prepared offsets table
  */
 struct ssdfs_blk2off_table_layout {
 	/* creation options */
 	int has_backup_copy;
 	int compression;
 	u32 pages_per_seg;
+
+	/* backup copy shares the last prepared table */
+	struct ssdfs_blk2off_table_args last;
 };
 
 /*
@@ -214,6 +265,7 @@ struct ssdfs_segbmap_layout {
  * @pebs_per_portion: PEB descriptors in one portion
  * @portions_count: count of portions in mapping table
  * @portion_size: size of portion in bytes
+ * @pre_erased_start_peb: first unallocated PEB (U64_MAX if not defined)
  * @fragments_array: array of pointers on fragment's buffers
  */
 struct ssdfs_maptbl_layout {
@@ -237,6 +289,7 @@ struct ssdfs_maptbl_layout {
 	u64 pre_erased_pebs;
 	u32 portions_count;
 	size_t portion_size;
+	u64 pre_erased_start_peb;
 	void **fragments_array;
 };
 
@@ -246,6 +299,9 @@ struct ssdfs_maptbl_layout {
  * @fragment_size: size of fragment in bytes
  * @bytes_count: number of bytes in the whole maptbl cache
  * @fragments_array: array of pointers on buffers
+ * @pairs: collected LEB to PEB pairs (packed into fragments at once)
+ * @pairs_count: number of collected LEB to PEB pairs
+ * @pairs_capacity: capacity of @pairs array
  */
 struct ssdfs_maptbl_cache_layout {
 	/* layout */
@@ -253,6 +309,11 @@ struct ssdfs_maptbl_cache_layout {
 	size_t fragment_size;
 	u32 bytes_count;
 	void **fragments_array;
+
+	/* collected pairs */
+	struct ssdfs_leb2peb_pair *pairs;
+	u32 pairs_count;
+	u32 pairs_capacity;
 };
 
 /*
@@ -311,10 +372,54 @@ struct ssdfs_write_buffer {
 	u32 capacity;
 };
 
+/*
+ * struct ssdfs_plan_metadata - planned write of metadata type
+ * @pebs: number of written PEBs
+ * @area_bytes: bytes of every log's area
+ * @write_ios: number of write I/O requests
+ * @written_bytes: bytes written by I/O requests
+ * @uncompr_bytes: uncompressed size of compressed areas
+ * @compr_bytes: compressed size of compressed areas
+ */
+struct ssdfs_plan_metadata {
+	u64 pebs;
+	u64 area_bytes[SSDFS_SEG_LOG_ITEMS_COUNT];
+	u64 write_ios;
+	u64 written_bytes;
+	u64 uncompr_bytes;
+	u64 compr_bytes;
+};
+
+/*
+ * struct ssdfs_mkfs_plan - dry run of volume creation
+ * @is_enabled: plan volume creation without device modification
+ * @metadata: planned writes of every metadata type
+ * @write_ios: total number of write I/O requests
+ * @written_bytes: total bytes written by I/O requests
+ * @writers: number of PEB writers
+ * @erase_ranges: number of erased ranges
+ * @erase_range_size: size of erased range in bytes
+ * @erase_threads: number of erase threads
+ */
+struct ssdfs_mkfs_plan {
+	int is_enabled;
+
+	struct ssdfs_plan_metadata metadata[SSDFS_METADATA_ITEMS_MAX];
+
+	u64 write_ios;
+	u64 written_bytes;
+	u32 writers;
+
+	u64 erase_ranges;
+	u64 erase_range_size;
+	u32 erase_threads;
+};
+
 /*
  * struct ssdfs_volume_layout - description of created volume layout
  * @force_overwrite: force overwrite partition option
  * @need_erase_device: necessity in device erasure option
+ * @quick_format: erase only PEBs of existing volume option
  * @seg_size: segment size in bytes
  * @page_size: page size in bytes
  * @nand_dies_count: NAND dies count on device
@@ -343,10 +448,12 @@ struct ssdfs_write_buffer {
  * @env: environment
  * @threads: threads environment
  * @is_volume_erased: inform that volume has been erased
+ * @plan: dry run of volume creation
  */
 struct ssdfs_volume_layout {
 	int force_overwrite;
 	int need_erase_device;
+	int quick_format;
 
 	u64 seg_size;
 	u32 page_size;
@@ -382,6 +489,85 @@ struct ssdfs_volume_layout {
 	struct ssdfs_environment env;
 	struct ssdfs_threads_environment threads;
 	int is_volume_erased;
+
+	struct ssdfs_mkfs_plan plan;
+};
+
+/*
+ * struct ssdfs_maptbl_check_job - PEBs validity check of NAND die
+ * @die_index: index of NAND die
+ * @thread: thread descriptor
+ * @err: code of error
+ * @dies_count: number of NAND dies
+ * @layout: volume layout
+ */
+struct ssdfs_maptbl_check_job {
+	u32 die_index;
+	pthread_t thread;
+	int err;
+
+	u32 dies_count;
+	struct ssdfs_volume_layout *layout;
+};
+
+/*
+ * struct ssdfs_peb_write_request - request to write PEB
+ * @seg_index: index of segment in layout
+ * @peb_index: index of PEB in segment
+ */
+struct ssdfs_peb_write_request {
+	int seg_index;
+	int peb_index;
+};
+
+/*
+ * struct ssdfs_peb_write_queue - queue of PEBs for writing into zones
+ * @lock: queue's lock
+ * @request_added: new request has been added or queue has been closed
+ * @request_done: request has been processed
+ * @requests: ring buffer of requests
+ * @capacity: capacity of ring buffer (limit of zones under write)
+ * @head: index of the first request in ring buffer
+ * @count: number of requests in ring buffer
+ * @active_zones: number of zones under write (queued or being written)
+ * @is_closed: no more requests will be added
+ * @err: code of the first failed request
+ */
+struct ssdfs_peb_write_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t request_added;
+	pthread_cond_t request_done;
+
+	struct ssdfs_peb_write_request *requests;
+	u32 capacity;
+	u32 head;
+	u32 count;
+
+	u32 active_zones;
+	int is_closed;
+	int err;
+};
+
+/*
+ * struct ssdfs_peb_writer - writer of PEBs
+ * @index: index of writer
+ * @thread: thread descriptor
+ * @err: code of error
+ * @write_buffer: buffer for alligned write of prepared metadata
+ * @open_zones: number of zones that have been opened by writer
+ * @layout: volume layout
+ * @queue: queue of write requests
+ */
+struct ssdfs_peb_writer {
+	u32 index;
+	pthread_t thread;
+	int err;
+
+	struct ssdfs_write_buffer write_buffer;
+	u32 open_zones;
+
+	struct ssdfs_volume_layout *layout;
+	struct ssdfs_peb_write_queue *queue;
 };
 
 /*
@@ -393,10 +579,13 @@ struct ssdfs_volume_layout {
  * @validate: validate prepared metadata and to correct (if necessary)
  * @define_layout: define final placement of layout's items
  * @commit: place prepared metadata into segment(s)
+ * @generate_peb: generate deferred content of PEB right before write
  *
  * Arguments:
  * @ptr: pointer of volume layout structure
  * @segs: count of segments [out]
+ * @seg_index: index of segment in layout
+ * @peb_index: index of PEB in segment
  */
 struct ssdfs_mkfs_operations {
 	int (*allocation_policy)(struct ssdfs_volume_layout *ptr, int *segs);
@@ -404,6 +593,8 @@ struct ssdfs_mkfs_operations {
 	int (*validate)(struct ssdfs_volume_layout *ptr);
 	int (*define_layout)(struct ssdfs_volume_layout *ptr);
 	int (*commit)(struct ssdfs_volume_layout *ptr);
+	int (*generate_peb)(struct ssdfs_volume_layout *ptr,
+			    int seg_index, int peb_index);
 };
 
 #define OFF_DESC_PER_FRAGMENT() \
@@ -516,6 +707,9 @@ void parse_options(int argc, char *argv[],
 		   struct ssdfs_volume_layout *layout);
 
 /* common.c */
+int share_extent_buffer(struct ssdfs_extent_desc *src,
+			struct ssdfs_extent_desc *dst);
+void release_extent_buffer(struct ssdfs_extent_desc *desc);
 int reserve_segments(struct ssdfs_volume_layout *layout,
 		     int meta_index);
 int set_extent_start_offset(struct ssdfs_volume_layout *layout,
@@ -583,6 +777,9 @@ int pre_commit_log_footer(struct ssdfs_volume_layout *layout,
 void commit_log_footer(struct ssdfs_volume_layout *layout,
 		       int seg_index, int peb_index,
 		       u32 blks_count);
+int clone_log_template(struct ssdfs_volume_layout *layout,
+			int tmpl_seg_index, int tmpl_peb_index,
+			int seg_index, int peb_index);
 
 /* initial_snapshot.c */
 int snap_mkfs_allocation_policy(struct ssdfs_volume_layout *layout,
@@ -615,12 +812,28 @@ int maptbl_mkfs_prepare(struct ssdfs_volume_layout *layout);
 int maptbl_mkfs_validate(struct ssdfs_volume_layout *layout);
 int maptbl_mkfs_define_layout(struct ssdfs_volume_layout *layout);
 int maptbl_mkfs_commit(struct ssdfs_volume_layout *layout);
+int maptbl_mkfs_generate_peb(struct ssdfs_volume_layout *layout,
+			     int seg_index, int peb_index);
 void maptbl_destroy_fragments_array(struct ssdfs_volume_layout *layout);
 
 /* mapping_table_cache.c */
 int maptbl_cache_mkfs_prepare(struct ssdfs_volume_layout *layout);
 int cache_leb2peb_pair(struct ssdfs_volume_layout *layout,
 			u64 leb_id, u64 peb_id);
+int maptbl_cache_mkfs_pack(struct ssdfs_volume_layout *layout);
 void maptbl_cache_destroy_fragments_array(struct ssdfs_volume_layout *layout);
 
+/* plan.c */
+void plan_account_erase(struct ssdfs_volume_layout *layout,
+			u64 ranges, u64 range_size, u32 threads);
+void plan_account_peb(struct ssdfs_volume_layout *layout,
+		      int meta_index,
+		      struct ssdfs_peb_content *desc,
+		      u64 write_ios, u64 written_bytes);
+void plan_show_report(struct ssdfs_volume_layout *layout,
+		      u64 generation_ns);
+
+/* quick_format.c */
+int quick_erase_device(struct ssdfs_volume_layout *layout);
+
 #endif /* _SSDFS_UTILS_MKFS_H */
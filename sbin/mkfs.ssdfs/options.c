@@ -50,7 +50,7 @@ void print_usage(void)
 	SSDFS_INFO("\t [-h|--help]\t\t  display help message and exit.\n");
 	SSDFS_INFO("\t [-i|--inode_size size]\t  inode size in bytes "
 		   "(265B|512B|1KB|2KB|4KB).\n");
-	SSDFS_INFO("\t [-j|--threads]\t\t  define erase threads number.\n");
+	SSDFS_INFO("\t [-j|--threads]\t\t  define erase (and ZNS write) threads number.\n");
 	SSDFS_INFO("\t [-L|--label]\t\t  set a volume label.\n");
 	SSDFS_INFO("\t [-M|--maptbl has_copy,stripes_per_fragment=value,"
 		   "fragments_per_peb=value,log_pages=value,"
@@ -63,8 +63,12 @@ void print_usage(void)
 	SSDFS_INFO("\t [-O|--offsets_table has_copy,"
 		   "compression=(none|zlib|lzo|lz4|zstd)]\t  "
 		   "offsets table options.\n");
+	SSDFS_INFO("\t [-P|--plan]\t\t  plan volume creation without "
+		   "device modification.\n");
 	SSDFS_INFO("\t [-p|--pagesize size]\t  page size of target device "
 		   "(4KB|8KB|16KB|32KB).\n");
+	SSDFS_INFO("\t [-Q|--quick-format]\t  erase only PEBs used by "
+		   "existing volume of the same geometry.\n");
 	SSDFS_INFO("\t [-q|--quiet]\t\t  quiet execution "
 		   "(useful for scripts).\n");
 	SSDFS_INFO("\t [-R|--erase-device]  erase whole device or partition by mkfs.\n");
@@ -331,7 +335,7 @@ void parse_options(int argc, char *argv[],
 	int oi = 1;
 	char *p;
 	u64 granularity;
-	char sopts[] = "B:C:D:de:fhi:j:L:M:m:O:p:qRS:s:T:U:V";
+	char sopts[] = "B:C:D:de:fhi:j:L:M:m:O:Pp:QqRS:s:T:U:V";
 	static const struct option lopts[] = {
 		{"blkbmap", 1, NULL, 'B'},
 		{"compression", 1, NULL, 'C'},
@@ -346,7 +350,9 @@ void parse_options(int argc, char *argv[],
 		{"maptbl", 1, NULL, 'M'},
 		{"migration-threshold", 1, NULL, 'm'},
 		{"offsets_table", 1, NULL, 'O'},
+		{"plan", 0, NULL, 'P'},
 		{"pagesize", 1, NULL, 'p'},
+		{"quick-format", 0, NULL, 'Q'},
 		{"quiet", 0, NULL, 'q'},
 		{"erase-device", 0, NULL, 'R'},
 		{"segbmap", 1, NULL, 'S'},
@@ -581,6 +587,9 @@ void parse_options(int argc, char *argv[],
 				};
 			};
 			break;
+		case 'P':
+			layout->plan.is_enabled = SSDFS_TRUE;
+			break;
 		case 'p':
 			granularity = detect_granularity(optarg);
 			if (granularity >= U64_MAX) {
@@ -591,6 +600,10 @@ void parse_options(int argc, char *argv[],
 				layout->page_size = (u32)granularity;
 			}
 			break;
+		case 'Q':
+			layout->quick_format = SSDFS_TRUE;
+			layout->need_erase_device = SSDFS_TRUE;
+			break;
 		case 'q':
 			layout->env.show_info = SSDFS_FALSE;
 			break;
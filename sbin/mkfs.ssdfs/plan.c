@@ -0,0 +1,328 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ *
+ * ssdfs-utils -- SSDFS file system utilities.
+ *
+ * sbin/mkfs.ssdfs/plan.c - dry run of volume creation functionality.
+ *
+ * Copyright (c) 2014-2019 HGST, a Western Digital Company.
+ *              http://www.hgst.com/
+ * Copyright (c) 2014-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ *
+ * (C) Copyright 2014-2019, HGST, Inc., All rights reserved.
+ *
+ * Created by HGST, San Jose Research Center, Storage Architecture Group
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ *
+ * Acknowledgement: Cyril Guyot
+ *                  Zvonimir Bandic
+ */
+
+#include <sys/stat.h>
+
+#include "mkfs.h"
+
+/************************************************************************
+ *                  Dry run of volume creation functionality            *
+ ************************************************************************/
+
+enum {
+	SSDFS_PLAN_IMAGE_FILE,
+	SSDFS_PLAN_BLK_DEVICE,
+	SSDFS_PLAN_MTD_DEVICE,
+	SSDFS_PLAN_ZNS_DEVICE,
+	SSDFS_PLAN_DEVICE_TYPE_MAX
+};
+
+/*
+ * struct ssdfs_plan_device_model - cost model of device
+ * @name: device type name
+ * @write_mbps: write throughput in MB/s
+ * @write_latency_us: cost of one write request in microseconds
+ * @erase_mbps: erase throughput in MB/s (0 - size doesn't matter)
+ * @erase_latency_us: cost of one erase request in microseconds
+ *
+ * The numbers are nominal figures of every device type. They are
+ * not measured because dry run never touches the device.
+ */
+struct ssdfs_plan_device_model {
+	const char *name;
+	u32 write_mbps;
+	u32 write_latency_us;
+	u32 erase_mbps;
+	u32 erase_latency_us;
+};
+
+static const struct ssdfs_plan_device_model plan_models[] = {
+	[SSDFS_PLAN_IMAGE_FILE] = {
+		.name = "image file",
+		.write_mbps = 2000,
+		.write_latency_us = 10,
+		.erase_mbps = 2000,
+		.erase_latency_us = 10,
+	},
+	[SSDFS_PLAN_BLK_DEVICE] = {
+		.name = "block device",
+		.write_mbps = 500,
+		.write_latency_us = 50,
+		.erase_mbps = 0,
+		.erase_latency_us = 1000,
+	},
+	[SSDFS_PLAN_MTD_DEVICE] = {
+		.name = "MTD device",
+		.write_mbps = 10,
+		.write_latency_us = 250,
+		.erase_mbps = 0,
+		.erase_latency_us = 3000,
+	},
+	[SSDFS_PLAN_ZNS_DEVICE] = {
+		.name = "ZNS device",
+		.write_mbps = 1000,
+		.write_latency_us = 30,
+		.erase_mbps = 0,
+		.erase_latency_us = 500,
+	},
+};
+
+static const char *plan_metadata_names[SSDFS_METADATA_ITEMS_MAX] = {
+	[SSDFS_INITIAL_SNAPSHOT]	= "initial snapshot",
+	[SSDFS_SUPERBLOCK]		= "superblock",
+	[SSDFS_SEGBMAP]			= "segment bitmap",
+	[SSDFS_PEB_MAPPING_TABLE]	= "mapping table",
+	[SSDFS_USER_DATA]		= "user data",
+};
+
+static const char *plan_area_names[SSDFS_SEG_LOG_ITEMS_COUNT] = {
+	[SSDFS_SEG_HEADER]		= "segment header",
+	[SSDFS_BLOCK_BITMAP]		= "block bitmap",
+	[SSDFS_OFFSET_TABLE]		= "offsets table",
+	[SSDFS_BLOCK_DESCRIPTORS]	= "block descriptors",
+	[SSDFS_MAPTBL_CACHE]		= "maptbl cache",
+	[SSDFS_LOG_PAYLOAD]		= "payload",
+	[SSDFS_LOG_FOOTER]		= "log footer",
+	[SSDFS_BLOCK_BITMAP_BACKUP]	= "block bitmap backup",
+	[SSDFS_OFFSET_TABLE_BACKUP]	= "offsets table backup",
+};
+
+void plan_account_erase(struct ssdfs_volume_layout *layout,
+			u64 ranges, u64 range_size, u32 threads)
+{
+	struct ssdfs_mkfs_plan *plan = &layout->plan;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "ranges %llu, range_size %llu, threads %u\n",
+		  ranges, range_size, threads);
+
+	plan->erase_ranges = ranges;
+	plan->erase_range_size = range_size;
+	plan->erase_threads = threads;
+}
+
+void plan_account_peb(struct ssdfs_volume_layout *layout,
+		      int meta_index,
+		      struct ssdfs_peb_content *desc,
+		      u64 write_ios, u64 written_bytes)
+{
+	struct ssdfs_plan_metadata *item;
+	struct ssdfs_extent_desc *extent;
+	int i;
+
+	BUG_ON(meta_index < 0 || meta_index >= SSDFS_METADATA_ITEMS_MAX);
+
+	item = &layout->plan.metadata[meta_index];
+
+	item->pebs++;
+	item->write_ios += write_ios;
+	item->written_bytes += written_bytes;
+
+	for (i = 0; i < SSDFS_SEG_LOG_ITEMS_COUNT; i++) {
+		extent = &desc->extents[i];
+
+		if (!extent->buf)
+			continue;
+
+		item->area_bytes[i] += extent->bytes_count;
+
+		if (extent->uncompr_bytes > 0) {
+			item->uncompr_bytes += extent->uncompr_bytes;
+			item->compr_bytes += extent->compr_bytes;
+		}
+	}
+}
+
+static int plan_get_device_type(struct ssdfs_volume_layout *layout)
+{
+	struct stat stat;
+
+	switch (layout->env.device_type) {
+	case SSDFS_MTD_DEVICE:
+		return SSDFS_PLAN_MTD_DEVICE;
+
+	case SSDFS_ZNS_DEVICE:
+		return SSDFS_PLAN_ZNS_DEVICE;
+
+	default:
+		/* continue logic */
+		break;
+	}
+
+	if (fstat(layout->env.fd, &stat) == 0 && S_ISREG(stat.st_mode))
+		return SSDFS_PLAN_IMAGE_FILE;
+
+	return SSDFS_PLAN_BLK_DEVICE;
+}
+
+/*
+ * plan_erase_requests() - calculate number of erase requests
+ * @layout: pointer on volume layout
+ * @device_type: device type of cost model
+ *
+ * Image file cannot be discarded and it is erased by writes
+ * of 128KB buffer. MTD device erases every erase block and
+ * ZNS device resets every zone of the range. Block device
+ * discards the whole range by one request.
+ */
+static u64 plan_erase_requests(struct ssdfs_volume_layout *layout,
+				int device_type)
+{
+	struct ssdfs_mkfs_plan *plan = &layout->plan;
+	u64 erase_size = layout->env.erase_size;
+	u64 requests;
+
+	switch (device_type) {
+	case SSDFS_PLAN_IMAGE_FILE:
+		requests = plan->erase_range_size + SSDFS_128KB - 1;
+		requests /= SSDFS_128KB;
+		break;
+
+	case SSDFS_PLAN_MTD_DEVICE:
+	case SSDFS_PLAN_ZNS_DEVICE:
+		requests = plan->erase_range_size + erase_size - 1;
+		requests /= erase_size;
+		break;
+
+	default:
+		requests = 1;
+		break;
+	}
+
+	return requests * plan->erase_ranges;
+}
+
+static inline
+u64 plan_io_cost_ns(u64 requests, u64 bytes,
+		    u32 latency_us, u32 mbps, u32 threads)
+{
+	u64 cost_ns;
+
+	cost_ns = requests * latency_us * 1000;
+
+	if (mbps > 0)
+		cost_ns += (bytes * 1000) / mbps;
+
+	return cost_ns / max_t(u32, threads, 1);
+}
+
+static inline
+u64 ns_to_ms(u64 ns)
+{
+	return (ns + 500000) / 1000000;
+}
+
+/*
+ * plan_show_report() - show report of volume creation dry run
+ * @layout: pointer on volume layout
+ * @generation_ns: measured time of metadata generation
+ *
+ * This method shows bytes and I/O requests of every metadata type,
+ * erase ranges, compression savings and predicted wall time of
+ * volume creation. The wall time is the measured time of metadata
+ * generation plus erase and write costs of the device's cost model.
+ */
+void plan_show_report(struct ssdfs_volume_layout *layout,
+		      u64 generation_ns)
+{
+	struct ssdfs_mkfs_plan *plan = &layout->plan;
+	const struct ssdfs_plan_device_model *model;
+	int device_type;
+	u64 erase_requests;
+	u64 erased_bytes;
+	u64 erase_ns, write_ns;
+	u64 uncompr_bytes = 0;
+	u64 compr_bytes = 0;
+	int i, j;
+
+	device_type = plan_get_device_type(layout);
+	BUG_ON(device_type >= SSDFS_PLAN_DEVICE_TYPE_MAX);
+	model = &plan_models[device_type];
+
+	erase_requests = plan_erase_requests(layout, device_type);
+	erased_bytes = plan->erase_ranges * plan->erase_range_size;
+
+	erase_ns = plan_io_cost_ns(erase_requests, erased_bytes,
+				   model->erase_latency_us,
+				   model->erase_mbps,
+				   plan->erase_threads);
+	write_ns = plan_io_cost_ns(plan->write_ios, plan->written_bytes,
+				   model->write_latency_us,
+				   model->write_mbps,
+				   plan->writers);
+
+	SSDFS_INFO("MKFS PLAN (device is not modified)\n");
+	SSDFS_INFO("device: %s (%s), size %llu bytes\n",
+		   layout->env.dev_name, model->name,
+		   (unsigned long long)layout->env.fs_size);
+	SSDFS_INFO("geometry: segment %llu bytes, erase block %u bytes, "
+		   "page %u bytes, segments %d\n",
+		   (unsigned long long)layout->seg_size,
+		   layout->env.erase_size, layout->page_size,
+		   layout->segs_count);
+
+	SSDFS_INFO("\n%-22s %8s %14s %10s %14s %14s\n",
+		   "METADATA", "PEBS", "WRITTEN_BYTES", "WRITE_IOS",
+		   "COMPR_BYTES", "COMPR_SAVINGS");
+
+	for (i = 0; i < SSDFS_METADATA_ITEMS_MAX; i++) {
+		struct ssdfs_plan_metadata *item = &plan->metadata[i];
+
+		if (item->pebs == 0)
+			continue;
+
+		SSDFS_INFO("%-22s %8llu %14llu %10llu %14llu %14llu\n",
+			   plan_metadata_names[i],
+			   item->pebs, item->written_bytes, item->write_ios,
+			   item->compr_bytes,
+			   item->uncompr_bytes - item->compr_bytes);
+
+		for (j = 0; j < SSDFS_SEG_LOG_ITEMS_COUNT; j++) {
+			if (item->area_bytes[j] == 0)
+				continue;
+
+			SSDFS_INFO("  %-20s %23llu\n",
+				   plan_area_names[j],
+				   item->area_bytes[j]);
+		}
+
+		uncompr_bytes += item->uncompr_bytes;
+		compr_bytes += item->compr_bytes;
+	}
+
+	SSDFS_INFO("\nwrite: %llu requests, %llu bytes, %u writer(s)\n",
+		   plan->write_ios, plan->written_bytes,
+		   max_t(u32, plan->writers, 1));
+	SSDFS_INFO("erase: %llu ranges of %llu bytes, %llu bytes, "
+		   "%llu requests, %u thread(s)\n",
+		   plan->erase_ranges, plan->erase_range_size,
+		   erased_bytes, erase_requests,
+		   max_t(u32, plan->erase_threads, 1));
+	SSDFS_INFO("compression: %llu bytes -> %llu bytes, "
+		   "saved %llu bytes\n",
+		   uncompr_bytes, compr_bytes,
+		   uncompr_bytes - compr_bytes);
+	SSDFS_INFO("predicted time: %llu ms (generation %llu ms, "
+		   "erase %llu ms, write %llu ms)\n",
+		   ns_to_ms(generation_ns + erase_ns + write_ns),
+		   ns_to_ms(generation_ns), ns_to_ms(erase_ns),
+		   ns_to_ms(write_ns));
+}
@@ -0,0 +1,885 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ *
+ * ssdfs-utils -- SSDFS file system utilities.
+ *
+ * sbin/mkfs.ssdfs/quick_format.c - quick re-format functionality.
+ *
+ * Copyright (c) 2014-2019 HGST, a Western Digital Company.
+ *              http://www.hgst.com/
+ * Copyright (c) 2014-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ *              http://www.ssdfs.org/
+ *
+ * (C) Copyright 2014-2019, HGST, Inc., All rights reserved.
+ *
+ * Created by HGST, San Jose Research Center, Storage Architecture Group
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ *
+ * Acknowledgement: Cyril Guyot
+ *                  Zvonimir Bandic
+ */
+
+#include <unistd.h>
+
+#include "mkfs.h"
+
+#define SSDFS_MKFS_PEBTBL_FRAG_COMPR_MASK \
+	(SSDFS_PEBTBL_FRAG_ZLIB_COMPR | SSDFS_PEBTBL_FRAG_LZO_COMPR | \
+	 SSDFS_PEBTBL_FRAG_LZ4_COMPR | SSDFS_PEBTBL_FRAG_ZSTD_COMPR)
+
+/************************************************************************
+ *                    Quick re-format functionality                     *
+ ************************************************************************/
+
+/*
+ * is_volume_geometry_equal() - check geometry of existing volume
+ * @layout: pointer on volume layout
+ * @old: volume header of existing volume
+ *
+ * Logs of existing volume can be discarded PEB by PEB only if
+ * PEBs of existing and new volumes have the same boundaries.
+ */
+static int is_volume_geometry_equal(struct ssdfs_volume_layout *layout,
+				    struct ssdfs_volume_header *old)
+{
+	struct ssdfs_volume_header *new = &layout->sb.vh;
+	u32 old_flags = le32_to_cpu(old->flags);
+	u32 new_flags = le32_to_cpu(new->flags);
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "old: log_pagesize %u, log_erasesize %u, log_segsize %u, "
+		  "pebs_count %llu, flags %#x; "
+		  "new: log_pagesize %u, log_erasesize %u, log_segsize %u, "
+		  "pebs_count %llu, flags %#x\n",
+		  old->log_pagesize, old->log_erasesize, old->log_segsize,
+		  le64_to_cpu(old->maptbl.pebs_count), old_flags,
+		  new->log_pagesize, new->log_erasesize, new->log_segsize,
+		  le64_to_cpu(new->maptbl.pebs_count), new_flags);
+
+	if (old->log_pagesize != new->log_pagesize ||
+	    old->log_erasesize != new->log_erasesize ||
+	    old->log_segsize != new->log_segsize)
+		return SSDFS_FALSE;
+
+	if (old->maptbl.pebs_count != new->maptbl.pebs_count)
+		return SSDFS_FALSE;
+
+	if ((old_flags & SSDFS_VH_ZNS_BASED_VOLUME) !=
+	    (new_flags & SSDFS_VH_ZNS_BASED_VOLUME))
+		return SSDFS_FALSE;
+
+	return SSDFS_TRUE;
+}
+
+static inline
+int is_ssdfs_log_header(void *buf)
+{
+	struct ssdfs_signature *magic = (struct ssdfs_signature *)buf;
+	u16 key = le16_to_cpu(magic->key);
+
+	if (le32_to_cpu(magic->common) != SSDFS_SUPER_MAGIC)
+		return SSDFS_FALSE;
+
+	return key == SSDFS_SEGMENT_HDR_MAGIC ||
+		key == SSDFS_PARTIAL_LOG_HDR_MAGIC;
+}
+
+/*
+ * struct ssdfs_quick_format_scan - scan of existing volume's metadata
+ * @vh: volume header of the latest superblock segment's log
+ * @timestamp: timestamp of the latest superblock segment's log
+ * @cache_peb: PEB ID of the log with mapping table cache
+ * @cache_desc: mapping table cache's area descriptor
+ * @cache: mapping table cache's content
+ * @area: buffer for log's area content
+ * @pebs_count: number of PEBs on the volume
+ * @peb_state: PEB states of existing volume's mapping table
+ * @scanned_pebs: number of PEBs with processed logs
+ */
+struct ssdfs_quick_format_scan {
+	struct ssdfs_volume_header vh;
+	u64 timestamp;
+	u64 cache_peb;
+	struct ssdfs_metadata_descriptor cache_desc;
+	u8 *cache;
+	u8 *area;
+	u64 pebs_count;
+	u8 *peb_state;
+	u64 scanned_pebs;
+};
+
+typedef int (*quick_log_fn)(struct ssdfs_volume_layout *layout,
+			    struct ssdfs_quick_format_scan *scan,
+			    u64 peb_id,
+			    union ssdfs_metadata_header *hdr);
+
+static inline
+int is_quick_area_valid(struct ssdfs_metadata_descriptor *desc,
+			u32 erase_size)
+{
+	u32 area_offset = le32_to_cpu(desc->offset);
+	u32 area_size = le32_to_cpu(desc->size);
+
+	if (area_size == 0 || area_offset == 0)
+		return SSDFS_FALSE;
+
+	return area_offset < erase_size &&
+		area_size <= (erase_size - area_offset);
+}
+
+/*
+ * quick_read_area() - read area of PEB
+ * @layout: pointer on volume layout
+ * @scan: scan of existing volume
+ * @peb_id: PEB ID
+ * @offset: offset of area from PEB's beginning in bytes
+ * @size: size of area in bytes
+ * @area: pointer on area's content in scan's buffer [out]
+ *
+ * Device is opened with O_DIRECT. So, the area is read by whole pages
+ * into the page aligned buffer.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO        - I/O error.
+ */
+static int quick_read_area(struct ssdfs_volume_layout *layout,
+			   struct ssdfs_quick_format_scan *scan,
+			   u64 peb_id, u32 offset, u32 size,
+			   u8 **area)
+{
+	u32 erase_size = layout->env.erase_size;
+	u32 page_size = layout->page_size;
+	u32 start = (offset / page_size) * page_size;
+	u32 end = ((offset + size + page_size - 1) / page_size) * page_size;
+	int err;
+
+	end = min_t(u32, end, erase_size);
+
+	err = layout->env.dev_ops->read(layout->env.fd,
+					(peb_id * erase_size) + start,
+					end - start, scan->area,
+					layout->env.show_debug);
+	if (err) {
+		SSDFS_ERR("fail to read PEB's area: "
+			  "peb_id %llu, offset %u, size %u, err %d\n",
+			  peb_id, offset, size, err);
+		return err;
+	}
+
+	*area = scan->area + (offset - start);
+	return 0;
+}
+
+/*
+ * quick_process_peb_logs() - process every log of PEB
+ * @layout: pointer on volume layout
+ * @scan: scan of existing volume
+ * @peb_id: PEB ID
+ * @fn: log processing function
+ *
+ * Logs are written from the PEB's beginning. Only the log's header
+ * is read to find the next log. The log's header is copied because
+ * the processing function can re-use the scan's buffer. The first page that doesn't start
+ * from a log's header finishes the PEB.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO        - I/O error.
+ * %-ENODATA    - log's content is unsupported.
+ */
+static int quick_process_peb_logs(struct ssdfs_volume_layout *layout,
+				  struct ssdfs_quick_format_scan *scan,
+				  u64 peb_id, quick_log_fn fn)
+{
+	struct ssdfs_metadata_descriptor *desc_array;
+	struct ssdfs_metadata_descriptor *desc;
+	union ssdfs_metadata_header hdr;
+	u32 erase_size = layout->env.erase_size;
+	u32 page_size = layout->page_size;
+	u32 log_offset = 0;
+	u32 log_end;
+	int i;
+	int err;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "peb_id %llu\n", peb_id);
+
+	scan->scanned_pebs++;
+
+	while (log_offset < erase_size) {
+		u32 hdr_offset = log_offset;
+		u8 *area;
+
+		if (peb_id == SSDFS_INITIAL_SNAPSHOT_SEG && log_offset == 0)
+			hdr_offset = SSDFS_RESERVED_VBR_SIZE;
+
+		err = quick_read_area(layout, scan, peb_id, hdr_offset,
+				      sizeof(hdr), &area);
+		if (err)
+			return err;
+
+		memcpy(&hdr, area, sizeof(hdr));
+
+		if (!is_ssdfs_log_header(&hdr))
+			break;
+
+		if (le16_to_cpu(hdr.magic.key) == SSDFS_SEGMENT_HDR_MAGIC)
+			desc_array = hdr.seg_hdr.desc_array;
+		else
+			desc_array = hdr.pl_hdr.desc_array;
+
+		err = fn(layout, scan, peb_id, &hdr);
+		if (err)
+			return err;
+
+		log_end = log_offset;
+
+		for (i = 0; i < SSDFS_SEG_HDR_DESC_MAX; i++) {
+			desc = &desc_array[i];
+
+			if (!is_quick_area_valid(desc, erase_size))
+				continue;
+
+			log_end = max_t(u32, log_end,
+					le32_to_cpu(desc->offset) +
+					le32_to_cpu(desc->size));
+		}
+
+		log_end = ((log_end + page_size - 1) / page_size) * page_size;
+
+		if (log_end <= log_offset)
+			break;
+
+		log_offset = log_end;
+	}
+
+	return 0;
+}
+
+/*
+ * quick_find_latest_sb_log() - remember the latest superblock's log
+ *
+ * The volume header and mapping table cache of the latest log
+ * describe the current state of mapping table.
+ */
+static int quick_find_latest_sb_log(struct ssdfs_volume_layout *layout,
+				    struct ssdfs_quick_format_scan *scan,
+				    u64 peb_id,
+				    union ssdfs_metadata_header *hdr)
+{
+	size_t hdr_size = sizeof(struct ssdfs_segment_header);
+	struct ssdfs_segment_header *seg_hdr = &hdr->seg_hdr;
+	struct ssdfs_metadata_descriptor *desc;
+	u64 timestamp;
+
+	if (le16_to_cpu(hdr->magic.key) != SSDFS_SEGMENT_HDR_MAGIC)
+		return 0;
+
+	if (!is_csum_valid(&seg_hdr->volume_hdr.check, seg_hdr, hdr_size))
+		return 0;
+
+	timestamp = le64_to_cpu(seg_hdr->timestamp);
+	if (timestamp < scan->timestamp)
+		return 0;
+
+	scan->timestamp = timestamp;
+	memcpy(&scan->vh, &seg_hdr->volume_hdr,
+		sizeof(struct ssdfs_volume_header));
+
+	desc = &seg_hdr->desc_array[SSDFS_MAPTBL_CACHE_INDEX];
+	if (is_quick_area_valid(desc, layout->env.erase_size)) {
+		scan->cache_peb = peb_id;
+		memcpy(&scan->cache_desc, desc,
+			sizeof(struct ssdfs_metadata_descriptor));
+	}
+
+	return 0;
+}
+
+/*
+ * quick_load_maptbl_cache() - find the latest mapping table cache
+ * @layout: pointer on volume layout
+ * @scan: scan of existing volume
+ *
+ * Superblock segment is followed from the current PEB to the next
+ * one while the next PEB contains the newer logs.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - mapping table cache is not found.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EIO        - I/O error.
+ */
+static int quick_load_maptbl_cache(struct ssdfs_volume_layout *layout,
+				   struct ssdfs_quick_format_scan *scan)
+{
+	struct ssdfs_volume_header *vh = &scan->vh;
+	struct ssdfs_leb2peb_pair *pair;
+	u64 peb_id;
+	u64 timestamp;
+	u32 area_offset;
+	u32 area_size;
+	u8 *area;
+	int i;
+	int err;
+
+	pair = &vh->sb_pebs[SSDFS_CUR_SB_SEG][SSDFS_MAIN_SB_SEG];
+	peb_id = le64_to_cpu(pair->peb_id);
+
+	for (i = 0; i < SSDFS_SB_CHAIN_MAX; i++) {
+		if (peb_id >= scan->pebs_count)
+			break;
+
+		timestamp = scan->timestamp;
+
+		err = quick_process_peb_logs(layout, scan, peb_id,
+					     quick_find_latest_sb_log);
+		if (err)
+			return err;
+
+		if (i > 0 && timestamp == scan->timestamp)
+			break;
+
+		pair = &vh->sb_pebs[SSDFS_NEXT_SB_SEG][SSDFS_MAIN_SB_SEG];
+		if (peb_id == le64_to_cpu(pair->peb_id))
+			break;
+
+		peb_id = le64_to_cpu(pair->peb_id);
+	}
+
+	if (scan->cache_peb >= U64_MAX) {
+		SSDFS_DBG(layout->env.show_debug,
+			  "mapping table cache is not found\n");
+		return -ENODATA;
+	}
+
+	area_offset = le32_to_cpu(scan->cache_desc.offset);
+	area_size = le32_to_cpu(scan->cache_desc.size);
+
+	scan->cache = calloc(1, area_size);
+	if (!scan->cache) {
+		SSDFS_ERR("fail to allocate memory: size %u\n",
+			  area_size);
+		return -ENOMEM;
+	}
+
+	err = quick_read_area(layout, scan, scan->cache_peb,
+			      area_offset, area_size, &area);
+	if (err)
+		return err;
+
+	memcpy(scan->cache, area, area_size);
+
+	return 0;
+}
+
+/*
+ * quick_convert_leb2peb() - convert LEB ID into PEB ID
+ * @layout: pointer on volume layout
+ * @scan: scan of existing volume
+ * @leb_id: LEB ID
+ *
+ * Every fragment of mapping table cache occupies a page.
+ * Only uncompressed fragments are processed.
+ *
+ * RETURN: PEB ID or U64_MAX if LEB is not found.
+ */
+static u64 quick_convert_leb2peb(struct ssdfs_volume_layout *layout,
+				 struct ssdfs_quick_format_scan *scan,
+				 u64 leb_id)
+{
+	struct ssdfs_maptbl_cache_header *hdr;
+	struct ssdfs_leb2peb_pair *pairs;
+	size_t hdr_size = SSDFS_MAPTBL_CACHE_HDR_SIZE;
+	size_t pair_size = SSDFS_LEB2PEB_PAIR_SIZE;
+	u32 area_size = le32_to_cpu(scan->cache_desc.size);
+	u32 page_size = layout->page_size;
+	u32 offset;
+	u16 items_count;
+	u16 i;
+
+	for (offset = 0; (offset + hdr_size) <= area_size;
+						offset += page_size) {
+		hdr = (struct ssdfs_maptbl_cache_header *)(scan->cache + offset);
+
+		if (le32_to_cpu(hdr->magic.common) != SSDFS_SUPER_MAGIC ||
+		    le16_to_cpu(hdr->magic.key) != SSDFS_MAPTBL_CACHE_MAGIC)
+			break;
+
+		if (le16_to_cpu(hdr->flags) != 0)
+			break;
+
+		items_count = le16_to_cpu(hdr->items_count);
+
+		if ((hdr_size + (items_count * pair_size)) >
+					min_t(u32, page_size, area_size - offset))
+			break;
+
+		if (leb_id < le64_to_cpu(hdr->start_leb) ||
+		    leb_id > le64_to_cpu(hdr->end_leb))
+			continue;
+
+		pairs = (struct ssdfs_leb2peb_pair *)((u8 *)hdr + hdr_size);
+
+		for (i = 0; i < items_count; i++) {
+			if (le64_to_cpu(pairs[i].leb_id) == leb_id)
+				return le64_to_cpu(pairs[i].peb_id);
+		}
+	}
+
+	return U64_MAX;
+}
+
+/*
+ * quick_store_peb_states() - store PEB states of log's PEB table fragments
+ *
+ * PEB table fragments are located at page boundaries of log's payload.
+ * The fragment of later log replaces the fragment of previous one.
+ * Fragment with corrupted checksum is ignored.
+ */
+static int quick_store_peb_states(struct ssdfs_volume_layout *layout,
+				  struct ssdfs_quick_format_scan *scan,
+				  u64 peb_id,
+				  union ssdfs_metadata_header *hdr)
+{
+	struct ssdfs_metadata_descriptor *desc;
+	struct ssdfs_peb_table_fragment_header *pebtbl_hdr;
+	struct ssdfs_peb_descriptor *desc_array;
+	size_t hdr_size = sizeof(struct ssdfs_peb_table_fragment_header);
+	size_t desc_size = sizeof(struct ssdfs_peb_descriptor);
+	u32 page_size = layout->page_size;
+	u32 area_offset;
+	u32 area_size;
+	u32 offset;
+	u8 *area;
+	int err;
+
+	if (le16_to_cpu(hdr->magic.key) == SSDFS_SEGMENT_HDR_MAGIC)
+		desc = &hdr->seg_hdr.desc_array[SSDFS_COLD_PAYLOAD_AREA_INDEX];
+	else
+		desc = &hdr->pl_hdr.desc_array[SSDFS_COLD_PAYLOAD_AREA_INDEX];
+
+	if (!is_quick_area_valid(desc, layout->env.erase_size))
+		return 0;
+
+	area_offset = le32_to_cpu(desc->offset);
+	area_size = le32_to_cpu(desc->size);
+
+	err = quick_read_area(layout, scan, peb_id,
+			      area_offset, area_size, &area);
+	if (err)
+		return err;
+
+	for (offset = 0; (offset + hdr_size) <= area_size;
+						offset += page_size) {
+		u8 *ptr = area + offset;
+		u64 start_peb;
+		u16 pebs_count;
+		u32 bytes_count;
+		__le32 csum;
+		u16 i;
+
+		pebtbl_hdr = (struct ssdfs_peb_table_fragment_header *)ptr;
+
+		if (le16_to_cpu(pebtbl_hdr->magic) != SSDFS_PEB_TABLE_MAGIC)
+			continue;
+
+		if (pebtbl_hdr->flags & SSDFS_MKFS_PEBTBL_FRAG_COMPR_MASK) {
+			SSDFS_DBG(layout->env.show_debug,
+				  "compressed PEB table fragment: "
+				  "peb_id %llu, offset %u\n",
+				  peb_id, offset);
+			return -ENODATA;
+		}
+
+		start_peb = le64_to_cpu(pebtbl_hdr->start_peb);
+		pebs_count = le16_to_cpu(pebtbl_hdr->pebs_count);
+		bytes_count = le32_to_cpu(pebtbl_hdr->bytes_count);
+
+		if (bytes_count != (hdr_size + (pebs_count * desc_size)) ||
+		    bytes_count > min_t(u32, page_size, area_size - offset) ||
+		    start_peb >= scan->pebs_count ||
+		    pebs_count > (scan->pebs_count - start_peb))
+			continue;
+
+		csum = pebtbl_hdr->checksum;
+		pebtbl_hdr->checksum = 0;
+		pebtbl_hdr->checksum = ssdfs_crc32_le(ptr, bytes_count);
+
+		if (pebtbl_hdr->checksum != csum) {
+			SSDFS_DBG(layout->env.show_debug,
+				  "corrupted PEB table fragment: "
+				  "peb_id %llu, offset %u\n",
+				  peb_id, offset);
+			continue;
+		}
+
+		desc_array = (struct ssdfs_peb_descriptor *)(ptr + hdr_size);
+
+		for (i = 0; i < pebs_count; i++)
+			scan->peb_state[start_peb + i] = desc_array[i].state;
+	}
+
+	return 0;
+}
+
+/*
+ * quick_load_maptbl() - load PEB states from existing mapping table
+ * @layout: pointer on volume layout
+ * @scan: scan of existing volume
+ *
+ * Only the main copy of mapping table is processed. PEB that
+ * isn't described by any valid fragment keeps the unknown state.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - mapping table cannot be processed.
+ * %-EIO        - I/O error.
+ */
+static int quick_load_maptbl(struct ssdfs_volume_layout *layout,
+			     struct ssdfs_quick_format_scan *scan)
+{
+	struct ssdfs_maptbl_sb_header *maptbl = &scan->vh.maptbl;
+	struct ssdfs_meta_area_extent *extent;
+	u32 lebs_per_seg = layout->seg_size / layout->env.erase_size;
+	u64 maptbl_pebs = 0;
+	u64 start_id;
+	u32 len;
+	u32 i, j;
+	int err;
+
+	for (i = 0; i < MAPTBL_LIMIT1; i++) {
+		extent = &maptbl->extents[i][SSDFS_MAIN_MAPTBL_SEG];
+		start_id = le64_to_cpu(extent->start_id);
+		len = le32_to_cpu(extent->len);
+
+		switch (le16_to_cpu(extent->type)) {
+		case SSDFS_SEG_EXTENT_TYPE:
+			start_id *= lebs_per_seg;
+			len *= lebs_per_seg;
+			break;
+
+		case SSDFS_PEB_EXTENT_TYPE:
+			/* LEB IDs */
+			break;
+
+		default:
+			continue;
+		}
+
+		for (j = 0; j < len; j++) {
+			u64 peb_id;
+
+			peb_id = quick_convert_leb2peb(layout, scan,
+							start_id + j);
+			if (peb_id >= scan->pebs_count) {
+				SSDFS_DBG(layout->env.show_debug,
+					  "unknown PEB of mapping table: "
+					  "leb_id %llu\n",
+					  start_id + j);
+				return -ENODATA;
+			}
+
+			err = quick_process_peb_logs(layout, scan, peb_id,
+						     quick_store_peb_states);
+			if (err)
+				return err;
+
+			scan->peb_state[peb_id] = SSDFS_MAPTBL_USED_PEB_STATE;
+			maptbl_pebs++;
+		}
+	}
+
+	if (maptbl_pebs == 0) {
+		SSDFS_DBG(layout->env.show_debug,
+			  "mapping table's extents are empty\n");
+		return -ENODATA;
+	}
+
+	return 0;
+}
+
+/*
+ * is_peb_used() - check that PEB can contain logs of existing volume
+ * @state: PEB state of existing volume's mapping table
+ *
+ * Clean and pre-erased PEBs have no valid logs. Bad PEB is never
+ * touched. PEB in any other state (or unknown one) is erased.
+ */
+static inline
+int is_peb_used(u8 state)
+{
+	switch (state) {
+	case SSDFS_MAPTBL_CLEAN_PEB_STATE:
+	case SSDFS_MAPTBL_PRE_ERASE_STATE:
+	case SSDFS_MAPTBL_BAD_PEB_STATE:
+		return SSDFS_FALSE;
+
+	default:
+		/* continue logic */
+		break;
+	}
+
+	return SSDFS_TRUE;
+}
+
+static int quick_erase_pebs(struct ssdfs_volume_layout *layout,
+			    u64 start_peb, u64 pebs_count,
+			    void *buf, size_t buf_size)
+{
+	u64 erase_size = layout->env.erase_size;
+	int err;
+
+	SSDFS_MKFS_INFO(layout->env.show_info,
+			"erasing PEBs %llu-%llu...\n",
+			start_peb, start_peb + pebs_count - 1);
+
+	err = layout->env.dev_ops->erase(layout->env.fd,
+					 start_peb * erase_size,
+					 pebs_count * erase_size,
+					 buf, buf_size,
+					 layout->env.show_debug);
+	if (err) {
+		SSDFS_ERR("unable to erase PEBs: "
+			  "start_peb %llu, pebs_count %llu, err %d\n",
+			  start_peb, pebs_count, err);
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * is_peb_written() - check that PEB will be written by mkfs
+ * @layout: pointer on volume layout
+ * @peb_id: PEB ID
+ */
+static int is_peb_written(struct ssdfs_volume_layout *layout, u64 peb_id)
+{
+	u64 pebs_per_seg = layout->seg_size / layout->env.erase_size;
+	int i;
+
+	for (i = 0; i < layout->segs_count; i++) {
+		struct ssdfs_segment_desc *seg = &layout->segs[i];
+		u64 start_peb = seg->seg_id * pebs_per_seg;
+
+		if (peb_id >= start_peb && peb_id < (start_peb + pebs_per_seg))
+			return SSDFS_TRUE;
+	}
+
+	return SSDFS_FALSE;
+}
+
+/*
+ * quick_erase_device() - erase only PEBs used by existing volume
+ * @layout: pointer on volume layout
+ *
+ * This method detects existing SSDFS volume on the device and
+ * compares its geometry with the new one. If geometry is the same,
+ * then used PEBs are found by means of the existing volume's
+ * mapping table: the volume header of the first PEB points out
+ * the superblock segment, the latest superblock's log provides
+ * the mapping table's extents and mapping table cache, and
+ * PEB table fragments of mapping table's logs provide the state
+ * of every PEB. Only logs' headers and metadata areas of these
+ * PEBs are read. Used PEBs of existing volume and PEBs of created
+ * segments are erased (discarded for block device or reset for
+ * ZNS device). Erasing goes from the first PEB, so the volume's entry
+ * point is destroyed at first and all stale logs are erased (and
+ * synced) before any new metadata is written. Interrupted re-format
+ * never leaves a mix of old and new volume's metadata.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENODATA    - device doesn't contain SSDFS volume or
+ *                its mapping table cannot be processed.
+ * %-ERANGE     - geometry of existing volume is different.
+ * %-ENOMEM     - fail to allocate memory.
+ * %-EIO        - fail to erase PEBs.
+ */
+int quick_erase_device(struct ssdfs_volume_layout *layout)
+{
+	struct ssdfs_quick_format_scan *scan;
+	union ssdfs_metadata_header *hdr;
+	size_t hdr_size = sizeof(struct ssdfs_segment_header);
+	u64 pebs_count = layout->env.fs_size / layout->env.erase_size;
+	u64 run_start = U64_MAX;
+	u64 used_pebs = 0;
+	u64 erased_pebs = 0;
+	u64 erased_ranges = 0;
+	void *buf = NULL;
+	size_t buf_size = SSDFS_128KB;
+	u8 *area;
+	u64 i;
+	int j, k;
+	int err;
+
+	SSDFS_DBG(layout->env.show_debug,
+		  "device %s, pebs_count %llu\n",
+		  layout->env.dev_name, pebs_count);
+
+	scan = calloc(1, sizeof(struct ssdfs_quick_format_scan));
+	hdr = calloc(1, sizeof(union ssdfs_metadata_header));
+	if (!scan || !hdr) {
+		SSDFS_ERR("fail to allocate memory\n");
+		err = -ENOMEM;
+		goto free_scan;
+	}
+
+	scan->pebs_count = pebs_count;
+	scan->cache_peb = U64_MAX;
+
+	scan->peb_state = calloc(pebs_count, sizeof(u8));
+	if (!scan->peb_state) {
+		SSDFS_ERR("fail to allocate memory\n");
+		err = -ENOMEM;
+		goto free_scan;
+	}
+
+	err = posix_memalign((void **)&scan->area, layout->page_size,
+			     layout->env.erase_size);
+	if (err || !scan->area) {
+		SSDFS_ERR("fail to allocate memory\n");
+		err = -ENOMEM;
+		goto free_scan;
+	}
+
+	err = quick_read_area(layout, scan, SSDFS_INITIAL_SNAPSHOT_SEG,
+			      SSDFS_RESERVED_VBR_SIZE, hdr_size, &area);
+	if (err)
+		goto free_scan;
+
+	memcpy(hdr, area, hdr_size);
+
+	if (le32_to_cpu(hdr->magic.common) != SSDFS_SUPER_MAGIC ||
+	    le16_to_cpu(hdr->magic.key) != SSDFS_SEGMENT_HDR_MAGIC ||
+	    !is_csum_valid(&hdr->seg_hdr.volume_hdr.check,
+			   &hdr->seg_hdr, hdr_size)) {
+		SSDFS_MKFS_INFO(layout->env.show_info,
+				"SSDFS volume is not found: full format\n");
+		err = -ENODATA;
+		goto free_scan;
+	}
+
+	memcpy(&scan->vh, &hdr->seg_hdr.volume_hdr,
+		sizeof(struct ssdfs_volume_header));
+
+	if (!is_volume_geometry_equal(layout, &scan->vh)) {
+		SSDFS_MKFS_INFO(layout->env.show_info,
+				"geometry of SSDFS volume is different: "
+				"full format\n");
+		err = -ERANGE;
+		goto free_scan;
+	}
+
+	err = quick_load_maptbl_cache(layout, scan);
+	if (!err)
+		err = quick_load_maptbl(layout, scan);
+
+	if (err == -ENODATA) {
+		SSDFS_MKFS_INFO(layout->env.show_info,
+				"mapping table of SSDFS volume "
+				"cannot be processed: full format\n");
+		goto free_scan;
+	} else if (err)
+		goto free_scan;
+
+	scan->peb_state[SSDFS_INITIAL_SNAPSHOT_SEG] =
+					SSDFS_MAPTBL_USED_PEB_STATE;
+
+	for (j = 0; j < SSDFS_SB_CHAIN_MAX; j++) {
+		for (k = 0; k < SSDFS_SB_SEG_COPY_MAX; k++) {
+			u64 peb_id = le64_to_cpu(scan->vh.sb_pebs[j][k].peb_id);
+
+			if (peb_id < pebs_count) {
+				scan->peb_state[peb_id] =
+					SSDFS_MAPTBL_USED_PEB_STATE;
+			}
+		}
+	}
+
+	err = posix_memalign(&buf, SSDFS_128KB, buf_size);
+	if (err || !buf) {
+		SSDFS_ERR("fail to allocate memory\n");
+		err = -ENOMEM;
+		goto free_scan;
+	}
+
+	memset(buf, 0xff, buf_size);
+
+	for (i = 0; i <= pebs_count; i++) {
+		if (i < pebs_count) {
+			int need_erase = is_peb_used(scan->peb_state[i]);
+
+			if (need_erase)
+				used_pebs++;
+			else
+				need_erase = is_peb_written(layout, i);
+
+			if (need_erase) {
+				erased_pebs++;
+				if (run_start == U64_MAX)
+					run_start = i;
+				continue;
+			}
+		}
+
+		if (run_start == U64_MAX)
+			continue;
+
+		erased_ranges++;
+
+		if (!layout->plan.is_enabled) {
+			err = quick_erase_pebs(layout, run_start,
+						i - run_start,
+						buf, buf_size);
+			if (err)
+				goto free_buf;
+		}
+
+		run_start = U64_MAX;
+	}
+
+	SSDFS_MKFS_INFO(layout->env.show_info,
+			"quick format: scanned PEBs %llu, "
+			"used PEBs %llu of %llu, "
+			"erased PEBs %llu, erased ranges %llu\n",
+			scan->scanned_pebs, used_pebs, pebs_count,
+			erased_pebs, erased_ranges);
+
+	if (layout->plan.is_enabled) {
+		plan_account_erase(layout, erased_pebs,
+				   layout->env.erase_size, 1);
+		goto free_buf;
+	}
+
+	if (fsync(layout->env.fd) < 0) {
+		SSDFS_ERR("fail to sync device %s: %s\n",
+			  layout->env.dev_name, strerror(errno));
+		err = -EIO;
+	}
+
+free_buf:
+	free(buf);
+
+free_scan:
+	if (scan) {
+		free(scan->peb_state);
+		free(scan->cache);
+		free(scan->area);
+	}
+	free(scan);
+	free(hdr);
+	return err;
+}
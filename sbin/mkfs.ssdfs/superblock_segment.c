@@ -1639,6 +1639,15 @@ int sb_mkfs_define_layout(struct ssdfs_volume_layout *layout)
 				layout->segs[seg_index].pebs_capacity);
 			peb_desc = &layout->segs[seg_index].pebs[peb_index];
 
+			if (j != SSDFS_MAIN_SB_SEG) {
+				/*
+				 * copy segment has the same log,
+				 * it will be cloned from the main
+				 * segment's log on commit
+				 */
+				goto inc_seg_index;
+			}
+
 			err = set_extent_start_offset(layout,
 							SSDFS_SB_SEG_TYPE,
 							peb_desc,
@@ -1752,6 +1761,7 @@ int sb_mkfs_commit(struct ssdfs_volume_layout *layout)
 	int segs_count;
 	int i, j;
 	int seg_index;
+	int main_seg_index = -1;
 	int peb_index = 0;
 	int err;
 
@@ -1783,6 +1793,28 @@ int sb_mkfs_commit(struct ssdfs_volume_layout *layout)
 			if (i != SSDFS_CUR_SB_SEG)
 				goto inc_seg_index;
 
+			if (j != SSDFS_MAIN_SB_SEG) {
+				/*
+				 * The only per-copy work is the segment
+				 * header and its checksum. It is cheaper
+				 * than creation of a thread.
+				 */
+				err = clone_log_template(layout,
+							 main_seg_index,
+							 peb_index,
+							 seg_index,
+							 peb_index);
+				if (err) {
+					SSDFS_ERR("fail to clone sb log: "
+						  "err %d\n", err);
+					return err;
+				}
+
+				goto inc_seg_index;
+			}
+
+			main_seg_index = seg_index;
+
 			err = pre_commit_segment_header(layout, seg_index,
 							peb_index,
 							SSDFS_SB_SEG_TYPE);
@@ -0,0 +1,503 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ *
+ * ssdfs-utils -- SSDFS file system utilities.
+ *
+ * sbin/recoverfs.ssdfs/checkpoint.c - implementation of recovery
+ *                                     progress checkpoints.
+ *
+ * Copyright (c) 2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ * All rights reserved.
+ *              http://www.ssdfs.org/
+ *
+ * Authors: Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#define _LARGEFILE64_SOURCE
+#define __USE_FILE_OFFSET64
+#define _GNU_SOURCE
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
+
+#include "recoverfs.h"
+
+static inline
+void ssdfs_recoverfs_checkpoint_name(char *name, size_t len, int thread_id)
+{
+	memset(name, 0, len);
+
+	if (thread_id == SSDFS_RECOVERFS_STAGE_CHECKPOINT) {
+		snprintf(name, len - 1, "%s",
+			 SSDFS_RECOVERFS_CHECKPOINT_NAME);
+	} else {
+		snprintf(name, len - 1, "%s.%d",
+			 SSDFS_RECOVERFS_CHECKPOINT_NAME, thread_id);
+	}
+}
+
+static inline
+__le32 ssdfs_recoverfs_checkpoint_csum(struct ssdfs_recoverfs_checkpoint *cp)
+{
+	__le32 old_csum = cp->csum;
+	__le32 csum;
+
+	cp->csum = 0;
+	csum = ssdfs_crc32_le(cp, sizeof(struct ssdfs_recoverfs_checkpoint));
+	cp->csum = old_csum;
+
+	return csum;
+}
+
+/*
+ * ssdfs_recoverfs_write_checkpoint() - write checkpoint atomically
+ * @folder_fd: output folder's file descriptor
+ * @thread_id: thread ID or SSDFS_RECOVERFS_STAGE_CHECKPOINT
+ * @cp: checkpoint
+ * @show_debug: show debug messages
+ *
+ * This method writes checkpoint into temporary file and
+ * renames it into checkpoint's name. Crash in the middle of
+ * operation keeps the previous checkpoint untouched.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+static
+int ssdfs_recoverfs_write_checkpoint(int folder_fd, int thread_id,
+				     struct ssdfs_recoverfs_checkpoint *cp,
+				     int show_debug)
+{
+	char name[SSDFS_MAX_NAME_LEN];
+	char tmp_name[SSDFS_MAX_NAME_LEN + 8];
+	ssize_t written;
+	int fd;
+	int err = 0;
+
+	SSDFS_DBG(show_debug,
+		  "thread_id %d, stage %u, next_peb %llu, "
+		  "end_peb %llu, last_folder %llu\n",
+		  thread_id, le16_to_cpu(cp->stage),
+		  le64_to_cpu(cp->next_peb),
+		  le64_to_cpu(cp->end_peb),
+		  le64_to_cpu(cp->last_folder));
+
+	ssdfs_recoverfs_checkpoint_name(name, sizeof(name), thread_id);
+
+	memset(tmp_name, 0, sizeof(tmp_name));
+	snprintf(tmp_name, sizeof(tmp_name) - 1, "%s.tmp", name);
+
+	cp->magic = cpu_to_le32(SSDFS_RECOVERFS_CHECKPOINT_MAGIC);
+	cp->thread_id = cpu_to_le16((u16)thread_id);
+	cp->csum = ssdfs_recoverfs_checkpoint_csum(cp);
+
+	fd = openat(folder_fd, tmp_name,
+		    O_CREAT | O_TRUNC | O_WRONLY | O_LARGEFILE,
+		    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd < 0) {
+		err = errno;
+		SSDFS_ERR("unable to create file %s: %s\n",
+			  tmp_name, strerror(errno));
+		return err;
+	}
+
+	written = write(fd, cp, sizeof(struct ssdfs_recoverfs_checkpoint));
+	if (written != sizeof(struct ssdfs_recoverfs_checkpoint)) {
+		err = written < 0 ? errno : -EIO;
+		SSDFS_ERR("fail to write file %s: written %zd\n",
+			  tmp_name, written);
+		goto close_file;
+	}
+
+	err = fsync(fd);
+	if (err) {
+		err = errno;
+		SSDFS_ERR("fail to sync file %s: %s\n",
+			  tmp_name, strerror(errno));
+		goto close_file;
+	}
+
+close_file:
+	close(fd);
+
+	if (err) {
+		unlinkat(folder_fd, tmp_name, 0);
+		return err;
+	}
+
+	err = renameat(folder_fd, tmp_name, folder_fd, name);
+	if (err) {
+		err = errno;
+		SSDFS_ERR("fail to rename file %s: %s\n",
+			  tmp_name, strerror(errno));
+		unlinkat(folder_fd, tmp_name, 0);
+		return err;
+	}
+
+	err = fsync(folder_fd);
+	if (err) {
+		err = errno;
+		SSDFS_ERR("fail to sync output folder: %s\n",
+			  strerror(errno));
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_recoverfs_read_checkpoint() - read and check checkpoint
+ * @folder_fd: output folder's file descriptor
+ * @thread_id: thread ID or SSDFS_RECOVERFS_STAGE_CHECKPOINT
+ * @fs_size: size of volume in bytes
+ * @erase_size: erase block size in bytes
+ * @cp: checkpoint [out]
+ * @show_debug: show debug messages
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOENT     - checkpoint doesn't exist.
+ * %-EIO        - checkpoint is corrupted.
+ * %-EINVAL     - checkpoint belongs to another volume.
+ */
+static
+int ssdfs_recoverfs_read_checkpoint(int folder_fd, int thread_id,
+				    u64 fs_size, u32 erase_size,
+				    struct ssdfs_recoverfs_checkpoint *cp,
+				    int show_debug)
+{
+	char name[SSDFS_MAX_NAME_LEN];
+	ssize_t read_bytes;
+	int fd;
+
+	SSDFS_DBG(show_debug,
+		  "thread_id %d, fs_size %llu, erase_size %u\n",
+		  thread_id, fs_size, erase_size);
+
+	ssdfs_recoverfs_checkpoint_name(name, sizeof(name), thread_id);
+
+	fd = openat(folder_fd, name, O_RDONLY | O_LARGEFILE);
+	if (fd < 0) {
+		if (errno == ENOENT)
+			return -ENOENT;
+
+		SSDFS_ERR("unable to open %s: %s\n",
+			  name, strerror(errno));
+		return errno;
+	}
+
+	memset(cp, 0, sizeof(struct ssdfs_recoverfs_checkpoint));
+
+	read_bytes = read(fd, cp, sizeof(struct ssdfs_recoverfs_checkpoint));
+	close(fd);
+
+	if (read_bytes != sizeof(struct ssdfs_recoverfs_checkpoint)) {
+		SSDFS_ERR("checkpoint %s is truncated: read_bytes %zd\n",
+			  name, read_bytes);
+		return -EIO;
+	}
+
+	if (le32_to_cpu(cp->magic) != SSDFS_RECOVERFS_CHECKPOINT_MAGIC ||
+	    le32_to_cpu(cp->csum) !=
+			le32_to_cpu(ssdfs_recoverfs_checkpoint_csum(cp))) {
+		SSDFS_ERR("checkpoint %s is corrupted\n", name);
+		return -EIO;
+	}
+
+	if (le16_to_cpu(cp->thread_id) != (u16)thread_id ||
+	    le64_to_cpu(cp->fs_size) != fs_size ||
+	    le32_to_cpu(cp->erase_size) != erase_size) {
+		SSDFS_ERR("checkpoint %s belongs to another volume: "
+			  "fs_size %llu, erase_size %u\n",
+			  name, le64_to_cpu(cp->fs_size),
+			  le32_to_cpu(cp->erase_size));
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_recoverfs_save_peb_range_checkpoint() - save thread's progress
+ * @state: pointer on thread state
+ * @next_peb: first PEB that is not processed yet
+ * @end_peb: PEB ID after the last PEB in thread's range
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_recoverfs_save_peb_range_checkpoint(struct ssdfs_thread_state *state,
+					      u64 next_peb, u64 end_peb)
+{
+	struct ssdfs_recoverfs_checkpoint cp;
+
+	SSDFS_DBG(state->base.show_debug,
+		  "thread %d, next_peb %llu, end_peb %llu\n",
+		  state->id, next_peb, end_peb);
+
+	memset(&cp, 0, sizeof(struct ssdfs_recoverfs_checkpoint));
+
+	cp.fs_size = cpu_to_le64(state->base.fs_size);
+	cp.erase_size = cpu_to_le32(state->base.erase_size);
+	cp.stage = cpu_to_le16(SSDFS_RECOVERFS_NOTHING_DONE);
+	cp.next_peb = cpu_to_le64(next_peb);
+	cp.end_peb = cpu_to_le64(end_peb);
+	cp.last_folder = cpu_to_le64(U64_MAX);
+
+	return ssdfs_recoverfs_write_checkpoint(state->output_folder.fd,
+						state->id, &cp,
+						state->base.show_debug);
+}
+
+/*
+ * ssdfs_recoverfs_load_peb_range_checkpoint() - load thread's progress
+ * @state: pointer on thread state
+ * @end_peb: PEB ID after the last PEB in thread's range
+ * @next_peb: first PEB that is not processed yet [out]
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-ENOENT     - checkpoint doesn't exist.
+ * %-EIO        - checkpoint is corrupted.
+ * %-EINVAL     - checkpoint describes another PEB range.
+ */
+int ssdfs_recoverfs_load_peb_range_checkpoint(struct ssdfs_thread_state *state,
+					      u64 end_peb, u64 *next_peb)
+{
+	struct ssdfs_recoverfs_checkpoint cp;
+	int err;
+
+	SSDFS_DBG(state->base.show_debug,
+		  "thread %d, PEB %llu, end_peb %llu\n",
+		  state->id, state->peb.id, end_peb);
+
+	err = ssdfs_recoverfs_read_checkpoint(state->output_folder.fd,
+					      state->id,
+					      state->base.fs_size,
+					      state->base.erase_size,
+					      &cp, state->base.show_debug);
+	if (err)
+		return err;
+
+	*next_peb = le64_to_cpu(cp.next_peb);
+
+	if (le64_to_cpu(cp.end_peb) != end_peb ||
+	    *next_peb < state->peb.id || *next_peb > end_peb) {
+		SSDFS_ERR("checkpoint of thread %d describes another range: "
+			  "next_peb %llu, end_peb %llu, "
+			  "expected range [%llu, %llu)\n",
+			  state->id, *next_peb, le64_to_cpu(cp.end_peb),
+			  state->peb.id, end_peb);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static inline
+__le32 ssdfs_recoverfs_inode_filter_csum(struct ssdfs_inode_filter *filter)
+{
+	if (filter->count <= 0)
+		return 0;
+
+	return ssdfs_crc32_le(filter->ranges,
+			      filter->count *
+				sizeof(struct ssdfs_inode_id_range));
+}
+
+static inline
+void ssdfs_recoverfs_save_options(struct ssdfs_recoverfs_environment *env,
+				  struct ssdfs_recoverfs_checkpoint *cp)
+{
+	cp->minute = cpu_to_le32(env->timestamp.minute);
+	cp->hour = cpu_to_le32(env->timestamp.hour);
+	cp->day = cpu_to_le32(env->timestamp.day);
+	cp->month = cpu_to_le32(env->timestamp.month);
+	cp->year = cpu_to_le32(env->timestamp.year);
+	cp->inode_ranges = cpu_to_le32((u32)env->inode_filter.count);
+	cp->inode_filter_csum =
+		ssdfs_recoverfs_inode_filter_csum(&env->inode_filter);
+	cp->threads = cpu_to_le16((u16)env->threads.capacity);
+}
+
+/*
+ * ssdfs_recoverfs_check_options() - check options of resumed recovery
+ * @env: recoverfs environment
+ * @cp: stage checkpoint
+ *
+ * Threads' ranges and the content of fragments depend on
+ * the threads number, the timestamp and the inode filter.
+ * Resumed recovery has to use the same options.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - options differ from the checkpoint's ones.
+ */
+static
+int ssdfs_recoverfs_check_options(struct ssdfs_recoverfs_environment *env,
+				  struct ssdfs_recoverfs_checkpoint *cp)
+{
+	int err = 0;
+
+	if (le16_to_cpu(cp->threads) != (u16)env->threads.capacity) {
+		SSDFS_ERR("interrupted recovery used %u threads: "
+			  "requested threads %d\n",
+			  le16_to_cpu(cp->threads),
+			  env->threads.capacity);
+		err = -EINVAL;
+	}
+
+	if (le32_to_cpu(cp->minute) != env->timestamp.minute ||
+	    le32_to_cpu(cp->hour) != env->timestamp.hour ||
+	    le32_to_cpu(cp->day) != env->timestamp.day ||
+	    le32_to_cpu(cp->month) != env->timestamp.month ||
+	    le32_to_cpu(cp->year) != env->timestamp.year) {
+		SSDFS_ERR("interrupted recovery used another timestamp: "
+			  "minute %u, hour %u, day %u, month %u, year %u\n",
+			  le32_to_cpu(cp->minute),
+			  le32_to_cpu(cp->hour),
+			  le32_to_cpu(cp->day),
+			  le32_to_cpu(cp->month),
+			  le32_to_cpu(cp->year));
+		err = -EINVAL;
+	}
+
+	if (le32_to_cpu(cp->inode_ranges) != (u32)env->inode_filter.count ||
+	    le32_to_cpu(cp->inode_filter_csum) !=
+		le32_to_cpu(ssdfs_recoverfs_inode_filter_csum(&env->inode_filter))) {
+		SSDFS_ERR("interrupted recovery used another inode filter: "
+			  "ranges %u\n",
+			  le32_to_cpu(cp->inode_ranges));
+		err = -EINVAL;
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_recoverfs_save_stage_checkpoint() - save finished stage of recovery
+ * @env: recoverfs environment
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_recoverfs_save_stage_checkpoint(struct ssdfs_recoverfs_environment *env)
+{
+	struct ssdfs_recoverfs_checkpoint cp;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "stage %d, last_folder %llu\n",
+		  env->checkpoint.stage,
+		  env->checkpoint.last_folder);
+
+	memset(&cp, 0, sizeof(struct ssdfs_recoverfs_checkpoint));
+
+	cp.fs_size = cpu_to_le64(env->base.fs_size);
+	cp.erase_size = cpu_to_le32(env->base.erase_size);
+	cp.stage = cpu_to_le16((u16)env->checkpoint.stage);
+	cp.next_peb = cpu_to_le64(U64_MAX);
+	cp.end_peb = cpu_to_le64(U64_MAX);
+	cp.last_folder = cpu_to_le64(env->checkpoint.last_folder);
+	ssdfs_recoverfs_save_options(env, &cp);
+
+	err = ssdfs_recoverfs_write_checkpoint(env->output_folder.fd,
+						SSDFS_RECOVERFS_STAGE_CHECKPOINT,
+						&cp, env->base.show_debug);
+	if (err)
+		return err;
+
+	env->checkpoint.timestamp = ssdfs_current_time_in_nanoseconds();
+	return 0;
+}
+
+/*
+ * ssdfs_recoverfs_load_stage_checkpoint() - load finished stage of recovery
+ * @env: recoverfs environment
+ *
+ * Absent stage checkpoint means that nothing has been finished yet.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EIO        - checkpoint is corrupted.
+ * %-EINVAL     - checkpoint belongs to another volume or
+ *                recovery options differ.
+ */
+int ssdfs_recoverfs_load_stage_checkpoint(struct ssdfs_recoverfs_environment *env)
+{
+	struct ssdfs_recoverfs_checkpoint cp;
+	int stage;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "output_folder %s\n",
+		  env->output_folder.name);
+
+	err = ssdfs_recoverfs_read_checkpoint(env->output_folder.fd,
+					      SSDFS_RECOVERFS_STAGE_CHECKPOINT,
+					      env->base.fs_size,
+					      env->base.erase_size,
+					      &cp, env->base.show_debug);
+	if (err == -ENOENT) {
+		env->checkpoint.stage = SSDFS_RECOVERFS_NOTHING_DONE;
+		env->checkpoint.last_folder = U64_MAX;
+		return 0;
+	} else if (err)
+		return err;
+
+	err = ssdfs_recoverfs_check_options(env, &cp);
+	if (err)
+		return err;
+
+	stage = le16_to_cpu(cp.stage);
+	if (stage >= SSDFS_RECOVERFS_STAGE_MAX) {
+		SSDFS_ERR("invalid stage %d in checkpoint\n", stage);
+		return -EIO;
+	}
+
+	env->checkpoint.stage = stage;
+	env->checkpoint.last_folder = le64_to_cpu(cp.last_folder);
+
+	return 0;
+}
+
+/*
+ * ssdfs_recoverfs_delete_checkpoints() - delete all checkpoints
+ * @env: recoverfs environment
+ */
+void ssdfs_recoverfs_delete_checkpoints(struct ssdfs_recoverfs_environment *env)
+{
+	char name[SSDFS_MAX_NAME_LEN];
+	int i;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "output_folder %s\n",
+		  env->output_folder.name);
+
+	for (i = 0; i < env->threads.capacity; i++) {
+		ssdfs_recoverfs_checkpoint_name(name, sizeof(name), i);
+		unlinkat(env->output_folder.fd, name, 0);
+	}
+
+	ssdfs_recoverfs_checkpoint_name(name, sizeof(name),
+					SSDFS_RECOVERFS_STAGE_CHECKPOINT);
+	unlinkat(env->output_folder.fd, name, 0);
+}
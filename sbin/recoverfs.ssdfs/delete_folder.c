@@ -31,61 +31,289 @@
 #include <errno.h>
 #include <pthread.h>
 #include <dirent.h>
+#include <sys/syscall.h>
 
 #include "recoverfs.h"
 
+/*
+ * struct ssdfs_linux_dirent64 - directory entry of getdents64()
+ * @d_ino: inode number
+ * @d_off: offset to next entry
+ * @d_reclen: length of this entry
+ * @d_type: file type
+ * @d_name: file name (null-terminated)
+ */
+struct ssdfs_linux_dirent64 {
+	u64 d_ino;
+	s64 d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+static
+void ssdfs_delete_files_portion(struct ssdfs_delete_files_job *job)
+{
+	u32 i;
+
+	SSDFS_DBG(job->show_debug,
+		  "job %u, count %u, jobs_count %u\n",
+		  job->id, job->count, job->jobs_count);
+
+	job->err = 0;
+	job->deleted = 0;
+
+	for (i = job->id; i < job->count; i += job->jobs_count) {
+		if (unlinkat(job->folder_fd, job->names[i], 0) == 0) {
+			job->deleted++;
+			continue;
+		}
+
+		if (errno == ENOENT)
+			continue;
+
+		job->err = errno;
+		SSDFS_ERR("unable to delete file %s: %s\n",
+			  job->names[i], strerror(errno));
+	}
+}
+
+static
+void *ssdfs_delete_files_thread(void *arg)
+{
+	struct ssdfs_delete_files_job *job =
+				(struct ssdfs_delete_files_job *)arg;
+
+	if (!job)
+		pthread_exit((void *)1);
+
+	ssdfs_delete_files_portion(job);
+
+	pthread_exit((void *)0);
+}
+
+/*
+ * ssdfs_delete_files_in_parallel() - delete portion of files
+ * @env: recoverfs environment
+ * @folder_fd: file descriptor of parent folder
+ * @names: names of files in parent folder
+ * @count: number of names in array
+ * @jobs: array of jobs
+ * @jobs_capacity: capacity of jobs array
+ * @deleted: number of deleted files [out]
+ *
+ * This method distributes the names among the bounded pool
+ * of threads. If a thread cannot be created, then the calling
+ * thread deletes the portion of files itself.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code of the last failed deletion.
+ */
+static
+int ssdfs_delete_files_in_parallel(struct ssdfs_recoverfs_environment *env,
+				   int folder_fd, char **names, u32 count,
+				   struct ssdfs_delete_files_job *jobs,
+				   u32 jobs_capacity, u64 *deleted)
+{
+	u32 jobs_count;
+	u32 i;
+	int err = 0;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "count %u, jobs_capacity %u\n",
+		  count, jobs_capacity);
+
+	*deleted = 0;
+	jobs_count = min_t(u32, jobs_capacity, count);
+
+	for (i = 0; i < jobs_count; i++) {
+		jobs[i].id = i;
+		jobs[i].err = 0;
+		jobs[i].show_debug = env->base.show_debug;
+		jobs[i].folder_fd = folder_fd;
+		jobs[i].names = names;
+		jobs[i].count = count;
+		jobs[i].jobs_count = jobs_count;
+		jobs[i].deleted = 0;
+		jobs[i].thread = 0;
+
+		if (jobs_count == 1) {
+			ssdfs_delete_files_portion(&jobs[i]);
+			continue;
+		}
+
+		err = pthread_create(&jobs[i].thread, NULL,
+				     ssdfs_delete_files_thread,
+				     (void *)&jobs[i]);
+		if (err) {
+			SSDFS_DBG(env->base.show_debug,
+				  "fail to create thread %u: %s\n",
+				  i, strerror(err));
+			jobs[i].thread = 0;
+			ssdfs_delete_files_portion(&jobs[i]);
+		}
+	}
+
+	err = 0;
+
+	for (i = 0; i < jobs_count; i++) {
+		if (jobs[i].thread)
+			pthread_join(jobs[i].thread, NULL);
+
+		*deleted += jobs[i].deleted;
+
+		if (jobs[i].err)
+			err = jobs[i].err;
+	}
+
+	return err;
+}
+
+/*
+ * ssdfs_delete_non_empty_folder() - delete folder with files
+ * @env: recoverfs environment
+ * @path: path to the folder
+ *
+ * This method reads the folder's entries by portions of getdents64()
+ * buffer and deletes every portion by bounded pool of threads.
+ * The folder is read again until nothing can be deleted.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
 static
 int ssdfs_delete_non_empty_folder(struct ssdfs_recoverfs_environment *env,
 				  const char *path)
 {
-	struct ssdfs_folder_environment parent;
-	int index;
+	struct ssdfs_delete_files_job *jobs = NULL;
+	char **names = NULL;
+	char *buf = NULL;
+	u32 names_capacity;
+	u32 jobs_capacity;
+	u64 pass_deleted;
+	u64 deleted;
+	int fd;
 	int err = 0;
 
 	SSDFS_DBG(env->base.show_debug,
 		  "path %s\n",
 		  path);
 
-	memset(&parent, 0, sizeof(struct ssdfs_folder_environment));
-	parent.name = path;
-
-	parent.fd = open(path, O_DIRECTORY, 0777);
-	if (parent.fd < 1) {
+	fd = open(path, O_DIRECTORY | O_RDONLY);
+	if (fd < 0) {
 		SSDFS_ERR("unable to open %s: %s\n",
 			  path, strerror(errno));
 		return errno;
 	}
 
-	err = ssdfs_recoverfs_prepare_name_list(&parent);
-	if (err) {
-		SSDFS_ERR("fail to scan folder %s: err %d\n",
-			  parent.name, err);
-		goto close_parent_folder;
+	buf = malloc(SSDFS_RECOVERFS_GETDENTS_BUFFER_SIZE);
+	if (!buf) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate buffer: %s\n",
+			  strerror(errno));
+		goto close_folder;
 	}
 
-	for (index = 0; index < parent.content.count; index++) {
-		if (IS_FILE(&parent, index)) {
-			err = unlinkat(parent.fd, FILE_NAME(&parent, index), 0);
-			if (err) {
+	names_capacity = SSDFS_RECOVERFS_GETDENTS_BUFFER_SIZE /
+					SSDFS_RECOVERFS_DIRENT_MIN_SIZE;
+
+	names = calloc(names_capacity, sizeof(char *));
+	if (!names) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate names array: %s\n",
+			  strerror(errno));
+		goto free_buffer;
+	}
+
+	jobs_capacity = max_t(u32, env->threads.capacity, 1);
+
+	jobs = calloc(jobs_capacity, sizeof(struct ssdfs_delete_files_job));
+	if (!jobs) {
+		err = -ENOMEM;
+		SSDFS_ERR("fail to allocate jobs array: %s\n",
+			  strerror(errno));
+		goto free_names;
+	}
+
+	do {
+		pass_deleted = 0;
+
+		if (lseek(fd, 0, SEEK_SET) < 0) {
+			err = errno;
+			SSDFS_ERR("fail to rewind folder %s: %s\n",
+				  path, strerror(errno));
+			goto free_jobs;
+		}
+
+		do {
+			struct ssdfs_linux_dirent64 *dirent;
+			long nread;
+			long offset;
+			u32 count = 0;
+
+			nread = syscall(SYS_getdents64, fd, buf,
+					SSDFS_RECOVERFS_GETDENTS_BUFFER_SIZE);
+			if (nread < 0) {
 				err = errno;
-				SSDFS_ERR("unable to delete file %s: %s\n",
-					  FILE_NAME(&parent, index),
-					  strerror(errno));
+				SSDFS_ERR("fail to read folder %s: %s\n",
+					  path, strerror(errno));
+				goto free_jobs;
+			} else if (nread == 0)
+				break;
+
+			for (offset = 0; offset < nread;
+					offset += dirent->d_reclen) {
+				dirent = (struct ssdfs_linux_dirent64 *)(buf + offset);
+
+				/* skip ".", ".." and subfolders */
+				if (dirent->d_type == DT_DIR)
+					continue;
+
+				BUG_ON(count >= names_capacity);
+				names[count++] = dirent->d_name;
 			}
-		}
-	}
 
-close_parent_folder:
-	close(parent.fd);
+			if (count == 0)
+				continue;
+
+			err = ssdfs_delete_files_in_parallel(env, fd,
+							     names, count,
+							     jobs,
+							     jobs_capacity,
+							     &deleted);
+			pass_deleted += deleted;
+
+			if (err) {
+				SSDFS_ERR("fail to delete files in %s: "
+					  "err %d\n",
+					  path, err);
+				goto free_jobs;
+			}
+		} while (SSDFS_TRUE);
+	} while (pass_deleted > 0);
+
+free_jobs:
+	free(jobs);
+
+free_names:
+	free(names);
+
+free_buffer:
+	free(buf);
+
+close_folder:
+	close(fd);
 
 	if (err)
 		return err;
 
-	err = rmdir(parent.name);
+	err = rmdir(path);
 	if (err) {
 		err = errno;
 		SSDFS_ERR("fail to delete %s: %s\n",
-			  parent.name, strerror(errno));
+			  path, strerror(errno));
 		return err;
 	}
 
@@ -135,3 +363,192 @@ int ssdfs_recoverfs_delete_folder(struct ssdfs_recoverfs_environment *env,
 
 	return 0;
 }
+
+/*
+ * ssdfs_recoverfs_move_folder_to_trash() - move folder into trash folder
+ * @env: recoverfs environment
+ * @folder_name: name of folder in output folder
+ *
+ * Rename is cheap and it makes folder invisible for the user.
+ * The content of trash folder is deleted later.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_recoverfs_move_folder_to_trash(struct ssdfs_recoverfs_environment *env,
+					 const char *folder_name)
+{
+	char new_name[SSDFS_MAX_NAME_LEN];
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "folder_name %s\n",
+		  folder_name);
+
+	err = mkdirat(env->output_folder.fd,
+		      SSDFS_RECOVERFS_TRASH_FOLDER_NAME, 0777);
+	if (err && errno != EEXIST) {
+		err = errno;
+		SSDFS_ERR("unable to create folder %s: %s\n",
+			  SSDFS_RECOVERFS_TRASH_FOLDER_NAME,
+			  strerror(errno));
+		return err;
+	}
+
+	memset(new_name, 0, sizeof(new_name));
+
+	err = snprintf(new_name, sizeof(new_name) - 1,
+			"%s/%s",
+			SSDFS_RECOVERFS_TRASH_FOLDER_NAME,
+			folder_name);
+	if (err < 0) {
+		SSDFS_ERR("fail to prepare string: %s\n",
+			  strerror(errno));
+		return err;
+	}
+
+	err = renameat(env->output_folder.fd, folder_name,
+			env->output_folder.fd, new_name);
+	if (err) {
+		err = errno;
+		SSDFS_ERR("fail to move %s into %s: %s\n",
+			  folder_name, SSDFS_RECOVERFS_TRASH_FOLDER_NAME,
+			  strerror(errno));
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_recoverfs_delete_trash() - delete trash folder
+ * @env: recoverfs environment
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_recoverfs_delete_trash(struct ssdfs_recoverfs_environment *env)
+{
+	struct ssdfs_folder_environment trash;
+	char path[SSDFS_MAX_NAME_LEN];
+	char folder_name[PATH_MAX];
+	int index;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "output_folder %s\n",
+		  env->output_folder.name);
+
+	memset(path, 0, sizeof(path));
+
+	err = snprintf(path, sizeof(path) - 1,
+			"%s/%s",
+			env->output_folder.name,
+			SSDFS_RECOVERFS_TRASH_FOLDER_NAME);
+	if (err < 0) {
+		SSDFS_ERR("fail to prepare string: %s\n",
+			  strerror(errno));
+		return err;
+	}
+
+	if (faccessat(env->output_folder.fd,
+		      SSDFS_RECOVERFS_TRASH_FOLDER_NAME, F_OK, 0) != 0) {
+		/* trash folder is absent */
+		return 0;
+	}
+
+	memset(&trash, 0, sizeof(struct ssdfs_folder_environment));
+	trash.name = path;
+	trash.fd = -1;
+
+	err = ssdfs_recoverfs_prepare_name_list(&trash);
+	if (err) {
+		SSDFS_ERR("fail to scan folder %s: err %d\n",
+			  path, err);
+		return err;
+	}
+
+	for (index = 0; index < trash.content.count; index++) {
+		if (IS_DOT_FOLDER(&trash, index)) {
+			/* do nothing */
+		} else if (IS_DOTDOT_FOLDER(&trash, index)) {
+			/* do nothing */
+		} else {
+			memset(folder_name, 0, sizeof(folder_name));
+			snprintf(folder_name, sizeof(folder_name) - 1,
+				 "%s/%s",
+				 SSDFS_RECOVERFS_TRASH_FOLDER_NAME,
+				 FOLDER_NAME(&trash, index));
+
+			err = ssdfs_recoverfs_delete_folder(env, folder_name);
+			if (err) {
+				SSDFS_ERR("fail to delete %s, err %d\n",
+					  folder_name, err);
+			}
+		}
+	}
+
+	for (index = 0; index < trash.content.count; index++) {
+		free(trash.content.namelist[index]);
+	}
+
+	free(trash.content.namelist);
+
+	err = rmdir(path);
+	if (err) {
+		err = errno;
+		SSDFS_ERR("fail to delete %s: %s\n",
+			  path, strerror(errno));
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * ssdfs_recoverfs_delete_trash_async() - delete trash folder in background
+ * @env: recoverfs environment
+ *
+ * This method forks the process that deletes the trash folder.
+ * The tool doesn't wait the ending of deletion. If the process
+ * cannot be forked, then trash folder is deleted synchronously.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code.
+ */
+int ssdfs_recoverfs_delete_trash_async(struct ssdfs_recoverfs_environment *env)
+{
+	pid_t pid;
+	int err;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "output_folder %s\n",
+		  env->output_folder.name);
+
+	fflush(stdout);
+	fflush(stderr);
+
+	pid = fork();
+	if (pid < 0) {
+		SSDFS_ERR("fail to fork process: %s\n",
+			  strerror(errno));
+		return ssdfs_recoverfs_delete_trash(env);
+	} else if (pid > 0) {
+		SSDFS_RECOVERFS_INFO(env->base.show_info,
+				     "DELETE INTERMEDIATE FOLDERS "
+				     "IN BACKGROUND: pid %d\n",
+				     (int)pid);
+		return 0;
+	}
+
+	/* child process */
+	setsid();
+	env->base.show_info = SSDFS_FALSE;
+
+	err = ssdfs_recoverfs_delete_trash(env);
+
+	_exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+}
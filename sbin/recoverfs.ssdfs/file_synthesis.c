@@ -476,7 +476,8 @@ int ssdfs_recoverfs_add_inode_id_job(struct ssdfs_recoverfs_environment *env,
 					      logs_count,
 					      env->output_folder.name,
 					      env->output_folder.fd,
-					      &env->timestamp);
+					      &env->timestamp,
+					      &env->inode_filter);
 		if (err) {
 			SSDFS_ERR("fail to initialize thread state: "
 				  "index %d, err %d\n",
@@ -517,7 +518,8 @@ int ssdfs_recoverfs_add_inode_id_job(struct ssdfs_recoverfs_environment *env,
 						      logs_count,
 						      env->output_folder.name,
 						      env->output_folder.fd,
-						      &env->timestamp);
+						      &env->timestamp,
+						      &env->inode_filter);
 			if (err) {
 				SSDFS_ERR("fail to initialize thread state: "
 					  "index %d, err %d\n",
@@ -36,85 +36,38 @@
 #include "recoverfs.h"
 
 int ssdfs_recoverfs_find_first_valid_node(struct ssdfs_recoverfs_environment *env,
-					  int fd,
+					  const u8 *content,
+					  u64 file_size,
 					  u32 *node_size,
 					  u32 *node_offset,
 					  u32 *nodes_count)
 {
-	struct stat stat;
 	struct ssdfs_inodes_btree_node_header *node_hdr;
-	u8 buffer[PAGE_CACHE_SIZE];
-	u64 file_size = 0;
+	size_t hdr_size = sizeof(struct ssdfs_inodes_btree_node_header);
 	u32 pagesize = env->base.page_size;
-	off_t offset;
-	ssize_t read_bytes = 0;
 	u64 rest_bytes;
-	int err;
 
 	SSDFS_DBG(env->base.show_debug,
-		  "output_folder %s, fd %d\n",
-		  env->output_folder.name, fd);
+		  "output_folder %s, file_size %llu\n",
+		  env->output_folder.name, file_size);
 
 	*node_size = U32_MAX;
 	*node_offset = U32_MAX;
 	*nodes_count = 0;
 
-	memset(buffer, 0, sizeof(buffer));
-
-	err = fstat(fd, &stat);
-	if (err) {
-		SSDFS_ERR("unable to get file status: %s\n",
-			  strerror(errno));
-		return errno;
-	}
-
-	switch (stat.st_mode & S_IFMT) {
-	case S_IFREG:
-		/* regular file */
-		file_size = stat.st_size;
-		break;
-
-	default:
-		SSDFS_ERR("unexpected file type\n");
-		return -ERANGE;
-	}
-
 	if (file_size == 0) {
 		SSDFS_DBG(env->base.show_debug,
-			  "empty file: output_folder %s, fd %d\n",
-			  env->output_folder.name, fd);
+			  "empty file: output_folder %s\n",
+			  env->output_folder.name);
 		return -ENOENT;
 	}
 
 	*node_offset = 0;
 
-	while (*node_offset < file_size) {
-		offset = lseek(fd, *node_offset, SEEK_SET);
-		if (offset < 0) {
-			err = errno;
-			SSDFS_ERR("fail to set offset %u in file: %s\n",
-				  *node_offset, strerror(errno));
-			return err;
-		} else if (offset != *node_offset) {
-			SSDFS_ERR("fail to set offset %u in file\n",
-				  *node_offset);
-			return -ERANGE;
-		}
-
-		read_bytes = read(fd, buffer, PAGE_CACHE_SIZE);
-		if (read_bytes < 0) {
-			err = errno;
-			SSDFS_ERR("unable to read file: %s\n",
-				  strerror(errno));
-			return err;
-		} else if (read_bytes != PAGE_CACHE_SIZE) {
-			SSDFS_ERR("unable to read the whole portion: "
-				  "read_bytes %zd\n",
-				  read_bytes);
-			return -EIO;
-		}
-
-		node_hdr = (struct ssdfs_inodes_btree_node_header *)buffer;
+	while (((u64)*node_offset + hdr_size) <= file_size) {
+		node_hdr =
+		    (struct ssdfs_inodes_btree_node_header *)(content +
+								*node_offset);
 
 		if (le32_to_cpu(node_hdr->node.magic.common) ==
 						SSDFS_SUPER_MAGIC &&
@@ -133,9 +86,9 @@ int ssdfs_recoverfs_find_first_valid_node(struct ssdfs_recoverfs_environment *en
 			*nodes_count = rest_bytes / *node_size;
 
 			SSDFS_DBG(env->base.show_debug,
-				  "output_folder %s, fd %d, "
+				  "output_folder %s, "
 				  "nodes_count %u\n",
-				  env->output_folder.name, fd,
+				  env->output_folder.name,
 				  *nodes_count);
 
 			return 0;
@@ -148,65 +101,37 @@ int ssdfs_recoverfs_find_first_valid_node(struct ssdfs_recoverfs_environment *en
 }
 
 int ssdfs_recoverfs_node_extract_inline_file(struct ssdfs_recoverfs_environment *env,
-					     int fd,
+					     const u8 *buffer,
 					     u32 node_offset,
-					     u32 node_size,
-					     u8 *buffer)
+					     u32 node_size)
 {
 	struct ssdfs_inodes_btree_node_header *node_hdr = NULL;
 	struct ssdfs_inode *raw_inode = NULL;
 	char name[SSDFS_MAX_NAME_LEN];
-	ssize_t read_bytes = 0;
 	ssize_t written_bytes = 0;
 	u32 item_area_offset;
 	u32 cur_offset;
-	off_t offset;
 	u32 item_area_size;
 	u32 items_capacity;
 	u32 item_size;
 	int err;
 
 	SSDFS_DBG(env->base.show_debug,
-		  "output_folder %s, fd %d, "
+		  "output_folder %s, "
 		  "node_size %u, node_offset %u\n",
-		  env->output_folder.name, fd,
+		  env->output_folder.name,
 		  node_size, node_offset);
 
-	offset = lseek(fd, node_offset, SEEK_SET);
-	if (offset < 0) {
-		err = errno;
-		SSDFS_ERR("fail to set offset %u in file: %s\n",
-			  node_offset, strerror(errno));
-		return err;
-	} else if (offset != node_offset) {
-		SSDFS_ERR("fail to set offset %u in file\n",
-			  node_offset);
-		return -ERANGE;
-	}
-
-	read_bytes = read(fd, buffer, node_size);
-	if (read_bytes < 0) {
-		err = errno;
-		SSDFS_ERR("unable to read file: %s\n",
-			  strerror(errno));
-		return err;
-	} else if (read_bytes != node_size) {
-		SSDFS_ERR("unable to read the whole portion: "
-			  "read_bytes %zd\n",
-			  read_bytes);
-		return -EIO;
-	}
-
 	node_hdr = (struct ssdfs_inodes_btree_node_header *)buffer;
 
 	if (le32_to_cpu(node_hdr->node.magic.common) != SSDFS_SUPER_MAGIC ||
 	    le16_to_cpu(node_hdr->node.magic.key) != SSDFS_INODES_BNODE_MAGIC) {
 		SSDFS_DBG(env->base.show_debug,
 			  "corruped node: "
-			  "output_folder %s, fd %d, "
+			  "output_folder %s, "
 			  "node_size %u, node_offset %u, "
 			  "magic (common %#x, key %#x)\n",
-			  env->output_folder.name, fd,
+			  env->output_folder.name,
 			  node_size, node_offset,
 			  le32_to_cpu(node_hdr->node.magic.common),
 			  le16_to_cpu(node_hdr->node.magic.key));
@@ -223,20 +148,20 @@ int ssdfs_recoverfs_node_extract_inline_file(struct ssdfs_recoverfs_environment
 	case SSDFS_BTREE_INDEX_NODE:
 		SSDFS_DBG(env->base.show_debug,
 			  "ignore node: "
-			  "output_folder %s, fd %d, "
+			  "output_folder %s, "
 			  "node_size %u, node_offset %u, "
 			  "type %#x\n",
-			  env->output_folder.name, fd,
+			  env->output_folder.name,
 			  node_size, node_offset,
 			  node_hdr->node.type);
 		return 0;
 
 	default:
 		SSDFS_ERR("corrupted node: "
-			  "output_folder %s, fd %d, "
+			  "output_folder %s, "
 			  "node_size %u, node_offset %u, "
 			  "type %#x\n",
-			  env->output_folder.name, fd,
+			  env->output_folder.name,
 			  node_size, node_offset,
 			  node_hdr->node.type);
 		return -EIO;
@@ -280,7 +205,7 @@ int ssdfs_recoverfs_node_extract_inline_file(struct ssdfs_recoverfs_environment
 
 	cur_offset = item_area_offset;
 	while ((cur_offset + item_size) < node_size) {
-		u8 *ptr;
+		const u8 *ptr;
 		u16 private_flags;
 		u64 file_size;
 
@@ -288,16 +213,19 @@ int ssdfs_recoverfs_node_extract_inline_file(struct ssdfs_recoverfs_environment
 
 		private_flags = le16_to_cpu(raw_inode->private_flags);
 
-		if (private_flags & SSDFS_INODE_HAS_INLINE_FILE) {
+		if (!is_inode_requested(&env->inode_filter,
+					le64_to_cpu(raw_inode->ino))) {
+			/* skip inode */
+		} else if (private_flags & SSDFS_INODE_HAS_INLINE_FILE) {
 			file_size = le64_to_cpu(raw_inode->size);
 
 			if (file_size == 0 || file_size >= U64_MAX) {
 				/* ignore file */
 				SSDFS_DBG(env->base.show_debug,
 					  "corruped node: "
-					  "output_folder %s, fd %d, "
+					  "output_folder %s, "
 					  "file_size %llu\n",
-					  env->output_folder.name, fd,
+					  env->output_folder.name,
 					  file_size);
 			} else {
 				u64 ino;
@@ -348,3 +276,41 @@ int ssdfs_recoverfs_node_extract_inline_file(struct ssdfs_recoverfs_environment
 
 	return 0;
 }
+
+void *ssdfs_recoverfs_extract_inline_files_range(void *arg)
+{
+	struct ssdfs_inline_files_job *job =
+				(struct ssdfs_inline_files_job *)arg;
+	struct ssdfs_recoverfs_environment *env;
+	u32 node_offset;
+	u32 i;
+	int err;
+
+	if (!job)
+		pthread_exit((void *)1);
+
+	env = job->env;
+	job->err = 0;
+	node_offset = job->start_offset;
+
+	SSDFS_DBG(env->base.show_debug,
+		  "job %u, start_offset %u, nodes_count %u\n",
+		  job->id, job->start_offset, job->nodes_count);
+
+	for (i = 0; i < job->nodes_count; i++) {
+		err = ssdfs_recoverfs_node_extract_inline_file(env,
+						job->content + node_offset,
+						node_offset,
+						job->node_size);
+		if (err) {
+			SSDFS_ERR("fail to process node: "
+				  "job %u, node_offset %u, err %d\n",
+				  job->id, node_offset, err);
+			job->err = err;
+		}
+
+		node_offset += job->node_size;
+	}
+
+	pthread_exit((void *)0);
+}
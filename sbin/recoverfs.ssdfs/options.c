@@ -14,6 +14,7 @@
 
 #include <sys/types.h>
 #include <getopt.h>
+#include <ctype.h>
 
 #include "recoverfs.h"
 
@@ -31,9 +32,15 @@ void print_usage(void)
 	SSDFS_RECOVERFS_INFO(SSDFS_TRUE, "recover SSDFS file system\n\n");
 	SSDFS_INFO("Usage: recoverfs.ssdfs <options> device root-folder\n");
 	SSDFS_INFO("Options:\n");
+	SSDFS_INFO("\t [-a|--async-cleanup]\t  delete intermediate "
+		   "folders in background.\n");
 	SSDFS_INFO("\t [-d|--debug]\t\t  show debug output.\n");
 	SSDFS_INFO("\t [-h|--help]\t\t  display help message and exit.\n");
+	SSDFS_INFO("\t [-i|--inode ino1,ino2,start-end,...]\t  "
+		   "recover only requested inodes.\n");
 	SSDFS_INFO("\t [-j|--threads]\t\t  define threads number.\n");
+	SSDFS_INFO("\t [-r|--resume]\t\t  continue recovery "
+		   "from the last checkpoint.\n");
 	SSDFS_INFO("\t [-t|--timestamp minute=value, "
 		   "hour=value, day=value, month=value, "
 		   "year=value]\t\t  define timestamp of files state.\n");
@@ -87,17 +94,150 @@ void check_year(int year)
 	}
 }
 
+static
+void add_inode_range(struct ssdfs_inode_filter *filter,
+		     u64 start, u64 end)
+{
+	struct ssdfs_inode_id_range *ranges;
+	size_t bytes;
+
+	bytes = (filter->count + 1) * sizeof(struct ssdfs_inode_id_range);
+
+	ranges = realloc(filter->ranges, bytes);
+	if (!ranges) {
+		SSDFS_ERR("fail to allocate inode ranges: %s\n",
+			  strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	filter->ranges = ranges;
+	filter->ranges[filter->count].start = start;
+	filter->ranges[filter->count].end = end;
+	filter->count++;
+}
+
+/*
+ * parse_inode_id() - parse inode ID
+ * @str: string with inode ID
+ * @endptr: pointer on the first character after inode ID [out]
+ * @ino: inode ID [out]
+ *
+ * strtoull() skips leading spaces and accepts the sign. So, "-1"
+ * would be wrapped into ULLONG_MAX. Inode ID has to start from digit.
+ *
+ * RETURN:
+ * [success]
+ * [failure] - error code:
+ *
+ * %-EINVAL     - invalid inode ID.
+ */
+static
+int parse_inode_id(char *str, char **endptr, u64 *ino)
+{
+	if (!isdigit((unsigned char)*str))
+		return -EINVAL;
+
+	errno = 0;
+	*ino = strtoull(str, endptr, 10);
+	if (errno || *endptr == str)
+		return -EINVAL;
+
+	return 0;
+}
+
+static
+void parse_inode_filter(char *str, struct ssdfs_inode_filter *filter)
+{
+	char *saveptr = NULL;
+	char *token;
+
+	for (token = strtok_r(str, ",", &saveptr); token != NULL;
+	     token = strtok_r(NULL, ",", &saveptr)) {
+		char *endptr = NULL;
+		u64 start, end;
+
+		if (parse_inode_id(token, &endptr, &start))
+			goto invalid_value;
+
+		if (*endptr == '-') {
+			if (parse_inode_id(endptr + 1, &endptr, &end))
+				goto invalid_value;
+		} else
+			end = start;
+
+		if (*endptr != '\0' || start > end)
+			goto invalid_value;
+
+		add_inode_range(filter, start, end);
+	}
+
+	return;
+
+invalid_value:
+	SSDFS_ERR("invalid inode ID or range: %s\n", token);
+	print_usage();
+	exit(EXIT_FAILURE);
+}
+
+static
+int compare_inode_ranges(const void *item1, const void *item2)
+{
+	const struct ssdfs_inode_id_range *range1 = item1;
+	const struct ssdfs_inode_id_range *range2 = item2;
+
+	if (range1->start < range2->start)
+		return -1;
+	else if (range1->start > range2->start)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * Sort the ranges and merge the overlapping ones
+ * to make possible the binary search in the filter.
+ */
+static
+void normalize_inode_filter(struct ssdfs_inode_filter *filter)
+{
+	int i, merged = 0;
+
+	if (filter->count <= 1)
+		return;
+
+	qsort(filter->ranges, filter->count,
+	      sizeof(struct ssdfs_inode_id_range),
+	      compare_inode_ranges);
+
+	for (i = 1; i < filter->count; i++) {
+		struct ssdfs_inode_id_range *last = &filter->ranges[merged];
+		struct ssdfs_inode_id_range *cur = &filter->ranges[i];
+
+		if (last->end >= U64_MAX || cur->start <= (last->end + 1)) {
+			last->end = max_t(u64, last->end, cur->end);
+		} else {
+			merged++;
+			filter->ranges[merged] = *cur;
+		}
+	}
+
+	filter->count = merged + 1;
+}
+
 void parse_options(int argc, char *argv[],
 		   struct ssdfs_recoverfs_environment *env)
 {
 	int c;
 	char *p;
 	int oi = 1;
-	char sopts[] = "dhj:t:qV";
+	char sopts[] = "adhi:j:rt:qV";
 	static const struct option lopts[] = {
+		{"async-cleanup", 0, NULL, 'a'},
 		{"debug", 0, NULL, 'd'},
 		{"help", 0, NULL, 'h'},
+		{"inode", 1, NULL, 'i'},
 		{"threads", 1, NULL, 'j'},
+		{"resume", 0, NULL, 'r'},
 		{"timestamp", 1, NULL, 't'},
 		{"quiet", 0, NULL, 'q'},
 		{"version", 0, NULL, 'V'},
@@ -121,15 +261,24 @@ void parse_options(int argc, char *argv[],
 
 	while ((c = getopt_long(argc, argv, sopts, lopts, &oi)) != EOF) {
 		switch (c) {
+		case 'a':
+			env->async_cleanup = SSDFS_TRUE;
+			break;
 		case 'd':
 			env->base.show_debug = SSDFS_TRUE;
 			break;
 		case 'h':
 			print_usage();
 			exit(EXIT_SUCCESS);
+		case 'i':
+			parse_inode_filter(optarg, &env->inode_filter);
+			break;
 		case 'j':
 			env->threads.capacity = atoi(optarg);
 			break;
+		case 'r':
+			env->checkpoint.resume = SSDFS_TRUE;
+			break;
 		case 't':
 			p = optarg;
 			while (*p != '\0') {
@@ -178,4 +327,6 @@ void parse_options(int argc, char *argv[],
 		print_usage();
 		exit(EXIT_FAILURE);
 	}
+
+	normalize_inode_filter(&env->inode_filter);
 }
@@ -171,6 +171,138 @@ int ssdfs_recoverfs_prepare_raw_buffer(struct ssdfs_raw_buffer *buf,
 	return 0;
 }
 
+static inline
+void ssdfs_recoverfs_forget_prefetched_log(struct ssdfs_thread_state *state)
+{
+	state->raw_dump.log.offset = U32_MAX;
+	state->raw_dump.log.size = 0;
+}
+
+/*
+ * ssdfs_recoverfs_prefetch_log() - read the whole log by few large requests
+ * @state: pointer on thread state
+ * @log_end: offset of the log's end from PEB's beginning
+ *
+ * This method reads the content of the log [log_offset, log_end)
+ * by one (or several, for huge logs) aligned read requests.
+ * Later, the block descriptors table and block states are
+ * retrieved from the prefetched buffer without any syscall.
+ *
+ * If the inode filter is applied, then the most of block states
+ * will be skipped. Nothing is prefetched in such case: the block
+ * descriptors table and the footer are read by dedicated requests
+ * and only requested block states are read from the device.
+ */
+static
+int ssdfs_recoverfs_prefetch_log(struct ssdfs_thread_state *state,
+				 u32 log_end)
+{
+	struct ssdfs_raw_dump_environment *dump_env;
+	struct ssdfs_raw_buffer *log_buf;
+	u32 start = state->peb.log_offset;
+	u32 size;
+	u32 portion;
+	u32 processed = 0;
+	int err;
+
+	SSDFS_DBG(state->base.show_debug,
+		  "thread %d, PEB %llu, log_offset %u, log_end %u\n",
+		  state->id, state->peb.id, state->peb.log_offset,
+		  log_end);
+
+	dump_env = &state->raw_dump;
+	ssdfs_recoverfs_forget_prefetched_log(state);
+
+	if (is_inode_filter_applied(&state->inode_filter)) {
+		SSDFS_DBG(state->base.show_debug,
+			  "inode filter is applied: "
+			  "read requested block states only\n");
+		return 0;
+	}
+
+	log_end = ALIGN(log_end, SSDFS_4KB);
+	log_end = min_t(u32, log_end, state->peb.peb_size);
+
+	if (start >= log_end) {
+		SSDFS_DBG(state->base.show_debug,
+			  "nothing to prefetch: "
+			  "log_offset %u, log_end %u\n",
+			  start, log_end);
+		return -ENODATA;
+	}
+
+	size = log_end - start;
+	log_buf = SSDFS_PREFETCHED_LOG(dump_env);
+
+	err = ssdfs_create_raw_buffer(log_buf, size);
+	if (err) {
+		SSDFS_ERR("fail to prepare log buffer: "
+			  "size %u, err %d\n",
+			  size, err);
+		return err;
+	}
+
+	while (processed < size) {
+		portion = min_t(u32, size - processed,
+				SSDFS_RECOVERFS_PREFETCH_PORTION_MAX);
+
+		err = ssdfs_read_area_content(&state->base,
+					      state->peb.id,
+					      state->peb.peb_size,
+					      start + processed, portion,
+					      (u8 *)log_buf->ptr + processed);
+		if (err) {
+			SSDFS_ERR("fail to prefetch log: "
+				  "peb_id %llu, offset %u, "
+				  "size %u, err %d\n",
+				  state->peb.id, start + processed,
+				  portion, err);
+			return err;
+		}
+
+		processed += portion;
+	}
+
+	dump_env->log.offset = start;
+	dump_env->log.size = size;
+
+	return 0;
+}
+
+/*
+ * ssdfs_recoverfs_read_log_content() - read a piece of the log's content
+ * @state: pointer on thread state
+ * @offset: offset from PEB's beginning
+ * @size: size of the piece in bytes
+ * @buf: pointer on buffer [out]
+ *
+ * This method copies the requested piece from the prefetched
+ * log's buffer. The device is read only if the piece is not
+ * covered by the prefetched content.
+ */
+static
+int ssdfs_recoverfs_read_log_content(struct ssdfs_thread_state *state,
+				     u32 offset, u32 size, void *buf)
+{
+	struct ssdfs_raw_dump_environment *dump_env = &state->raw_dump;
+	u64 end = (u64)offset + size;
+
+	if (dump_env->log.offset < U32_MAX &&
+	    offset >= dump_env->log.offset &&
+	    end <= ((u64)dump_env->log.offset + dump_env->log.size)) {
+		memcpy(buf,
+			(u8 *)SSDFS_PREFETCHED_LOG(dump_env)->ptr +
+				(offset - dump_env->log.offset),
+			size);
+		return 0;
+	}
+
+	return ssdfs_read_area_content(&state->base,
+					state->peb.id,
+					state->peb.peb_size,
+					offset, size, buf);
+}
+
 static
 int ssdfs_recoverfs_prefetch_blk_desc_table(struct ssdfs_thread_state *state)
 {
@@ -238,11 +370,8 @@ int ssdfs_recoverfs_prefetch_blk_desc_table(struct ssdfs_thread_state *state)
 		return err;
 	}
 
-	err = ssdfs_read_blk_desc_array(&state->base,
-					state->peb.id,
-					state->peb.peb_size,
-					offset, size,
-					area_buf->ptr);
+	err = ssdfs_recoverfs_read_log_content(state, offset, size,
+					       area_buf->ptr);
 	if (err) {
 		SSDFS_ERR("fail to read block descriptors: "
 			  "peb_id %llu, peb_size %u, "
@@ -829,6 +958,26 @@ int ssdfs_recoverfs_get_next_blk_desc(struct ssdfs_thread_state *state,
 	return 0;
 }
 
+/*
+ * is_block_requested() - check that block's inode should be recovered
+ * @state: pointer on thread state
+ * @blk_desc: block descriptor
+ *
+ * The inodes b-tree is always recovered because inline files
+ * are extracted from it at the final step.
+ */
+static inline
+int is_block_requested(struct ssdfs_thread_state *state,
+			struct ssdfs_block_descriptor *blk_desc)
+{
+	u64 ino = le64_to_cpu(blk_desc->ino);
+
+	if (ino == SSDFS_INODES_BTREE_INO)
+		return SSDFS_TRUE;
+
+	return is_inode_requested(&state->inode_filter, ino);
+}
+
 static inline
 int IS_BLK_STATE_INVALID(struct ssdfs_blk_state_offset *blk_state)
 {
@@ -905,10 +1054,8 @@ int ssdfs_recoverfs_read_raw_block_state(struct ssdfs_thread_state *state,
 		return err;
 	}
 
-	err = ssdfs_read_area_content(&state->base,
-				      peb_id, peb_size,
-				      offset, block_size,
-				      area_buf->ptr);
+	err = ssdfs_recoverfs_read_log_content(state, (u32)offset, block_size,
+					       area_buf->ptr);
 	if (err) {
 		SSDFS_ERR("fail to read block state: "
 			  "peb_id %llu, peb_size %u, "
@@ -1399,35 +1546,13 @@ int ssdfs_recoverfs_copy_block_state(struct ssdfs_thread_state *state,
 		 le32_to_cpu(blk_desc->logical_offset));
 
 	/*
-	 * Check that file is absent
+	 * Resumed recovery re-processes the PEBs after the last
+	 * checkpoint. So, the file could exist already and it
+	 * needs to be rewritten by the same block's state.
 	 */
 	fd = openat(state->checkpoint_folder.fd,
 		    state->name_buf,
-		    O_RDWR | O_LARGEFILE,
-		    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-	if (fd < 0) {
-		/*
-		 * File absence is expected.
-		 * Continue logic.
-		 */
-	} else {
-		SSDFS_ERR("file %d exists already: "
-			  "name %s, thread %d, err %d: %s\n",
-			  fd, state->name_buf,
-			  state->id, errno, strerror(errno));
-		SSDFS_ERR("Rewrite existing file: "
-			  "name %s, thread %d, PEB %llu, log_offset %u, "
-			  "BLK_DESC: (ino %llu, logical_offset %u)\n",
-			  state->name_buf, state->id, state->peb.id,
-			  state->peb.log_offset,
-			  le64_to_cpu(blk_desc->ino),
-			  le32_to_cpu(blk_desc->logical_offset));
-		goto write_to_file;
-	}
-
-	fd = openat(state->checkpoint_folder.fd,
-		    state->name_buf,
-		    O_CREAT | O_RDWR | O_LARGEFILE,
+		    O_CREAT | O_TRUNC | O_WRONLY | O_LARGEFILE,
 		    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 	if (fd < 0) {
 		err = errno;
@@ -1436,7 +1561,6 @@ int ssdfs_recoverfs_copy_block_state(struct ssdfs_thread_state *state,
 		goto fail_copy_block_state;
 	}
 
-write_to_file:
 	BUG_ON(!SSDFS_DUMP_DATA(env)->ptr);
 
 	written_bytes = write(fd, SSDFS_DUMP_DATA(env)->ptr,
@@ -1481,6 +1605,7 @@ int ssdfs_recoverfs_parse_full_log(struct ssdfs_thread_state *state)
 	u64 timestamp;
 	u32 latest_area_offset = 0;
 	u32 latest_area_size = 0;
+	u64 log_end = 0;
 	u32 next_log_index = state->peb.log_index + 1;
 	u32 i;
 	int err = 0;
@@ -1549,6 +1674,9 @@ int ssdfs_recoverfs_parse_full_log(struct ssdfs_thread_state *state)
 			area_desc->offset = offset;
 			area_desc->size = size;
 
+			if ((offset + size) <= peb_size)
+				log_end = max_t(u64, log_end, offset + size);
+
 			if (latest_area_offset < offset) {
 				if ((offset + size) < peb_size) {
 					latest_area_offset = offset;
@@ -1568,6 +1696,22 @@ int ssdfs_recoverfs_parse_full_log(struct ssdfs_thread_state *state)
 		}
 	}
 
+	/*
+	 * The latest block state could be stored at the area's end.
+	 * Prefetch one more logical block to serve it from the buffer.
+	 */
+	log_end += state->base.page_size;
+
+	err = ssdfs_recoverfs_prefetch_log(state,
+					   min_t(u64, log_end, peb_size));
+	if (err) {
+		err = 0;
+		SSDFS_DBG(state->base.show_debug,
+			  "unable to prefetch log: "
+			  "thread %d, PEB %llu, log_offset %u\n",
+			  state->id, state->peb.id, state->peb.log_offset);
+	}
+
 	i = SSDFS_LOG_FOOTER_INDEX;
 	area_desc = &SSDFS_RAW_AREA_ENV(dump_env, i)->area;
 
@@ -1588,12 +1732,10 @@ int ssdfs_recoverfs_parse_full_log(struct ssdfs_thread_state *state)
 			goto close_checkpoint_folder;
 		}
 
-		err = ssdfs_read_log_footer(&state->base,
-					    state->peb.id,
-					    state->peb.peb_size,
-					    area_desc->offset,
-					    size,
-					    raw_buf->ptr);
+		err = ssdfs_recoverfs_read_log_content(state,
+						       (u32)area_desc->offset,
+						       size,
+						       raw_buf->ptr);
 		if (err) {
 			SSDFS_ERR("fail to read PEB's footer: "
 				  "peb_id %llu, peb_size %u, "
@@ -1644,6 +1786,18 @@ int ssdfs_recoverfs_parse_full_log(struct ssdfs_thread_state *state)
 	}
 
 	while (ssdfs_recoverfs_get_next_blk_desc(state, &blk_desc) == 0) {
+		if (!is_block_requested(state, &blk_desc)) {
+			SSDFS_DBG(state->base.show_debug,
+				  "skip block: "
+				  "thread %d, PEB %llu, log_offset %u, "
+				  "ino %llu, logical_offset %u\n",
+				  state->id, state->peb.id,
+				  state->peb.log_offset,
+				  le64_to_cpu(blk_desc.ino),
+				  le32_to_cpu(blk_desc.logical_offset));
+			continue;
+		}
+
 		err = ssdfs_recoverfs_extract_block_state(state, &blk_desc);
 		if (err) {
 			SSDFS_DBG(state->base.show_debug,
@@ -1695,6 +1849,7 @@ int ssdfs_recoverfs_parse_partial_log(struct ssdfs_thread_state *state)
 	u16 seg_type;
 	u64 timestamp;
 	u32 latest_area_offset = 0;
+	u64 log_end = 0;
 	u32 next_log_index = state->peb.log_index + 1;
 	int area_index;
 	u32 i;
@@ -1764,6 +1919,9 @@ int ssdfs_recoverfs_parse_partial_log(struct ssdfs_thread_state *state)
 			area_desc->offset = offset;
 			area_desc->size = size;
 
+			if ((offset + size) <= peb_size)
+				log_end = max_t(u64, log_end, offset + size);
+
 			if (latest_area_offset < offset) {
 				if ((offset + size) < peb_size) {
 					latest_area_offset = offset;
@@ -1782,6 +1940,22 @@ int ssdfs_recoverfs_parse_partial_log(struct ssdfs_thread_state *state)
 		}
 	}
 
+	/*
+	 * The latest block state could be stored at the area's end.
+	 * Prefetch one more logical block to serve it from the buffer.
+	 */
+	log_end += state->base.page_size;
+
+	err = ssdfs_recoverfs_prefetch_log(state,
+					   min_t(u64, log_end, peb_size));
+	if (err) {
+		err = 0;
+		SSDFS_DBG(state->base.show_debug,
+			  "unable to prefetch log: "
+			  "thread %d, PEB %llu, log_offset %u\n",
+			  state->id, state->peb.id, state->peb.log_offset);
+	}
+
 	state->peb.log_size = le32_to_cpu(pl_hdr->log_bytes);
 	next_log_index = state->peb.log_size + SSDFS_4KB - 1;
 	next_log_index /= SSDFS_4KB;
@@ -1811,6 +1985,18 @@ int ssdfs_recoverfs_parse_partial_log(struct ssdfs_thread_state *state)
 	}
 
 	while (ssdfs_recoverfs_get_next_blk_desc(state, &blk_desc) == 0) {
+		if (!is_block_requested(state, &blk_desc)) {
+			SSDFS_DBG(state->base.show_debug,
+				  "skip block: "
+				  "thread %d, PEB %llu, log_offset %u, "
+				  "ino %llu, logical_offset %u\n",
+				  state->id, state->peb.id,
+				  state->peb.log_offset,
+				  le64_to_cpu(blk_desc.ino),
+				  le32_to_cpu(blk_desc.logical_offset));
+			continue;
+		}
+
 		err = ssdfs_recoverfs_extract_block_state(state, &blk_desc);
 		if (err) {
 			SSDFS_DBG(state->base.show_debug,
@@ -1865,6 +2051,8 @@ int ssdfs_recoverfs_process_peb(struct ssdfs_thread_state *state)
 	BUG_ON(!SSDFS_RAW_SEG_HDR(dump_env)->ptr);
 
 	do {
+		ssdfs_recoverfs_forget_prefetched_log(state);
+
 		err = ssdfs_create_raw_area_environment(&dump_env->seg_hdr,
 						state->peb.log_offset,
 						sizeof(struct ssdfs_segment_header),
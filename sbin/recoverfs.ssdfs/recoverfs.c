@@ -19,6 +19,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <linux/fs.h>
 #include <getopt.h>
 #include <fcntl.h>
@@ -81,6 +82,11 @@ int ssdfs_recoverfs_open_output_folder(struct ssdfs_recoverfs_environment *env)
 
 	free(parent->content.namelist);
 
+	if (env->checkpoint.resume) {
+		/* output folder contains results of interrupted recovery */
+		return 0;
+	}
+
 	if (parent->content.count > SSDFS_EMPTY_FOLDER_DEFAULT_ITEMS_COUNT) {
 		SSDFS_ERR("Output folder %s is not empty!!!! "
 			  "Please, prepare empty folder.\n",
@@ -97,6 +103,9 @@ void *ssdfs_recoverfs_process_peb_range(void *arg)
 	u64 per_1_percent = 0;
 	u64 message_threshold = 0;
 	u64 start_peb_id;
+	u64 end_peb_id;
+	u64 checkpoint_time;
+	u64 cur_time;
 	u64 i;
 	int err;
 
@@ -109,6 +118,8 @@ void *ssdfs_recoverfs_process_peb_range(void *arg)
 
 	state->err = 0;
 	start_peb_id = state->peb.id;
+	end_peb_id = start_peb_id + state->peb.pebs_count;
+	checkpoint_time = ssdfs_current_time_in_nanoseconds();
 
 	per_1_percent = state->peb.pebs_count / 100;
 	if (per_1_percent == 0)
@@ -138,6 +149,23 @@ void *ssdfs_recoverfs_process_peb_range(void *arg)
 				  "peb_id %llu, err %d\n",
 				  state->peb.id, err);
 		}
+
+		cur_time = ssdfs_current_time_in_nanoseconds();
+
+		if ((i + 1) >= state->peb.pebs_count ||
+		    (cur_time - checkpoint_time) >=
+					SSDFS_RECOVERFS_CHECKPOINT_INTERVAL) {
+			err = ssdfs_recoverfs_save_peb_range_checkpoint(state,
+							start_peb_id + i + 1,
+							end_peb_id);
+			if (err) {
+				SSDFS_ERR("fail to save checkpoint: "
+					  "thread %d, err %d\n",
+					  state->id, err);
+			}
+
+			checkpoint_time = cur_time;
+		}
 	}
 
 	SSDFS_RECOVERFS_INFO(state->base.show_info,
@@ -172,8 +200,19 @@ int ssdfs_recoverfs_synthesize_files(struct ssdfs_recoverfs_environment *env)
 			/* do nothing */
 		} else if (IS_DOTDOT_FOLDER(parent, index)) {
 			/* do nothing */
+		} else if (IS_TRASH_FOLDER(parent, index)) {
+			/* do nothing */
 		} else if (IS_FOLDER(parent, index)) {
 			u64 timestamp = atoll(FOLDER_NAME(parent, index));
+			u64 last_folder = env->checkpoint.last_folder;
+			u64 cur_time;
+
+			if (last_folder != U64_MAX && timestamp <= last_folder) {
+				SSDFS_DBG(env->base.show_debug,
+					  "folder %s has been processed already\n",
+					  FOLDER_NAME(parent, index));
+				continue;
+			}
 
 			if (is_timestamp_inside_range(&env->timestamp, timestamp)) {
 				SSDFS_DBG(env->base.show_debug,
@@ -189,6 +228,19 @@ int ssdfs_recoverfs_synthesize_files(struct ssdfs_recoverfs_environment *env)
 						  err);
 				}
 			}
+
+			env->checkpoint.last_folder = timestamp;
+
+			cur_time = ssdfs_current_time_in_nanoseconds();
+			if ((cur_time - env->checkpoint.timestamp) <
+					SSDFS_RECOVERFS_CHECKPOINT_INTERVAL)
+				continue;
+
+			err = ssdfs_recoverfs_save_stage_checkpoint(env);
+			if (err) {
+				SSDFS_ERR("fail to save checkpoint: err %d\n",
+					  err);
+			}
 		}
 	}
 
@@ -197,7 +249,16 @@ int ssdfs_recoverfs_synthesize_files(struct ssdfs_recoverfs_environment *env)
 			/* do nothing */
 		} else if (IS_DOTDOT_FOLDER(parent, index)) {
 			/* do nothing */
-		} else {
+		} else if (IS_TRASH_FOLDER(parent, index)) {
+			/* do nothing */
+		} else if (IS_FOLDER(parent, index)) {
+			if (env->async_cleanup) {
+				err = ssdfs_recoverfs_move_folder_to_trash(env,
+						FOLDER_NAME(parent, index));
+				if (!err)
+					continue;
+			}
+
 			err = ssdfs_recoverfs_delete_folder(env,
 						FOLDER_NAME(parent, index));
 			if (err) {
@@ -208,6 +269,16 @@ int ssdfs_recoverfs_synthesize_files(struct ssdfs_recoverfs_environment *env)
 		}
 	}
 
+	if (env->async_cleanup)
+		err = ssdfs_recoverfs_delete_trash_async(env);
+	else
+		err = ssdfs_recoverfs_delete_trash(env);
+
+	if (err) {
+		SSDFS_ERR("fail to delete %s, err %d\n",
+			  SSDFS_RECOVERFS_TRASH_FOLDER_NAME, err);
+	}
+
 	for (index = 0; index < parent->content.count; index++) {
 		free(parent->content.namelist[index]);
 	}
@@ -220,13 +291,19 @@ int ssdfs_recoverfs_synthesize_files(struct ssdfs_recoverfs_environment *env)
 static
 int ssdfs_recoverfs_extract_inline_files(struct ssdfs_recoverfs_environment *env)
 {
+	struct ssdfs_inline_files_job *jobs = NULL;
 	char name[SSDFS_MAX_NAME_LEN];
-	u8 *buffer = NULL;
+	struct stat stat;
+	u8 *content = MAP_FAILED;
+	u64 file_size;
 	int fd;
 	u32 node_size;
 	u32 node_offset;
 	u32 nodes_count = 0;
-	int i;
+	u32 nodes_per_job;
+	u32 jobs_count;
+	u32 started_jobs = 0;
+	u32 i;
 	int err = 0;
 
 	SSDFS_DBG(env->base.show_debug,
@@ -240,8 +317,7 @@ int ssdfs_recoverfs_extract_inline_files(struct ssdfs_recoverfs_environment *env
 
 	fd = openat(env->output_folder.fd,
 		    name,
-		    O_RDWR | O_LARGEFILE,
-		    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+		    O_RDONLY | O_LARGEFILE);
 	if (fd < 0) {
 		err = errno;
 		SSDFS_ERR("unable to open %s: %s\n",
@@ -249,7 +325,44 @@ int ssdfs_recoverfs_extract_inline_files(struct ssdfs_recoverfs_environment *env
 		return err;
 	}
 
-	err = ssdfs_recoverfs_find_first_valid_node(env, fd,
+	err = fstat(fd, &stat);
+	if (err) {
+		err = errno;
+		SSDFS_ERR("unable to get file status: %s\n",
+			  strerror(errno));
+		goto close_file;
+	}
+
+	switch (stat.st_mode & S_IFMT) {
+	case S_IFREG:
+		/* regular file */
+		file_size = stat.st_size;
+		break;
+
+	default:
+		err = -ERANGE;
+		SSDFS_ERR("unexpected file type\n");
+		goto close_file;
+	}
+
+	if (file_size == 0) {
+		SSDFS_DBG(env->base.show_debug,
+			  "empty file: output_folder %s, file %s\n",
+			  env->output_folder.name, name);
+		goto close_file;
+	}
+
+	content = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (content == MAP_FAILED) {
+		err = errno;
+		SSDFS_ERR("fail to map file %s: %s\n",
+			  name, strerror(errno));
+		goto close_file;
+	}
+
+	madvise(content, file_size, MADV_SEQUENTIAL);
+
+	err = ssdfs_recoverfs_find_first_valid_node(env, content, file_size,
 						    &node_size,
 						    &node_offset,
 						    &nodes_count);
@@ -260,13 +373,13 @@ int ssdfs_recoverfs_extract_inline_files(struct ssdfs_recoverfs_environment *env
 			  "output_folder %s, file %s\n",
 			  env->output_folder.name,
 			  name);
-		goto close_file;
+		goto unmap_file;
 	} else if (err) {
 		SSDFS_ERR("fail to find valid node: "
 			  "output_folder %s, file %s\n",
 			  env->output_folder.name,
 			  name);
-		goto close_file;
+		goto unmap_file;
 	}
 
 	if (nodes_count == 0) {
@@ -277,39 +390,68 @@ int ssdfs_recoverfs_extract_inline_files(struct ssdfs_recoverfs_environment *env
 			  nodes_count,
 			  env->output_folder.name,
 			  name);
-		goto close_file;
+		goto unmap_file;
 	} else if (nodes_count >= U32_MAX) {
 		err = -ERANGE;
 		SSDFS_ERR("fail to calculate nodes count\n");
-		goto close_file;
+		goto unmap_file;
 	}
 
-	buffer = malloc(node_size);
-	if (!buffer) {
+	jobs_count = min_t(u32, env->threads.capacity, nodes_count);
+	if (jobs_count == 0)
+		jobs_count = 1;
+
+	nodes_per_job = (nodes_count + jobs_count - 1) / jobs_count;
+
+	jobs = calloc(jobs_count, sizeof(struct ssdfs_inline_files_job));
+	if (!jobs) {
 		err = -ENOMEM;
-		SSDFS_ERR("fail to allocate buffer: "
-			  "node_size %u\n",
-			  node_size);
-		goto close_file;
+		SSDFS_ERR("fail to allocate jobs array: %s\n",
+			  strerror(errno));
+		goto unmap_file;
 	}
 
-	memset(buffer, 0, node_size);
-
-	for (i = 0; i < nodes_count; i++) {
-		err = ssdfs_recoverfs_node_extract_inline_file(env, fd,
-								node_offset,
-								node_size,
-								buffer);
+	for (i = 0; i < jobs_count; i++) {
+		struct ssdfs_inline_files_job *job = &jobs[i];
+		u32 first_node = i * nodes_per_job;
+
+		if (first_node >= nodes_count)
+			break;
+
+		job->id = i;
+		job->err = 0;
+		job->env = env;
+		job->content = content;
+		job->node_size = node_size;
+		job->start_offset = node_offset + (first_node * node_size);
+		job->nodes_count = min_t(u32, nodes_per_job,
+					 nodes_count - first_node);
+
+		err = pthread_create(&job->thread, NULL,
+				     ssdfs_recoverfs_extract_inline_files_range,
+				     (void *)job);
 		if (err) {
-			SSDFS_ERR("fail to process node: "
-				  "index %d, node_offset %u, err %d\n",
-				  i, node_offset, err);
+			SSDFS_ERR("fail to create thread %u: %s\n",
+				  i, strerror(err));
+			break;
 		}
 
-		node_offset += node_size;
+		started_jobs++;
+	}
+
+	for (i = 0; i < started_jobs; i++) {
+		pthread_join(jobs[i].thread, NULL);
+
+		if (jobs[i].err != 0) {
+			SSDFS_ERR("job %u has failed: err %d\n",
+				  i, jobs[i].err);
+		}
 	}
 
-	free(buffer);
+	free(jobs);
+
+unmap_file:
+	munmap(content, file_size);
 
 close_file:
 	close(fd);
@@ -338,10 +480,19 @@ int main(int argc, char *argv[])
 		.timestamp.day = SSDFS_ANY_DAY,
 		.timestamp.month = SSDFS_ANY_MONTH,
 		.timestamp.year = SSDFS_ANY_YEAR,
+		.inode_filter.ranges = NULL,
+		.inode_filter.count = 0,
+		.async_cleanup = SSDFS_FALSE,
+		.checkpoint.resume = SSDFS_FALSE,
+		.checkpoint.stage = SSDFS_RECOVERFS_NOTHING_DONE,
+		.checkpoint.last_folder = U64_MAX,
+		.checkpoint.timestamp = 0,
 	};
 	union ssdfs_metadata_header buf;
 	u64 pebs_count;
 	u64 pebs_per_thread;
+	u64 end_peb;
+	u64 next_peb;
 	u32 logs_count;
 	int i;
 	int err = 0;
@@ -387,8 +538,13 @@ int main(int argc, char *argv[])
 	pebs_per_thread = (pebs_count + env.threads.capacity - 1);
 	pebs_per_thread /= env.threads.capacity;
 
-	SSDFS_RECOVERFS_INFO(env.base.show_info,
-			     "[003]\tCREATE THREADS...\n");
+	if (env.checkpoint.resume) {
+		err = ssdfs_recoverfs_load_stage_checkpoint(&env);
+		if (err) {
+			SSDFS_ERR("fail to load checkpoint: err %d\n", err);
+			goto close_device;
+		}
+	}
 
 	env.threads.jobs = calloc(env.threads.capacity,
 				  sizeof(struct ssdfs_thread_state));
@@ -399,6 +555,22 @@ int main(int argc, char *argv[])
 		goto close_device;
 	}
 
+	if (env.checkpoint.stage >= SSDFS_RECOVERFS_PEBS_PROCESSED) {
+		SSDFS_RECOVERFS_INFO(env.base.show_info,
+				     "[003]\t[SKIPPED: PEBS ARE PROCESSED]\n");
+		goto build_files;
+	}
+
+	/* store recovery options before any thread's checkpoint */
+	err = ssdfs_recoverfs_save_stage_checkpoint(&env);
+	if (err) {
+		SSDFS_ERR("fail to save checkpoint: err %d\n", err);
+		goto free_threads_pool;
+	}
+
+	SSDFS_RECOVERFS_INFO(env.base.show_info,
+			     "[003]\tCREATE THREADS...\n");
+
 	logs_count = env.base.erase_size / SSDFS_4KB;
 
 	for (i = 0; i < env.threads.capacity; i++) {
@@ -411,7 +583,8 @@ int main(int argc, char *argv[])
 					      logs_count,
 					      env.output_folder.name,
 					      env.output_folder.fd,
-					      &env.timestamp);
+					      &env.timestamp,
+					      &env.inode_filter);
 		if (err) {
 			SSDFS_ERR("fail to initialize thread state: "
 				  "index %d, err %d\n",
@@ -419,6 +592,32 @@ int main(int argc, char *argv[])
 			goto free_threads_pool;
 		}
 
+		end_peb = env.threads.jobs[i].peb.id +
+				env.threads.jobs[i].peb.pebs_count;
+
+		if (env.checkpoint.resume) {
+			err = ssdfs_recoverfs_load_peb_range_checkpoint(&env.threads.jobs[i],
+									end_peb,
+									&next_peb);
+			if (err == -ENOENT) {
+				err = 0;
+				/* start from the beginning of range */
+			} else if (err) {
+				SSDFS_ERR("fail to load checkpoint: "
+					  "index %d, err %d\n",
+					  i, err);
+				for (i--; i >= 0; i--) {
+					pthread_join(env.threads.jobs[i].thread, NULL);
+					env.threads.requested_jobs--;
+				}
+				goto free_threads_pool;
+			} else {
+				env.threads.jobs[i].peb.id = next_peb;
+				env.threads.jobs[i].peb.pebs_count =
+							end_peb - next_peb;
+			}
+		}
+
 		err = pthread_create(&env.threads.jobs[i].thread, NULL,
 				     ssdfs_recoverfs_process_peb_range,
 				     (void *)&env.threads.jobs[i]);
@@ -444,9 +643,25 @@ int main(int argc, char *argv[])
 	ssdfs_wait_threads_activity_ending(&env);
 	env.threads.requested_jobs = 0;
 
+	env.checkpoint.stage = SSDFS_RECOVERFS_PEBS_PROCESSED;
+	env.checkpoint.last_folder = U64_MAX;
+
+	err = ssdfs_recoverfs_save_stage_checkpoint(&env);
+	if (err) {
+		SSDFS_ERR("fail to save checkpoint: err %d\n", err);
+		goto free_threads_pool;
+	}
+
 	SSDFS_RECOVERFS_INFO(env.base.show_info,
 			     "[004]\t[SUCCESS]\n");
 
+build_files:
+	if (env.checkpoint.stage >= SSDFS_RECOVERFS_FILES_SYNTHESIZED) {
+		SSDFS_RECOVERFS_INFO(env.base.show_info,
+				     "[005]\t[SKIPPED: FILES ARE BUILT]\n");
+		goto extract_inline_files;
+	}
+
 	SSDFS_RECOVERFS_INFO(env.base.show_info,
 			     "[005]\tBUILD FILES...\n");
 
@@ -457,9 +672,18 @@ int main(int argc, char *argv[])
 		goto free_threads_pool;
 	}
 
+	env.checkpoint.stage = SSDFS_RECOVERFS_FILES_SYNTHESIZED;
+
+	err = ssdfs_recoverfs_save_stage_checkpoint(&env);
+	if (err) {
+		SSDFS_ERR("fail to save checkpoint: err %d\n", err);
+		goto free_threads_pool;
+	}
+
 	SSDFS_RECOVERFS_INFO(env.base.show_info,
 			     "[005]\t[SUCCESS]\n");
 
+extract_inline_files:
 	SSDFS_RECOVERFS_INFO(env.base.show_info,
 			     "[006]\tEXTRACT INLINE FILES...\n");
 
@@ -470,6 +694,8 @@ int main(int argc, char *argv[])
 		goto free_threads_pool;
 	}
 
+	ssdfs_recoverfs_delete_checkpoints(&env);
+
 	SSDFS_RECOVERFS_INFO(env.base.show_info,
 			     "[006]\t[SUCCESS]\n");
 
@@ -484,5 +710,9 @@ free_threads_pool:
 close_device:
 	close(env.base.fd);
 	close(env.output_folder.fd);
+
+	if (env.inode_filter.ranges)
+		free(env.inode_filter.ranges);
+
 	exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
 }
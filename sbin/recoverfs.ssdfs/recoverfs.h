@@ -38,6 +38,87 @@
 #define SSDFS_RECOVERFS_DEFAULT_THREADS		(1)
 #define SSDFS_FILE_NAME_DELIMITER		('-')
 #define SSDFS_EMPTY_FOLDER_DEFAULT_ITEMS_COUNT	(2)
+#define SSDFS_RECOVERFS_PREFETCH_PORTION_MAX	(SSDFS_8MB)
+
+#define SSDFS_RECOVERFS_GETDENTS_BUFFER_SIZE	(SSDFS_1MB)
+#define SSDFS_RECOVERFS_DIRENT_MIN_SIZE		(24)
+#define SSDFS_RECOVERFS_TRASH_FOLDER_NAME	(".recoverfs_trash")
+
+#define SSDFS_RECOVERFS_CHECKPOINT_MAGIC	(0x52434B50) /* RCKP */
+#define SSDFS_RECOVERFS_CHECKPOINT_NAME		(".recoverfs_checkpoint")
+#define SSDFS_RECOVERFS_CHECKPOINT_INTERVAL	(30ULL * 1000000000ULL) /* 30 seconds */
+
+/* Recovery stages that checkpoint can record as finished */
+enum {
+	SSDFS_RECOVERFS_NOTHING_DONE,
+	SSDFS_RECOVERFS_PEBS_PROCESSED,
+	SSDFS_RECOVERFS_FILES_SYNTHESIZED,
+	SSDFS_RECOVERFS_STAGE_MAX
+};
+
+#define SSDFS_RECOVERFS_STAGE_CHECKPOINT	(U16_MAX)
+
+/*
+ * struct ssdfs_recoverfs_checkpoint - recoverfs progress checkpoint
+ * @magic: checkpoint magic
+ * @csum: checksum of checkpoint
+ * @fs_size: size of volume in bytes
+ * @erase_size: erase block size in bytes
+ * @stage: finished stage of recovery
+ * @thread_id: thread ID (SSDFS_RECOVERFS_STAGE_CHECKPOINT for stage)
+ * @next_peb: first PEB in thread's range that is not processed yet
+ * @end_peb: PEB ID after the last PEB in thread's range
+ * @last_folder: timestamp of last folder with synthesized files
+ * @minute: requested minute of files state
+ * @hour: requested hour of files state
+ * @day: requested day of files state
+ * @month: requested month of files state
+ * @year: requested year of files state
+ * @inode_ranges: number of ranges in inode filter
+ * @inode_filter_csum: checksum of inode filter's ranges
+ * @threads: number of threads
+ * @reserved: reserved field
+ *
+ * Every thread saves the progress of PEBs processing into dedicated
+ * checkpoint file. The main thread saves the stage checkpoint.
+ * The stage checkpoint keeps the options of recovery that define
+ * the threads' ranges and the recovered content. It is saved before
+ * threads start, so resumed recovery can be checked against it.
+ * Fragments are stored in output folder as files, so it doesn't need
+ * to save fragment index. Synthesized fragments are deleted, so
+ * synthesized inodes cannot be affected by resumed synthesis.
+ */
+struct ssdfs_recoverfs_checkpoint {
+/* 0x0000 */
+	__le32 magic;
+	__le32 csum;
+	__le64 fs_size;
+
+/* 0x0010 */
+	__le32 erase_size;
+	__le16 stage;
+	__le16 thread_id;
+	__le64 next_peb;
+
+/* 0x0020 */
+	__le64 end_peb;
+	__le64 last_folder;
+
+/* 0x0030 */
+	__le32 minute;
+	__le32 hour;
+	__le32 day;
+	__le32 month;
+
+/* 0x0040 */
+	__le32 year;
+	__le32 inode_ranges;
+	__le32 inode_filter_csum;
+	__le16 threads;
+	__le16 reserved;
+
+/* 0x0050 */
+};
 
 /*
  * struct ssdfs_recoverfs_environment - recoverfs environment
@@ -45,12 +126,75 @@
  * @threads: threads environment
  * @output_folder: output folder environment
  * @timestamp: timestamp defining the state of files
+ * @inode_filter: inode IDs that should be recovered
+ * @async_cleanup: delete intermediate folders in background
+ * @checkpoint.resume: continue recovery from the last checkpoint
+ * @checkpoint.stage: finished stage of recovery
+ * @checkpoint.last_folder: timestamp of last folder with synthesized files
+ * @checkpoint.timestamp: time of the last saved checkpoint
  */
 struct ssdfs_recoverfs_environment {
 	struct ssdfs_environment base;
 	struct ssdfs_threads_environment threads;
 	struct ssdfs_folder_environment output_folder;
 	struct ssdfs_time_range timestamp;
+	struct ssdfs_inode_filter inode_filter;
+	int async_cleanup;
+
+	struct {
+		int resume;
+		int stage;
+		u64 last_folder;
+		u64 timestamp;
+	} checkpoint;
+};
+
+/*
+ * struct ssdfs_inline_files_job - inline files extraction job
+ * @id: job ID
+ * @thread: thread descriptor
+ * @err: code of error
+ * @env: recoverfs environment
+ * @content: mapped content of inodes b-tree file
+ * @node_size: node size in bytes
+ * @start_offset: offset of the first node of the job
+ * @nodes_count: number of nodes in the job
+ */
+struct ssdfs_inline_files_job {
+	unsigned int id;
+	pthread_t thread;
+	int err;
+
+	struct ssdfs_recoverfs_environment *env;
+	const u8 *content;
+	u32 node_size;
+	u32 start_offset;
+	u32 nodes_count;
+};
+
+/*
+ * struct ssdfs_delete_files_job - files deletion job
+ * @id: job ID
+ * @thread: thread descriptor
+ * @err: code of error
+ * @show_debug: show debug messages
+ * @folder_fd: file descriptor of parent folder
+ * @names: names of files in parent folder
+ * @count: number of names in array
+ * @jobs_count: number of jobs that share the names array
+ * @deleted: number of deleted files
+ */
+struct ssdfs_delete_files_job {
+	unsigned int id;
+	pthread_t thread;
+	int err;
+	int show_debug;
+
+	int folder_fd;
+	char **names;
+	u32 count;
+	u32 jobs_count;
+	u64 deleted;
 };
 
 #define SSDFS_DOT_FOLDER_NAME		(".")
@@ -155,6 +299,15 @@ void ssdfs_init_timestamp(struct ssdfs_thread_state *state,
 		sizeof(struct ssdfs_time_range));
 }
 
+static inline
+void ssdfs_init_inode_filter(struct ssdfs_thread_state *state,
+			     struct ssdfs_inode_filter *inode_filter)
+{
+	/* ranges array is shared by threads in read-only mode */
+	memcpy(&state->inode_filter, inode_filter,
+		sizeof(struct ssdfs_inode_filter));
+}
+
 static inline
 void ssdfs_init_item_descriptors(struct ssdfs_thread_state *state)
 {
@@ -171,7 +324,8 @@ int ssdfs_init_thread_state(struct ssdfs_thread_state *state,
 			    u32 logs_count,
 			    const char *output_folder,
 			    int output_fd,
-			    struct ssdfs_time_range *timestamp)
+			    struct ssdfs_time_range *timestamp,
+			    struct ssdfs_inode_filter *inode_filter)
 {
 	int err;
 
@@ -190,11 +344,55 @@ int ssdfs_init_thread_state(struct ssdfs_thread_state *state,
 	ssdfs_init_folder_descriptors(state, output_folder, output_fd);
 	ssdfs_init_file_descriptors(state);
 	ssdfs_init_timestamp(state, timestamp);
+	ssdfs_init_inode_filter(state, inode_filter);
 	ssdfs_init_item_descriptors(state);
 
 	return 0;
 }
 
+/*
+ * is_inode_filter_applied() - check that only some inodes are requested
+ * @filter: inode IDs filter
+ */
+static inline
+int is_inode_filter_applied(struct ssdfs_inode_filter *filter)
+{
+	return filter->count > 0;
+}
+
+/*
+ * is_inode_requested() - check that inode should be recovered
+ * @filter: inode IDs filter
+ * @ino: inode ID
+ *
+ * Empty filter means that any inode is requested.
+ */
+static inline
+int is_inode_requested(struct ssdfs_inode_filter *filter, u64 ino)
+{
+	int lower = 0;
+	int upper;
+
+	if (filter->count <= 0)
+		return SSDFS_TRUE;
+
+	upper = filter->count - 1;
+
+	while (lower <= upper) {
+		int index = lower + ((upper - lower) / 2);
+		struct ssdfs_inode_id_range *range = &filter->ranges[index];
+
+		if (ino < range->start)
+			upper = index - 1;
+		else if (ino > range->end)
+			lower = index + 1;
+		else
+			return SSDFS_TRUE;
+	}
+
+	return SSDFS_FALSE;
+}
+
 static inline
 int IS_CONTENT_VALID(struct ssdfs_folder_environment *folder, int index)
 {
@@ -267,6 +465,18 @@ int IS_DOTDOT_FOLDER(struct ssdfs_folder_environment *folder, int index)
 	return SSDFS_FALSE;
 }
 
+static inline
+int IS_TRASH_FOLDER(struct ssdfs_folder_environment *folder, int index)
+{
+	BUG_ON(!IS_CONTENT_VALID(folder, index));
+
+	if (strcmp(FOLDER_NAME(folder, index),
+		   SSDFS_RECOVERFS_TRASH_FOLDER_NAME) == 0)
+		return SSDFS_TRUE;
+
+	return SSDFS_FALSE;
+}
+
 static inline
 int ssdfs_recoverfs_prepare_name_list(struct ssdfs_folder_environment *folder)
 {
@@ -303,9 +513,22 @@ void ssdfs_wait_threads_activity_ending(struct ssdfs_recoverfs_environment *env)
 
 /* Application APIs */
 
+/* checkpoint.c */
+int ssdfs_recoverfs_save_peb_range_checkpoint(struct ssdfs_thread_state *state,
+					      u64 next_peb, u64 end_peb);
+int ssdfs_recoverfs_load_peb_range_checkpoint(struct ssdfs_thread_state *state,
+					      u64 end_peb, u64 *next_peb);
+int ssdfs_recoverfs_save_stage_checkpoint(struct ssdfs_recoverfs_environment *env);
+int ssdfs_recoverfs_load_stage_checkpoint(struct ssdfs_recoverfs_environment *env);
+void ssdfs_recoverfs_delete_checkpoints(struct ssdfs_recoverfs_environment *env);
+
 /* delete_folder.c */
 int ssdfs_recoverfs_delete_folder(struct ssdfs_recoverfs_environment *env,
 				  const char *folder_name);
+int ssdfs_recoverfs_move_folder_to_trash(struct ssdfs_recoverfs_environment *env,
+					 const char *folder_name);
+int ssdfs_recoverfs_delete_trash(struct ssdfs_recoverfs_environment *env);
+int ssdfs_recoverfs_delete_trash_async(struct ssdfs_recoverfs_environment *env);
 
 /* file_synthesis.c */
 int ssdfs_recoverfs_build_files_in_folder(struct ssdfs_recoverfs_environment *env,
@@ -313,15 +536,16 @@ int ssdfs_recoverfs_build_files_in_folder(struct ssdfs_recoverfs_environment *en
 
 /* inline_files.c */
 int ssdfs_recoverfs_find_first_valid_node(struct ssdfs_recoverfs_environment *env,
-					  int fd,
+					  const u8 *content,
+					  u64 file_size,
 					  u32 *node_size,
 					  u32 *node_offset,
 					  u32 *nodes_count);
 int ssdfs_recoverfs_node_extract_inline_file(struct ssdfs_recoverfs_environment *env,
-					     int fd,
+					     const u8 *buffer,
 					     u32 node_offset,
-					     u32 node_size,
-					     u8 *buffer);
+					     u32 node_size);
+void *ssdfs_recoverfs_extract_inline_files_range(void *arg);
 
 /* options.c */
 void print_usage(void);